@@ -0,0 +1,81 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Vector.h"
+#include "cinder/audio/audio.h"
+#include "cinder/audio/dsp/Fft.h"
+
+#include "TripleBuffer.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace reza {
+namespace sound {
+
+struct AudioFrame {
+    static const int kSize = 512;
+    float mSpectrum[kSize]; // magnitude in decibels, normalized to 0 -> 1
+    float mWaveform[kSize]; // -1 -> 1
+    ci::vec4 mBands;        // bass, low mid, high mid, treble
+    float mLevel;           // rms
+};
+
+typedef std::shared_ptr<class AudioAnalyzer> AudioAnalyzerRef;
+class AudioAnalyzer {
+  public:
+    static AudioAnalyzerRef create()
+    {
+        return AudioAnalyzerRef( new AudioAnalyzer() );
+    }
+    ~AudioAnalyzer();
+
+    // Live capture from the default input device, analyzed on a worker thread
+    void startInput();
+    void stopInput();
+    bool isInputRunning() const { return mRunning; }
+
+    // Offline source, analyzed on demand at an exact sample position
+    bool loadFile( const ci::fs::path &path );
+    void clearFile();
+    bool hasFile() const { return mFileBuffer.size() > 0; }
+    void analyzeFile( double seconds );
+
+    void setGain( float gain ) { mGain = gain; }
+    float getSmoothing() const { return mSmoothing; }
+    void setSmoothing( float smoothing ) { mSmoothing = smoothing; }
+
+    // Main thread: picks up the newest analysis, returns true if it changed
+    bool update();
+    const AudioFrame &getFrame() const { return mFrames.getFront(); }
+
+  protected:
+    AudioAnalyzer();
+    void run();
+    void analyze( const float *samples, float sampleRate, bool smooth, AudioFrame &frame );
+
+    size_t mFftSize = 1024;
+    std::unique_ptr<ci::audio::dsp::Fft> mFft;
+    ci::audio::Buffer mWindow;
+    ci::audio::Buffer mWindowed;
+    ci::audio::BufferSpectral mSpectral;
+    std::vector<float> mMagnitudes;
+
+    ci::audio::InputDeviceNodeRef mInputNode;
+    ci::audio::MonitorNodeRef mMonitorNode;
+    std::thread mThread;
+    std::atomic<bool> mRunning;
+    std::atomic<float> mGain;
+    std::atomic<float> mSmoothing;
+
+    std::vector<float> mFileBuffer;
+    std::vector<float> mFileWindow; // the samples analyzeFile() hands to each FFT
+    float mFileSampleRate = 44100.0f;
+
+    sync::TripleBuffer<AudioFrame> mFrames;
+};
+
+} // namespace sound
+} // namespace reza
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "cinder/Color.h"
+#include "cinder/Matrix.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Texture.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace reza {
+namespace sparse {
+
+// Live output that shades only part of the pixels every frame and fills in the rest from
+// the frame before. The skipped pixels are masked in the depth buffer before the session
+// shader draws, so early depth testing rejects them without the shader having to know.
+// A missing pixel is reprojected into the previous frame along the camera model of
+// render.glsl and spheretrace.glsl, at the hit distance when the shader exports one as
+// aov.glsl's Z and at infinity otherwise, and clamped to the colors of its shaded
+// neighbours. Every pixel inside the focus region is shaded each frame.
+typedef std::shared_ptr<class Checkerboard> CheckerboardRef;
+class Checkerboard {
+  public:
+    enum Mode {
+        FULL = 0,
+        CHECKER = 1, // half the pixels, alternating like a checkerboard
+        ROWS = 2,    // every other row
+        QUARTER = 3  // one pixel of every 2x2 block
+    };
+
+    // What the session shader's iCamera uniforms were set to for a frame
+    struct Camera {
+        ci::mat3 mViewMatrix;
+        ci::vec3 mEyePoint = ci::vec3( 0.0f );
+        float mFov = 1.0f; // radians
+        float mAspect = 1.0f;
+        // Texcoords at the lower left and upper right corners of the frame
+        ci::vec2 mTexcoordMin = ci::vec2( 0.0f );
+        ci::vec2 mTexcoordMax = ci::vec2( 1.0f );
+    };
+
+    static CheckerboardRef create()
+    {
+        return CheckerboardRef( new Checkerboard() );
+    }
+
+    // Shades this frame's pixels with drawFn into a target of size pixels and reconstructs
+    // the whole frame from them. With depth set the hit distance is read from the shader's
+    // second output. A still frame shows exactly what the one before did, so the history
+    // is taken as it is and a few of them converge on the full resolution image.
+    void render( const ci::ivec2 &size, const Camera &camera, const ci::ColorA &background, bool depth, bool still, const std::function<void()> &drawFn );
+    ci::gl::Texture2dRef getTexture() const;
+
+    // Frames it takes to shade every pixel once
+    int getPhases() const;
+    // Drops the previous frame, e.g. after the shader changed
+    void reset() { mHistoryValid = false; }
+
+    void setMode( Mode mode );
+    Mode getMode() const { return mMode; }
+    // Center normalized with a top left origin, radius relative to the height, zero is off
+    void setFocus( const ci::vec2 &center, float radius );
+    // How strictly reprojected colors are kept within their neighbours' range, 0 to 1
+    void setClamp( float clamp ) { mClamp = clamp; }
+
+  protected:
+    Checkerboard();
+
+    Mode mMode = FULL;
+    ci::vec2 mFocusCenter = ci::vec2( 0.5f );
+    float mFocusRadius = 0.0f;
+    float mClamp = 1.0f;
+
+    ci::gl::FboRef mShadeFboRef;
+    bool mShadeDepth = false;
+    ci::gl::FboRef mFrameFboRefs[2];
+    int mLast = 0;
+    bool mHistoryValid = false;
+    Camera mPrevious;
+    uint32_t mFrame = 0;
+
+    ci::gl::GlslProgRef mMaskGlslProgRef;
+    ci::gl::GlslProgRef mResolveGlslProgRef;
+};
+
+} // namespace sparse
+} // namespace reza
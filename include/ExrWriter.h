@@ -0,0 +1,84 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Vector.h"
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace reza {
+namespace exr {
+
+// Streams an OpenEXR file to disk as it's rendered. Scanline files take rows top to
+// bottom and compress the blocks in them in parallel, tiled files take tiles in any order
+// and compress them on worker threads while the caller renders the next one, so neither
+// ever holds more than a few tiles of the image. Pixels are passed as interleaved floats in
+// the order of the format's channels and stored as half or full floats per channel.
+typedef std::shared_ptr<class ExrWriter> ExrWriterRef;
+class ExrWriter {
+  public:
+    enum Compression {
+        NONE = 0,
+        ZIPS = 2, // zlib, one scanline per block
+        ZIP = 3   // zlib, 16 scanlines per block
+    };
+
+    struct Channel {
+        std::string mName;
+        bool mHalf = true;
+    };
+
+    struct Format {
+        ci::ivec2 mSize = ci::ivec2( 0 );
+        ci::ivec2 mTileSize = ci::ivec2( 0 ); // zero for a scanline file
+        std::vector<Channel> mChannels;
+        Compression mCompression = ZIP;
+    };
+
+    // Returns nullptr if the file can't be opened
+    static ExrWriterRef create( const ci::fs::path &path, const Format &format );
+    ~ExrWriter();
+
+    // Scanline files, the next rows of the image, top first, in any number per call
+    void writeRows( const float *pixels, int rows );
+    // Tiled files, the tile at column x and row y of the grid, top left first. Edge tiles
+    // are cut to the image, pixels still has rows as wide as a full tile.
+    void writeTile( const ci::ivec2 &tile, const float *pixels );
+    // Waits for the tiles still compressing and completes the file, also done on destruction
+    void close();
+
+  protected:
+    ExrWriter( const ci::fs::path &path, const Format &format );
+    void writeHeader();
+    std::vector<uint8_t> encode( const float *pixels, int stride, int width, int rows ) const;
+    void writeChunk( const std::vector<int> &coordinates, const std::vector<uint8_t> &data, size_t index );
+    void drain( size_t count );
+
+    struct Pending {
+        ci::ivec2 mTile;
+        std::future<std::vector<uint8_t>> mData;
+    };
+
+    Format mFormat;
+    std::vector<int> mOrder; // channels sorted by name, as the file stores them
+    int mLinesPerBlock = 1;
+    std::ofstream mStream;
+    std::streamoff mOffsetsPosition = 0;
+    std::vector<uint64_t> mOffsets;
+    std::deque<Pending> mPending;
+    std::vector<float> mCarry;
+    size_t mMaxPending = 1;
+    int mRowsWritten = 0;
+    bool mClosed = false;
+};
+
+// Round to nearest even, overflow goes to infinity
+uint16_t toHalf( float value );
+
+} // namespace exr
+} // namespace reza
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace reza {
+namespace watch {
+
+// Watches a directory tree with the platform's own notifications (FSEvents on macOS,
+// inotify on Linux). Bursts of events are coalesced and only handed over once the tree
+// has been quiet for the debounce interval, so a save that touches several files or goes
+// through a rename arrives as a single change.
+typedef std::shared_ptr<class FileWatcher> FileWatcherRef;
+class FileWatcher {
+  public:
+    typedef std::function<void( const std::vector<ci::fs::path> & )> Callback;
+    static FileWatcherRef create( const ci::fs::path &root, const Callback &callback, double debounce = 0.05 )
+    {
+        return FileWatcherRef( new FileWatcher( root, callback, debounce ) );
+    }
+    ~FileWatcher();
+
+    // Main thread, calls back with the files that changed once a burst has settled
+    void update();
+
+    // Reports a path as changed without it being written, e.g. to run the first build
+    void touch( const ci::fs::path &path ) { push( path ); }
+
+    const ci::fs::path &getRoot() const { return mRoot; }
+
+  protected:
+    FileWatcher( const ci::fs::path &root, const Callback &callback, double debounce );
+    void start();
+    void stop();
+    void push( const ci::fs::path &path );
+
+    ci::fs::path mRoot;
+    Callback mCallback;
+    std::chrono::steady_clock::duration mDebounce;
+
+    std::mutex mMutex;
+    std::set<ci::fs::path> mPending;
+    std::chrono::steady_clock::time_point mLastEvent;
+
+#if defined( __APPLE__ )
+    void *mStream = nullptr;
+    void *mQueue = nullptr;
+#else
+    void run();
+    void addDirectory( const ci::fs::path &path );
+
+    int mInotify = -1;
+    int mWake[2] = { -1, -1 };
+    std::map<int, ci::fs::path> mDirectories;
+    std::thread mThread;
+    std::atomic<bool> mRunning;
+#endif
+};
+
+} // namespace watch
+} // namespace reza
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+namespace reza {
+namespace pace {
+
+// Decides when the output window draws and measures how long an input takes to reach the
+// screen. Just in time frames start by waiting on a fence behind the previous swap, so at
+// most one frame is queued and the time it went out is known. The other modes leave the
+// queueing to the driver and count a frame as presented when the loop comes back around.
+// Inputs are stamped when they arrive and latched right before the frame that reads them;
+// their latency runs to that frame's present.
+//   VSYNC         presents on the vertical blank, the swap paces the loop
+//   UNCAPPED      draws as fast as it can and presents right away, tearing
+//   ADAPTIVE      vsync while frames fit in a refresh, a late one tears instead of
+//                 waiting for the next blank
+//   JUST_IN_TIME  vsync, but the frame starts a fixed delay after the previous present,
+//                 so inputs are sampled as late as the render time allows
+typedef std::shared_ptr<class FramePacer> FramePacerRef;
+class FramePacer {
+  public:
+    enum Mode {
+        VSYNC = 0,
+        UNCAPPED = 1,
+        ADAPTIVE = 2,
+        JUST_IN_TIME = 3
+    };
+
+    static FramePacerRef create( double refreshRate )
+    {
+        return FramePacerRef( new FramePacer( refreshRate ) );
+    }
+
+    void setMode( Mode mode );
+    Mode getMode() const { return mMode; }
+    void setRefreshRate( double refreshRate ) { mPeriod = 1000.0 / refreshRate; }
+    // JUST_IN_TIME, milliseconds from a present to the start of the next frame. It is cut
+    // short when the slowest recent frame wouldn't fit in what is left of the refresh.
+    void setDelay( double milliseconds ) { mDelay = milliseconds; }
+
+    // What the presenting window should be set to, it changes on its own in ADAPTIVE
+    bool isVerticalSync() const { return mVerticalSync; }
+
+    // Main thread, with the output context current. beginFrame() at the top of the draw,
+    // just in time it blocks until the previous frame is on screen and then until this one
+    // is due. latchInputs() once the frame's inputs are read and endFrame() once it's drawn.
+    void beginFrame();
+    void latchInputs();
+    void endFrame();
+
+    // Main thread, whenever an input the output reads arrives
+    void markInput();
+
+    // Over the last second, in milliseconds. Latency is 0 while no input arrived.
+    double getLatency() const { return mLatency; }
+    double getMaxLatency() const { return mMaxLatency; }
+    double getFrameInterval() const { return mFrameInterval; }
+    // Presents that came a refresh or more late
+    int getMissedFrames() const { return mMissedFrames; }
+
+  protected:
+    typedef std::chrono::steady_clock Clock;
+
+    FramePacer( double refreshRate );
+    static double milliseconds( Clock::duration duration );
+    // Blocks until the GPU is through everything queued so far
+    static void waitForGpu();
+
+    Mode mMode = VSYNC;
+    double mPeriod;
+    double mDelay = 4.0;
+    bool mVerticalSync = true;
+    // Consecutive late frames with vsync on, and fast ones with it off, for ADAPTIVE
+    int mLateFrames = 0;
+    int mFastFrames = 0;
+
+    Clock::time_point mPresentTime;
+    Clock::time_point mFrameStart;
+    bool mPresented = false;
+    // Oldest input not yet read by a frame, and oldest input read by the frame in flight
+    Clock::time_point mInputTime;
+    Clock::time_point mFrameInputTime;
+    bool mInput = false;
+    bool mFrameInput = false;
+
+    // Slowest frame from its start to the GPU finishing it, over this and the last second
+    double mRenderTime = 0.0;
+    double mWindowRenderTime = 0.0;
+
+    Clock::time_point mWindowStart;
+    double mWindowLatency = 0.0;
+    double mWindowMaxLatency = 0.0;
+    int mWindowInputs = 0;
+    double mWindowInterval = 0.0;
+    int mWindowFrames = 0;
+    int mWindowMissed = 0;
+
+    double mLatency = 0.0;
+    double mMaxLatency = 0.0;
+    double mFrameInterval = 0.0;
+    int mMissedFrames = 0;
+};
+
+} // namespace pace
+} // namespace reza
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Json.h"
+#include "cinder/Vector.h"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace reza {
+namespace job {
+
+// Renders scripted from the command line or from JSON job files, run one after another in
+// the one process. Job files hold a JOBS array, each job an object with any of the keys
+// below, and optional DEFAULTS every job starts from. Relative paths are taken from the
+// job file's directory, or the working directory on the command line.
+//   NAME          shown in the log
+//   SESSION       session directory, the one loaded now when missing
+//   OUTPUT        file written, its extension picks png, jpg, tif or exr
+//   SIZE          [width, height] of the canvas, the output window's when missing
+//   SCALE         OUTPUT IMAGE SCALE
+//   FRAMES        [first, last], inclusive. More than one frame writes a sequence with
+//                 the frame number after the file name.
+//   TOTAL FRAMES  frames iAnimationTime runs over, FRAMES in the exporter when missing
+//   CAMERA        a cam.json
+//   PARAMS        {"name": value or [values]} set on the shader's widgets as they are,
+//                 [low, high] for a range and [r, g, b, a] for a color. The timeline
+//                 leaves these params alone while the job renders.
+// On the command line --jobs FILE adds a file's jobs, and --session, --output,
+// --size WxH, --scale N, --frames FIRST:LAST, --total N, --camera FILE and
+// --param NAME=V[,V...] describe one more. --quit leaves once every job is done, with
+// exit status 1 when a job was skipped or one of its frames failed to save.
+typedef std::shared_ptr<class JobQueue> JobQueueRef;
+class JobQueue {
+  public:
+    struct Job {
+        std::string mName;
+        ci::fs::path mSession;
+        ci::fs::path mOutput;
+        ci::ivec2 mSize = ci::ivec2( 0 );
+        int mScale = 0; // zero leaves it as it is, like mTotalFrames
+        int mFirstFrame = 0;
+        int mLastFrame = 0;
+        int mTotalFrames = 0;
+        ci::fs::path mCamera;
+        std::map<std::string, std::vector<float>> mParams;
+    };
+
+    static JobQueueRef create()
+    {
+        return JobQueueRef( new JobQueue() );
+    }
+
+    // Returns false and logs what was wrong when an argument or a file can't be used, the
+    // jobs that could be read are queued anyway
+    bool parseArgs( const std::vector<std::string> &args );
+    bool loadFile( const ci::fs::path &path );
+
+    bool isEmpty() const { return mJobs.empty(); }
+    size_t getNumJobs() const { return mJobs.size(); }
+    Job pop();
+    bool shouldQuit() const { return mQuit; }
+
+  protected:
+    JobQueue() {}
+    static bool parseJob( const ci::JsonTree &tree, const ci::fs::path &root, Job *job );
+    static ci::fs::path resolve( const ci::fs::path &root, const std::string &path );
+
+    std::deque<Job> mJobs;
+    bool mQuit = false;
+};
+
+} // namespace job
+} // namespace reza
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Texture.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace reza {
+namespace noise {
+
+// Tileable noise baked on first use for noisetex.glsl: 2D gradient noise with its
+// derivatives, 3D gradient noise, and 2D/3D cellular F1/F2. The volumes are generated on
+// every core with generate(), which is safe off the main thread, and upload() hands them
+// to the GPU as half floats.
+typedef std::shared_ptr<class NoiseTextures> NoiseTexturesRef;
+class NoiseTextures {
+  public:
+    // Lattice cells per tile and samples per cell of each texture
+    static const int kNoise2DPeriod = 32;
+    static const int kNoise2DSamples = 16;
+    static const int kNoise3DPeriod = 16;
+    static const int kNoise3DSamples = 8;
+    static const int kCellular2DPeriod = 32;
+    static const int kCellular2DSamples = 16;
+    static const int kCellular3DPeriod = 8;
+    static const int kCellular3DSamples = 8;
+
+    static NoiseTexturesRef create()
+    {
+        return NoiseTexturesRef( new NoiseTextures() );
+    }
+
+    void generate();
+    void upload();
+    // Binds iNoise2D, iNoise3D, iCellular2D and iCellular3D to unit and the three after it
+    void bind( const ci::gl::GlslProgRef &glsl, uint8_t unit );
+
+    bool isUploaded() const { return mNoise2DRef != nullptr; }
+    size_t getByteSize() const { return mByteSize; }
+
+  protected:
+    NoiseTextures() {}
+
+    std::vector<float> mNoise2D;
+    std::vector<float> mNoise3D;
+    std::vector<float> mCellular2D;
+    std::vector<float> mCellular3D;
+
+    ci::gl::Texture2dRef mNoise2DRef;
+    ci::gl::Texture3dRef mNoise3DRef;
+    ci::gl::Texture2dRef mCellular2DRef;
+    ci::gl::Texture3dRef mCellular3DRef;
+    size_t mByteSize = 0;
+};
+
+} // namespace noise
+} // namespace reza
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Osc.h"
+#include "cinder/Filesystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace reza {
+namespace rec {
+
+// Log layout (native endian): "FOSC" uint32 version, then records of
+// uint32 size | double seconds | uint16 address length | address | uint16 tag length | tags | arguments
+
+typedef std::shared_ptr<class OscRecorder> OscRecorderRef;
+class OscRecorder {
+  public:
+    static OscRecorderRef create( size_t capacity = 1 << 20 )
+    {
+        return OscRecorderRef( new OscRecorder( capacity ) );
+    }
+    ~OscRecorder();
+
+    bool start( const ci::fs::path &path );
+    void stop();
+    bool isRecording() const { return mRecording; }
+
+    // Called from the receiving thread. Never blocks or allocates: the message is
+    // encoded into a scratch buffer and copied into a single producer / single
+    // consumer ring that a writer thread drains to disk. There's one producer, so a
+    // call made while another is still running on a different thread is dropped.
+    void record( const ci::osc::Message &msg );
+
+    size_t getNumRecorded() const { return mNumRecorded; }
+    size_t getNumDropped() const { return mNumDropped; }
+
+  protected:
+    OscRecorder( size_t capacity );
+    void write();
+    void drain();
+
+    std::vector<uint8_t> mRing;
+    std::vector<uint8_t> mScratch;
+    std::atomic<size_t> mHead;
+    std::atomic<size_t> mTail;
+    std::atomic<bool> mRecording;
+    std::atomic<bool> mScratchBusy;
+    std::atomic<size_t> mNumRecorded;
+    std::atomic<size_t> mNumDropped;
+    std::chrono::steady_clock::time_point mStartTime;
+    std::thread mWriterThread;
+    FILE *mFile = nullptr;
+};
+
+typedef std::shared_ptr<class OscPlayer> OscPlayerRef;
+class OscPlayer {
+  public:
+    static OscPlayerRef create()
+    {
+        return OscPlayerRef( new OscPlayer() );
+    }
+
+    bool load( const ci::fs::path &path );
+    void clear();
+    bool isEmpty() const { return mEntries.empty(); }
+    double getDuration() const { return mEntries.empty() ? 0.0 : mEntries.back().mTime; }
+
+    void reset();
+    // Dispatches, in recorded order, every message stamped at or before time.
+    void update( double time, const std::function<void( const ci::osc::Message & )> &fn );
+
+  protected:
+    OscPlayer() {}
+    bool decode( size_t index, ci::osc::Message &msg ) const;
+
+    struct Entry {
+        double mTime;
+        size_t mOffset;
+        size_t mSize;
+    };
+
+    std::vector<uint8_t> mData;
+    std::vector<Entry> mEntries;
+    size_t mPosition = 0;
+};
+
+} // namespace rec
+} // namespace reza
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Rect.h"
+#include "cinder/app/Window.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Texture.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace reza {
+namespace proj {
+
+// One output of a multi projector setup. Each projector shows a sub rect of the shared
+// canvas in its own window, warped by a four corner keystone and faded out along its
+// edges where it overlaps its neighbours.
+typedef std::shared_ptr<class Projector> ProjectorRef;
+class Projector {
+  public:
+    struct Format {
+        std::string mName;
+        int mDisplay = 0;
+        bool mFullScreen = false;
+        ci::ivec2 mPos = ci::ivec2( 0 );
+        ci::ivec2 mSize = ci::ivec2( 1280, 720 );
+        ci::Rectf mRect = ci::Rectf( 0.0f, 0.0f, 1.0f, 1.0f );                                                  // canvas sub rect, normalized, top left origin
+        ci::vec2 mCorners[4] = { ci::vec2( 0.0f ), ci::vec2( 1.0f, 0.0f ), ci::vec2( 1.0f ), ci::vec2( 0.0f, 1.0f ) }; // ul, ur, lr, ll in the window, normalized
+        ci::vec4 mBlend = ci::vec4( 0.0f );                                                                    // left, right, top, bottom overlap widths, normalized
+        float mBlendPower = 2.0f;
+        float mGamma = 2.2f;
+    };
+
+    // Reads the OUTPUTS array and CANVAS size of outputs.json
+    static std::vector<Format> load( const ci::fs::path &path, ci::ivec2 &canvasSize );
+
+    static ProjectorRef create( const Format &format, const std::function<ci::gl::Texture2dRef()> &canvasFn )
+    {
+        return ProjectorRef( new Projector( format, canvasFn ) );
+    }
+    ~Projector();
+
+    ci::app::WindowRef getWindow() const { return mWindowRef; }
+    const Format &getFormat() const { return mFormat; }
+
+  protected:
+    Projector( const Format &format, const std::function<ci::gl::Texture2dRef()> &canvasFn );
+    void draw();
+
+    Format mFormat;
+    std::function<ci::gl::Texture2dRef()> mCanvasFn;
+    ci::app::WindowRef mWindowRef;
+    ci::mat3 mInverseWarp;
+    ci::gl::GlslProgRef mGlslProgRef;
+};
+
+} // namespace proj
+} // namespace reza
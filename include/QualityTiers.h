@@ -0,0 +1,139 @@
+#pragma once
+
+#include "cinder/Display.h"
+#include "cinder/gl/Context.h"
+#include "cinder/gl/GlslProg.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace reza {
+namespace quality {
+
+// Specializations of the session shader with FRAGMENT_QUALITY defined as 0 (draft) to 3
+// (export), see quality.glsl. The live compile is the default tier, the others are built
+// on a worker thread with its own shared context and kept in a cache keyed by the
+// sources, so going back to an earlier edit or session doesn't compile them again.
+// Live output picks its tier from the GPU frame times it's fed, exports take the highest.
+typedef std::shared_ptr<class QualityTiers> QualityTiersRef;
+class QualityTiers {
+  public:
+    static const int kTiers = 4;
+    // What a shader compiles to when nothing defines FRAGMENT_QUALITY
+    static const int kDefaultTier = 2;
+
+    typedef std::function<ci::gl::GlslProgRef( const std::vector<std::string> &, const std::vector<std::string> & )> CompileFn;
+
+    // Main thread, the worker's context shares objects with the current one
+    static QualityTiersRef create( const CompileFn &compileFn )
+    {
+        return QualityTiersRef( new QualityTiers( compileFn ) );
+    }
+    ~QualityTiers();
+
+    // The display's nominal refresh in Hz, 60 when it doesn't report one. One refresh is
+    // the budget a live frame has.
+    static double getRefreshRate( const ci::DisplayRef &display );
+
+    // Takes the live program compiled from sources as the default tier and queues the rest.
+    // Shaders that never test FRAGMENT_QUALITY use the one program for every tier.
+    void setSources( const std::vector<std::string> &sources, const ci::gl::GlslProgRef &glsl );
+    void clear();
+
+    // Main thread, collects what the worker finished and returns true if a tier changed
+    bool update();
+
+    // Returns nullptr while the tier compiles or if it failed to. With wait set the call
+    // blocks until the worker is done with it, which is what exports need.
+    ci::gl::GlslProgRef getGlslProg( int tier, bool wait = false );
+    // The highest tier that compiled, waiting for the ones still compiling. nullptr until a
+    // shader compiles.
+    ci::gl::GlslProgRef getExportGlslProg();
+    int getExportTier();
+    // The tier live output should draw with, the nearest one below it that is ready
+    ci::gl::GlslProgRef getLiveGlslProg();
+
+    // Other passes of the sources compiled on the worker for a tier, each with its own define
+    // on top of the tier's. They go ahead of the tiers still queued and replace an earlier
+    // request that hasn't finished.
+    void compileVariants( int tier, const std::vector<std::string> &defines );
+    // Main thread, returns true once, when every variant of the last request is done. The
+    // programs are in the order of its defines, nullptr for any that failed to compile.
+    bool getVariants( int &tier, std::vector<ci::gl::GlslProgRef> &glsls );
+
+    // GPU time of a rendered live frame against the time a frame has. In auto mode a tier
+    // that runs over budget steps down, and one that leaves most of it unused steps up
+    // unless the next tier already proved too slow a moment ago.
+    void addFrameTime( double milliseconds, double budgetMilliseconds );
+    void setAuto( bool value ) { mAuto = value; }
+    bool isAuto() const { return mAuto; }
+    void setTier( int tier );
+    int getTier() const { return mTier; }
+    int getLiveTier() const { return mLiveTier; }
+    double getFrameTime() const { return mFrameTime; }
+    bool isSpecialized() const { return mSpecialized; }
+
+  protected:
+    QualityTiers( const CompileFn &compileFn );
+    void run();
+    void invalidateTimes();
+
+    struct Job {
+        size_t mKey;
+        int mTier;
+        uint64_t mGeneration;
+        std::shared_ptr<std::vector<std::string>> mSources;
+        std::vector<std::string> mDefines;
+        // 0 for the tiers themselves
+        uint64_t mRequest;
+        size_t mVariant;
+    };
+    struct Result {
+        Job mJob;
+        ci::gl::GlslProgRef mGlslProgRef;
+    };
+
+    CompileFn mCompileFn;
+    ci::gl::ContextRef mContextRef;
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mJobsCondition;
+    std::condition_variable mResultsCondition;
+    std::deque<Job> mJobs;
+    std::vector<Result> mResults;
+    bool mRunning = true;
+    uint64_t mGeneration = 0;
+
+    size_t mSourcesKey = 0;
+    std::shared_ptr<std::vector<std::string>> mSources;
+    bool mSpecialized = false;
+    ci::gl::GlslProgRef mGlslProgRefs[kTiers];
+    bool mPending[kTiers] = { false, false, false, false };
+    // Most recently used first
+    std::list<std::pair<size_t, ci::gl::GlslProgRef>> mCache;
+    static const size_t kCacheSize = 24;
+
+    uint64_t mRequest = 0;
+    int mVariantTier = kDefaultTier;
+    std::vector<ci::gl::GlslProgRef> mVariantRefs;
+    size_t mVariantsPending = 0;
+
+    bool mAuto = true;
+    int mTier = kDefaultTier;
+    int mLiveTier = kDefaultTier;
+    int mFrames = 0;
+    double mFrameTime = 0.0;
+    double mTierTimes[kTiers] = { 0.0, 0.0, 0.0, 0.0 };
+    double mTierTimestamps[kTiers] = { 0.0, 0.0, 0.0, 0.0 };
+};
+
+} // namespace quality
+} // namespace reza
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "asio/asio.hpp"
+#include "cinder/Surface.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/Pbo.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace reza {
+namespace remote {
+
+// Embedded HTTP server for watching and steering a session from another machine.
+//   GET /           a page with the preview and a control for every parameter
+//   GET /stream     the preview as MJPEG (multipart/x-mixed-replace)
+//   GET /frame.jpg  the latest preview frame
+//   GET /ws         WebSocket, receives the state whenever it changes and sends control
+//                   messages as text, which getMessages() hands to the main thread
+// It listens on loopback unless given another address, which also takes a token: every
+// request then has to carry it as ?token= (the page passes its own on). Without a token
+// only requests addressed to 127.0.0.1, localhost or [::1] are served, and WebSockets from
+// a page another origin served are turned away either way.
+// Networking runs on its own thread and JPEG encoding on another. Frames are only read
+// back while a stream client is connected and the encoder is idle, at most at the frame
+// rate and bandwidth set here. A frame that comes out while a client's socket is still
+// busy replaces the one waiting for it, so a slow client drops frames rather than falling
+// behind in time.
+typedef std::shared_ptr<class RemoteServer> RemoteServerRef;
+class RemoteServer {
+  public:
+    struct Format {
+        Format &width( int width )
+        {
+            mWidth = width;
+            return *this;
+        }
+        Format &fps( float fps )
+        {
+            mFps = fps;
+            return *this;
+        }
+        Format &kbps( int kbps )
+        {
+            mKbps = kbps;
+            return *this;
+        }
+        Format &quality( float quality )
+        {
+            mQuality = quality;
+            return *this;
+        }
+        Format &address( const std::string &address )
+        {
+            mAddress = address;
+            return *this;
+        }
+        Format &token( const std::string &token )
+        {
+            mToken = token;
+            return *this;
+        }
+
+        int mWidth = 640; // of the preview, the height follows the frame's aspect
+        float mFps = 30.0f;
+        int mKbps = 8000; // of the stream, larger frames come further apart
+        float mQuality = 0.7f;
+        std::string mAddress = "127.0.0.1";
+        std::string mToken; // required by any address but loopback
+    };
+
+    // Throws asio::system_error when the address can't be bound, std::invalid_argument when
+    // it isn't loopback and there is no token
+    static RemoteServerRef create( uint16_t port, const Format &format )
+    {
+        return RemoteServerRef( new RemoteServer( port, format ) );
+    }
+    ~RemoteServer();
+
+    uint16_t getPort() const { return mPort; }
+    const Format &getFormat() const { return mFormat; }
+    int getNumStreamClients() const { return mStreamClients; }
+    int getNumSocketClients() const { return mSocketClients; }
+
+    // Main thread, with the GL context current, once per frame. Starts an asynchronous read
+    // back of frame when a stream client is waiting for it and returns whether it did; the
+    // pixels are handed to the encoder on the following call, so the render never waits on
+    // them. Unchanged frames are only sent to clients that just connected.
+    bool capture( const ci::gl::FboRef &frame, bool changed );
+
+    // JSON sent to every WebSocket client when it changes and to new ones on connect
+    void setState( const std::string &state );
+    // Text messages received from WebSocket clients since the last call, oldest first
+    std::vector<std::string> getMessages();
+
+  protected:
+    RemoteServer( uint16_t port, const Format &format );
+
+    class Connection;
+    typedef std::shared_ptr<Connection> ConnectionRef;
+
+    bool wantsFrame();
+    void encode();
+    void accept();
+    void publishFrame( const std::shared_ptr<const std::string> &jpeg );
+    void publishState( const std::shared_ptr<const std::string> &state );
+    void receive( const std::string &message );
+
+    uint16_t mPort;
+    Format mFormat;
+
+    asio::io_service mIoService;
+    std::unique_ptr<asio::io_service::work> mWork;
+    asio::ip::tcp::acceptor mAcceptor;
+    std::thread mNetworkThread;
+
+    // Only touched on the network thread
+    std::vector<std::weak_ptr<Connection>> mConnections;
+    std::shared_ptr<const std::string> mState;
+
+    std::atomic<int> mStreamClients;
+    std::atomic<int> mSocketClients;
+    std::atomic<bool> mWaiting; // a client connected since the last frame went out
+    std::atomic<bool> mEncoding;
+
+    std::thread mEncoderThread;
+    std::mutex mEncoderMutex;
+    std::chrono::steady_clock::time_point mNextFrameTime;
+    std::condition_variable mEncoderCondition;
+    ci::Surface8u mPending;
+    bool mHasPending = false;
+    bool mRunning = true;
+
+    std::mutex mMessagesMutex;
+    std::vector<std::string> mMessages;
+    std::string mLastState;
+
+    ci::gl::FboRef mPreviewFboRef;
+    ci::gl::PboRef mPboRef;
+    ci::ivec2 mReadSize;
+    bool mReading = false;
+    bool mChanged = true;
+};
+
+} // namespace remote
+} // namespace reza
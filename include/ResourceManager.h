@@ -0,0 +1,117 @@
+#pragma once
+
+#include "cinder/Rect.h"
+#include "cinder/Surface.h"
+#include "cinder/gl/Batch.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/Texture.h"
+
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace reza {
+namespace res {
+
+// Counts the memory held by GL objects and images, by category, against a GPU and a CPU
+// budget. It also owns the framebuffers and rect batches the output draws with, so they
+// are reused rather than made again. A pooled framebuffer is handed out again once nobody
+// else holds it, and dropped after it has been idle for a whole trim() interval. A
+// category is expected to always ask for the same format. Exports check fits() before
+// taking a path that needs a whole image at once.
+typedef std::shared_ptr<class ResourceManager> ResourceManagerRef;
+class ResourceManager {
+  public:
+    enum Pool {
+        GPU = 0,
+        CPU = 1
+    };
+
+    struct Usage {
+        std::string mCategory;
+        Pool mPool;
+        size_t mBytes;
+    };
+
+    typedef std::function<ci::gl::FboRef( const ci::ivec2 & )> FboFn;
+
+    static ResourceManagerRef create()
+    {
+        return ResourceManagerRef( new ResourceManager() );
+    }
+
+    // Zero for no limit
+    void setBudget( Pool pool, size_t bytes ) { mBudgets[pool] = bytes; }
+    size_t getBudget( Pool pool ) const { return mBudgets[pool]; }
+    size_t getBytes( Pool pool );
+    // Whether bytes more would still be inside the pool's budget. What the replacing
+    // category holds now is left out, since it's about to be reused or released.
+    bool fits( Pool pool, size_t bytes, const std::string &replacing = "" );
+    // Every category that holds anything, largest first
+    std::vector<Usage> getUsage();
+
+    // Main thread, with the output context current. A framebuffer of the category that
+    // nobody holds any more, or one made with createFn when none is the right size.
+    ci::gl::FboRef getFbo( const std::string &category, const ci::ivec2 &size, const FboFn &createFn );
+    ci::gl::FboRef getFbo( const std::string &category, const ci::ivec2 &size, const ci::gl::Fbo::Format &format );
+    // The category's rect batch for glsl. When only the rect or the texcoords changed its
+    // vertices are rewritten in place. Corners go in the order of geom::Rect::texCoords().
+    ci::gl::BatchRef getRect( const std::string &category, const ci::gl::GlslProgRef &glsl, const ci::Rectf &rect, const ci::vec2 &ul, const ci::vec2 &ur, const ci::vec2 &lr, const ci::vec2 &ll );
+    // Drops pooled framebuffers that stayed idle since the last call
+    void trim();
+
+    // Counted for as long as the object lives, tracking it again does nothing
+    void track( const std::string &category, const ci::gl::Texture2dRef &texture );
+    void track( const std::string &category, const ci::gl::FboRef &fbo );
+    void track( const std::string &category, const ci::Surface8uRef &surface );
+    // For subsystems that keep count of their own memory
+    void addSource( const std::string &category, Pool pool, const std::function<size_t()> &bytesFn );
+
+    static size_t getTexelBytes( GLenum internalFormat );
+    static size_t getByteSize( const ci::gl::Texture2dRef &texture );
+    // Color attachments only, renderbuffers aren't counted
+    static size_t getByteSize( const ci::gl::FboRef &fbo );
+
+  protected:
+    ResourceManager() {}
+    void track( const std::string &category, Pool pool, const std::shared_ptr<const void> &owner, size_t bytes );
+    void prune();
+
+    struct Tracked {
+        std::string mCategory;
+        Pool mPool;
+        std::weak_ptr<const void> mOwner;
+        size_t mBytes;
+    };
+
+    struct Source {
+        std::string mCategory;
+        Pool mPool;
+        std::function<size_t()> mBytesFn;
+    };
+
+    struct PooledFbo {
+        std::string mCategory;
+        ci::gl::FboRef mFbo;
+        bool mIdle = false;
+    };
+
+    struct PooledRect {
+        ci::gl::GlslProgRef mGlsl;
+        ci::gl::BatchRef mBatch;
+        ci::Rectf mRect;
+        std::array<ci::vec2, 4> mTexcoords;
+    };
+
+    std::vector<Tracked> mTracked;
+    std::vector<Source> mSources;
+    std::vector<PooledFbo> mFbos;
+    std::map<std::string, PooledRect> mRects;
+    size_t mBudgets[2] = { 0, 0 };
+};
+
+} // namespace res
+} // namespace reza
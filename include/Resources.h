@@ -9,11 +9,24 @@
 #define WORKING_PATH "Working"
 
 #define SHADERS_PATH "Shaders"
+#define PALETTES_PATH "Palettes"
 #define SETTINGS_PATH ""
 #define TUTORIALS_PATH "Tutorials"
 #define EXAMPLES_PATH "Examples"
+#define THUMBNAILS_PATH "Thumbnails"
 
 #define CAMERA_PATH "cam.json"
+#define TIMELINE_PATH "timeline.json"
+#define OSC_LOG_PATH "osc.log"
+#define OSC_STATE_PATH "Osc"
+#define AUDIO_PATH "audio.json"
+#define SNAPSHOT_PATH "session.snapshot"
+#define STARTUP_PATH "startup.json"
+#define CLEAN_SHUTDOWN_PATH "clean.shutdown"
+#define OUTPUTS_PATH "outputs.json"
+#define SWEEP_PATH "sweep.json"
+#define ANALYSIS_PATH "analysis.json"
+#define REMOTE_PATH "remote.json"
 
 #define APP_UI "fragment"
 #define SHADER_UI "params"
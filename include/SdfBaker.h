@@ -0,0 +1,53 @@
+#pragma once
+
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Texture.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace reza {
+namespace bake {
+
+// Evaluates the static part of a scene (BAKE_SDF in sdfbake.glsl) over a 3D grid into a
+// half float volume that shaders sample instead. The bake program is the session shader
+// compiled with SDF_BAKE_PASS, drawn once per slice of the grid. The sparse layout keeps
+// only the bricks near the surface in an atlas and a single distance for every other one.
+typedef std::shared_ptr<class SdfBaker> SdfBakerRef;
+class SdfBaker {
+  public:
+    static const int kBrickSize = 8;
+
+    static SdfBakerRef create()
+    {
+        return SdfBakerRef( new SdfBaker() );
+    }
+    ~SdfBaker();
+
+    // uniformsFn sets everything else the program reads before each slice is drawn
+    void bake( const ci::gl::GlslProgRef &glsl, int resolution, bool sparse, const std::function<void( const ci::gl::GlslProgRef & )> &uniformsFn );
+    // Binds the volume (and the brick table of a sparse bake) from unit onwards, returns
+    // the number of units used
+    int bind( const ci::gl::GlslProgRef &glsl, uint8_t unit );
+    void clear();
+
+    bool isBaked() const { return mVolumeRef != nullptr; }
+    size_t getByteSize() const { return mByteSize; }
+    double getBakeSeconds() const { return mBakeSeconds; }
+
+  protected:
+    SdfBaker() {}
+    ci::gl::Texture3dRef render( const ci::gl::GlslProgRef &glsl, int resolution, const std::function<void( const ci::gl::GlslProgRef & )> &uniformsFn );
+    void pack( const ci::gl::Texture3dRef &dense, int resolution );
+
+    ci::gl::Texture3dRef mVolumeRef;
+    ci::gl::Texture3dRef mBricksRef;
+    GLuint mFbo = 0;
+    size_t mByteSize = 0;
+    double mBakeSeconds = 0.0;
+};
+
+} // namespace bake
+} // namespace reza
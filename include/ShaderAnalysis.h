@@ -0,0 +1,83 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace reza {
+namespace analysis {
+
+// Static cost estimate of a fragment shader, run on the source after includes are resolved.
+// The shader is preprocessed with the given defines, split into functions and every
+// function's body counted: arithmetic, builtins weighted by what they roughly cost, texture
+// fetches and calls to other functions, all multiplied by the trip counts of the loops
+// around them. Calls are followed from main to get how often each function runs per
+// pixel, and that times its own cost is what the hot spots are ranked by. Both sides of a
+// branch are counted and loops run to their bound, so the numbers are an upper bound.
+typedef std::shared_ptr<class ShaderAnalysis> ShaderAnalysisRef;
+class ShaderAnalysis {
+  public:
+    // One texture fetch costs this many arithmetic ops in the totals
+    static const int kTextureWeight = 8;
+    // Trips assumed for loops whose bound isn't a constant
+    static const int kUnknownTrips = 16;
+
+    struct Function {
+        std::string mName; // name( parameter types )
+        int mLine = 0;
+        double mAlu = 0.0; // per call, without the functions it calls
+        double mTexture = 0.0;
+        double mCalls = 0.0; // per pixel
+        double mShare = 0.0; // of the pixel's cost, 0 to 1
+        // Calls to other functions per call of this one, most first
+        std::vector<std::pair<std::string, double>> mFanOut;
+    };
+
+    struct Loop {
+        std::string mFunction;
+        int mLine = 0;
+        double mTrips = 0.0;
+        bool mConstant = true; // false when the trip count is kUnknownTrips
+    };
+
+    // defines are "NAME VALUE" or "NAME", as if they came before the source
+    static ShaderAnalysisRef create( const std::string &source, const std::vector<std::string> &defines = {} )
+    {
+        return ShaderAnalysisRef( new ShaderAnalysis( source, defines ) );
+    }
+
+    // Functions main reaches, by share of the cost, highest first
+    const std::vector<Function> &getFunctions() const { return mFunctions; }
+    const std::vector<Loop> &getLoops() const { return mLoops; }
+    // Expensive builtins inside loops, loops without a constant bound
+    const std::vector<std::string> &getWarnings() const { return mWarnings; }
+    // Weighted ops per pixel, see kTextureWeight
+    double getCost() const { return mCost; }
+    double getTextureFetches() const { return mTextureFetches; }
+    const std::vector<std::string> &getDefines() const { return mDefines; }
+
+    // Measured GPU time of a frame, split over the hot spots by their share
+    void setGpuMilliseconds( double milliseconds ) { mGpuMilliseconds = milliseconds; }
+    double getGpuMilliseconds() const { return mGpuMilliseconds; }
+
+    // Lines for the console, the top count hot spots with their fan out, then the warnings
+    std::vector<std::string> getSummary( size_t count ) const;
+    // The JSON analysis.json is written with
+    std::string serialize() const;
+
+  protected:
+    ShaderAnalysis( const std::string &source, const std::vector<std::string> &defines );
+
+    std::vector<std::string> mDefines;
+    std::vector<Function> mFunctions;
+    std::vector<Loop> mLoops;
+    std::vector<std::string> mWarnings;
+    double mCost = 0.0;
+    double mTextureFetches = 0.0;
+    double mGpuMilliseconds = 0.0;
+};
+
+} // namespace analysis
+} // namespace reza
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace reza {
+namespace snap {
+
+// Builds the payload of one chunk
+class ChunkWriter {
+  public:
+    template <typename T>
+    void write( const T &value )
+    {
+        mBytes.append( reinterpret_cast<const char *>( &value ), sizeof( T ) );
+    }
+    void writeString( const std::string &value )
+    {
+        write<uint32_t>( uint32_t( value.size() ) );
+        mBytes.append( value );
+    }
+    const std::string &getBytes() const { return mBytes; }
+
+  protected:
+    std::string mBytes;
+};
+
+// Reads a chunk payload in place; every read fails once the data runs out
+class ChunkReader {
+  public:
+    ChunkReader( const char *data, size_t size )
+        : mPtr( data ), mEnd( data + size )
+    {
+    }
+    template <typename T>
+    bool read( T &value )
+    {
+        if( size_t( mEnd - mPtr ) < sizeof( T ) ) {
+            mPtr = mEnd;
+            mGood = false;
+            return false;
+        }
+        memcpy( &value, mPtr, sizeof( T ) );
+        mPtr += sizeof( T );
+        return true;
+    }
+    bool readString( std::string &value )
+    {
+        uint32_t size = 0;
+        if( !read( size ) || size_t( mEnd - mPtr ) < size ) {
+            mPtr = mEnd;
+            mGood = false;
+            return false;
+        }
+        value.assign( mPtr, size );
+        mPtr += size;
+        return true;
+    }
+    bool isGood() const { return mGood; }
+    bool isEnd() const { return mPtr >= mEnd; }
+
+  protected:
+    const char *mPtr;
+    const char *mEnd;
+    bool mGood = true;
+};
+
+// A whole session in one versioned file of tagged chunks:
+//   "FSNP" | uint32 version | { uint32 tag | uint32 size | bytes }*
+// Files are memory mapped on load and written atomically through a temporary file, and
+// a save is skipped entirely when no chunk changed since the last one.
+typedef std::shared_ptr<class Snapshot> SnapshotRef;
+class Snapshot {
+  public:
+    static SnapshotRef create()
+    {
+        return SnapshotRef( new Snapshot() );
+    }
+    ~Snapshot();
+
+    static const uint32_t kVersion = 1;
+    static uint32_t tag( const char *name ) { return uint32_t( name[0] ) | uint32_t( name[1] ) << 8 | uint32_t( name[2] ) << 16 | uint32_t( name[3] ) << 24; }
+
+    // Returns true if the chunk differs from what the snapshot already holds
+    bool setChunk( uint32_t tag, const std::string &bytes );
+    bool hasChunk( uint32_t tag ) const { return mChunks.find( tag ) != mChunks.end(); }
+    ChunkReader getChunk( uint32_t tag ) const;
+
+    bool isDirty() const { return mDirty; }
+    // Saving is skipped when nothing changed since the snapshot was last written to or read from path
+    bool save( const ci::fs::path &path );
+    bool load( const ci::fs::path &path );
+    // Releases the mapping once the chunks have been read
+    void close();
+    // Drops every chunk, for a snapshot that turned out unusable. The next save writes it all.
+    void clear();
+
+  protected:
+    Snapshot() {}
+
+    struct Chunk {
+        const char *mData;
+        size_t mSize;
+    };
+    std::map<uint32_t, Chunk> mChunks;
+    std::map<uint32_t, std::string> mOwned;
+    bool mDirty = false;
+    ci::fs::path mPath;
+
+    void *mMapping = nullptr;
+    size_t mMappingSize = 0;
+};
+
+} // namespace snap
+} // namespace reza
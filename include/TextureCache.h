@@ -0,0 +1,85 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Surface.h"
+#include "cinder/gl/Pbo.h"
+#include "cinder/gl/Texture.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reza {
+namespace tex {
+
+// Textures decoded on worker threads and streamed to the GPU through pixel buffer
+// objects. Lives for the whole app, so sessions that share images share textures.
+typedef std::shared_ptr<class TextureCache> TextureCacheRef;
+class TextureCache {
+  public:
+    static TextureCacheRef create( int numThreads = 2 )
+    {
+        return TextureCacheRef( new TextureCache( numThreads ) );
+    }
+    ~TextureCache();
+
+    // Returns nullptr until the texture is resident. With wait set the call blocks until
+    // the image is decoded and uploaded, which is what exports need to be frame exact.
+    ci::gl::Texture2dRef get( const ci::fs::path &path, bool wait = false );
+    void prefetch( const ci::fs::path &path );
+
+    // Main thread, uploads whatever the workers finished since the last call and
+    // returns true if any texture changed
+    bool update();
+
+    void clear();
+    size_t getNumTextures() const { return mTextures.size(); }
+    size_t getByteSize() const { return mByteSize; }
+
+    // Least recently used textures are released once the cache grows past this
+    void setByteBudget( size_t bytes ) { mByteBudget = bytes; }
+
+  protected:
+    TextureCache( int numThreads );
+    void run();
+    void request( const std::string &key, const ci::fs::path &path, std::time_t modified );
+    // Files are stat'ed at most once a second, force checks now
+    std::time_t getModified( const std::string &key, const ci::fs::path &path, bool force = false );
+    void upload( const std::string &key, const ci::Surface8uRef &surface );
+    void evict();
+
+    struct Entry {
+        ci::gl::Texture2dRef mTexture;
+        std::time_t mModified;
+        size_t mBytes;
+        uint64_t mLastUsed;
+    };
+
+    std::map<std::string, Entry> mTextures;
+    std::map<std::string, std::time_t> mFailed; // modification time of files that didn't decode
+    std::map<std::string, std::time_t> mPending;
+    // Modification time of each file and when it was last checked
+    std::map<std::string, std::pair<std::chrono::steady_clock::time_point, std::time_t>> mModified;
+    std::deque<std::pair<std::string, ci::fs::path>> mJobs;
+    std::vector<std::pair<std::string, ci::Surface8uRef>> mResults;
+    std::mutex mMutex;
+    std::condition_variable mJobsCondition;
+    std::condition_variable mResultsCondition;
+    std::vector<std::thread> mThreads;
+    bool mRunning = true;
+
+    ci::gl::PboRef mPboRef;
+    size_t mByteSize = 0;
+    size_t mByteBudget = size_t( 1024 ) * 1024 * 1024;
+    uint64_t mFrame = 0;
+};
+
+} // namespace tex
+} // namespace reza
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "NoiseTextures.h"
+#include "cinder/Filesystem.h"
+#include "cinder/Surface.h"
+#include "cinder/gl/Context.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Texture.h"
+
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace reza {
+namespace thumb {
+
+// Previews of sessions that aren't loaded, for the Examples and Tutorials browsers. A
+// worker thread with its own shared context reads a session's shaders and params, resolves
+// the includes and hashes the lot; a strip of kFrames frames at evenly spaced animation
+// times is rendered only when no PNG with that hash is in the cache directory yet. Editing
+// a session or an include it uses changes the hash, nothing else invalidates a thumbnail.
+// A shader that samples noise before the environment has any is shown but not cached, and
+// made again once an environment with noise is set.
+// Shaders are compiled at the draft quality tier and the worker yields between frames, so
+// it stays out of the way of the live output. It holds still while paused.
+typedef std::shared_ptr<class ThumbnailCache> ThumbnailCacheRef;
+class ThumbnailCache {
+  public:
+    static const int kFrames = 4;
+
+    typedef std::function<ci::gl::GlslProgRef( const std::vector<std::string> &, const std::vector<std::string> & )> CompileFn;
+
+    // What every session shader reads besides its own params
+    struct Environment {
+        ci::gl::Texture2dRef mPalettes;
+        std::vector<ci::vec4> mPaletteTable;
+        reza::noise::NoiseTexturesRef mNoiseTextures;
+        uint8_t mNoiseUnit = 2; // thumbnails bind no channels or passes, so noise follows the audio unit
+        float mFov = 45.0f; // degrees
+    };
+
+    // Main thread, the worker's context shares objects with the current one. includes is
+    // searched after the session's own Shaders and Shaders/Common directories.
+    static ThumbnailCacheRef create( const ci::fs::path &directory, const ci::fs::path &includes, int size, const CompileFn &compileFn )
+    {
+        return ThumbnailCacheRef( new ThumbnailCache( directory, includes, size, compileFn ) );
+    }
+    ~ThumbnailCache();
+
+    void setEnvironment( const Environment &environment );
+    // Queues a session, urgent ones go before the rest. A key requested before is skipped
+    // until a file of its session is newer than it was then, so asking again is cheap.
+    void request( const std::string &key, const ci::fs::path &session, bool urgent = false );
+    void setPaused( bool paused );
+
+    // Main thread, uploads what the worker finished and returns true if a thumbnail changed
+    bool update();
+    // True while a thumbnail waits for an environment with noise
+    bool isWaitingForNoise();
+    // The strip of frames side by side, nullptr until it's ready
+    ci::gl::Texture2dRef get( const std::string &key ) const;
+
+  protected:
+    ThumbnailCache( const ci::fs::path &directory, const ci::fs::path &includes, int size, const CompileFn &compileFn );
+    void run();
+    ci::Surface8uRef make( const ci::fs::path &session, bool &complete );
+    ci::Surface8uRef render( const std::vector<std::string> &sources, const std::string &params, const Environment &environment, bool &complete );
+
+    struct Job {
+        std::string mKey;
+        ci::fs::path mSession;
+    };
+
+    ci::fs::path mDirectory;
+    ci::fs::path mIncludes;
+    int mSize;
+    CompileFn mCompileFn;
+    ci::gl::ContextRef mContextRef;
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Job> mJobs;
+    std::vector<Job> mWaiting; // drawn without the noise they sample
+    std::vector<std::pair<std::string, ci::Surface8uRef>> mResults;
+    Environment mEnvironment;
+    bool mPaused = false;
+    bool mRunning = true;
+
+    std::map<std::string, ci::gl::Texture2dRef> mTextures;
+    // Main thread, newest file time of each key's session when it was last queued
+    std::map<std::string, std::time_t> mRequested;
+};
+
+} // namespace thumb
+} // namespace reza
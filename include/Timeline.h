@@ -0,0 +1,103 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace reza {
+namespace timeline {
+
+// The easing families mirror Common/easing.glsl so a curve authored against the
+// shader helpers looks the same when it is driven from the timeline.
+enum class Ease {
+    STEP,
+    LINEAR,
+    IN_QUAD,
+    OUT_QUAD,
+    IN_OUT_QUAD,
+    IN_CUBIC,
+    OUT_CUBIC,
+    IN_OUT_CUBIC,
+    IN_QUART,
+    OUT_QUART,
+    IN_OUT_QUART,
+    IN_QUINT,
+    OUT_QUINT,
+    IN_OUT_QUINT,
+    IN_SINE,
+    OUT_SINE,
+    IN_OUT_SINE,
+    IN_EXPO,
+    OUT_EXPO,
+    IN_OUT_EXPO,
+    IN_CIRC,
+    OUT_CIRC,
+    IN_OUT_CIRC,
+    IN_ELASTIC,
+    OUT_ELASTIC,
+    IN_OUT_ELASTIC,
+    IN_BACK,
+    OUT_BACK,
+    IN_OUT_BACK,
+    IN_BOUNCE,
+    OUT_BOUNCE,
+    IN_OUT_BOUNCE
+};
+
+Ease getEase( const std::string &name );
+std::string getEaseName( Ease ease );
+float ease( Ease type, float t );
+
+struct Key {
+    float mTime;
+    float mValue;
+    Ease mEase; // interpolation from this key to the next one
+};
+
+struct Track {
+    std::string mName; // same addressing as OSC, i.e. "params/speed" or "params/color/2"
+    std::vector<Key> mKeys;
+};
+
+typedef std::shared_ptr<class Timeline> TimelineRef;
+class Timeline {
+  public:
+    static TimelineRef create()
+    {
+        return TimelineRef( new Timeline() );
+    }
+
+    void load( const ci::fs::path &path );
+    void save( const ci::fs::path &path );
+
+    void addKey( const std::string &name, float time, float value, Ease ease = Ease::IN_OUT_QUAD );
+    void clear();
+    bool isEmpty() const { return mTracks.empty(); }
+
+    const std::vector<Track> &getTracks() const { return mTracks; }
+    size_t getNumTracks() const { return mTracks.size(); }
+
+    // Bakes every track into a flat table of samples over the animation range (0 -> 1),
+    // evaluate() is then a lerp per track and never allocates. Tracks with a STEP key are
+    // evaluated from their keys so the step stays sharp.
+    void compile();
+    void evaluate( float time, float *results ) const;
+
+    void setResolution( int resolution );
+    int getResolution() const { return mResolution; }
+
+  protected:
+    Timeline() {}
+    float sample( const Track &track, float time ) const;
+
+    std::vector<Track> mTracks;
+    std::vector<float> mSamples;
+    std::vector<char> mStepped; // per track
+    int mResolution = 2048;
+    bool mCompiled = false;
+};
+
+} // namespace timeline
+} // namespace reza
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace reza {
+namespace sync {
+
+// Single writer / single reader hand-off of the latest value. The writer never waits on
+// the reader and the reader always gets the most recent complete value; neither side locks.
+template <typename T>
+class TripleBuffer {
+  public:
+    TripleBuffer()
+        : mMiddle( 1 ), mBack( 2 ), mFront( 0 )
+    {
+    }
+
+    // Writer side
+    T &getBack() { return mBuffers[mBack]; }
+    void publish()
+    {
+        uint8_t previous = mMiddle.exchange( uint8_t( mBack | kDirty ), std::memory_order_acq_rel );
+        mBack = uint8_t( previous & kIndex );
+    }
+
+    // Reader side, returns true when a newer value has been swapped in
+    bool update()
+    {
+        if( !( mMiddle.load( std::memory_order_acquire ) & kDirty ) ) {
+            return false;
+        }
+        uint8_t previous = mMiddle.exchange( mFront, std::memory_order_acq_rel );
+        mFront = uint8_t( previous & kIndex );
+        return true;
+    }
+    const T &getFront() const { return mBuffers[mFront]; }
+
+  protected:
+    static const uint8_t kIndex = 0x3;
+    static const uint8_t kDirty = 0x4;
+
+    T mBuffers[3];
+    std::atomic<uint8_t> mMiddle;
+    uint8_t mBack;
+    uint8_t mFront;
+};
+
+} // namespace sync
+} // namespace reza
@@ -9,6 +9,18 @@ vec3 permute(vec3 x) {
 }
 
 
+#ifdef FRAGMENT_NOISE_TEXTURE
+#include "noisetex.glsl"
+
+vec2 cellular(vec2 P) {
+  return cellularTex(P);
+}
+
+vec2 cellular(vec3 P) {
+  return cellularTex(P);
+}
+#else
+
 // Cellular noise, returning F1 and F2 in a vec2.
 // Standard 3x3 search window for good F1 and F2 values
 vec2 cellular(vec2 P) {
@@ -216,3 +228,4 @@ vec2 cellular(vec3 P) {
 	return sqrt(d11.xy); // F1, F2
 #endif
 }
+#endif
@@ -1,13 +1,20 @@
 #include "noise3D.glsl"
 #include "noise2D.glsl"
+#include "quality.glsl"
+
+// Lower quality tiers drop the finest octaves, the export tier adds one
+#ifndef FBM_OCTAVE_BIAS
+#define FBM_OCTAVE_BIAS QUALITY( -2, -1, 0, 1 )
+#endif
 
 float fbm(in vec2 v, int octaves)
 {
 	float res = 0.0;
 	float scale = 1.0;
-	for(int i=0; i<8; i++)
+	int count = octaves > 0 ? max(min(octaves, 8) + FBM_OCTAVE_BIAS, 1) : 0;
+	for(int i=0; i<9; i++)
 	{
-		if(i >= octaves) break;
+		if(i >= count) break;
 		res += snoise(v) * scale;
 		v *= vec2(2.0, 2.0);
 		scale *= 0.5;
@@ -19,9 +26,10 @@ float fbm(in vec3 v, int octaves)
 {
 	float res = 0.0;
 	float scale = 1.0;
-	for(int i=0; i<8; i++)
+	int count = octaves > 0 ? max(min(octaves, 8) + FBM_OCTAVE_BIAS, 1) : 0;
+	for(int i=0; i<9; i++)
 	{
-		if(i >= octaves) break;
+		if(i >= count) break;
 		res += snoise(v) * scale;
 		v *= vec3(2.0, 2.0, 2.0);
 		scale *= 0.5;
@@ -34,9 +42,10 @@ float fbm_abs(in vec2 v, int octaves)
 {
 	float res = 0.0;
 	float scale = 1.0;
-	for(int i=0; i<8; i++)
+	int count = octaves > 0 ? max(min(octaves, 8) + FBM_OCTAVE_BIAS, 1) : 0;
+	for(int i=0; i<9; i++)
 	{
-		if(i >= octaves) break;
+		if(i >= count) break;
 		res += abs(snoise(v)) * scale;
 		v *= vec2(2.0, 2.0);
 		scale *= 0.5;
@@ -48,9 +57,10 @@ float fbm_abs(in vec3 v, int octaves)
 {
 	float res = 0.0;
 	float scale = 1.0;
-	for(int i=0; i<8; i++)
+	int count = octaves > 0 ? max(min(octaves, 8) + FBM_OCTAVE_BIAS, 1) : 0;
+	for(int i=0; i<9; i++)
 	{
-		if(i >= octaves) break;
+		if(i >= count) break;
 		res += abs(snoise(v)) * scale;
 		v *= vec3(2.0, 2.0, 2.0);
 		scale *= 0.5;
@@ -24,6 +24,13 @@ vec3 permute(vec3 x) {
   return n2mod289(((x*34.0)+1.0)*x);
 }
 
+#ifdef FRAGMENT_NOISE_TEXTURE
+#include "noisetex.glsl"
+
+float snoise(vec2 v) {
+  return snoiseTex(v);
+}
+#else
 float snoise(vec2 v)
   {
   const vec4 C = vec4(0.211324865405187,  // (3.0-sqrt(3.0))/6.0
@@ -72,3 +79,4 @@ float snoise(vec2 v)
   g.yz = a0.yz * x12.xz + h.yz * x12.yw;
   return 130.0 * dot(m, g);
 }
+#endif
@@ -0,0 +1,42 @@
+// Noise looked up from textures Fragment generates the first time a shader samples them
+// instead of computed in ALU. Define FRAGMENT_NOISE_TEXTURE before including noise2D.glsl, noise3D.glsl,
+// cellular.glsl or fbm.glsl and their snoise and cellular switch over to these.
+//
+// Each lookup is a single filtered fetch, in exchange the noise is gradient noise rather
+// than simplex, repeats every PERIOD units and is linearly interpolated between samples:
+//   snoiseTex( vec2 )     32 unit tile, 16 samples per unit, derivatives in snoiseTexGrad
+//   snoiseTex( vec3 )     16 unit tile,  8 samples per unit
+//   cellularTex( vec2 )   32 unit tile, 16 samples per unit, F1 and F2
+//   cellularTex( vec3 )    8 unit tile,  8 samples per unit, F1 and F2
+// Octaves much finer than the samples blur out, keep those in ALU.
+
+#ifndef NOISETEX_GLSL
+#define NOISETEX_GLSL
+
+uniform sampler2D iNoise2D;
+uniform sampler3D iNoise3D;
+uniform sampler2D iCellular2D;
+uniform sampler3D iCellular3D;
+
+float snoiseTex( vec2 p ) {
+  return texture( iNoise2D, p / 32.0 ).r;
+}
+
+// Value, d/dx and d/dy
+vec3 snoiseTexGrad( vec2 p ) {
+  return texture( iNoise2D, p / 32.0 ).rgb;
+}
+
+float snoiseTex( vec3 p ) {
+  return texture( iNoise3D, p / 16.0 ).r;
+}
+
+vec2 cellularTex( vec2 p ) {
+  return texture( iCellular2D, p / 32.0 ).rg;
+}
+
+vec2 cellularTex( vec3 p ) {
+  return texture( iCellular3D, p / 8.0 ).rg;
+}
+
+#endif
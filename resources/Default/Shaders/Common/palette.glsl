@@ -0,0 +1,8 @@
+// Palette 0 is Assets/palettes.png, palettes 1 -> N are the pngs in the session's
+// Shaders/Palettes folder in name order. t runs along a gradient and row picks one of
+// the gradients stacked in that image, 0 being the top one and 1 the bottom one.
+vec3 palette( int index, float t, float row )
+{
+    vec4 entry = iPaletteTable[clamp( index, 0, iPaletteCount - 1 )];
+    return texture( iPalettes, vec2( t, mix( entry.x, entry.y, row ) ) ).rgb;
+}
@@ -4,11 +4,17 @@ uniform vec3 iCameraEyePoint;
 uniform mat3 iModelMatrix;
 uniform float iCameraFov;
 
+#include "quality.glsl"
+
+#ifndef RENDER_STEPS
+#define RENDER_STEPS QUALITY( 50, 100, 150, 600 )
+#endif
+
 float castRay( in vec3 ro, in vec3 rd ) {
     float maxd = 100.0; // ray marching distance max
     float s = maxd;
     float d = 0.0;
-    for( int i = 0; i < 150; i++ ) {
+    for( int i = 0; i < RENDER_STEPS; i++ ) {
         if( s < 0.0001 ||  s > maxd ) break;
         s = scene( ro + rd * d );
         d += s * 0.25;
@@ -29,6 +35,9 @@ vec3 calcNormal( in vec3 pos ) {
 vec3 render( in vec3 ro, in vec3 rd ) {
   float t = castRay( ro, rd );
   vec3 pos = ro + t * rd;
+#ifdef FRAGMENT_AOV_EXPORT
+  oAov = vec4( t, calcNormal( pos ) );
+#endif
   return vec3( clamp( dot( calcNormal( pos ), normalize( ro - pos ) ), 0.0, 1.0 ) );
   return calcNormal( pos );
 }
@@ -0,0 +1,76 @@
+// Bakes the static part of a scene into a 3D texture, so it costs one texture lookup per
+// step instead of a full evaluation. Define the function and its bounds, then include:
+//
+//   float rocks( vec3 p ) { ... }
+//   #define BAKE_SDF rocks
+//   #define BAKE_BOUNDS vec4( 0.0, 0.0, 0.0, 2.0 )  // center, half extent of the grid
+//   #define BAKE_RESOLUTION 128                      // optional, samples per axis
+//   #define BAKE_SPARSE                              // optional, keep only surface bricks
+//   #include "sdfbake.glsl"
+//
+//   float scene( vec3 p ) { return min( bakedSdf( p ), movingParts( p ) ); }
+//
+// Fragment rebakes whenever the shader compiles or a param changes, params that BAKE_SDF
+// reads are fine, time is not. Close to the surface the grid is too coarse to shade from,
+// so bakedSdf evaluates BAKE_SDF there. Declare oColor before the include, the bake pass
+// writes its samples to it.
+
+#ifndef BAKE_RESOLUTION
+#define BAKE_RESOLUTION 128
+#endif
+
+#ifndef BAKE_BAND
+#define BAKE_BAND 2.0 // voxels around the surface that use BAKE_SDF
+#endif
+
+#define BAKE_BRICK 8
+
+uniform sampler3D iBakedSdf;
+uniform sampler3D iBakedSdfBricks;
+
+#ifdef SDF_BAKE_PASS
+
+uniform float iBakeSlice;
+uniform float iBakeResolution;
+
+float bakedSdf( vec3 p ) {
+    return BAKE_SDF( p );
+}
+
+// Distances are stored in units of the half extent
+void main() {
+    vec3 uvw = vec3( gl_FragCoord.xy, iBakeSlice + 0.5 ) / iBakeResolution;
+    vec3 p = BAKE_BOUNDS.xyz + ( uvw * 2.0 - 1.0 ) * BAKE_BOUNDS.w;
+    oColor = vec4( BAKE_SDF( p ) / BAKE_BOUNDS.w );
+}
+
+// The session's own main is compiled but never runs in this pass
+#define main fragmentMain
+
+#else
+
+float sampleBakedSdf( vec3 uvw ) {
+#ifdef BAKE_SPARSE
+    vec3 resolution = vec3( textureSize( iBakedSdfBricks, 0 ) * BAKE_BRICK );
+    vec3 g = clamp( uvw * resolution - 0.5, vec3( 0.0 ), resolution - 1.0 );
+    ivec3 brick = min( ivec3( g ) / BAKE_BRICK, textureSize( iBakedSdfBricks, 0 ) - 1 );
+    vec4 entry = texelFetch( iBakedSdfBricks, brick, 0 );
+    if( entry.a < 0.5 ) return entry.r;
+    vec3 local = g - vec3( brick * BAKE_BRICK );
+    return texture( iBakedSdf, ( entry.xyz * float( BAKE_BRICK + 1 ) + local + 0.5 ) / vec3( textureSize( iBakedSdf, 0 ) ) ).r;
+#else
+    return texture( iBakedSdf, uvw ).r;
+#endif
+}
+
+float bakedSdf( vec3 p ) {
+    vec3 uvw = ( p - BAKE_BOUNDS.xyz ) / ( 2.0 * BAKE_BOUNDS.w ) + 0.5;
+    vec3 inside = clamp( uvw, 0.0, 1.0 );
+    // Outside the grid the distance to it is added to the value on its boundary
+    float d = ( sampleBakedSdf( inside ) + length( ( uvw - inside ) * 2.0 ) ) * BAKE_BOUNDS.w;
+    float band = BAKE_BAND * 2.0 * BAKE_BOUNDS.w / float( BAKE_RESOLUTION );
+    if( d < band ) return BAKE_SDF( p );
+    return d;
+}
+
+#endif
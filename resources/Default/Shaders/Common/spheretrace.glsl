@@ -0,0 +1,191 @@
+// Accelerated drop in for render.glsl, include it after your scene( vec3 ) function.
+//
+// castRay is enhanced sphere tracing (Keinert et al. 2014): steps are over-relaxed and
+// fall back to plain sphere tracing as soon as two unbounding spheres stop overlapping.
+// calcNormal samples the scene four times instead of six, and rays that miss the
+// bounding sphere never march at all.
+//
+// Optional defines, set them before the include:
+//   SPHERETRACE_BOUNDS     vec4( center, radius ) enclosing the whole scene
+//   SPHERETRACE_STEPS      maximum number of steps, 150 at the default quality tier
+//   SPHERETRACE_PRECISION  how far off a hit may be in pixels, 1.0 at the default tier
+//   SPHERETRACE_MAX        maximum ray distance, 100.0
+//   SPHERETRACE_RELAXATION over-relaxation factor, 1.6 (1.0 disables it)
+//   SPHERETRACE_DEPTH_PREPASS seeds every ray from a low resolution depth prepass
+//
+// Include aov.glsl first to export the hit distance and normal with .exr saves.
+//
+// With SPHERETRACE_DEPTH_PREPASS, Fragment first renders the shader at a quarter of the
+// resolution with SPHERETRACE_PREPASS defined. That pass cone traces each block of
+// pixels and writes how far every ray in it can safely skip, the full pass starts there.
+// The prepass relies on scene() never overestimating the distance to the surface, and
+// writes its distances from a main() of its own, so declare oColor and vTexcoord before
+// the include. It's off by default: it only saves marching on scenes without
+// SPHERETRACE_BOUNDS, and with bounds set its extra pass can cost more than it saves.
+// Compare "GPU MS" in analysis.json with and without it before turning it on.
+
+uniform mat3 iCameraViewMatrix;
+uniform vec3 iCameraPivotPoint;
+uniform vec3 iCameraEyePoint;
+uniform mat3 iModelMatrix;
+uniform float iCameraFov;
+
+#ifdef SPHERETRACE_DEPTH_PREPASS
+uniform sampler2D iDepthPrepass;
+uniform vec2 iDepthPrepassSize;
+#endif
+
+#include "quality.glsl"
+
+#ifndef SPHERETRACE_STEPS
+#define SPHERETRACE_STEPS QUALITY( 64, 100, 150, 400 )
+#endif
+
+#ifndef SPHERETRACE_PRECISION
+#define SPHERETRACE_PRECISION QUALITY( 4.0, 2.0, 1.0, 0.5 )
+#endif
+
+#ifndef SPHERETRACE_MAX
+#define SPHERETRACE_MAX 100.0
+#endif
+
+#ifndef SPHERETRACE_RELAXATION
+#define SPHERETRACE_RELAXATION 1.6
+#endif
+
+#define SPHERETRACE_PREPASS_SCALE 4
+
+// Entry and exit distance along the ray, x > y when it misses
+vec2 traceBounds( in vec3 ro, in vec3 rd ) {
+#ifdef SPHERETRACE_BOUNDS
+    vec3 oc = ro - SPHERETRACE_BOUNDS.xyz;
+    float b = dot( oc, rd );
+    float c = dot( oc, oc ) - SPHERETRACE_BOUNDS.w * SPHERETRACE_BOUNDS.w;
+    float h = b * b - c;
+    if( h < 0.0 ) return vec2( 1.0, 0.0 );
+    h = sqrt( h );
+    return vec2( max( -b - h, 0.0 ), min( -b + h, SPHERETRACE_MAX ) );
+#else
+    return vec2( 0.0, SPHERETRACE_MAX );
+#endif
+}
+
+// Half the angle covered by one pixel of a viewport that is height pixels tall
+float pixelRadius( in float height ) {
+    return SPHERETRACE_PRECISION / ( height * tan( iCameraFov ) );
+}
+
+// Returns the hit distance, or a value past SPHERETRACE_MAX on a miss
+float castRay( in vec3 ro, in vec3 rd, in float tmin, in float tmax, in float pixel ) {
+    float omega = SPHERETRACE_RELAXATION;
+    float t = tmin;
+    float prevRadius = 0.0;
+    float stepLength = 0.0;
+    float candidateT = SPHERETRACE_MAX + 1.0;
+    float candidateError = 1e32;
+    for( int i = 0; i < SPHERETRACE_STEPS; i++ ) {
+        float radius = scene( ro + rd * t );
+        bool sorFail = omega > 1.0 && ( abs( radius ) + prevRadius ) < stepLength;
+        if( sorFail ) {
+            stepLength -= omega * stepLength;
+            omega = 1.0;
+        }
+        else {
+            stepLength = radius * omega;
+        }
+        prevRadius = abs( radius );
+        float error = prevRadius / max( t, 0.0001 );
+        if( !sorFail && error < candidateError ) {
+            candidateT = t;
+            candidateError = error;
+        }
+        if( ( !sorFail && ( error < pixel || prevRadius < 0.0001 ) ) || t > tmax ) break;
+        t += stepLength;
+    }
+    return ( candidateError < pixel || candidateError * candidateT < 0.0001 ) ? candidateT : SPHERETRACE_MAX + 1.0;
+}
+
+// Marches a cone as wide as a prepass pixel and stops before anything could enter it,
+// so every ray inside can start at the returned distance
+float castCone( in vec3 ro, in vec3 rd, in float tmin, in float tmax, in float cone ) {
+    float t = tmin;
+    for( int i = 0; i < SPHERETRACE_STEPS; i++ ) {
+        float radius = scene( ro + rd * t );
+        float width = cone * t;
+        if( radius < width || t > tmax ) break;
+        t += ( radius - width ) / ( 1.0 + cone );
+    }
+    return min( t, tmax );
+}
+
+float castRay( in vec3 ro, in vec3 rd ) {
+    vec2 bounds = traceBounds( ro, rd );
+    if( bounds.x > bounds.y ) return SPHERETRACE_MAX + 1.0;
+    float pixel = pixelRadius( iResolution.y );
+#if defined( SPHERETRACE_DEPTH_PREPASS ) && !defined( SPHERETRACE_PREPASS )
+    if( iDepthPrepassSize.x > 0.0 ) {
+        ivec2 texel = ivec2( gl_FragCoord.xy ) / SPHERETRACE_PREPASS_SCALE;
+        bounds.x = max( bounds.x, texelFetch( iDepthPrepass, texel, 0 ).r );
+        pixel = pixelRadius( iDepthPrepassSize.y * float( SPHERETRACE_PREPASS_SCALE ) );
+    }
+#endif
+    return castRay( ro, rd, bounds.x, bounds.y, pixel );
+}
+
+// Tetrahedral gradient, four scene evaluations instead of six
+vec3 calcNormal( in vec3 pos ) {
+    const vec2 k = vec2( 1.0, -1.0 );
+    const float h = 0.001;
+    return normalize(
+        k.xyy * scene( pos + k.xyy * h ) +
+        k.yyx * scene( pos + k.yyx * h ) +
+        k.yxy * scene( pos + k.yxy * h ) +
+        k.xxx * scene( pos + k.xxx * h ) );
+}
+
+vec3 render( in vec3 ro, in vec3 rd ) {
+    float t = castRay( ro, rd );
+#ifdef FRAGMENT_AOV_EXPORT
+    oAov = vec4( SPHERETRACE_MAX, vec3( 0.0 ) );
+#endif
+    if( t > SPHERETRACE_MAX ) return vec3( 0.0 );
+    vec3 pos = ro + t * rd;
+    vec3 normal = calcNormal( pos );
+#ifdef FRAGMENT_AOV_EXPORT
+    oAov = vec4( t, normal );
+#endif
+    return vec3( clamp( dot( normal, normalize( ro - pos ) ), 0.0, 1.0 ) );
+}
+
+void cameraRay( in vec2 tc, out vec3 ro, out vec3 rd ) {
+  vec2 p = -1.0 + 2.0 * tc;
+  p.x *= iAspect;
+
+  ro = iCameraEyePoint * 2.5;
+  rd = normalize( vec3( p.xy, - tan( iCameraFov ) ) ) * iCameraViewMatrix;
+  rd *= iModelMatrix;
+  ro *= iModelMatrix;
+}
+
+vec3 render( in vec2 tc ) {
+  vec3 ro, rd;
+  cameraRay( tc, ro, rd );
+  vec3 col = render( ro, rd );
+  return col;
+}
+
+#ifdef SPHERETRACE_PREPASS
+// The R32F target gets the distance itself, nothing the session's main does to its color
+// can reach it
+void main() {
+    vec3 ro, rd;
+    cameraRay( vTexcoord, ro, rd );
+    vec2 bounds = traceBounds( ro, rd );
+    // Half the diagonal of a prepass pixel, padded
+    float cone = pixelRadius( iDepthPrepassSize.y ) * 1.5;
+    oColor = vec4( bounds.x > bounds.y ? SPHERETRACE_MAX : castCone( ro, rd, bounds.x, bounds.y, cone ) );
+}
+
+// The session's own main is compiled but never runs in this pass
+#define main fragmentMain
+#endif
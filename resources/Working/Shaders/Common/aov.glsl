@@ -0,0 +1,29 @@
+// Gives a shader a second output with four extra channels (arbitrary output values) that
+// Fragment writes next to RGBA when an image or sequence is saved as .exr. Include it
+// before render.glsl or spheretrace.glsl and their render( ro, rd ) fills it with the hit
+// distance and the world space normal. AOV_NAMES names the channels in the file, in order,
+// define it before the include to write something else:
+//
+//   #define AOV_NAMES P.X P.Y P.Z ID
+//   #include "aov.glsl"
+//   ...
+//   #ifdef FRAGMENT_AOV_EXPORT
+//   oAov = vec4( pos, material );
+//   #endif
+//
+// Fragment defines FRAGMENT_AOV_EXPORT only in the variant that renders .exr files, and
+// in the one checkerboarding reprojects with when the first channel is Z. Everything else
+// compiles the writes and whatever only they need out.
+
+#ifndef AOV_GLSL
+#define AOV_GLSL
+
+#define FRAGMENT_AOV
+
+#ifndef AOV_NAMES
+#define AOV_NAMES Z N.X N.Y N.Z
+#endif
+
+out vec4 oAov;
+
+#endif
@@ -30,6 +30,13 @@ vec4 taylorInvSqrt(vec4 r)
   return 1.79284291400159 - 0.85373472095314 * r;
 }
 
+#ifdef FRAGMENT_NOISE_TEXTURE
+#include "noisetex.glsl"
+
+float snoise(vec3 v) {
+  return snoiseTex(v);
+}
+#else
 float snoise(vec3 v)
   {
   const vec2  C = vec2(1.0/6.0, 1.0/3.0) ;
@@ -104,3 +111,4 @@ float snoise(vec3 v)
   return 42.0 * dot( m*m, vec4( dot(p0,x0), dot(p1,x1),
                                 dot(p2,x2), dot(p3,x3) ) );
   }
+#endif
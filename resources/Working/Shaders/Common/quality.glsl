@@ -0,0 +1,30 @@
+// FRAGMENT_QUALITY says how much work a shader may spend per pixel, from 0 (draft) to
+// 3 (export). Fragment compiles every tier of shaders that test it: live output switches
+// between them to hold its frame rate and image exports always use tier 3. Without the
+// define a shader gets tier 2, which is what the includes cost before there were tiers.
+//
+//   #include "quality.glsl"
+//   for( int i = 0; i < QUALITY( 32, 64, 100, 300 ); i++ ) { ... }
+//   #if FRAGMENT_QUALITY >= 3
+//   col = supersample( tc );
+//   #endif
+
+#ifndef QUALITY_GLSL
+#define QUALITY_GLSL
+
+#ifndef FRAGMENT_QUALITY
+#define FRAGMENT_QUALITY 2
+#endif
+
+// Picks the argument that belongs to the current tier
+#if FRAGMENT_QUALITY <= 0
+#define QUALITY( draft, low, normal, best ) draft
+#elif FRAGMENT_QUALITY == 1
+#define QUALITY( draft, low, normal, best ) low
+#elif FRAGMENT_QUALITY == 2
+#define QUALITY( draft, low, normal, best ) normal
+#else
+#define QUALITY( draft, low, normal, best ) best
+#endif
+
+#endif
@@ -6,3 +6,8 @@ uniform vec4 iMouse;
 uniform vec4 iBackgroundColor;
 uniform vec4 iDate;
 uniform sampler2D iPalettes;
+uniform vec4 iPaletteTable[16]; // per palette: first row, last row (atlas v), rows
+uniform int iPaletteCount;
+uniform sampler2D iAudio; // row 0: spectrum, row 1: waveform
+uniform vec4 iAudioBands; // bass, low mid, high mid, treble
+uniform float iAudioLevel;
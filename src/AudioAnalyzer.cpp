@@ -0,0 +1,182 @@
+#include "AudioAnalyzer.h"
+
+#include "cinder/DataSource.h"
+#include "cinder/Log.h"
+#include "cinder/audio/Utilities.h"
+#include "cinder/audio/dsp/Dsp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace sound {
+
+AudioAnalyzer::AudioAnalyzer()
+    : mFft( new audio::dsp::Fft( mFftSize ) ), mWindow( mFftSize ), mWindowed( mFftSize ), mSpectral( mFftSize ), mMagnitudes( mFftSize / 2, 0.0f ), mRunning( false ), mGain( 1.0f ), mSmoothing( 0.5f ), mFileWindow( mFftSize )
+{
+    audio::dsp::generateWindow( audio::dsp::WindowType::BLACKMAN, mWindow.getData(), mFftSize );
+}
+
+AudioAnalyzer::~AudioAnalyzer()
+{
+    stopInput();
+}
+
+void AudioAnalyzer::startInput()
+{
+    if( mRunning ) {
+        return;
+    }
+    auto ctx = audio::Context::master();
+    mInputNode = ctx->createInputDeviceNode();
+    mMonitorNode = ctx->makeNode( new audio::MonitorNode( audio::MonitorNode::Format().windowSize( mFftSize ) ) );
+    mInputNode >> mMonitorNode;
+    mInputNode->enable();
+    ctx->enable();
+
+    std::fill( mMagnitudes.begin(), mMagnitudes.end(), 0.0f );
+    mRunning = true;
+    mThread = thread( &AudioAnalyzer::run, this );
+}
+
+void AudioAnalyzer::stopInput()
+{
+    if( !mRunning ) {
+        return;
+    }
+    mRunning = false;
+    if( mThread.joinable() ) {
+        mThread.join();
+    }
+    mInputNode->disable();
+    mInputNode->disconnectAll();
+    mInputNode = nullptr;
+    mMonitorNode = nullptr;
+}
+
+void AudioAnalyzer::run()
+{
+    float sampleRate = float( audio::Context::master()->getSampleRate() );
+    auto hop = chrono::duration<double>( double( mFftSize / 2 ) / sampleRate );
+    auto next = chrono::steady_clock::now();
+    while( mRunning ) {
+        // MonitorNode copies out of its lock-free ring, so this never blocks the audio thread
+        const audio::Buffer &buffer = mMonitorNode->getBuffer();
+        AudioFrame &frame = mFrames.getBack();
+        analyze( buffer.getChannel( 0 ), sampleRate, true, frame );
+        mFrames.publish();
+
+        next += chrono::duration_cast<chrono::steady_clock::duration>( hop );
+        this_thread::sleep_until( next );
+    }
+}
+
+bool AudioAnalyzer::loadFile( const fs::path &path )
+{
+    clearFile();
+    try {
+        auto source = audio::load( ci::loadFile( path ) );
+        auto buffer = source->loadBuffer();
+        size_t frames = buffer->getNumFrames();
+        size_t channels = buffer->getNumChannels();
+        mFileBuffer.assign( frames, 0.0f );
+        for( size_t c = 0; c < channels; c++ ) {
+            const float *channel = buffer->getChannel( c );
+            for( size_t i = 0; i < frames; i++ ) {
+                mFileBuffer[i] += channel[i] / float( channels );
+            }
+        }
+        mFileSampleRate = float( source->getSampleRate() );
+        return true;
+    }
+    catch( const ci::Exception &exc ) {
+        CI_LOG_E( "Error loading audio file: " << path << " " << exc.what() );
+    }
+    return false;
+}
+
+void AudioAnalyzer::clearFile()
+{
+    mFileBuffer.clear();
+}
+
+void AudioAnalyzer::analyzeFile( double seconds )
+{
+    if( mRunning || mFileBuffer.empty() ) {
+        return;
+    }
+
+    // Smoothing is replayed over a fixed number of hops ending at the requested sample, so
+    // the result only depends on the time asked for and never on how frames were spaced.
+    const int history = 4;
+    long hop = long( mFftSize / 2 );
+    long end = long( std::round( seconds * double( mFileSampleRate ) ) );
+    AudioFrame &frame = mFrames.getBack();
+    std::fill( mMagnitudes.begin(), mMagnitudes.end(), 0.0f );
+    for( int h = history; h >= 0; h-- ) {
+        long start = end - long( mFftSize ) - h * hop;
+        for( size_t i = 0; i < mFftSize; i++ ) {
+            long index = start + long( i );
+            mFileWindow[i] = ( index >= 0 && index < long( mFileBuffer.size() ) ) ? mFileBuffer[index] : 0.0f;
+        }
+        analyze( mFileWindow.data(), mFileSampleRate, true, frame );
+    }
+    mFrames.publish();
+}
+
+bool AudioAnalyzer::update()
+{
+    return mFrames.update();
+}
+
+void AudioAnalyzer::analyze( const float *samples, float sampleRate, bool smooth, AudioFrame &frame )
+{
+    float gain = mGain;
+    float smoothing = smooth ? float( mSmoothing ) : 0.0f;
+
+    audio::dsp::mul( samples, mWindow.getData(), mWindowed.getData(), mFftSize );
+    audio::dsp::mul( mWindowed.getData(), gain, mWindowed.getData(), mFftSize );
+    mFft->forward( &mWindowed, &mSpectral );
+
+    float *real = mSpectral.getReal();
+    float *imag = mSpectral.getImag();
+    imag[0] = 0.0f; // nyquist is packed into the first imaginary bin
+    const float magScale = 1.0f / float( mFftSize );
+    size_t bins = mMagnitudes.size();
+    for( size_t i = 0; i < bins; i++ ) {
+        float magnitude = sqrt( real[i] * real[i] + imag[i] * imag[i] ) * magScale;
+        mMagnitudes[i] = mMagnitudes[i] * smoothing + magnitude * ( 1.0f - smoothing );
+    }
+
+    // Spectrum and waveform are resampled to the fixed texture width
+    float level = 0.0f;
+    for( int i = 0; i < AudioFrame::kSize; i++ ) {
+        size_t bin = size_t( i ) * bins / AudioFrame::kSize;
+        frame.mSpectrum[i] = std::min( audio::linearToDecibel( mMagnitudes[bin] ) / 100.0f, 1.0f );
+        size_t sample = size_t( i ) * mFftSize / AudioFrame::kSize;
+        frame.mWaveform[i] = samples[sample] * gain;
+    }
+    for( size_t i = 0; i < mFftSize; i++ ) {
+        level += samples[i] * samples[i];
+    }
+    frame.mLevel = sqrt( level / float( mFftSize ) ) * gain;
+
+    const float edges[5] = { 20.0f, 250.0f, 2000.0f, 6000.0f, 20000.0f };
+    float binWidth = sampleRate / float( mFftSize );
+    for( int b = 0; b < 4; b++ ) {
+        size_t lo = std::min( size_t( edges[b] / binWidth ), bins - 1 );
+        size_t hi = std::max( std::min( size_t( edges[b + 1] / binWidth ), bins ), lo + 1 );
+        float energy = 0.0f;
+        for( size_t i = lo; i < hi; i++ ) {
+            energy += mMagnitudes[i] * mMagnitudes[i];
+        }
+        frame.mBands[b] = std::min( audio::linearToDecibel( sqrt( energy / float( hi - lo ) ) ) / 100.0f, 1.0f );
+    }
+}
+
+} // namespace sound
+} // namespace reza
@@ -0,0 +1,275 @@
+#include "Checkerboard.h"
+
+#include "cinder/Log.h"
+#include "cinder/gl/gl.h"
+
+#include <cmath>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace sparse {
+
+static const char *sVertex = R"(#version 150
+uniform mat4 ciModelViewProjection;
+in vec4 ciPosition;
+void main()
+{
+    gl_Position = ciModelViewProjection * ciPosition;
+}
+)";
+
+// Which pixels a frame shades, shared by the mask and the resolve
+static const char *sPattern = R"(
+uniform int uMode;
+uniform int uPhase;
+uniform vec3 uFocus;
+
+bool isShaded( ivec2 q )
+{
+    if( uFocus.z > 0.0 && distance( vec2( q ) + 0.5, uFocus.xy ) < uFocus.z ) {
+        return true;
+    }
+    if( uMode == 1 ) {
+        return ( ( q.x + q.y + uPhase ) & 1 ) == 0;
+    }
+    if( uMode == 2 ) {
+        return ( ( q.y + uPhase ) & 1 ) == 0;
+    }
+    // Diagonal pixels of the 2x2 blocks follow each other so every two frames cover a checkerboard
+    const int order[4] = int[4]( 0, 3, 1, 2 );
+    return ( q.x & 1 ) + 2 * ( q.y & 1 ) == order[uPhase & 3];
+}
+)";
+
+static const char *sMask = R"(
+out vec4 oColor;
+
+void main()
+{
+    if( isShaded( ivec2( gl_FragCoord.xy ) ) ) {
+        discard;
+    }
+    oColor = vec4( 0.0 );
+}
+)";
+
+static const char *sResolve = R"(
+uniform sampler2D uColor;
+uniform sampler2D uDepth;
+uniform sampler2D uHistory;
+uniform float uUseDepth;
+uniform float uUseHistory;
+uniform float uStill;
+uniform float uClamp;
+uniform vec2 uSize;
+uniform float uAspect;
+uniform vec4 uTexcoords;
+uniform mat3 uView;
+uniform vec3 uEye;
+uniform float uTanFov;
+uniform mat3 uPreviousView;
+uniform vec3 uPreviousEye;
+uniform float uPreviousTanFov;
+out vec4 oColor;
+
+// The rays of render.glsl and spheretrace.glsl, which start at 2.5 times the eye point
+vec3 rayDirection( vec2 uv )
+{
+    vec2 p = -1.0 + 2.0 * mix( uTexcoords.xy, uTexcoords.zw, uv );
+    p.x *= uAspect;
+    return normalize( vec3( p, -uTanFov ) ) * uView;
+}
+
+vec2 project( vec3 world )
+{
+    vec3 d = uPreviousView * normalize( world - uPreviousEye * 2.5 );
+    if( d.z >= 0.0 ) {
+        return vec2( -1.0 );
+    }
+    vec2 p = d.xy * ( uPreviousTanFov / -d.z );
+    p.x /= uAspect;
+    return ( ( p + 1.0 ) * 0.5 - uTexcoords.xy ) / ( uTexcoords.zw - uTexcoords.xy );
+}
+
+void main()
+{
+    ivec2 q = ivec2( gl_FragCoord.xy );
+    vec4 color = texelFetch( uColor, q, 0 );
+    if( isShaded( q ) ) {
+        oColor = color;
+        return;
+    }
+    if( uStill > 0.5 && uUseHistory > 0.5 ) {
+        oColor = texelFetch( uHistory, q, 0 );
+        return;
+    }
+
+    // Every 3x3 block holds shaded pixels in all modes
+    vec4 lo = vec4( 1e10 );
+    vec4 hi = vec4( -1e10 );
+    vec4 sum = vec4( 0.0 );
+    float weight = 0.0;
+    float t = 1e6;
+    ivec2 limit = ivec2( uSize ) - 1;
+    for( int y = -1; y <= 1; y++ ) {
+        for( int x = -1; x <= 1; x++ ) {
+            ivec2 n = clamp( q + ivec2( x, y ), ivec2( 0 ), limit );
+            if( !isShaded( n ) ) {
+                continue;
+            }
+            vec4 c = texelFetch( uColor, n, 0 );
+            float w = ( x == 0 || y == 0 ) ? 2.0 : 1.0;
+            lo = min( lo, c );
+            hi = max( hi, c );
+            sum += c * w;
+            weight += w;
+            if( uUseDepth > 0.5 ) {
+                t = min( t, texelFetch( uDepth, n, 0 ).r );
+            }
+        }
+    }
+    vec4 average = weight > 0.0 ? sum / weight : color;
+    if( uUseHistory < 0.5 || weight == 0.0 ) {
+        oColor = average;
+        return;
+    }
+    vec2 uv = ( vec2( q ) + 0.5 ) / uSize;
+    vec2 previous = project( uEye * 2.5 + rayDirection( uv ) * t );
+    if( any( lessThan( previous, vec2( 0.0 ) ) ) || any( greaterThan( previous, vec2( 1.0 ) ) ) ) {
+        oColor = average;
+        return;
+    }
+    vec4 history = texture( uHistory, previous );
+    oColor = mix( history, clamp( history, lo, hi ), uClamp );
+}
+)";
+
+Checkerboard::Checkerboard()
+{
+    string header = "#version 150\n";
+    try {
+        mMaskGlslProgRef = gl::GlslProg::create( gl::GlslProg::Format().vertex( sVertex ).fragment( header + sPattern + sMask ) );
+        mResolveGlslProgRef = gl::GlslProg::create( gl::GlslProg::Format().vertex( sVertex ).fragment( header + sPattern + sResolve ) );
+    }
+    catch( const ci::Exception &exc ) {
+        CI_LOG_E( "Checkerboard shader error: " << exc.what() );
+    }
+}
+
+void Checkerboard::setMode( Mode mode )
+{
+    if( mode != mMode ) {
+        mMode = mode;
+        mHistoryValid = false;
+    }
+}
+
+void Checkerboard::setFocus( const vec2 &center, float radius )
+{
+    mFocusCenter = center;
+    mFocusRadius = radius;
+}
+
+int Checkerboard::getPhases() const
+{
+    return mMode == QUARTER ? 4 : ( mMode == FULL ? 1 : 2 );
+}
+
+gl::Texture2dRef Checkerboard::getTexture() const
+{
+    return mFrameFboRefs[mLast] ? mFrameFboRefs[mLast]->getColorTexture() : nullptr;
+}
+
+void Checkerboard::render( const ivec2 &size, const Camera &camera, const ColorA &background, bool depth, bool still, const function<void()> &drawFn )
+{
+    if( !mMaskGlslProgRef || !mResolveGlslProgRef ) {
+        drawFn();
+        return;
+    }
+    if( !mShadeFboRef || mShadeFboRef->getSize() != size || mShadeDepth != depth ) {
+        auto texFmt = gl::Texture2d::Format().minFilter( GL_NEAREST ).magFilter( GL_NEAREST );
+        auto fboFmt = gl::Fbo::Format().colorTexture( texFmt );
+        if( depth ) {
+            fboFmt.attachment( GL_COLOR_ATTACHMENT1, gl::Texture2d::create( size.x, size.y, gl::Texture2d::Format().internalFormat( GL_R32F ).minFilter( GL_NEAREST ).magFilter( GL_NEAREST ) ) );
+        }
+        mShadeFboRef = gl::Fbo::create( size.x, size.y, fboFmt );
+        mShadeDepth = depth;
+    }
+    if( !mFrameFboRefs[0] || mFrameFboRefs[0]->getSize() != size ) {
+        auto fboFmt = gl::Fbo::Format().disableDepth().colorTexture( gl::Texture2d::Format().minFilter( GL_LINEAR ).magFilter( GL_LINEAR ) );
+        for( auto &it : mFrameFboRefs ) {
+            it = gl::Fbo::create( size.x, size.y, fboFmt );
+        }
+        mHistoryValid = false;
+    }
+    int phase = int( mFrame++ % uint32_t( getPhases() ) );
+    vec3 focus( mFocusCenter.x * size.x, ( 1.0f - mFocusCenter.y ) * size.y, mFocusRadius * size.y );
+    for( auto &glsl : { mMaskGlslProgRef, mResolveGlslProgRef } ) {
+        glsl->uniform( "uMode", int( mMode ) );
+        glsl->uniform( "uPhase", phase );
+        glsl->uniform( "uFocus", focus );
+    }
+
+    {
+        gl::ScopedFramebuffer scpFbo( mShadeFboRef );
+        gl::ScopedViewport scpViewport( ivec2( 0 ), size );
+        gl::clear( background );
+        // The mask and the frame both sit at half depth, so a masked pixel fails GL_LESS
+        {
+            gl::ScopedMatrices scpMatrices;
+            gl::setMatricesWindow( size );
+            gl::ScopedDepth scpDepth( true );
+            gl::ScopedGlslProg scpGlsl( mMaskGlslProgRef );
+            glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+            gl::drawSolidRect( Rectf( vec2( 0.0f ), vec2( size ) ) );
+            glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+        }
+        gl::ScopedDepthTest scpDepthTest( true, GL_LESS );
+        gl::ScopedDepthWrite scpDepthWrite( false );
+        drawFn();
+    }
+
+    int current = mLast ^ 1;
+    {
+        gl::ScopedFramebuffer scpFbo( mFrameFboRefs[current] );
+        gl::ScopedViewport scpViewport( ivec2( 0 ), size );
+        gl::ScopedMatrices scpMatrices;
+        gl::setMatricesWindow( size );
+        gl::ScopedBlend scpBlend( false );
+        gl::ScopedGlslProg scpGlsl( mResolveGlslProgRef );
+        gl::ScopedTextureBind scpColor( mShadeFboRef->getColorTexture(), 0 );
+        gl::ScopedTextureBind scpHistory( mFrameFboRefs[mLast]->getColorTexture(), 2 );
+        if( depth ) {
+            mShadeFboRef->getTexture2d( GL_COLOR_ATTACHMENT1 )->bind( 1 );
+        }
+        auto &glsl = mResolveGlslProgRef;
+        glsl->uniform( "uColor", 0 );
+        glsl->uniform( "uDepth", 1 );
+        glsl->uniform( "uHistory", 2 );
+        glsl->uniform( "uUseDepth", depth ? 1.0f : 0.0f );
+        glsl->uniform( "uUseHistory", mHistoryValid ? 1.0f : 0.0f );
+        glsl->uniform( "uStill", still ? 1.0f : 0.0f );
+        glsl->uniform( "uClamp", mClamp );
+        glsl->uniform( "uSize", vec2( size ) );
+        glsl->uniform( "uAspect", camera.mAspect );
+        glsl->uniform( "uTexcoords", vec4( camera.mTexcoordMin, camera.mTexcoordMax ) );
+        glsl->uniform( "uView", camera.mViewMatrix );
+        glsl->uniform( "uEye", camera.mEyePoint );
+        glsl->uniform( "uTanFov", tanf( camera.mFov ) );
+        glsl->uniform( "uPreviousView", mPrevious.mViewMatrix );
+        glsl->uniform( "uPreviousEye", mPrevious.mEyePoint );
+        glsl->uniform( "uPreviousTanFov", tanf( mPrevious.mFov ) );
+        gl::drawSolidRect( Rectf( vec2( 0.0f ), vec2( size ) ) );
+        if( depth ) {
+            mShadeFboRef->getTexture2d( GL_COLOR_ATTACHMENT1 )->unbind( 1 );
+        }
+    }
+    mLast = current;
+    mPrevious = camera;
+    mHistoryValid = true;
+}
+
+} // namespace sparse
+} // namespace reza
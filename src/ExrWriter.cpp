@@ -0,0 +1,336 @@
+#include "ExrWriter.h"
+
+#include "cinder/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <zlib.h>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace exr {
+
+uint16_t toHalf( float value )
+{
+    uint32_t bits;
+    memcpy( &bits, &value, sizeof( bits ) );
+    uint32_t sign = ( bits >> 16 ) & 0x8000;
+    uint32_t exponent = ( bits >> 23 ) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+    if( exponent == 0xff ) {
+        return uint16_t( sign | 0x7c00 | ( mantissa ? 0x200 : 0 ) );
+    }
+    int e = int( exponent ) - 127 + 15;
+    if( e >= 31 ) {
+        return uint16_t( sign | 0x7c00 );
+    }
+    if( e <= 0 ) {
+        // Denormals, anything below half the smallest one is zero
+        if( e < -10 ) {
+            return uint16_t( sign );
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - e;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ( ( 1u << shift ) - 1 );
+        uint32_t halfway = 1u << ( shift - 1 );
+        if( rest > halfway || ( rest == halfway && ( half & 1 ) ) ) {
+            half++;
+        }
+        return uint16_t( sign | half );
+    }
+    // A carry out of the mantissa bumps the exponent, which is the right rounding too
+    uint32_t half = ( uint32_t( e ) << 10 ) | ( mantissa >> 13 );
+    uint32_t rest = mantissa & 0x1fff;
+    if( rest > 0x1000 || ( rest == 0x1000 && ( half & 1 ) ) ) {
+        half++;
+    }
+    return uint16_t( sign | half );
+}
+
+static void put( vector<uint8_t> &buffer, const void *data, size_t size )
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>( data );
+    buffer.insert( buffer.end(), bytes, bytes + size );
+}
+
+static void putInt( vector<uint8_t> &buffer, int32_t value )
+{
+    put( buffer, &value, sizeof( value ) );
+}
+
+static void putFloat( vector<uint8_t> &buffer, float value )
+{
+    put( buffer, &value, sizeof( value ) );
+}
+
+static void putString( vector<uint8_t> &buffer, const string &value )
+{
+    put( buffer, value.c_str(), value.size() + 1 );
+}
+
+static void putAttribute( vector<uint8_t> &buffer, const string &name, const string &type, const vector<uint8_t> &value )
+{
+    putString( buffer, name );
+    putString( buffer, type );
+    putInt( buffer, int32_t( value.size() ) );
+    put( buffer, value.data(), value.size() );
+}
+
+ExrWriterRef ExrWriter::create( const fs::path &path, const Format &format )
+{
+    if( format.mSize.x <= 0 || format.mSize.y <= 0 || format.mChannels.empty() ) {
+        CI_LOG_E( "EXR HAS NO PIXELS: " << path );
+        return nullptr;
+    }
+    ExrWriterRef writer( new ExrWriter( path, format ) );
+    if( !writer->mStream ) {
+        CI_LOG_E( "UNABLE TO WRITE EXR: " << path );
+        return nullptr;
+    }
+    return writer;
+}
+
+ExrWriter::ExrWriter( const fs::path &path, const Format &format )
+    : mFormat( format ), mStream( path.string(), ios::binary | ios::trunc )
+{
+    for( auto &it : mFormat.mChannels ) {
+        // Longer names need the long names flag, which older readers reject
+        it.mName = it.mName.substr( 0, 31 );
+    }
+    for( int i = 0; i < int( mFormat.mChannels.size() ); i++ ) {
+        mOrder.push_back( i );
+    }
+    sort( mOrder.begin(), mOrder.end(), [this]( int a, int b ) { return mFormat.mChannels[a].mName < mFormat.mChannels[b].mName; } );
+    mLinesPerBlock = mFormat.mCompression == ZIP ? 16 : 1;
+    mMaxPending = std::max( 1u, thread::hardware_concurrency() );
+
+    size_t chunks;
+    if( mFormat.mTileSize.x > 0 && mFormat.mTileSize.y > 0 ) {
+        ivec2 tiles = ( mFormat.mSize + mFormat.mTileSize - 1 ) / mFormat.mTileSize;
+        chunks = size_t( tiles.x ) * tiles.y;
+    }
+    else {
+        mFormat.mTileSize = ivec2( 0 );
+        chunks = size_t( ( mFormat.mSize.y + mLinesPerBlock - 1 ) / mLinesPerBlock );
+    }
+    mOffsets.resize( chunks, 0 );
+    if( mStream ) {
+        writeHeader();
+    }
+}
+
+ExrWriter::~ExrWriter()
+{
+    close();
+}
+
+void ExrWriter::writeHeader()
+{
+    bool tiled = mFormat.mTileSize.x > 0;
+    vector<uint8_t> header;
+    putInt( header, 20000630 );
+    putInt( header, tiled ? 0x202 : 2 );
+
+    vector<uint8_t> channels;
+    for( int index : mOrder ) {
+        putString( channels, mFormat.mChannels[index].mName );
+        putInt( channels, mFormat.mChannels[index].mHalf ? 1 : 2 );
+        uint8_t linear[4] = { 0, 0, 0, 0 };
+        put( channels, linear, 4 );
+        putInt( channels, 1 );
+        putInt( channels, 1 );
+    }
+    channels.push_back( 0 );
+    putAttribute( header, "channels", "chlist", channels );
+    putAttribute( header, "compression", "compression", { uint8_t( mFormat.mCompression ) } );
+
+    vector<uint8_t> window;
+    putInt( window, 0 );
+    putInt( window, 0 );
+    putInt( window, mFormat.mSize.x - 1 );
+    putInt( window, mFormat.mSize.y - 1 );
+    putAttribute( header, "dataWindow", "box2i", window );
+    putAttribute( header, "displayWindow", "box2i", window );
+    // Tiles arrive in whatever order they finish compressing
+    putAttribute( header, "lineOrder", "lineOrder", { uint8_t( tiled ? 2 : 0 ) } );
+
+    vector<uint8_t> value;
+    putFloat( value, 1.0f );
+    putAttribute( header, "pixelAspectRatio", "float", value );
+    putAttribute( header, "screenWindowWidth", "float", value );
+    value.clear();
+    putFloat( value, 0.0f );
+    putFloat( value, 0.0f );
+    putAttribute( header, "screenWindowCenter", "v2f", value );
+    if( tiled ) {
+        value.clear();
+        putInt( value, mFormat.mTileSize.x );
+        putInt( value, mFormat.mTileSize.y );
+        value.push_back( 0 ); // one level, rounded down
+        putAttribute( header, "tiles", "tiledesc", value );
+    }
+    header.push_back( 0 );
+
+    mStream.write( reinterpret_cast<const char *>( header.data() ), header.size() );
+    // The offset table is filled in as chunks land and written for real on close
+    mOffsetsPosition = mStream.tellp();
+    vector<uint64_t> placeholder( mOffsets.size(), 0 );
+    mStream.write( reinterpret_cast<const char *>( placeholder.data() ), placeholder.size() * sizeof( uint64_t ) );
+}
+
+vector<uint8_t> ExrWriter::encode( const float *pixels, int stride, int width, int rows ) const
+{
+    // Every line stores all samples of one channel before the next
+    size_t channels = mFormat.mChannels.size();
+    vector<uint8_t> raw;
+    for( int y = 0; y < rows; y++ ) {
+        const float *row = pixels + size_t( y ) * stride * channels;
+        for( int index : mOrder ) {
+            if( mFormat.mChannels[index].mHalf ) {
+                for( int x = 0; x < width; x++ ) {
+                    uint16_t half = toHalf( row[x * channels + index] );
+                    put( raw, &half, sizeof( half ) );
+                }
+            }
+            else {
+                for( int x = 0; x < width; x++ ) {
+                    put( raw, &row[x * channels + index], sizeof( float ) );
+                }
+            }
+        }
+    }
+    if( mFormat.mCompression == NONE || raw.empty() ) {
+        return raw;
+    }
+
+    // The zip predictor: even bytes then odd bytes, each stored as the difference to the one
+    // before it, which turns the slowly changing high bytes of halfs into runs of zeros
+    vector<uint8_t> shuffled( raw.size() );
+    size_t middle = ( raw.size() + 1 ) / 2;
+    for( size_t i = 0; i < raw.size(); i++ ) {
+        shuffled[( i & 1 ) ? middle + i / 2 : i / 2] = raw[i];
+    }
+    for( size_t i = shuffled.size() - 1; i > 0; i-- ) {
+        shuffled[i] = uint8_t( int( shuffled[i] ) - int( shuffled[i - 1] ) + 128 );
+    }
+    uLongf size = compressBound( uLong( shuffled.size() ) );
+    vector<uint8_t> compressed( size );
+    // Readers take a chunk as big as the raw data to be stored uncompressed
+    if( compress2( compressed.data(), &size, shuffled.data(), uLong( shuffled.size() ), 4 ) != Z_OK || size >= raw.size() ) {
+        return raw;
+    }
+    compressed.resize( size );
+    return compressed;
+}
+
+void ExrWriter::writeChunk( const vector<int> &coordinates, const vector<uint8_t> &data, size_t index )
+{
+    mOffsets[index] = uint64_t( mStream.tellp() );
+    vector<uint8_t> chunk;
+    for( int it : coordinates ) {
+        putInt( chunk, it );
+    }
+    putInt( chunk, int32_t( data.size() ) );
+    mStream.write( reinterpret_cast<const char *>( chunk.data() ), chunk.size() );
+    mStream.write( reinterpret_cast<const char *>( data.data() ), data.size() );
+}
+
+void ExrWriter::writeRows( const float *pixels, int rows )
+{
+    if( mClosed || mFormat.mTileSize.x > 0 ) {
+        return;
+    }
+    int width = mFormat.mSize.x;
+    size_t rowFloats = size_t( width ) * mFormat.mChannels.size();
+    rows = std::min( rows, mFormat.mSize.y - mRowsWritten - int( mCarry.size() / rowFloats ) );
+    if( rows <= 0 ) {
+        return;
+    }
+    // Rows short of a full block wait for the next call, unless they end the image
+    if( !mCarry.empty() ) {
+        mCarry.insert( mCarry.end(), pixels, pixels + rowFloats * rows );
+        pixels = mCarry.data();
+        rows = int( mCarry.size() / rowFloats );
+    }
+    bool last = mRowsWritten + rows >= mFormat.mSize.y;
+    int blocks = last ? ( rows + mLinesPerBlock - 1 ) / mLinesPerBlock : rows / mLinesPerBlock;
+    int encodedRows = std::min( rows, blocks * mLinesPerBlock );
+
+    // Blocks compress on every core and are written in order
+    vector<vector<uint8_t>> encoded( blocks );
+    int numThreads = std::max( 1, std::min( int( mMaxPending ), blocks ) );
+    vector<future<void>> workers;
+    for( int t = 0; t < numThreads; t++ ) {
+        workers.push_back( async( launch::async, [&, t] {
+            for( int b = t; b < blocks; b += numThreads ) {
+                int lines = std::min( mLinesPerBlock, rows - b * mLinesPerBlock );
+                encoded[b] = encode( pixels + size_t( b ) * mLinesPerBlock * rowFloats, width, width, lines );
+            }
+        } ) );
+    }
+    for( auto &it : workers ) {
+        it.get();
+    }
+    for( int b = 0; b < blocks; b++ ) {
+        int y = mRowsWritten + b * mLinesPerBlock;
+        writeChunk( { y }, encoded[b], size_t( y / mLinesPerBlock ) );
+    }
+    mRowsWritten += encodedRows;
+    mCarry = vector<float>( pixels + size_t( encodedRows ) * rowFloats, pixels + size_t( rows ) * rowFloats );
+}
+
+void ExrWriter::writeTile( const ivec2 &tile, const float *pixels )
+{
+    if( mClosed || mFormat.mTileSize.x <= 0 ) {
+        return;
+    }
+    ivec2 origin = tile * mFormat.mTileSize;
+    if( origin.x < 0 || origin.y < 0 || origin.x >= mFormat.mSize.x || origin.y >= mFormat.mSize.y ) {
+        return;
+    }
+    ivec2 size = glm::min( mFormat.mTileSize, mFormat.mSize - origin );
+    int stride = mFormat.mTileSize.x;
+    auto data = make_shared<vector<float>>( pixels, pixels + size_t( stride ) * size.y * mFormat.mChannels.size() );
+
+    // Compression overlaps with rendering the next tiles, up to one tile per core
+    drain( mMaxPending - 1 );
+    Pending pending;
+    pending.mTile = tile;
+    pending.mData = async( launch::async, [this, data, stride, size] { return encode( data->data(), stride, size.x, size.y ); } );
+    mPending.push_back( move( pending ) );
+}
+
+void ExrWriter::drain( size_t count )
+{
+    int tilesX = ( mFormat.mSize.x + mFormat.mTileSize.x - 1 ) / std::max( mFormat.mTileSize.x, 1 );
+    while( mPending.size() > count ) {
+        Pending pending = move( mPending.front() );
+        mPending.pop_front();
+        writeChunk( { pending.mTile.x, pending.mTile.y, 0, 0 }, pending.mData.get(), size_t( pending.mTile.y ) * tilesX + pending.mTile.x );
+    }
+}
+
+void ExrWriter::close()
+{
+    if( mClosed ) {
+        return;
+    }
+    mClosed = true;
+    drain( 0 );
+    if( !mStream ) {
+        return;
+    }
+    if( std::count( mOffsets.begin(), mOffsets.end(), uint64_t( 0 ) ) > 0 ) {
+        CI_LOG_W( "EXR CLOSED WITH MISSING CHUNKS" );
+    }
+    mStream.seekp( mOffsetsPosition );
+    mStream.write( reinterpret_cast<const char *>( mOffsets.data() ), mOffsets.size() * sizeof( uint64_t ) );
+    mStream.close();
+}
+
+} // namespace exr
+} // namespace reza
@@ -0,0 +1,192 @@
+#include "FileWatcher.h"
+
+#include "cinder/Log.h"
+
+#if defined( __APPLE__ )
+#include <CoreServices/CoreServices.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace watch {
+
+FileWatcher::FileWatcher( const fs::path &root, const Callback &callback, double debounce )
+    : mRoot( root ), mCallback( callback ), mDebounce( chrono::duration_cast<chrono::steady_clock::duration>( chrono::duration<double>( debounce ) ) )
+{
+#if !defined( __APPLE__ )
+    mRunning = false;
+#endif
+    start();
+}
+
+FileWatcher::~FileWatcher()
+{
+    stop();
+}
+
+void FileWatcher::push( const fs::path &path )
+{
+    lock_guard<mutex> lock( mMutex );
+    mPending.insert( path );
+    mLastEvent = chrono::steady_clock::now();
+}
+
+void FileWatcher::update()
+{
+    vector<fs::path> changed;
+    {
+        lock_guard<mutex> lock( mMutex );
+        if( mPending.empty() || chrono::steady_clock::now() - mLastEvent < mDebounce ) {
+            return;
+        }
+        changed.assign( mPending.begin(), mPending.end() );
+        mPending.clear();
+    }
+    if( mCallback ) {
+        mCallback( changed );
+    }
+}
+
+#if defined( __APPLE__ )
+
+void FileWatcher::start()
+{
+    auto callback = []( ConstFSEventStreamRef stream, void *info, size_t numEvents, void *eventPaths, const FSEventStreamEventFlags flags[], const FSEventStreamEventId ids[] ) {
+        FileWatcher *watcher = static_cast<FileWatcher *>( info );
+        char **paths = static_cast<char **>( eventPaths );
+        for( size_t i = 0; i < numEvents; i++ ) {
+            if( !( flags[i] & kFSEventStreamEventFlagItemIsDir ) ) {
+                watcher->push( fs::path( paths[i] ) );
+            }
+        }
+    };
+
+    CFStringRef root = CFStringCreateWithCString( kCFAllocatorDefault, mRoot.string().c_str(), kCFStringEncodingUTF8 );
+    CFArrayRef paths = CFArrayCreate( kCFAllocatorDefault, (const void **)&root, 1, &kCFTypeArrayCallBacks );
+    FSEventStreamContext context = { 0, this, nullptr, nullptr, nullptr };
+    FSEventStreamRef stream = FSEventStreamCreate( kCFAllocatorDefault, callback, &context, paths, kFSEventStreamEventIdSinceNow, 0.01, kFSEventStreamCreateFlagFileEvents | kFSEventStreamCreateFlagNoDefer );
+    CFRelease( paths );
+    CFRelease( root );
+    if( stream == nullptr ) {
+        CI_LOG_E( "Unable to watch: " << mRoot );
+        return;
+    }
+
+    dispatch_queue_t queue = dispatch_queue_create( "fragment.filewatcher", DISPATCH_QUEUE_SERIAL );
+    FSEventStreamSetDispatchQueue( stream, queue );
+    FSEventStreamStart( stream );
+    mStream = stream;
+    mQueue = queue;
+}
+
+void FileWatcher::stop()
+{
+    if( mStream == nullptr ) {
+        return;
+    }
+    FSEventStreamRef stream = static_cast<FSEventStreamRef>( mStream );
+    FSEventStreamStop( stream );
+    FSEventStreamInvalidate( stream );
+    FSEventStreamRelease( stream );
+    dispatch_release( static_cast<dispatch_queue_t>( mQueue ) );
+    mStream = nullptr;
+    mQueue = nullptr;
+}
+
+#else
+
+void FileWatcher::start()
+{
+    mInotify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if( mInotify < 0 || pipe( mWake ) != 0 ) {
+        CI_LOG_E( "Unable to watch: " << mRoot );
+        return;
+    }
+    addDirectory( mRoot );
+    mRunning = true;
+    mThread = thread( &FileWatcher::run, this );
+}
+
+void FileWatcher::stop()
+{
+    if( mRunning ) {
+        mRunning = false;
+        char wake = 0;
+        if( write( mWake[1], &wake, 1 ) < 0 ) {
+            CI_LOG_E( "Unable to wake watcher thread" );
+        }
+        mThread.join();
+    }
+    for( int fd : { mInotify, mWake[0], mWake[1] } ) {
+        if( fd >= 0 ) {
+            close( fd );
+        }
+    }
+    mInotify = mWake[0] = mWake[1] = -1;
+}
+
+void FileWatcher::addDirectory( const fs::path &path )
+{
+    int wd = inotify_add_watch( mInotify, path.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE );
+    if( wd < 0 ) {
+        CI_LOG_E( "Unable to watch: " << path );
+        return;
+    }
+    mDirectories[wd] = path;
+    for( fs::directory_iterator it( path ), end; it != end; ++it ) {
+        if( fs::is_directory( it->path() ) ) {
+            addDirectory( it->path() );
+        }
+    }
+}
+
+void FileWatcher::run()
+{
+    alignas( inotify_event ) char buffer[4096];
+    pollfd fds[2] = { { mInotify, POLLIN, 0 }, { mWake[0], POLLIN, 0 } };
+    while( mRunning ) {
+        if( poll( fds, 2, -1 ) <= 0 ) {
+            continue;
+        }
+        if( fds[1].revents & POLLIN ) {
+            break;
+        }
+        ssize_t length;
+        while( ( length = read( mInotify, buffer, sizeof( buffer ) ) ) > 0 ) {
+            for( char *ptr = buffer; ptr < buffer + length; ) {
+                const inotify_event *event = reinterpret_cast<const inotify_event *>( ptr );
+                ptr += sizeof( inotify_event ) + event->len;
+                if( event->mask & IN_IGNORED ) {
+                    mDirectories.erase( event->wd );
+                    continue;
+                }
+                auto it = mDirectories.find( event->wd );
+                if( it == mDirectories.end() || event->len == 0 ) {
+                    continue;
+                }
+                fs::path path = it->second / event->name;
+                if( event->mask & IN_ISDIR ) {
+                    if( event->mask & ( IN_CREATE | IN_MOVED_TO ) ) {
+                        addDirectory( path );
+                    }
+                    continue;
+                }
+                // A created file is reported once it has been written and closed
+                if( event->mask & ( IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE ) ) {
+                    push( path );
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+} // namespace watch
+} // namespace reza
@@ -3,11 +3,22 @@
 #include "cinder/app/App.h"
 #include "cinder/app/RendererGl.h"
 #include "cinder/gl/Batch.h"
+#include "cinder/gl/Fbo.h"
 #include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Query.h"
 #include "cinder/gl/ShaderPreprocessor.h"
 #include "cinder/gl/gl.h"
+#include "cinder/ip/Resize.h"
 #include "cinder/qtime/AvfWriter.h"
+#include "cinder/ImageIo.h"
 #include "cinder/Log.h"
+#include "cinder/Timer.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <regex>
+#include <set>
 
 //BLOCKS
 #include "Osc.h"
@@ -17,7 +28,6 @@
 #include "Helpers.h"
 #include "EasyCamera.h"
 #include "LiveCode.h"
-#include "Watchdog.h"
 #include "Tiler.h"
 #include "UI.h"
 #include "SaveLoadCamera.h"
@@ -25,6 +35,26 @@
 #include "SequenceSaver.h"
 #include "MovieSaver.h"
 
+//SOURCE
+#include "AudioAnalyzer.h"
+#include "Checkerboard.h"
+#include "ExrWriter.h"
+#include "FileWatcher.h"
+#include "FramePacer.h"
+#include "JobQueue.h"
+#include "OscRecorder.h"
+#include "NoiseTextures.h"
+#include "Projector.h"
+#include "QualityTiers.h"
+#include "RemoteServer.h"
+#include "ResourceManager.h"
+#include "SdfBaker.h"
+#include "ShaderAnalysis.h"
+#include "Snapshot.h"
+#include "TextureCache.h"
+#include "ThumbnailCache.h"
+#include "Timeline.h"
+
 /*
  TO DO:
  
@@ -47,18 +77,27 @@ using namespace reza::paths;
 using namespace reza::mov;
 using namespace reza::seq;
 using namespace reza::img;
-
-#define USE_UDP 1
-
-#if USE_UDP
-using Receiver = osc::ReceiverUdp;
-using protocol = asio::ip::udp;
-typedef std::shared_ptr<class osc::ReceiverUdp> ReceiverRef;
-#else
-using Receiver = osc::ReceiverTcp;
-using protocol = asio::ip::tcp;
-typedef std::shared_ptr<class osc::ReceiverTcp> ReceiverRef;
-#endif
+using namespace reza::timeline;
+using namespace reza::rec;
+using namespace reza::sound;
+using namespace reza::tex;
+using namespace reza::watch;
+using namespace reza::snap;
+using namespace reza::proj;
+using namespace reza::bake;
+using namespace reza::noise;
+using namespace reza::quality;
+using namespace reza::exr;
+using namespace reza::analysis;
+using namespace reza::sparse;
+using namespace reza::remote;
+using namespace reza::thumb;
+using namespace reza::pace;
+using namespace reza::res;
+using namespace reza::job;
+
+typedef std::shared_ptr<class osc::ReceiverUdp> ReceiverUdpRef;
+typedef std::shared_ptr<class osc::ReceiverTcp> ReceiverTcpRef;
 
 class Fragment : public App {
   public:
@@ -71,6 +110,12 @@ class Fragment : public App {
     //CLEANUP
     void cleanup() override;
 
+    //INPUT FROM ANY WINDOW
+    void mouseDown( MouseEvent event ) override;
+    void mouseDrag( MouseEvent event ) override;
+    void mouseWheel( MouseEvent event ) override;
+    void keyDown( KeyEvent event ) override;
+
     // CAMERA
     EasyCameraRef mCameraRef;
 
@@ -78,8 +123,17 @@ class Fragment : public App {
     void createAssetDirectories();
     void createSessionDefaultDirectories();
     void createSessionWorkingDirectories();
-    void createSessionExamplesDirectories();
-    void createSessionTutorialsDirectories();
+    vector<string> getSessionNames( const string &folder );
+    fs::path getSessionPath( const string &folder, const string &name );
+    fs::path getSessionSourcePath( const string &folder, const string &name );
+
+    //STARTUP
+    chrono::steady_clock::time_point mStartupTime;
+    vector<pair<string, double>> mStartupTimings;
+    mutex mStartupMutex;
+    bool mStartupReported = false;
+    void timeStartup( const string &name, const function<void()> &fn );
+    void reportStartup();
 
     //OUTPUT
     void setupOutput();
@@ -95,17 +149,73 @@ class Fragment : public App {
     vec2 mMouse = vec2( 0.0 );
     vec2 mMousePrev = vec2( 0.0 );
     vec2 mMouseClick = vec2( 0.0 );
+    // A plain drag, whose position is read again right before each frame
+    bool mMouseDragging = false;
     bool mOutputWindowFullscreen = false;
     ivec2 mOutputWindowOrigin = ivec2( 0 );
     ivec2 mOutputWindowSize = ivec2( 1920, 1080 );
 
+    //FRAME PACING
+    FramePacerRef mFramePacerRef;
+    int mPacingMode = FramePacer::VSYNC;
+    float mPacingDelay = 4.0f;
+    bool mVerticalSync = true;
+    // Of the display the output window is on, live frames are timed against it
+    double mRefreshRate = 60.0;
+    void setupFramePacing();
+    void applyFramePacing();
+    void sampleInputs();
+
+    //PROJECTORS
+    void setupProjectors();
+    vec2 getCanvasSize();
+    vector<ProjectorRef> mProjectorRefs;
+    ivec2 mCanvasSize = ivec2( 0 );
+
+    //IDLE
+    gl::FboRef mFrameFboRef = nullptr;
+    bool mFrameDirty = true;
+    size_t mFrameHash = 0;
+    bool mUsesGlobalTime = true;
+    bool mUsesAnimationTime = true;
+    bool mUsesDate = true;
+    bool mUsesMouse = true;
+    bool mUsesAudio = true;
+    vector<function<float()>> mParamGetters;
+    int mFramesDrawn = 0;
+    int mFramesSkipped = 0;
+    double mIdleTime = 0.0;
+    float mIdleRatio = 0.0f;
+    void renderOutput( bool still = false );
+    void applyUniforms( const gl::GlslProgRef &glsl, const vec2 &size );
+    void reflectUniforms();
+    void bindParamGetters();
+    void addParamGetters( View *view, vector<function<float()>> &getters );
+    bool updateFrameHash();
+
     //BACKGROUND
     ColorA mBgColor = ColorA::white();
 
     //COLOR PALETTE
-    Surface32fRef mPaletteSurfRef = nullptr;
+    static const int kMaxPalettes = 16;
+    Surface8uRef mPaletteSurfRef = nullptr;
+    vector<Surface8uRef> mSessionPaletteSurfRefs;
     gl::Texture2dRef mPaletteTexRef = nullptr;
+    vector<vec4> mPaletteTable;
+    vector<FileWatcherRef> mPaletteWatcherRefs;
     void setupPalettes();
+    void loadPalettes();
+    void loadSessionPalettes();
+    void watchPalettes();
+
+    //NOISE TEXTURES
+    // Channels count up from 2, then the depth prepass, the baked sdf and its bricks, then noise
+    uint8_t getNoiseTextureUnit() const { return uint8_t( 5 + mTextureChannels.size() ); }
+    // Generated the first time a linked program samples it, most sessions never do
+    bool mUsesNoise = false;
+    NoiseTexturesRef mNoiseTexturesRef;
+    future<void> mNoiseGenerate;
+    void updateNoise();
 
     // IMAGE EXPORTER
     ImageSaverRef mImageSaverRef;
@@ -123,18 +233,236 @@ class Fragment : public App {
     int mTotalFrames = 120;
     float mCurrentTime = 0.0f;
     float mSeconds = 0.0;
+    double getAnimationSeconds();
+    bool isExporting();
+
+    // EXR EXPORTER
+    vector<string> mAovNames; // channels of oAov, none when the shader doesn't write it
+    fs::path mExrPath;
+    fs::path mExrSequencePath;
+    string mExrSequenceName;
+    int mExrSequenceFrame = -1;
+    bool mSaveExrSequence = false;
+    bool renderExr( const fs::path &path );
+    string getFrameNumber( int frame );
+
+    //RESOURCES
+    // Console lines for memory, the two pools and then the largest categories
+    static const int kMemoryLines = 8;
+    ResourceManagerRef mResourceManagerRef;
+    int mGpuBudget = 2048; // MB, zero for none
+    int mCpuBudget = 4096;
+    double mResourcesTime = 0.0;
+    vector<LabelRef> mMemoryLabelRefs;
+    void setupResources();
+    void updateResources();
+    void updateMemoryLabels();
+    void applyBudgets();
+    bool fitsImage( int scale );
+
+    // Images too large for the budget, written as canvas sized tiles by the output window
+    fs::path mTilesPath;
+    string mTilesName;
+    string mTilesExt;
+    fs::path mTilesSequencePath;
+    string mTilesSequenceName;
+    int mTilesSequenceFrame = -1;
+    bool renderTiles( const fs::path &directory, const string &name, const string &ext );
+    // Draws the canvas sized tiles of the OUTPUT IMAGE SCALE image top left first, with a
+    // compiled shader. Stops early, returning false, when tileFn does.
+    bool drawTiles( const function<bool( const ivec2 &index, const Surface8u &tile )> &tileFn );
+    bool renderImage( const fs::path &path );
+
+    //JOBS
+    JobQueueRef mJobQueueRef;
+    JobQueue::Job mJob;
+    bool mJobsRunning = false;
+    bool mJobCompiling = false;
+    // Jobs that couldn't be read or were skipped and frames that failed to save, --quit
+    // exits with 1 when there were any
+    int mJobFailures = 0;
+    // Of the working shaders after the last job loaded, so each job reads them once at most.
+    // Zero when unknown, it's only kept while jobs run.
+    size_t mJobShadersHash = 0;
+    int mJobGeneration = 0;
+    double mJobTime = 0.0;
+    double mJobCompileTimeout = 60.0; // seconds a job waits for its shaders to build
+    int mJobFrame = -1;
+    ivec2 mJobSize = ivec2( 0 ); // the canvas while a job renders, zero for the window's
+    set<string> mJobParams;      // upper cased, the timeline leaves them alone while the job renders
+    void setupJobs();
+    void updateJobs();
+    void startJob();
+    void applyJob();
+    bool renderJob( const fs::path &path );
+    size_t getShadersHash( const fs::path &root );
+
+    //AUDIO
+    AudioAnalyzerRef mAudioAnalyzerRef;
+    gl::Texture2dRef mAudioTexRef = nullptr;
+    bool mAudioInput = false;
+    float mAudioGain = 1.0f;
+    fs::path mAudioFilePath;
+    void setupAudio();
+    void updateAudio();
+    void setAudioFile( const fs::path &path );
+    void saveAudio( const fs::path &path );
+    void loadAudio( const fs::path &path );
+
+    //TEXTURE CHANNELS
+    struct TextureChannel {
+        string mName;
+        bool mVideo = false;
+        vector<fs::path> mFrames; // a single image, or the frames of an image sequence folder
+        gl::Texture2dRef mTextureRef = nullptr;
+    };
+    TextureCacheRef mTextureCacheRef;
+    vector<TextureChannel> mTextureChannels;
+    void setupTextureChannels();
+    void parseTextureChannels( const vector<string> &sources );
+    void updateTextureChannels();
+    fs::path getTextureChannelPath( const string &path );
 
     //BATCH & GLSL
     bool mSetupBatch = true;
     gl::BatchRef mBatchRef = nullptr;
     gl::GlslProgRef mGlslProgRef = nullptr;
     GlslParamsRef mGlslParamsRef = nullptr;
+    FileWatcherRef mShaderWatcherRef;
     bool mGlslInitialized = false;
+    int mGlslGeneration = 0; // builds finished so far, whether they compiled or not
 
     void setupBatch();
     void drawBatch();
+    vector<vec2> getTexcoords();
+    vector<vec2> getTexcoords( const vec2 &uv0, const vec2 &uv1 );
     void setupGlsl();
 
+    //SHADER VARIANTS
+    gl::GlslProgRef compileVariant( const vector<string> &sources, const vector<string> &defines );
+    bool findDefine( const vector<string> &sources, const string &name, string *value = nullptr );
+    // The prepass and bake variants trace the scene the live program draws, so they are
+    // compiled for its tier, once per tier and set of sources
+    vector<string> mVariantSources;
+    int mVariantTier = -1;
+    gl::GlslProgRef mPrepassTierRefs[QualityTiers::kTiers];
+    gl::GlslProgRef mBakeTierRefs[QualityTiers::kTiers];
+    // Only this variant writes oAov, compiled the first time an export or the checkerboard asks
+    gl::GlslProgRef mAovTierRefs[QualityTiers::kTiers];
+    void setupVariants( const vector<string> &sources );
+    void updateVariants();
+    void applyVariants( int tier );
+    gl::GlslProgRef getAovGlslProg( int tier );
+
+    //QUALITY TIERS
+    static const int kFrameQueryBuffers = 3;
+    QualityTiersRef mQualityTiersRef;
+    gl::QueryTimeSwappedRef mFrameQueryRef;
+    int mFrameQueries = 0;
+    bool mQualityAuto = true;
+    int mQualityTier = QualityTiers::kDefaultTier;
+    void setupQualityTiers();
+    void updateQualityTiers();
+
+    //THUMBNAILS
+    ThumbnailCacheRef mThumbnailCacheRef;
+    int mThumbnailSize = 96;
+    gl::Texture2dRef mThumbnailPlaceholderRef;
+    // Per browser folder: the session picked, whether picking one previews it rather than
+    // loading it, and the view showing the preview
+    map<string, string> mBrowserSelection;
+    map<string, bool> mBrowserPreview;
+    map<string, TextureViewRef> mBrowserPreviewRefs;
+    void setupThumbnails();
+    void updateThumbnails();
+    void updateThumbnailEnvironment();
+    void updateBrowserPreview( const string &folder );
+
+    //SHADER ANALYSIS
+    // Measured frames after a compile or a tier change before the GPU time is attributed
+    static const int kAnalysisFrames = 30;
+    static const int kAnalysisHotSpots = 8;
+    ShaderAnalysisRef mShaderAnalysisRef;
+    // One analysis runs at a time off the main thread, the latest request waits for it
+    future<ShaderAnalysisRef> mAnalysisJob;
+    bool mAnalysisQueued = false;
+    bool mAnalysisTimed = false;
+    string mAnalysisJson; // what analysis.json holds
+    map<int, ShaderAnalysisRef> mAnalysisTiers; // of the current sources
+    vector<string> mAnalysisSources;
+    int mAnalysisTier = QualityTiers::kDefaultTier;
+    int mAnalysisFrames = 0;
+    void analyzeShader( int tier );
+    void startAnalysis();
+    void writeAnalysis();
+    void updateAnalysis();
+
+    //CHECKERBOARD
+    CheckerboardRef mCheckerboardRef;
+    int mCheckerboardMode = Checkerboard::FULL;
+    vec2 mFocusCenter = vec2( 0.5f );
+    float mFocusRadius = 0.0f;
+    float mHistoryClamp = 1.0f;
+    // Frames left to render after the scene stopped changing, until every pixel is shaded
+    int mCheckerboardSettle = 0;
+    bool isCheckerboarding();
+    Checkerboard::Camera getCheckerboardCamera( const vec2 &size );
+
+    //DEPTH PREPASS
+    static const int kPrepassScale = 4;
+    bool mUsesDepthPrepass = false;
+    gl::GlslProgRef mPrepassGlslProgRef = nullptr;
+    gl::BatchRef mPrepassBatchRef = nullptr;
+    gl::FboRef mPrepassFboRef = nullptr;
+    void renderPrepass( const vec2 &size );
+
+    //SDF BAKE
+    SdfBakerRef mSdfBakerRef;
+    gl::GlslProgRef mBakeGlslProgRef = nullptr;
+    bool mUsesBakedSdf = false;
+    bool mBakeDirty = false;
+    bool mBakeSparse = false;
+    int mBakeResolution = 128;
+    size_t mBakeParamsHash = 0;
+    vector<function<float()>> mBakeParamGetters; // the params the bake pass reads
+    void setupBake( const gl::GlslProgRef &glsl );
+    void updateBake( const vec2 &size );
+
+    //SWEEP
+    struct SweepAxis {
+        string mName;
+        string mType;
+        float mMin;
+        float mMax;
+        int mSteps;
+    };
+    fs::path mSweepPath;
+    bool loadSweep( vector<SweepAxis> &axes, vector<float> &times, ivec2 &cell );
+    void renderSweep( const fs::path &path );
+
+    //SHADER PARAMS
+    typedef map<string, pair<string, vector<float>>> PanelValues;
+    string mUniformSignature;
+    PanelValues mPendingParamValues;
+    string getUniformSignature( const vector<string> &sources );
+    PanelValues getPanelValues( const string &panel );
+    void setPanelValues( const string &panel, const PanelValues &values );
+
+    //TIMELINE
+    TimelineRef mTimelineRef;
+    bool mTimelineEnabled = true;
+    vector<float> mTimelineValues;
+    vector<function<void( float )>> mTimelineSetters;
+    vector<string> mTimelineParams; // upper cased widget name of each track
+    vector<float> mTimelineLast;    // what each track last wrote, NAN to write it again
+    void setupTimeline();
+    void updateTimeline();
+    void bindTimeline();
+    void keyTimeline();
+    void saveTimeline( const fs::path &path );
+    void loadTimeline( const fs::path &path );
+    function<void( float )> getViewSetter( const string &address );
+
     //UI
     AppUIRef mUIRef;
     void setupUIs();
@@ -144,6 +472,7 @@ class Fragment : public App {
     UIPanelRef setupExporterUI( UIPanelRef ui );
     UIPanelRef setupExamplesUI( UIPanelRef ui );
     UIPanelRef setupTutorialsUI( UIPanelRef ui );
+    UIPanelRef setupBrowserUI( UIPanelRef ui, const string &folder, const string &title );
     UIPanelRef setupConsoleUI( UIPanelRef ui );
 
     //CONSOLE
@@ -165,6 +494,7 @@ class Fragment : public App {
     fs::path mDefaultMoviePath;
     fs::path mDefaultRenderPath;
 
+    bool mLoadingSettings = false;
     void saveSettings( const fs::path &path );
     void loadSettings( const fs::path &path );
 
@@ -177,14 +507,65 @@ class Fragment : public App {
     void saveSession();
     void loadSession();
 
+    // SNAPSHOT
+    SnapshotRef mSnapshotRef;
+    double mSnapshotTime = 0.0;
+    double mSnapshotInterval = 5.0;
+    bool mCleanShutdown = false; // the last run got to cleanup()
+    bool mSnapshotShadersDirty = true;
+    map<uint32_t, string> mSnapshotChunks; // last handed to the autosave
+    future<bool> mSnapshotSave;
+    void setupSnapshot();
+    void updateSnapshot();
+    void waitSnapshot();
+    map<uint32_t, string> getSnapshotChunks();
+    static string getSnapshotShaders( const fs::path &root );
+    static bool isSnapshotSource( const fs::path &path );
+    bool isSnapshotCurrent( const fs::path &session );
+    bool saveSnapshot( const fs::path &path );
+    bool loadSnapshot( const fs::path &path );
+
     // SAVE & LOAD
     void save( const fs::path &path );
     void load( const fs::path &path );
 
     // OSC
-    ReceiverRef mReceiverRef;
+    vector<ReceiverUdpRef> mReceiverUdpRefs;
+    vector<ReceiverTcpRef> mReceiverTcpRefs;
+    vector<osc::Message> mOscQueue;
     void setupOsc();
+    void updateOsc();
+    void receiveOscMessage( const osc::Message &msg );
+    void routeOscMessage( const osc::Message &msg );
     int mOscPort = 10001;
+    int mOscPortCount = 1;
+    bool mOscUdp = true;
+    bool mOscTcp = false;
+
+    // OSC RECORDING & REPLAY
+    OscRecorderRef mOscRecorderRef;
+    OscPlayerRef mOscPlayerRef;
+    bool mOscReplay = false;
+    bool mOscReplaying = false;
+    void setupOscRecorder();
+    void startOscRecording();
+    void stopOscRecording();
+    void updateOscReplay();
+    void saveOscRecording( const fs::path &path );
+    void loadOscRecording( const fs::path &path );
+    void syncOscRecordingUI();
+
+    // REMOTE
+    RemoteServerRef mRemoteServerRef;
+    bool mRemote = false;
+    int mRemotePort = 8080;
+    int mRemoteWidth = 640;
+    int mRemoteKbps = 8000;
+    double mRemoteStateTime = 0.0;
+    double mRemoteStateInterval = 0.1;
+    void setupRemote();
+    void updateRemote();
+    string getRemoteState();
 
     // EDITOR
     void openEditor();
@@ -209,57 +590,151 @@ void Fragment::prepareSettings( App::Settings *settings )
 void Fragment::setup()
 {
     cout << getAppSupportPath() << endl;
-    CI_LOG_V( "SETUP ASSETS DIRECTORIES" );
-    createAssetDirectories();
-    CI_LOG_V( "SETUP DEFAULT DIRECTORIES" );
-    createSessionDefaultDirectories();
-    CI_LOG_V( "SETUP WORKING DIRECTORIES" );
-    createSessionWorkingDirectories();
-    CI_LOG_V( "SETUP EXAMPLES DIRECTORIES" );
-    createSessionExamplesDirectories();
-    CI_LOG_V( "SETUP TUTORIALS DIRECTORIES" );
-    createSessionTutorialsDirectories();
-
-    CI_LOG_V( "SETUP OUTPUT" );
-    setupOutput();
-
-    CI_LOG_V( "SETUP CAMERA" );
-    EasyCamera::Format cfmt;
-    cfmt.distance( 1.0f );
-    mCameraRef = EasyCamera::create( mOutputWindowRef, cfmt );
-    mCameraRef->enable();
-
-    CI_LOG_V( "SETUP PALETTES" );
-    setupPalettes();
-
-    CI_LOG_V( "SETUP IMAGE SAVER" );
-    setupImageSaver();
-
-    CI_LOG_V( "SETUP SEQUENCE SAVER" );
-    setupSequenceSaver();
-
-    CI_LOG_V( "SETUP MOVIE SAVER" );
-    setupMovieSaver();
-
-    CI_LOG_V( "SETUP GLSL" );
-    setupGlsl();
-
-    CI_LOG_V( "SETUP UIS" );
-    setupUIs();
-
-    CI_LOG_V( "LOADING APP & UI SETTINGS" );
-    loadSettings( getAppSupportWorkingSessionPath() );
+    mStartupTime = chrono::steady_clock::now();
+    mResourceManagerRef = ResourceManager::create();
+
+    // Copies into app support only touch disjoint trees, so they run alongside each other
+    // and the window setup below. Examples and tutorials are copied when first opened.
+    auto assets = async( launch::async, [this] {
+        timeStartup( "ASSETS DIRECTORIES", [this] { createAssetDirectories(); } );
+        timeStartup( "PALETTES DECODE", [this] { loadPalettes(); } );
+    } );
+    auto defaults = async( launch::async, [this] {
+        timeStartup( "DEFAULT DIRECTORIES", [this] { createSessionDefaultDirectories(); } );
+    } );
+    auto working = async( launch::async, [this] {
+        timeStartup( "WORKING DIRECTORIES", [this] { createSessionWorkingDirectories(); } );
+        timeStartup( "SESSION PALETTES DECODE", [this] { loadSessionPalettes(); } );
+    } );
+    mNoiseTexturesRef = NoiseTextures::create();
+
+    timeStartup( "OUTPUT", [this] { setupOutput(); } );
+    timeStartup( "PROJECTORS", [this] { setupProjectors(); } );
+    timeStartup( "FRAME PACING", [this] { setupFramePacing(); } );
+
+    timeStartup( "CAMERA", [this] {
+        EasyCamera::Format cfmt;
+        cfmt.distance( 1.0f );
+        mCameraRef = EasyCamera::create( mOutputWindowRef, cfmt );
+        mCameraRef->enable();
+    } );
+
+    timeStartup( "AUDIO", [this] { setupAudio(); } );
+    timeStartup( "TEXTURE CHANNELS", [this] { setupTextureChannels(); } );
+    timeStartup( "IMAGE SAVER", [this] { setupImageSaver(); } );
+    timeStartup( "SEQUENCE SAVER", [this] { setupSequenceSaver(); } );
+    timeStartup( "MOVIE SAVER", [this] { setupMovieSaver(); } );
+    timeStartup( "OSC RECORDER", [this] { setupOscRecorder(); } );
+    timeStartup( "TIMELINE", [this] { setupTimeline(); } );
+    timeStartup( "SNAPSHOT", [this] { setupSnapshot(); } );
+
+    timeStartup( "DIRECTORIES WAIT", [&] {
+        assets.get();
+        defaults.get();
+        working.get();
+    } );
+
+    timeStartup( "PALETTES UPLOAD", [this] {
+        setupPalettes();
+        watchPalettes();
+    } );
+    timeStartup( "QUALITY TIERS", [this] { setupQualityTiers(); } );
+    timeStartup( "THUMBNAILS", [this] { setupThumbnails(); } );
+    timeStartup( "RESOURCES", [this] { setupResources(); } );
+    // The working shader is compiled on the first frame, see setupGlsl()
+    timeStartup( "GLSL", [this] { setupGlsl(); } );
+    timeStartup( "UIS", [this] { setupUIs(); } );
+    timeStartup( "APP & UI SETTINGS", [this] {
+        loadSettings( getAppSupportWorkingSessionPath() );
+        // After a crash the snapshot holds the latest state, otherwise the files do unless
+        // the snapshot was written after them
+        if( !mCleanShutdown || isSnapshotCurrent( getAppSupportWorkingSessionPath() ) ) {
+            loadSnapshot( getAppSupportWorkingSessionSettingsPath( SNAPSHOT_PATH ) );
+        }
+    } );
+    timeStartup( "JOBS", [this] { setupJobs(); } );
     arrangeUIWindows();
     arrangeUIWindows();
 }
 
+void Fragment::timeStartup( const string &name, const function<void()> &fn )
+{
+    CI_LOG_V( "SETUP " << name );
+    auto start = chrono::steady_clock::now();
+    fn();
+    double ms = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+    lock_guard<mutex> lock( mStartupMutex );
+    mStartupTimings.push_back( make_pair( name, ms ) );
+}
+
+void Fragment::reportStartup()
+{
+    // Called once the working shader has compiled, i.e. when the first real frame is ready
+    double total = chrono::duration<double, milli>( chrono::steady_clock::now() - mStartupTime ).count();
+    JsonTree tree;
+    JsonTree phases = JsonTree::makeArray( "PHASES" );
+    for( auto &it : mStartupTimings ) {
+        CI_LOG_I( "STARTUP " << it.first << ": " << it.second << " MS" );
+        JsonTree phase;
+        phase.addChild( JsonTree( "NAME", it.first ) );
+        phase.addChild( JsonTree( "MS", it.second ) );
+        phases.addChild( phase );
+    }
+    CI_LOG_I( "STARTUP FIRST FRAME: " << total << " MS" );
+    tree.addChild( phases );
+    tree.addChild( JsonTree( "FIRST FRAME MS", total ) );
+    tree.write( getAppSupportPath( STARTUP_PATH ) );
+    mStartupReported = true;
+}
+
 //------------------------------------------------------------------------------
 #pragma mark - CLEANUP
 //------------------------------------------------------------------------------
 
 void Fragment::cleanup()
 {
+    stopOscRecording();
+    mRemoteServerRef.reset();
+    mThumbnailCacheRef.reset();
     saveSettings( getAppSupportWorkingSessionPath() );
+    saveSnapshot( getAppSupportWorkingSessionSettingsPath( SNAPSHOT_PATH ) );
+    // Tells the next run the files above are the latest state, see setupSnapshot()
+    {
+        ofstream marker( getAppSupportPath( CLEAN_SHUTDOWN_PATH ).string() );
+    }
+    // Scripts running jobs with --quit see failures in the exit status, the app would exit 0
+    if( mJobQueueRef && mJobQueueRef->shouldQuit() && mJobFailures > 0 ) {
+        std::exit( 1 );
+    }
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - INPUT FROM ANY WINDOW
+//------------------------------------------------------------------------------
+
+// Widgets the idle check can't read (colors, buttons) still invalidate the cached frame
+void Fragment::mouseDown( MouseEvent event )
+{
+    mFrameDirty = true;
+    mFramePacerRef->markInput();
+}
+
+void Fragment::mouseDrag( MouseEvent event )
+{
+    mFrameDirty = true;
+    mFramePacerRef->markInput();
+}
+
+void Fragment::mouseWheel( MouseEvent event )
+{
+    mFrameDirty = true;
+    mFramePacerRef->markInput();
+}
+
+void Fragment::keyDown( KeyEvent event )
+{
+    mFrameDirty = true;
+    mFramePacerRef->markInput();
 }
 
 //------------------------------------------------------------------------------
@@ -317,30 +792,56 @@ void Fragment::createSessionWorkingDirectories()
     }
 }
 
-void Fragment::createSessionExamplesDirectories()
+vector<string> Fragment::getSessionNames( const string &folder )
 {
-    //INSIDER THE APP
-    auto local = getResourcesPath( EXAMPLES_PATH );
-
-    //OUTSIDE THE APP
-    auto support = getAppSupportPath( EXAMPLES_PATH );
-
-    if( !fs::exists( support ) ) {
-        copyDirectoryRecursively( local, support );
+    // Bundled sessions together with any the user added to app support
+    set<string> names;
+    for( auto &root : { getResourcesPath( folder ), getAppSupportPath( folder ) } ) {
+        if( !fs::exists( root ) ) {
+            continue;
+        }
+        for( fs::directory_iterator it( root ), eit; it != eit; ++it ) {
+            // Hidden ones include copies still being made
+            string name = it->path().filename().string();
+            if( fs::is_directory( it->path() ) && !name.empty() && name[0] != '.' ) {
+                names.insert( name );
+            }
+        }
     }
+    return vector<string>( names.begin(), names.end() );
 }
 
-void Fragment::createSessionTutorialsDirectories()
+fs::path Fragment::getSessionPath( const string &folder, const string &name )
 {
-    //INSIDER THE APP
-    auto local = getResourcesPath( TUTORIALS_PATH );
-
-    //OUTSIDE THE APP
-    auto support = getAppSupportPath( TUTORIALS_PATH );
-
-    if( !fs::exists( support ) ) {
-        copyDirectoryRecursively( local, support );
+    // Bundled sessions are copied out of the app the first time they are opened. The copy
+    // is made next to it and renamed into place, so an interrupted one is never taken for
+    // the session. A copy without its shader, left by a build that copied in place, is
+    // made again.
+    auto support = addPath( getAppSupportPath( folder ), name );
+    auto local = addPath( getResourcesPath( folder ), name );
+    if( fs::exists( local ) && !fs::exists( addPath( addPath( support, SHADERS_PATH ), "shader.frag" ) ) ) {
+        auto partial = addPath( getAppSupportPath( folder ), "." + name + ".partial" );
+        if( fs::exists( partial ) ) {
+            fs::remove_all( partial );
+        }
+        createDirectories( partial );
+        copyDirectoryRecursively( local, partial );
+        if( fs::exists( support ) ) {
+            fs::remove_all( support );
+        }
+        fs::rename( partial, support );
     }
+    return support;
+}
+
+fs::path Fragment::getSessionSourcePath( const string &folder, const string &name )
+{
+    // Where a session's files are read from without copying it out of the app, the bundled
+    // ones stand in for a copy that never finished
+    auto support = addPath( getAppSupportPath( folder ), name );
+    auto local = addPath( getResourcesPath( folder ), name );
+    bool copied = fs::exists( addPath( addPath( support, SHADERS_PATH ), "shader.frag" ) );
+    return copied || !fs::exists( local ) ? support : local;
 }
 
 //------------------------------------------------------------------------------
@@ -352,11 +853,15 @@ void Fragment::setupOutput()
     mOutputWindowRef = getWindow();
     mOutputWindowRef->getSignalClose().connect( [this] { quit(); } );
     mOutputWindowRef->getSignalDraw().connect( [this] {
+        // Inputs are read after the pacer's wait, as close to the frame as its mode allows
+        mFramePacerRef->beginFrame();
+        sampleInputs();
         updateOutput();
         mImageSaverRef->update();
         mSequenceSaverRef->update();
         drawOutput();
         mMovieSaverRef->update();
+        mFramePacerRef->endFrame();
     } );
     mOutputWindowRef->getSignalResize().connect( [this] {
         mOutputWindowSize = mOutputWindowRef->getSize();
@@ -366,9 +871,16 @@ void Fragment::setupOutput()
         loadCamera( getAppSupportWorkingSessionSettingsPath( CAMERA_PATH ), mCameraRef->getCameraPersp(), [this]() { mCameraRef->update(); } );
     } );
     mOutputWindowRef->getSignalMove().connect( [this] { mOutputWindowOrigin = mOutputWindowRef->getPos(); } );
+    mOutputWindowRef->getSignalDisplayChange().connect( [this] {
+        mRefreshRate = QualityTiers::getRefreshRate( mOutputWindowRef->getDisplay() );
+        if( mFramePacerRef ) {
+            mFramePacerRef->setRefreshRate( mRefreshRate );
+        }
+    } );
     mOutputWindowRef->getSignalKeyDown().connect( [this]( KeyEvent event ) { keyDownOutput( event ); } );
     mOutputWindowRef->getSignalMouseDown().connect( [this]( MouseEvent event ) {
         mMousePrev = mMouseClick = mMouse = vec2( event.getPos() );
+        mMouseDragging = !event.isMetaDown();
         if( ( ( getElapsedSeconds() - mLastClick ) < mDoubleClickThreshold ) ) {
             mTexcoordOffset = vec2( 0.0f );
             mTexcoordScale = 0.0;
@@ -386,7 +898,10 @@ void Fragment::setupOutput()
             mSetupBatch = true;
         }
     } );
-    mOutputWindowRef->getSignalMouseUp().connect( [this]( MouseEvent event ) { mMouse = vec2( 0.0 ); } );
+    mOutputWindowRef->getSignalMouseUp().connect( [this]( MouseEvent event ) {
+        mMouse = vec2( 0.0 );
+        mMouseDragging = false;
+    } );
     mOutputWindowRef->getSignalMouseWheel().connect( [this]( MouseEvent event ) {
         if( event.isMetaDown() ) {
             mTexcoordScale += event.getWheelIncrement() * 0.001;
@@ -397,11 +912,23 @@ void Fragment::setupOutput()
 
 void Fragment::updateOutput()
 {
-    mOutputWindowRef->setTitle( to_string( (int)getAverageFps() ) + " FPS" );
+    string quality = mQualityTiersRef->isSpecialized() ? " Q" + to_string( mQualityTiersRef->getLiveTier() ) : "";
+    string latency = mFramePacerRef->getLatency() > 0.0 ? " " + to_string( (int)mFramePacerRef->getLatency() ) + "/" + to_string( (int)mFramePacerRef->getMaxLatency() ) + " MS LATENCY" : "";
+    mOutputWindowRef->setTitle( to_string( (int)getAverageFps() ) + " FPS " + to_string( (int)( mIdleRatio * 100.0f ) ) + "% IDLE" + quality + latency );
+
+    if( mFramePacerRef->isVerticalSync() != mVerticalSync ) {
+        applyFramePacing();
+    }
+
+    updateQualityTiers();
+    updateAnalysis();
+    updateThumbnails();
+    updateResources();
 
     if( mSetupBatch ) {
         setupBatch();
         mSetupBatch = false;
+        mFrameDirty = true;
     }
     if( mSequenceSaverRef->isRecording() ) {
         mCurrentTime = mSequenceSaverRef->getCurrentTime();
@@ -409,47 +936,624 @@ void Fragment::updateOutput()
     else if( mMovieSaverRef->isRecording() ) {
         mCurrentTime = mMovieSaverRef->getCurrentTime();
     }
+    else if( mExrSequenceFrame >= 0 ) {
+        mCurrentTime = float( mExrSequenceFrame ) / float( std::max( mTotalFrames, 1 ) );
+    }
+    else if( mTilesSequenceFrame >= 0 ) {
+        mCurrentTime = float( mTilesSequenceFrame ) / float( std::max( mTotalFrames, 1 ) );
+    }
+    else if( mJobFrame >= 0 ) {
+        mCurrentTime = float( mJobFrame ) / float( std::max( mTotalFrames, 1 ) );
+    }
     else {
         mCurrentTime = mSequenceSaverRef->getCurrentTime();
     }
+    mShaderWatcherRef->update();
+    for( auto &it : mPaletteWatcherRefs ) {
+        it->update();
+    }
+    updateOsc();
+    updateOscReplay();
+    updateRemote();
+    updateTimeline();
+    updateAudio();
+    updateTextureChannels();
+    updateSnapshot();
+}
+
+double Fragment::getAnimationSeconds()
+{
+    // Export frames are spaced at the live frame rate, so a frame lands on the same
+    // inputs no matter how long it takes to render
+    double frame = std::round( mCurrentTime * mTotalFrames );
+    return frame / getFrameRate();
+}
+
+bool Fragment::isExporting()
+{
+    return mSequenceSaverRef->isRecording() || mMovieSaverRef->isRecording() || mExrSequenceFrame >= 0 || mTilesSequenceFrame >= 0 || mJobFrame >= 0;
 }
 
 void Fragment::drawOutput()
+{
+    // The shader only runs when something it reads has changed, otherwise the last frame is
+    // presented again. Exports always render since the savers draw on their own schedule.
+    ivec2 pixels = mOutputWindowRef->toPixels( mOutputWindowRef->getSize() );
+    ivec2 canvas = mProjectorRefs.empty() ? pixels : ivec2( getCanvasSize() );
+    if( !mFrameFboRef || mFrameFboRef->getSize() != canvas ) {
+        mFrameFboRef = nullptr;
+        mFrameFboRef = mResourceManagerRef->getFbo( "FRAME", canvas, gl::Fbo::Format().disableDepth() );
+        mFrameDirty = true;
+    }
+    bool exporting = isExporting();
+    if( updateFrameHash() || exporting ) {
+        mFrameDirty = true;
+    }
+
+    if( !mSweepPath.empty() ) {
+        renderSweep( mSweepPath );
+        mSweepPath.clear();
+        mFrameDirty = true;
+    }
+    if( !mExrPath.empty() ) {
+        renderExr( mExrPath );
+        mExrPath.clear();
+    }
+    if( mExrSequenceFrame >= 0 ) {
+        renderExr( mExrSequencePath / ( mExrSequenceName + "_" + getFrameNumber( mExrSequenceFrame ) + ".exr" ) );
+        if( ++mExrSequenceFrame >= mTotalFrames ) {
+            mExrSequenceFrame = -1;
+        }
+    }
+    if( !mTilesPath.empty() ) {
+        renderTiles( mTilesPath, mTilesName, mTilesExt );
+        mTilesPath.clear();
+    }
+    if( mTilesSequenceFrame >= 0 ) {
+        renderTiles( mTilesSequencePath, mTilesSequenceName + "_" + getFrameNumber( mTilesSequenceFrame ), "png" );
+        if( ++mTilesSequenceFrame >= mTotalFrames ) {
+            mTilesSequenceFrame = -1;
+        }
+    }
+    updateJobs();
+
+    // A sparse frame left pixels to the history, a still scene gets the frames it takes to
+    // shade them too
+    bool still = false;
+    if( !mFrameDirty && mCheckerboardSettle > 0 && isCheckerboarding() ) {
+        mCheckerboardSettle--;
+        mFrameDirty = true;
+        still = true;
+    }
+
+    bool rendered = mFrameDirty;
+    if( mFrameDirty ) {
+        gl::ScopedFramebuffer scpFbo( mFrameFboRef );
+        gl::ScopedViewport scpViewport( ivec2( 0 ), mFrameFboRef->getSize() );
+        renderOutput( still );
+        if( !still && isCheckerboarding() && mCheckerboardRef ) {
+            mCheckerboardSettle = mCheckerboardRef->getPhases() - 1;
+        }
+        mFrameDirty = false;
+        mFramesDrawn++;
+    }
+    else {
+        mFramesSkipped++;
+    }
+    if( mRemoteServerRef ) {
+        mRemoteServerRef->capture( mFrameFboRef, rendered );
+    }
+    if( mProjectorRefs.empty() ) {
+        mFrameFboRef->blitToScreen( mFrameFboRef->getBounds(), Area( ivec2( 0 ), pixels ) );
+    }
+    else {
+        // The output window previews the whole canvas, the projectors present their slices of it
+        gl::clear( Color::black() );
+        mFrameFboRef->blitToScreen( mFrameFboRef->getBounds(), Area::proportionalFit( mFrameFboRef->getBounds(), Area( ivec2( 0 ), pixels ), true ) );
+    }
+
+    double now = getElapsedSeconds();
+    if( now - mIdleTime > 1.0 ) {
+        int total = mFramesDrawn + mFramesSkipped;
+        mIdleRatio = total > 0 ? float( mFramesSkipped ) / float( total ) : 0.0f;
+        mFramesDrawn = mFramesSkipped = 0;
+        mIdleTime = now;
+    }
+}
+
+void Fragment::renderOutput( bool still )
 {
     gl::clear( mBgColor );
-    vec2 size = mOutputWindowRef->getSize();
+    vec2 size = getCanvasSize();
     gl::setMatricesWindow( size );
 
     if( mGlslProgRef ) {
+        // Checkerboarding reprojects at the hit distance, which only the AOV variant writes
+        auto glsl = mGlslProgRef;
+        bool depth = false;
+        if( mCompiledGlsl && isCheckerboarding() && !mAovNames.empty() && mAovNames[0] == "Z" ) {
+            auto aov = getAovGlslProg( mVariantTier );
+            if( aov ) {
+                glsl = aov;
+                depth = true;
+            }
+        }
+        if( mCompiledGlsl ) {
+            if( mBakeGlslProgRef ) {
+                updateBake( size );
+            }
+            // Bakes are left out of the frame time, they only run when something changed
+            mFrameQueryRef->begin();
+            if( mPrepassGlslProgRef ) {
+                renderPrepass( size );
+            }
+            applyUniforms( glsl, size );
+            if( mPrepassGlslProgRef && mPrepassFboRef ) {
+                uint8_t unit = uint8_t( 2 + mTextureChannels.size() );
+                glsl->uniform( "iDepthPrepass", int( unit ) );
+                glsl->uniform( "iDepthPrepassSize", vec2( mPrepassFboRef->getSize() ) );
+                mPrepassFboRef->getColorTexture()->bind( unit );
+            }
+        }
+        if( isCheckerboarding() ) {
+            if( !mCheckerboardRef ) {
+                mCheckerboardRef = Checkerboard::create();
+            }
+            mCheckerboardRef->setMode( Checkerboard::Mode( mCheckerboardMode ) );
+            mCheckerboardRef->setFocus( mFocusCenter, mFocusRadius );
+            mCheckerboardRef->setClamp( mHistoryClamp );
+            mCheckerboardRef->render( gl::getViewport().second, getCheckerboardCamera( size ), mBgColor, depth, still, [this, glsl, size] {
+                if( glsl == mGlslProgRef ) {
+                    _drawOutput();
+                    return;
+                }
+                gl::ScopedBlendAlpha scpAlp;
+                vector<vec2> t = getTexcoords();
+                mResourceManagerRef->getRect( "OUTPUT AOV", glsl, Rectf( vec2( 0.0f ), size ), t[0], t[1], t[2], t[3] )->draw();
+            } );
+            gl::ScopedBlend scpBlend( false );
+            gl::draw( mCheckerboardRef->getTexture(), Rectf( vec2( 0.0f ), size ) );
+        }
+        else {
+            _drawOutput();
+        }
         if( mCompiledGlsl ) {
-            chrono::system_clock::time_point now = chrono::system_clock::now();
-            time_t tt = chrono::system_clock::to_time_t( now );
-            tm local_tm = *localtime( &tt );
+            mFrameQueryRef->end();
+            // Results are read a few frames late so the query never stalls the pipeline
+            if( ++mFrameQueries > kFrameQueryBuffers ) {
+                mQualityTiersRef->addFrameTime( mFrameQueryRef->getElapsedMilliseconds(), 1000.0 / mRefreshRate );
+                mAnalysisFrames++;
+            }
+        }
+    }
+}
+
+void Fragment::applyUniforms( const gl::GlslProgRef &glsl, const vec2 &size )
+{
+    chrono::system_clock::time_point now = chrono::system_clock::now();
+    time_t tt = chrono::system_clock::to_time_t( now );
+    tm local_tm = *localtime( &tt );
+
+    float hours = local_tm.tm_hour + 1.0f;
+    float minutes = hours * 60 + ( local_tm.tm_min + 1 );
+    float seconds = minutes * 60 + ( local_tm.tm_sec );
+
+    vec2 mouse = mMouse * size / vec2( mOutputWindowRef->getSize() );
+    vec2 click = mMouseClick * size / vec2( mOutputWindowRef->getSize() );
+
+    glsl->uniform( "iBackgroundColor", mBgColor );
+    glsl->uniform( "iResolution", vec3( size.x, size.y, 0.0 ) );
+    glsl->uniform( "iAspect", size.x / size.y );
+    glsl->uniform( "iGlobalTime", float( getElapsedSeconds() ) );
+    glsl->uniform( "iAnimationTime", mCurrentTime );
+    glsl->uniform( "iMouse", vec4( mouse.x, size.y - mouse.y, click.x, size.y - click.y ) );
+    glsl->uniform( "iDate", vec4( local_tm.tm_year + 1900, local_tm.tm_mon + 1, local_tm.tm_mday, seconds ) );
+    glsl->uniform( "iPalettes", 0 );
+    glsl->uniform( "iPaletteTable", mPaletteTable.data(), int( mPaletteTable.size() ) );
+    glsl->uniform( "iPaletteCount", int( mPaletteTable.size() ) );
+    glsl->uniform( "iAudio", 1 );
+    glsl->uniform( "iAudioBands", mAudioAnalyzerRef->getFrame().mBands );
+    glsl->uniform( "iAudioLevel", mAudioAnalyzerRef->getFrame().mLevel );
+
+    mat3 identity;
+    glsl->uniform( "iModelMatrix", identity );
+    glsl->uniform( "iCameraViewMatrix", mat3( mCameraRef->getCameraPersp().getViewMatrix() ) );
+    glsl->uniform( "iCameraPivotPoint", mCameraRef->getCameraPersp().getPivotPoint() );
+    glsl->uniform( "iCameraEyePoint", mCameraRef->getCameraPersp().getEyePoint() );
+    glsl->uniform( "iCameraFov", toRadians( mCameraRef->getCameraPersp().getFov() ) );
+
+    mPaletteTexRef->bind( 0 );
+    mAudioTexRef->bind( 1 );
+    for( size_t i = 0; i < mTextureChannels.size(); i++ ) {
+        auto &channel = mTextureChannels[i];
+        if( channel.mTextureRef ) {
+            glsl->uniform( channel.mName, int( 2 + i ) );
+            channel.mTextureRef->bind( uint8_t( 2 + i ) );
+        }
+    }
+    // The unit after the channels belongs to the depth prepass
+    if( mSdfBakerRef && mSdfBakerRef->isBaked() ) {
+        mSdfBakerRef->bind( glsl, uint8_t( 3 + mTextureChannels.size() ) );
+    }
+    if( mUsesNoise ) {
+        updateNoise();
+        mNoiseTexturesRef->bind( glsl, getNoiseTextureUnit() );
+    }
+    mGlslParamsRef->applyUniforms( glsl );
+}
 
-            float hours = local_tm.tm_hour + 1.0f;
-            float minutes = hours * 60 + ( local_tm.tm_min + 1 );
-            float seconds = minutes * 60 + ( local_tm.tm_sec );
+void Fragment::renderPrepass( const vec2 &size )
+{
+    // Each prepass pixel covers exactly kPrepassScale x kPrepassScale frame pixels, so the
+    // canvas is stretched over the part of the target that lines up with the frame
+    ivec2 frame = gl::getViewport().second;
+    ivec2 pixels = ( frame + ivec2( kPrepassScale - 1 ) ) / kPrepassScale;
+    if( !mPrepassFboRef || mPrepassFboRef->getSize() != pixels ) {
+        auto texFmt = gl::Texture2d::Format().internalFormat( GL_R32F ).minFilter( GL_NEAREST ).magFilter( GL_NEAREST );
+        mPrepassFboRef = nullptr;
+        mPrepassFboRef = mResourceManagerRef->getFbo( "PREPASS", pixels, gl::Fbo::Format().disableDepth().colorTexture( texFmt ) );
+    }
+    vec2 extent = size * vec2( pixels * kPrepassScale ) / vec2( frame );
+
+    gl::ScopedFramebuffer scpFbo( mPrepassFboRef );
+    gl::ScopedViewport scpViewport( ivec2( 0 ), pixels );
+    gl::ScopedMatrices scpMatrices;
+    gl::setMatricesWindow( extent );
+    gl::clear( Color( 0.0f, 0.0f, 0.0f ) );
+    applyUniforms( mPrepassGlslProgRef, size );
+    mPrepassGlslProgRef->uniform( "iDepthPrepassSize", vec2( pixels ) );
+    if( mPrepassBatchRef ) {
+        mPrepassBatchRef->draw();
+    }
+}
+
+void Fragment::setupBake( const gl::GlslProgRef &glsl )
+{
+    const vector<string> &sources = mVariantSources;
+    mBakeGlslProgRef = glsl;
+    if( !mBakeGlslProgRef ) {
+        if( mSdfBakerRef ) {
+            mSdfBakerRef->clear();
+        }
+        return;
+    }
+    if( !mSdfBakerRef ) {
+        mSdfBakerRef = SdfBaker::create();
+    }
+    // The session's own defines come before the include's defaults
+    mBakeResolution = 128;
+    mBakeSparse = false;
+    string resolution;
+    if( findDefine( sources, "BAKE_RESOLUTION", &resolution ) ) {
+        mBakeResolution = std::min( std::max( atoi( resolution.c_str() ), 8 ), 512 );
+    }
+    mBakeSparse = findDefine( sources, "BAKE_SPARSE" );
+    mBakeDirty = true;
+
+    // The bake variant only runs BAKE_SDF, so the params still active in it are the ones
+    // it reads. Animating any other param leaves the bake alone.
+    mBakeParamGetters.clear();
+    auto ui = mUIRef->getUI( SHADER_UI );
+    if( ui == nullptr ) {
+        return;
+    }
+    set<string> read;
+    for( auto &it : mBakeGlslProgRef->getActiveUniforms() ) {
+        read.insert( it.mName );
+    }
+    for( auto &view : ui->getSubViews() ) {
+        if( read.count( view->getName() ) ) {
+            addParamGetters( view.get(), mBakeParamGetters );
+        }
+    }
+}
+
+void Fragment::updateBake( const vec2 &size )
+{
+    // Whatever BAKE_SDF reads from the params is baked in, so a change to one rebakes
+    size_t hash = 0;
+    for( auto &it : mBakeParamGetters ) {
+        hash ^= std::hash<float>()( it() ) + 0x9e3779b9 + ( hash << 6 ) + ( hash >> 2 );
+    }
+    if( !mBakeDirty && hash == mBakeParamsHash ) {
+        return;
+    }
+    mSdfBakerRef->bake( mBakeGlslProgRef, mBakeResolution, mBakeSparse, [this, size]( const gl::GlslProgRef &glsl ) { applyUniforms( glsl, size ); } );
+    mBakeParamsHash = hash;
+    mBakeDirty = false;
+}
+
+gl::GlslProgRef Fragment::compileVariant( const vector<string> &sources, const vector<string> &defines )
+{
+    if( sources.size() < 2 ) {
+        return nullptr;
+    }
+    string header;
+    for( auto &it : defines ) {
+        header += "#define " + it + "\n";
+    }
+    // The defines have to follow the #version line when the shader has one
+    string fragment = sources[1];
+    size_t pos = fragment.compare( 0, 8, "#version" ) == 0 ? fragment.find( '\n' ) + 1 : 0;
+    fragment.insert( pos, header );
+    try {
+        return gl::GlslProg::create( gl::GlslProg::Format().vertex( sources[0] ).fragment( fragment ).fragDataLocation( 0, "oColor" ).fragDataLocation( 1, "oAov" ) );
+    }
+    catch( const ci::Exception &exc ) {
+        CI_LOG_E( "Unable to compile shader variant: " << exc.what() );
+    }
+    return nullptr;
+}
+
+void Fragment::setupVariants( const vector<string> &sources )
+{
+    mVariantSources = sources;
+    for( int tier = 0; tier < QualityTiers::kTiers; tier++ ) {
+        mPrepassTierRefs[tier] = nullptr;
+        mBakeTierRefs[tier] = nullptr;
+        mAovTierRefs[tier] = nullptr;
+    }
+    // The old passes trace another scene, so a new build compiles its own right away, just
+    // like the live program it came with
+    bool specialized = mQualityTiersRef->isSpecialized();
+    int tier = specialized ? mQualityTiersRef->getLiveTier() : QualityTiers::kDefaultTier;
+    auto compile = [this, specialized, tier]( const string &define ) {
+        vector<string> defines = { define };
+        if( specialized ) {
+            defines.push_back( "FRAGMENT_QUALITY " + to_string( tier ) );
+        }
+        return compileVariant( mVariantSources, defines );
+    };
+    // Sphere traced shaders that ask for it get a low resolution pass seeding their rays
+    if( mUsesDepthPrepass ) {
+        mPrepassTierRefs[tier] = compile( "SPHERETRACE_PREPASS" );
+    }
+    if( mUsesBakedSdf ) {
+        mBakeTierRefs[tier] = compile( "SDF_BAKE_PASS" );
+    }
+    mVariantTier = tier;
+    applyVariants( tier );
+}
+
+gl::GlslProgRef Fragment::getAovGlslProg( int tier )
+{
+    if( mAovNames.empty() ) {
+        return nullptr;
+    }
+    bool specialized = mQualityTiersRef->isSpecialized();
+    tier = specialized ? std::min( std::max( tier, 0 ), QualityTiers::kTiers - 1 ) : QualityTiers::kDefaultTier;
+    auto &glsl = mAovTierRefs[tier];
+    if( !glsl ) {
+        vector<string> defines = { "FRAGMENT_AOV_EXPORT" };
+        if( specialized ) {
+            defines.push_back( "FRAGMENT_QUALITY " + to_string( tier ) );
+        }
+        glsl = compileVariant( mVariantSources, defines );
+    }
+    return glsl;
+}
+
+void Fragment::updateVariants()
+{
+    // Variants the worker finished are kept for their tier even if live output moved on
+    int done;
+    vector<gl::GlslProgRef> glsls;
+    if( mQualityTiersRef->getVariants( done, glsls ) ) {
+        size_t index = 0;
+        if( mUsesDepthPrepass && index < glsls.size() ) {
+            mPrepassTierRefs[done] = glsls[index++];
+        }
+        if( mUsesBakedSdf && index < glsls.size() ) {
+            mBakeTierRefs[done] = glsls[index++];
+        }
+        if( done == mVariantTier ) {
+            applyVariants( done );
+        }
+    }
+
+    bool specialized = mQualityTiersRef->isSpecialized();
+    int tier = specialized ? mQualityTiersRef->getLiveTier() : QualityTiers::kDefaultTier;
+    if( tier == mVariantTier || mVariantSources.empty() ) {
+        return;
+    }
+    mVariantTier = tier;
+    bool prepass = mUsesDepthPrepass && !mPrepassTierRefs[tier];
+    bool bake = mUsesBakedSdf && !mBakeTierRefs[tier];
+    if( !prepass && !bake ) {
+        applyVariants( tier );
+        return;
+    }
+    // A tier changes when frames run over budget, so its passes compile on the tiers' worker
+    // and the ones in use stay until both are ready
+    vector<string> defines;
+    if( mUsesDepthPrepass ) {
+        defines.push_back( "SPHERETRACE_PREPASS" );
+    }
+    if( mUsesBakedSdf ) {
+        defines.push_back( "SDF_BAKE_PASS" );
+    }
+    mQualityTiersRef->compileVariants( tier, defines );
+}
+
+void Fragment::applyVariants( int tier )
+{
+    mPrepassGlslProgRef = mUsesDepthPrepass ? mPrepassTierRefs[tier] : nullptr;
+    setupBake( mUsesBakedSdf ? mBakeTierRefs[tier] : nullptr );
+    mSetupBatch = true;
+}
+
+bool Fragment::findDefine( const vector<string> &sources, const string &name, string *value )
+{
+    // Only directives that start a line count, the includes mention theirs in comments
+    if( sources.size() < 2 ) {
+        return false;
+    }
+    smatch match;
+    if( !regex_search( sources[1], match, regex( "(^|\\n)[ \\t]*#define[ \\t]+" + name + "\\b[ \\t]*([^\\n]*)" ) ) ) {
+        return false;
+    }
+    if( value != nullptr ) {
+        *value = match[2].str();
+    }
+    return true;
+}
+
+bool Fragment::updateFrameHash()
+{
+    if( mUsesGlobalTime ) {
+        return true;
+    }
+
+    size_t hash = 0;
+    auto combine = [&hash]( double value ) {
+        hash ^= std::hash<double>()( value ) + 0x9e3779b9 + ( hash << 6 ) + ( hash >> 2 );
+    };
+
+    for( int i = 0; i < 4; i++ ) {
+        combine( mBgColor[i] );
+    }
+    if( mUsesAnimationTime ) {
+        combine( mCurrentTime );
+    }
+    if( mUsesDate ) {
+        combine( double( time( nullptr ) ) );
+    }
+    if( mUsesMouse ) {
+        combine( mMouse.x );
+        combine( mMouse.y );
+        combine( mMouseClick.x );
+        combine( mMouseClick.y );
+    }
+    const auto &cam = mCameraRef->getCameraPersp();
+    mat4 view = cam.getViewMatrix();
+    for( int i = 0; i < 4; i++ ) {
+        for( int j = 0; j < 4; j++ ) {
+            combine( view[i][j] );
+        }
+    }
+    combine( cam.getFov() );
+    for( auto &it : mParamGetters ) {
+        combine( it() );
+    }
+
+    bool changed = hash != mFrameHash;
+    mFrameHash = hash;
+    return changed;
+}
+
+void Fragment::reflectUniforms()
+{
+    // Names come from the linked program, so uniforms the compiler dropped don't count
+    mUsesGlobalTime = mUsesAnimationTime = mUsesDate = mUsesMouse = mUsesAudio = mUsesDepthPrepass = mUsesBakedSdf = mUsesNoise = false;
+    for( auto &it : mGlslProgRef->getActiveUniforms() ) {
+        const string &name = it.mName;
+        if( name == "iGlobalTime" ) {
+            mUsesGlobalTime = true;
+        }
+        else if( name == "iAnimationTime" ) {
+            mUsesAnimationTime = true;
+        }
+        else if( name == "iDate" ) {
+            mUsesDate = true;
+        }
+        else if( name == "iMouse" ) {
+            mUsesMouse = true;
+        }
+        else if( name == "iAudio" || name == "iAudioBands" || name == "iAudioLevel" ) {
+            mUsesAudio = true;
+        }
+        else if( name == "iDepthPrepass" ) {
+            mUsesDepthPrepass = true;
+        }
+        else if( name == "iBakedSdf" ) {
+            mUsesBakedSdf = true;
+        }
+        else if( name == "iNoise2D" || name == "iNoise3D" || name == "iCellular2D" || name == "iCellular3D" ) {
+            mUsesNoise = true;
+        }
+    }
+    // Start generating now so the first frame that binds it waits on as little as possible
+    if( mUsesNoise && !mNoiseTexturesRef->isUploaded() && !mNoiseGenerate.valid() ) {
+        auto noise = mNoiseTexturesRef;
+        mNoiseGenerate = async( launch::async, [noise] { noise->generate(); } );
+    }
+    mFrameDirty = true;
+}
 
-            mGlslProgRef->uniform( "iBackgroundColor", mBgColor );
-            mGlslProgRef->uniform( "iResolution", vec3( size.x, size.y, 0.0 ) );
-            mGlslProgRef->uniform( "iAspect", mOutputWindowRef->getAspectRatio() );
-            mGlslProgRef->uniform( "iGlobalTime", float( getElapsedSeconds() ) );
-            mGlslProgRef->uniform( "iAnimationTime", mCurrentTime );
-            mGlslProgRef->uniform( "iMouse", vec4( mMouse.x, size.y - mMouse.y, mMouseClick.x, size.y - mMouseClick.y ) );
-            mGlslProgRef->uniform( "iDate", vec4( local_tm.tm_year + 1900, local_tm.tm_mon + 1, local_tm.tm_mday, seconds ) );
-            mGlslProgRef->uniform( "iPalettes", 0 );
+void Fragment::updateNoise()
+{
+    if( mNoiseTexturesRef->isUploaded() ) {
+        return;
+    }
+    // Every frame that samples noise has to have it, so the first one blocks on the rest of the generate
+    if( mNoiseGenerate.valid() ) {
+        mNoiseGenerate.get();
+    }
+    else {
+        mNoiseTexturesRef->generate();
+    }
+    mNoiseTexturesRef->upload();
+    if( mThumbnailCacheRef ) {
+        updateThumbnailEnvironment();
+    }
+}
 
-            mat3 identity;
-            mGlslProgRef->uniform( "iModelMatrix", identity );
-            mGlslProgRef->uniform( "iCameraViewMatrix", mat3( mCameraRef->getCameraPersp().getViewMatrix() ) );
-            mGlslProgRef->uniform( "iCameraPivotPoint", mCameraRef->getCameraPersp().getPivotPoint() );
-            mGlslProgRef->uniform( "iCameraEyePoint", mCameraRef->getCameraPersp().getEyePoint() );
-            mGlslProgRef->uniform( "iCameraFov", toRadians( mCameraRef->getCameraPersp().getFov() ) );
+void Fragment::bindParamGetters()
+{
+    mParamGetters.clear();
+    auto ui = mUIRef->getUI( SHADER_UI );
+    if( ui == nullptr ) {
+        return;
+    }
+    for( auto &view : ui->getSubViews() ) {
+        addParamGetters( view.get(), mParamGetters );
+    }
+}
 
-            mPaletteTexRef->bind( 0 );
-            mGlslParamsRef->applyUniforms( mGlslProgRef );
+void Fragment::addParamGetters( View *view, vector<function<float()>> &getters )
+{
+    string type = view->getType();
+    if( type == "Sliderf" ) {
+        getters.push_back( [view] { return static_cast<Sliderf *>( view )->getValue(); } );
+    }
+    else if( type == "Slideri" ) {
+        getters.push_back( [view] { return float( static_cast<Slideri *>( view )->getValue() ); } );
+    }
+    else if( type == "Dialerf" ) {
+        getters.push_back( [view] { return static_cast<Dialerf *>( view )->getValue(); } );
+    }
+    else if( type == "Dialeri" ) {
+        getters.push_back( [view] { return float( static_cast<Dialeri *>( view )->getValue() ); } );
+    }
+    else if( type == "Toggle" ) {
+        getters.push_back( [view] { return static_cast<Toggle *>( view )->getValue() ? 1.0f : 0.0f; } );
+    }
+    else if( type == "XYPad" ) {
+        getters.push_back( [view] { return static_cast<XYPad *>( view )->getValue().x; } );
+        getters.push_back( [view] { return static_cast<XYPad *>( view )->getValue().y; } );
+    }
+    else if( type == "Rangef" ) {
+        getters.push_back( [view] { return static_cast<Rangef *>( view )->getValueLow(); } );
+        getters.push_back( [view] { return static_cast<Rangef *>( view )->getValueHigh(); } );
+    }
+    else if( type == "Rangei" ) {
+        getters.push_back( [view] { return float( static_cast<Rangei *>( view )->getValueLow() ); } );
+        getters.push_back( [view] { return float( static_cast<Rangei *>( view )->getValueHigh() ); } );
+    }
+    else if( type == "ColorPicker" ) {
+        ColorPicker *widget = static_cast<ColorPicker *>( view );
+        for( int i = 0; i < 4; i++ ) {
+            getters.push_back( [widget, i] { return widget->getColor()[i]; } );
+        }
+    }
+    else if( type == "MultiSlider" ) {
+        MultiSlider *widget = static_cast<MultiSlider *>( view );
+        vector<string> suffixes = { "-X", "-Y", "-Z", "-W" };
+        int total = std::min( int( widget->getSubViews().size() ), int( suffixes.size() ) );
+        for( int i = 0; i < total; i++ ) {
+            string key = view->getName() + suffixes[i];
+            getters.push_back( [widget, key] { return widget->getValue( key ); } );
         }
-        _drawOutput();
     }
 }
 
@@ -463,8 +1567,19 @@ void Fragment::_drawOutput( const vec2 &ul, const vec2 &ur, const vec2 &lr, cons
 {
     gl::ScopedBlendAlpha scpAlp;
     vec2 size = mOutputWindowRef->getSize();
-    auto batch = gl::Batch::create( geom::Rect( Rectf( 0.0f, 0.0f, size.x, size.y ) ).texCoords( ul, ur, lr, ll ), mGlslProgRef );
-    batch->draw();
+    // Exports draw with the highest quality tier, waiting for it if it's still compiling
+    auto glsl = mCompiledGlsl ? mQualityTiersRef->getExportGlslProg() : nullptr;
+    if( glsl && glsl != mGlslProgRef ) {
+        applyUniforms( glsl, getCanvasSize() );
+    }
+    else {
+        glsl = mGlslProgRef;
+    }
+    // Export tiles don't line up with the prepass, rays march from the camera instead
+    if( mPrepassGlslProgRef ) {
+        glsl->uniform( "iDepthPrepassSize", vec2( 0.0f ) );
+    }
+    mResourceManagerRef->getRect( "EXPORT", glsl, Rectf( 0.0f, 0.0f, size.x, size.y ), ul, ur, lr, ll )->draw();
 }
 
 void Fragment::keyDownOutput( KeyEvent event )
@@ -512,28 +1627,388 @@ void Fragment::keyDownOutput( KeyEvent event )
 }
 
 //------------------------------------------------------------------------------
-#pragma mark - BATCH
+#pragma mark - PROJECTORS
 //------------------------------------------------------------------------------
 
-void Fragment::setupBatch()
+void Fragment::setupProjectors()
 {
-    if( mGlslProgRef ) {
-        vec2 size = mOutputWindowRef->getSize();
-        vector<vec2> texcoords = { vec2( 0.0, 1.0 ), vec2( 1.0, 1.0 ), vec2( 1.0, 0.0 ), vec2( 0.0, 0.0 ) };
-        for( auto &it : texcoords ) {
-            it += normalize( vec2( 0.5 ) - it ) * mTexcoordScale;
-            it += mTexcoordOffset;
-        }
-        auto geo = geom::Rect( Rectf( 0.0f, 0.0f, size.x, size.y ) );
-        geo.texCoords( texcoords[0], texcoords[1], texcoords[2], texcoords[3] );
-        mBatchRef = gl::Batch::create( geo, mGlslProgRef );
+    // Every projector shows a slice of one canvas that the shader renders once per frame in
+    // the output window's draw, which runs before the projector windows' draws
+    auto formats = Projector::load( getAppSupportPath( OUTPUTS_PATH ), mCanvasSize );
+    if( formats.empty() ) {
+        return;
+    }
+    if( mCanvasSize.x <= 0 || mCanvasSize.y <= 0 ) {
+        mCanvasSize = mOutputWindowRef->toPixels( mOutputWindowRef->getSize() );
+    }
+    for( auto &it : formats ) {
+        auto projector = Projector::create( it, [this]() -> gl::Texture2dRef { return mFrameFboRef ? mFrameFboRef->getColorTexture() : nullptr; } );
+        projector->getWindow()->getSignalKeyDown().connect( [this]( KeyEvent event ) { keyDownOutput( event ); } );
+        mProjectorRefs.push_back( projector );
     }
+
+    mSetupBatch = true;
+    mFrameDirty = true;
 }
 
-void Fragment::drawBatch()
+vec2 Fragment::getCanvasSize()
 {
-    gl::ScopedColor scpClr( ColorA( 1.0, 0.0, 0.0, 1.0 ) );
-    if( mBatchRef ) {
+    if( mJobSize.x > 0 && mJobSize.y > 0 ) {
+        return vec2( mJobSize );
+    }
+    return mProjectorRefs.empty() ? vec2( mOutputWindowRef->getSize() ) : vec2( mCanvasSize );
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - FRAME PACING
+//------------------------------------------------------------------------------
+
+void Fragment::setupFramePacing()
+{
+    mRefreshRate = QualityTiers::getRefreshRate( mOutputWindowRef->getDisplay() );
+    mFramePacerRef = FramePacer::create( mRefreshRate );
+    mFramePacerRef->setMode( FramePacer::Mode( mPacingMode ) );
+    mFramePacerRef->setDelay( mPacingDelay );
+    applyFramePacing();
+}
+
+void Fragment::applyFramePacing()
+{
+    // Only the last window to present waits for the vertical blank, so all outputs flip
+    // within the same refresh instead of each one costing a frame
+    mVerticalSync = mFramePacerRef->isVerticalSync();
+    mOutputWindowRef->getRenderer()->makeCurrentContext();
+    gl::enableVerticalSync( mVerticalSync && mProjectorRefs.empty() );
+    for( size_t i = 0; i < mProjectorRefs.size(); i++ ) {
+        mProjectorRefs[i]->getWindow()->getRenderer()->makeCurrentContext();
+        gl::enableVerticalSync( mVerticalSync && i + 1 == mProjectorRefs.size() );
+    }
+    mOutputWindowRef->getRenderer()->makeCurrentContext();
+    // The output window's swap paces the loop. A projector's swap doesn't hold up the
+    // output window's draw, so with projectors the app's frame rate keeps the pace.
+    if( mProjectorRefs.empty() || mPacingMode == FramePacer::UNCAPPED ) {
+        disableFrameRate();
+    }
+    else {
+        setFrameRate( getFrameRate() );
+    }
+}
+
+void Fragment::sampleInputs()
+{
+    // OSC that came in while the frame waited is handed over now rather than a frame later
+    io_service().poll();
+    if( mMouseDragging ) {
+        vec2 mouse = vec2( getMousePos() - mOutputWindowRef->getPos() );
+        if( mouse != mMouse ) {
+            mMouse = mouse;
+            mFramePacerRef->markInput();
+        }
+    }
+    mFramePacerRef->latchInputs();
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - QUALITY TIERS
+//------------------------------------------------------------------------------
+
+void Fragment::setupQualityTiers()
+{
+    // Tiers compile on a worker with a context of its own, sharing programs with this one
+    mOutputWindowRef->getRenderer()->makeCurrentContext();
+    mQualityTiersRef = QualityTiers::create( [this]( const vector<string> &sources, const vector<string> &defines ) {
+        return compileVariant( sources, defines );
+    } );
+    mFrameQueryRef = gl::QueryTimeSwapped::create( kFrameQueryBuffers );
+}
+
+void Fragment::updateQualityTiers()
+{
+    mQualityTiersRef->update();
+    if( mQualityTiersRef->isAuto() ) {
+        mQualityTier = mQualityTiersRef->getTier();
+    }
+    if( !mCompiledGlsl ) {
+        return;
+    }
+    auto glsl = mQualityTiersRef->getLiveGlslProg();
+    if( glsl && glsl != mGlslProgRef ) {
+        mGlslProgRef = glsl;
+        mSetupBatch = true;
+    }
+    updateVariants();
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - RESOURCES
+//------------------------------------------------------------------------------
+
+void Fragment::setupResources()
+{
+    mResourceManagerRef->addSource( "NOISE", ResourceManager::GPU, [this] { return mNoiseTexturesRef->getByteSize(); } );
+    mResourceManagerRef->addSource( "CHANNELS", ResourceManager::GPU, [this] { return mTextureCacheRef->getByteSize(); } );
+    mResourceManagerRef->addSource( "SDF BAKE", ResourceManager::GPU, [this] { return mSdfBakerRef ? mSdfBakerRef->getByteSize() : 0; } );
+    applyBudgets();
+}
+
+void Fragment::applyBudgets()
+{
+    size_t mb = 1024 * 1024;
+    mResourceManagerRef->setBudget( ResourceManager::GPU, size_t( std::max( mGpuBudget, 0 ) ) * mb );
+    mResourceManagerRef->setBudget( ResourceManager::CPU, size_t( std::max( mCpuBudget, 0 ) ) * mb );
+    // Channel images may take half of the GPU budget before the least used go
+    mTextureCacheRef->setByteBudget( mGpuBudget > 0 ? size_t( mGpuBudget ) * mb / 2 : size_t( 1024 ) * mb );
+}
+
+void Fragment::updateResources()
+{
+    double now = getElapsedSeconds();
+    if( now - mResourcesTime < 1.0 ) {
+        return;
+    }
+    mResourcesTime = now;
+    mResourceManagerRef->trim();
+    updateMemoryLabels();
+}
+
+void Fragment::updateMemoryLabels()
+{
+    if( mMemoryLabelRefs.empty() ) {
+        return;
+    }
+    auto format = []( size_t bytes ) {
+        return bytes < 1024 * 1024 ? to_string( ( bytes + 1023 ) / 1024 ) + " KB" : to_string( ( bytes + 512 * 1024 ) / ( 1024 * 1024 ) ) + " MB";
+    };
+    vector<string> lines;
+    for( auto pool : { ResourceManager::GPU, ResourceManager::CPU } ) {
+        size_t budget = mResourceManagerRef->getBudget( pool );
+        string name = pool == ResourceManager::GPU ? "GPU: " : "CPU: ";
+        lines.push_back( name + format( mResourceManagerRef->getBytes( pool ) ) + ( budget > 0 ? " OF " + format( budget ) : "" ) );
+    }
+    for( auto &it : mResourceManagerRef->getUsage() ) {
+        lines.push_back( it.mCategory + ( it.mPool == ResourceManager::GPU ? " GPU: " : " CPU: " ) + format( it.mBytes ) );
+    }
+    for( size_t i = 0; i < mMemoryLabelRefs.size(); i++ ) {
+        mMemoryLabelRefs[i]->setLabel( i < lines.size() ? lines[i] : "" );
+    }
+}
+
+bool Fragment::fitsImage( int scale )
+{
+    // The image savers hold the whole 8 bit image while they put it together
+    vec2 size = getCanvasSize() * float( std::max( scale, 1 ) );
+    return mResourceManagerRef->fits( ResourceManager::CPU, size_t( size.x ) * size_t( size.y ) * 4 );
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - THUMBNAILS
+//------------------------------------------------------------------------------
+
+void Fragment::setupThumbnails()
+{
+    // Like the tiers, thumbnails render on a worker sharing objects with the output context
+    mOutputWindowRef->getRenderer()->makeCurrentContext();
+    // Sessions without includes of their own get the bundled ones, never the ones being edited
+    mThumbnailCacheRef = ThumbnailCache::create( getAppSupportPath( THUMBNAILS_PATH ), addPath( getResourcesDefaultShadersPath(), "Common" ), mThumbnailSize, [this]( const vector<string> &sources, const vector<string> &defines ) {
+        return compileVariant( sources, defines );
+    } );
+    mThumbnailPlaceholderRef = gl::Texture2d::create( Surface8u( mThumbnailSize * ThumbnailCache::kFrames, mThumbnailSize, false ) );
+    updateThumbnailEnvironment();
+}
+
+void Fragment::updateThumbnailEnvironment()
+{
+    ThumbnailCache::Environment environment;
+    environment.mPalettes = mPaletteTexRef;
+    environment.mPaletteTable = mPaletteTable;
+    // The thumbnail worker only sees the noise once it's uploaded, never while it's being replaced
+    environment.mNoiseTextures = mNoiseTexturesRef->isUploaded() ? mNoiseTexturesRef : nullptr;
+    environment.mFov = mCameraRef->getCameraPersp().getFov();
+    mThumbnailCacheRef->setEnvironment( environment );
+}
+
+void Fragment::updateThumbnails()
+{
+    // Exports get the GPU to themselves
+    mThumbnailCacheRef->setPaused( isExporting() );
+    if( mThumbnailCacheRef->update() ) {
+        for( auto &it : mBrowserPreviewRefs ) {
+            updateBrowserPreview( it.first );
+        }
+    }
+    // A session that samples noise gets it generated for its thumbnail, without holding up the frame
+    if( mThumbnailCacheRef->isWaitingForNoise() && !mNoiseTexturesRef->isUploaded() ) {
+        if( !mNoiseGenerate.valid() ) {
+            auto noise = mNoiseTexturesRef;
+            mNoiseGenerate = async( launch::async, [noise] { noise->generate(); } );
+        }
+        else if( mNoiseGenerate.wait_for( chrono::seconds( 0 ) ) == future_status::ready ) {
+            updateNoise();
+        }
+    }
+}
+
+void Fragment::updateBrowserPreview( const string &folder )
+{
+    auto view = mBrowserPreviewRefs.find( folder );
+    if( view == mBrowserPreviewRefs.end() || !view->second ) {
+        return;
+    }
+    auto &name = mBrowserSelection[folder];
+    auto texture = name.empty() ? nullptr : mThumbnailCacheRef->get( folder + "/" + name );
+    view->second->setTexture( texture ? texture : mThumbnailPlaceholderRef );
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - SHADER ANALYSIS
+//------------------------------------------------------------------------------
+void Fragment::analyzeShader( int tier )
+{
+    mAnalysisTier = tier;
+    mAnalysisFrames = 0;
+    mAnalysisTimed = false;
+    auto it = mAnalysisTiers.find( tier );
+    if( it != mAnalysisTiers.end() ) {
+        mAnalysisQueued = false;
+        mShaderAnalysisRef = it->second;
+        writeAnalysis();
+        return;
+    }
+    mAnalysisQueued = true;
+    startAnalysis();
+}
+
+void Fragment::startAnalysis()
+{
+    if( !mAnalysisQueued || mAnalysisJob.valid() ) {
+        return;
+    }
+    mAnalysisQueued = false;
+    if( mAnalysisSources.size() < 2 ) {
+        return;
+    }
+    vector<string> defines;
+    if( mQualityTiersRef->isSpecialized() ) {
+        defines.push_back( "FRAGMENT_QUALITY " + to_string( mAnalysisTier ) );
+    }
+    string source = mAnalysisSources[1];
+    mAnalysisJob = async( launch::async, [source, defines] { return ShaderAnalysis::create( source, defines ); } );
+}
+
+void Fragment::writeAnalysis()
+{
+    // Recompiles that leave the source alone and tier switches back and forth come to the
+    // same analysis, the file is left as it is
+    string json = mShaderAnalysisRef->serialize();
+    if( json == mAnalysisJson ) {
+        return;
+    }
+    mAnalysisJson = json;
+    ofstream stream( getAppSupportPath( ANALYSIS_PATH ).string(), ios::trunc );
+    stream << json;
+}
+
+void Fragment::updateAnalysis()
+{
+    bool changed = false;
+    if( mAnalysisJob.valid() && mAnalysisJob.wait_for( chrono::seconds( 0 ) ) == future_status::ready ) {
+        auto analysis = mAnalysisJob.get();
+        // A newer request or a failed compile since makes this one stale
+        if( !mAnalysisQueued && mCompiledGlsl && !mAnalysisTiers.count( mAnalysisTier ) ) {
+            mAnalysisTiers[mAnalysisTier] = analysis;
+            mShaderAnalysisRef = analysis;
+            writeAnalysis();
+            changed = true;
+        }
+    }
+    startAnalysis();
+    if( !mShaderAnalysisRef ) {
+        return;
+    }
+    // The estimate has to be of the tier that is being measured
+    if( mQualityTiersRef->isSpecialized() && mQualityTiersRef->getLiveTier() != mAnalysisTier ) {
+        analyzeShader( mQualityTiersRef->getLiveTier() );
+        return;
+    }
+    if( !mAnalysisTimed && mAnalysisFrames >= kAnalysisFrames && !mAnalysisJob.valid() && !mAnalysisQueued ) {
+        mAnalysisTimed = true;
+        mShaderAnalysisRef->setGpuMilliseconds( mQualityTiersRef->getFrameTime() );
+        writeAnalysis();
+        changed = true;
+    }
+    if( changed ) {
+        auto ui = mUIRef->getUI( CONSOLE_UI );
+        if( ui != nullptr ) {
+            ui->clear();
+            setupConsoleUI( ui );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - CHECKERBOARD
+//------------------------------------------------------------------------------
+bool Fragment::isCheckerboarding()
+{
+    // Exports and everything else that saves frames always shade every pixel
+    return mCheckerboardMode != Checkerboard::FULL && mCompiledGlsl && !isExporting();
+}
+
+Checkerboard::Camera Fragment::getCheckerboardCamera( const vec2 &size )
+{
+    // The same values applyUniforms gives the shader
+    const auto &cam = mCameraRef->getCameraPersp();
+    vector<vec2> texcoords = getTexcoords();
+    Checkerboard::Camera camera;
+    camera.mViewMatrix = mat3( cam.getViewMatrix() );
+    camera.mEyePoint = cam.getEyePoint();
+    camera.mFov = toRadians( cam.getFov() );
+    camera.mAspect = size.x / size.y;
+    camera.mTexcoordMin = texcoords[3];
+    camera.mTexcoordMax = texcoords[1];
+    return camera;
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - BATCH
+//------------------------------------------------------------------------------
+
+void Fragment::setupBatch()
+{
+    if( mGlslProgRef ) {
+        // Resizes and pans rewrite the vertices of the batches already there
+        Rectf rect( vec2( 0.0f ), getCanvasSize() );
+        vector<vec2> t = getTexcoords();
+        mBatchRef = mResourceManagerRef->getRect( "OUTPUT", mGlslProgRef, rect, t[0], t[1], t[2], t[3] );
+        mPrepassBatchRef = mPrepassGlslProgRef ? mResourceManagerRef->getRect( "OUTPUT PREPASS", mPrepassGlslProgRef, rect, t[0], t[1], t[2], t[3] ) : nullptr;
+    }
+}
+
+// Upper left, upper right, lower right and lower left of the view into the shader
+vector<vec2> Fragment::getTexcoords()
+{
+    vector<vec2> texcoords = { vec2( 0.0, 1.0 ), vec2( 1.0, 1.0 ), vec2( 1.0, 0.0 ), vec2( 0.0, 0.0 ) };
+    for( auto &it : texcoords ) {
+        it += normalize( vec2( 0.5 ) - it ) * mTexcoordScale;
+        it += mTexcoordOffset;
+    }
+    return texcoords;
+}
+
+// The same corners for the part of the view from uv0 to uv1, the upper left being zero
+vector<vec2> Fragment::getTexcoords( const vec2 &uv0, const vec2 &uv1 )
+{
+    vector<vec2> corners = getTexcoords();
+    auto at = [&corners]( float u, float v ) {
+        return mix( mix( corners[0], corners[1], u ), mix( corners[3], corners[2], u ), v );
+    };
+    return { at( uv0.x, uv0.y ), at( uv1.x, uv0.y ), at( uv1.x, uv1.y ), at( uv0.x, uv1.y ) };
+}
+
+void Fragment::drawBatch()
+{
+    gl::ScopedColor scpClr( ColorA( 1.0, 0.0, 0.0, 1.0 ) );
+    if( mBatchRef ) {
         mBatchRef->draw();
     }
     else {
@@ -585,11 +2060,76 @@ UIPanelRef Fragment::setupAppUI( UIPanelRef ui )
     } );
     ui->down();
     ui->addSpacer();
+    auto oscCb = [this]( bool value ) { setupOsc(); };
     auto dialer = ui->addDialeri( "OSC PORT", &mOscPort, 0, 65535 );
     dialer->setTrigger( Trigger::END );
     dialer->setCallback( [this]( int value ) {
         setupOsc();
     } );
+    ui->right();
+    auto ports = ui->addDialeri( "PORTS", &mOscPortCount, 1, 16, Dialeri::Format().label( false ) );
+    ports->setTrigger( Trigger::END );
+    ports->setCallback( [this]( int value ) {
+        setupOsc();
+    } );
+    ui->down();
+    ui->addToggle( "UDP", &mOscUdp )->setCallback( oscCb );
+    ui->right();
+    ui->addToggle( "TCP", &mOscTcp )->setCallback( oscCb );
+    ui->addToggle( "REC OSC", false )->setCallback( [this]( bool value ) {
+        if( !mLoadingSettings ) {
+            if( value ) {
+                startOscRecording();
+            }
+            else {
+                stopOscRecording();
+            }
+        }
+    } );
+    ui->down();
+    auto remoteCb = [this]( int value ) { setupRemote(); };
+    ui->addToggle( "REMOTE", &mRemote )->setCallback( [this]( bool value ) { setupRemote(); } );
+    ui->right();
+    auto remotePort = ui->addDialeri( "REMOTE PORT", &mRemotePort, 0, 65535, Dialeri::Format().label( false ) );
+    remotePort->setTrigger( Trigger::END );
+    remotePort->setCallback( remoteCb );
+    ui->down();
+    auto remoteWidth = ui->addDialeri( "REMOTE WIDTH", &mRemoteWidth, 64, 4096 );
+    remoteWidth->setTrigger( Trigger::END );
+    remoteWidth->setCallback( remoteCb );
+    ui->right();
+    auto remoteKbps = ui->addDialeri( "REMOTE KBPS", &mRemoteKbps, 100, 100000, Dialeri::Format().label( false ) );
+    remoteKbps->setTrigger( Trigger::END );
+    remoteKbps->setCallback( remoteCb );
+    ui->down();
+    ui->addSpacer();
+    ui->addToggle( "AUDIO IN", &mAudioInput )->setCallback( [this]( bool value ) {
+        if( value && mAudioFilePath.empty() ) {
+            mAudioAnalyzerRef->startInput();
+        }
+        else {
+            mAudioAnalyzerRef->stopInput();
+        }
+    } );
+    ui->right();
+    ui->addButton( "AUDIO FILE", false )->setCallback( [this]( bool value ) {
+        if( value ) {
+            // A cancelled dialog keeps the file there is, AUDIO CLEAR is what drops it
+            fs::path path = getOpenFilePath( mAudioFilePath.parent_path(), { "wav", "aif", "aiff", "mp3" } );
+            if( !path.empty() ) {
+                setAudioFile( path );
+            }
+        }
+    } );
+    ui->addButton( "AUDIO CLEAR", false )->setCallback( [this]( bool value ) {
+        if( value ) {
+            setAudioFile( fs::path() );
+        }
+    } );
+    ui->down();
+    ui->addSliderf( "AUDIO GAIN", &mAudioGain, 0.0f, 10.0f )->setCallback( [this]( float value ) {
+        mAudioAnalyzerRef->setGain( value );
+    } );
     ui->addSpacer();
     ui->addButton( "SAVE AS", false )->setCallback( [this]( bool value ) { if( value ) { saveSession(); } } );
     ui->right();
@@ -627,6 +2167,41 @@ UIPanelRef Fragment::setupAppUI( UIPanelRef ui )
     } );
     ui->addSliderf( "FOV", &mCameraRef->getFov(), 0.0f, 180.0f )
         ->setCallback( [this]( float value ) { mCameraRef->update(); } );
+    ui->addSpacer();
+    ui->addToggle( "AUTO QUALITY", &mQualityAuto )->setCallback( [this]( bool value ) {
+        mQualityTiersRef->setAuto( value );
+    } );
+    ui->right();
+    ui->addDialeri( "QUALITY", &mQualityTier, 0, QualityTiers::kTiers - 1 )->setCallback( [this]( int value ) {
+        mQualityTiersRef->setTier( value );
+    } );
+    ui->down();
+
+    auto dirty = [this]( float value ) { mFrameDirty = true; };
+    vector<string> modes = { "FULL", "CHECKER", "ROWS", "QUARTER" };
+    ui->addRadio( "SHADING", modes )->setCallback( [this, modes]( string name, bool value ) {
+        if( value ) {
+            mCheckerboardMode = int( find( modes.begin(), modes.end(), name ) - modes.begin() );
+            mFrameDirty = true;
+        }
+    } );
+    ui->addSliderf( "FOCUS X", &mFocusCenter.x, 0.0f, 1.0f )->setCallback( dirty );
+    ui->addSliderf( "FOCUS Y", &mFocusCenter.y, 0.0f, 1.0f )->setCallback( dirty );
+    ui->addSliderf( "FOCUS RADIUS", &mFocusRadius, 0.0f, 1.0f )->setCallback( dirty );
+    ui->addSliderf( "HISTORY CLAMP", &mHistoryClamp, 0.0f, 1.0f )->setCallback( dirty );
+    ui->addSpacer();
+
+    vector<string> pacing = { "VSYNC", "UNCAPPED", "ADAPTIVE", "JUST IN TIME" };
+    ui->addRadio( "PACING", pacing )->setCallback( [this, pacing]( string name, bool value ) {
+        if( value ) {
+            mPacingMode = int( find( pacing.begin(), pacing.end(), name ) - pacing.begin() );
+            mFramePacerRef->setMode( FramePacer::Mode( mPacingMode ) );
+            applyFramePacing();
+        }
+    } );
+    ui->addSliderf( "PACING DELAY", &mPacingDelay, 0.0f, 16.0f )->setCallback( [this]( float value ) {
+        mFramePacerRef->setDelay( value );
+    } );
 
     return ui;
 }
@@ -654,6 +2229,11 @@ UIPanelRef Fragment::setupExporterUI( UIPanelRef ui )
                 if( it != string::npos ) {
                     filename = filename.substr( 0, it );
                 }
+                if( path.extension() == ".exr" ) {
+                    // Rendered by the output window, like the sweep
+                    mExrPath = path;
+                    return;
+                }
                 vector<string> extensions = { "png", "jpg", "tif" };
                 bool valid = false;
                 for( auto it : extensions ) {
@@ -665,6 +2245,13 @@ UIPanelRef Fragment::setupExporterUI( UIPanelRef ui )
                 if( !valid ) {
                     ext = "png";
                 }
+                if( !fitsImage( *mImageSaverRef->getSizeMultiplier() ) ) {
+                    CI_LOG_I( "IMAGE OVER BUDGET, SAVING TILES" );
+                    mTilesPath = addPath( opath, filename + "_tiles" );
+                    mTilesName = filename;
+                    mTilesExt = ext;
+                    return;
+                }
                 mImageSaverRef->save( opath, filename, ext );
             }
         }
@@ -675,10 +2262,12 @@ UIPanelRef Fragment::setupExporterUI( UIPanelRef ui )
             mImageSaverRef->setSizeMultiplier( value );
             mSequenceSaverRef->setSizeMultiplier( value );
         } );
+    ui->addDialeri( "GPU BUDGET MB", &mGpuBudget, 0, 65536 )->setCallback( [this]( int value ) { applyBudgets(); } );
+    ui->addDialeri( "CPU BUDGET MB", &mCpuBudget, 0, 65536 )->setCallback( [this]( int value ) { applyBudgets(); } );
 
     ui->addSpacer();
     ui->addButton( "RENDER", false )->setCallback( [this]( bool value ) {
-        if( value && ( mSaveMovie || mSaveSequence ) ) {
+        if( value && ( mSaveMovie || mSaveSequence || mSaveExrSequence ) ) {
             fs::path path = getSaveFilePath( mDefaultMoviePath );
             if( !path.empty() ) {
                 mDefaultMoviePath = path.parent_path();
@@ -696,88 +2285,116 @@ UIPanelRef Fragment::setupExporterUI( UIPanelRef ui )
                     mMovieSaverRef->save( opath, filename, "mov" );
                 }
 
-                if( mSaveSequence ) {
+                if( mSaveSequence && fitsImage( *mImageSaverRef->getSizeMultiplier() ) ) {
                     mSequenceSaverRef->save( addPath( opath, filename ), filename, "png" );
                 }
+                else if( mSaveSequence ) {
+                    CI_LOG_I( "SEQUENCE OVER BUDGET, SAVING TILES" );
+                    mTilesSequencePath = addPath( opath, filename + "_tiles" );
+                    mTilesSequenceName = filename;
+                    mTilesSequenceFrame = 0;
+                }
+
+                if( mSaveExrSequence ) {
+                    mExrSequencePath = addPath( opath, filename + "_exr" );
+                    mExrSequenceName = filename;
+                    fs::create_directories( mExrSequencePath );
+                    mExrSequenceFrame = 0;
+                }
             }
         }
     } );
     ui->right();
     ui->addToggle( "MOV", &mSaveMovie );
     ui->addToggle( "PNG", &mSaveSequence );
+    ui->addToggle( "EXR", &mSaveExrSequence );
     ui->addDialeri( "FRAMES", &mTotalFrames, 0, 99999, Dialeri::Format().label( false ) )
         ->setCallback( [this]( int value ) {
             mMovieSaverRef->setTotalFrames( value );
             mSequenceSaverRef->setTotalFrames( value );
         } );
     ui->down();
+    ui->addSpacer();
+    ui->addButton( "SAVE SWEEP AS", false )->setCallback( [this]( bool value ) {
+        if( value ) {
+            fs::path path = ci::app::getSaveFilePath( mDefaultRenderPath );
+            if( !path.empty() ) {
+                mDefaultRenderPath = path.parent_path();
+                if( path.extension().string() != ".png" ) {
+                    path.replace_extension( "png" );
+                }
+                // Rendered by the output window, the batch only lives in its context
+                mSweepPath = path;
+            }
+        }
+    } );
+    ui->addSpacer();
+    ui->addToggle( "TIMELINE", &mTimelineEnabled );
+    ui->right();
+    ui->addToggle( "REPLAY OSC", &mOscReplay );
+    ui->addButton( "KEY", false )->setCallback( [this]( bool value ) {
+        if( value ) {
+            keyTimeline();
+        }
+    } );
+    ui->addButton( "CLEAR KEYS", false )->setCallback( [this]( bool value ) {
+        if( value ) {
+            mTimelineRef->clear();
+            bindTimeline();
+            saveTimeline( getAppSupportWorkingSessionSettingsPath() );
+        }
+    } );
+    ui->down();
     return ui;
 }
 
 UIPanelRef Fragment::setupExamplesUI( UIPanelRef ui )
 {
-    ui->setTriggerSubViews( false );
-    ui->setLoadSubViews( false );
-    ui->addSpacer();
-
-    fs::path examplesPath = getAppSupportPath( EXAMPLES_PATH );
-    vector<string> examples;
-
-    fs::directory_iterator it( examplesPath ), eit;
-    for( ; it != eit; ++it ) {
-        if( fs::is_directory( it->path() ) ) {
-            string path = it->path().native();
-            size_t lastSlash = path.rfind( getPathSeparator(), path.length() );
-            if( lastSlash == string::npos ) {
-                examples.push_back( path );
-            }
-            else {
-                examples.push_back( path.substr( lastSlash + 1, string::npos ) );
-            }
-        }
-    }
-
-    ui->addRadio( "Examples", examples )
-        ->setCallback( [this]( string name, bool value ) {
-            if( value ) {
-                load( addPath( getAppSupportPath( EXAMPLES_PATH ), name ) );
-                arrangeUIWindows();
-            }
-        } );
-    return ui;
+    return setupBrowserUI( ui, EXAMPLES_PATH, "Examples" );
 }
 
 UIPanelRef Fragment::setupTutorialsUI( UIPanelRef ui )
+{
+    return setupBrowserUI( ui, TUTORIALS_PATH, "Tutorials" );
+}
+
+UIPanelRef Fragment::setupBrowserUI( UIPanelRef ui, const string &folder, const string &title )
 {
     ui->setTriggerSubViews( false );
     ui->setLoadSubViews( false );
     ui->addSpacer();
 
-    fs::path tutorialsPath = getAppSupportPath( TUTORIALS_PATH );
-    vector<string> tutorials;
+    vector<string> sessions = getSessionNames( folder );
+    for( auto &it : sessions ) {
+        mThumbnailCacheRef->request( folder + "/" + it, getSessionSourcePath( folder, it ) );
+    }
 
-    fs::directory_iterator it( tutorialsPath ), eit;
-    for( ; it != eit; ++it ) {
-        if( fs::is_directory( it->path() ) ) {
-            string path = it->path().native();
-            size_t lastSlash = path.rfind( getPathSeparator(), path.length() );
-            if( lastSlash == string::npos ) {
-                tutorials.push_back( path );
-            }
-            else {
-                tutorials.push_back( path.substr( lastSlash + 1, string::npos ) );
-            }
+    mBrowserPreviewRefs[folder] = ui->addTexture( "THUMBNAIL", mThumbnailPlaceholderRef );
+    ui->addToggle( "PREVIEW", &mBrowserPreview[folder] );
+    ui->addButton( "LOAD", false )->setCallback( [this, folder]( bool value ) {
+        if( value && !mBrowserSelection[folder].empty() ) {
+            load( getSessionPath( folder, mBrowserSelection[folder] ) );
+            arrangeUIWindows();
         }
-    }
+    } );
+    ui->addSpacer();
 
-    ui->addRadio( "Tutorials", tutorials )
-        ->setCallback( [this]( string name, bool value ) {
-            if( value ) {
-                load( addPath( getAppSupportPath( TUTORIALS_PATH ), name ) );
+    ui->addRadio( title, sessions )
+        ->setCallback( [this, folder]( string name, bool value ) {
+            if( !value ) {
+                return;
+            }
+            mBrowserSelection[folder] = name;
+            if( mBrowserPreview[folder] ) {
+                mThumbnailCacheRef->request( folder + "/" + name, getSessionSourcePath( folder, name ), true );
+                updateBrowserPreview( folder );
+            }
+            else {
+                load( getSessionPath( folder, name ) );
                 arrangeUIWindows();
             }
         } );
-
+    updateBrowserPreview( folder );
     return ui;
 }
 
@@ -823,6 +2440,20 @@ UIPanelRef Fragment::setupConsoleUI( UIPanelRef ui )
         ui->addSpacer();
         addTextArea( msg );
     }
+    // Where the shader's time goes, by static estimate and once measured in milliseconds
+    if( mCompiledGlsl && mShaderAnalysisRef ) {
+        for( auto &it : mShaderAnalysisRef->getSummary( kAnalysisHotSpots ) ) {
+            ui->addSpacer();
+            addTextArea( it );
+        }
+    }
+    // Memory by category, refreshed every second
+    ui->addSpacer();
+    mMemoryLabelRefs.clear();
+    for( int i = 0; i < kMemoryLines; i++ ) {
+        mMemoryLabelRefs.push_back( ui->addLabel( "", FontSize::SMALL ) );
+    }
+    updateMemoryLabels();
     ui->autoSizeToFitSubviews();
     return ui;
 }
@@ -861,21 +2492,869 @@ void Fragment::arrangeUIWindows()
 #pragma mark - COLOR PALETTE
 //------------------------------------------------------------------------------
 
-void Fragment::setupPalettes()
+void Fragment::loadPalettes()
 {
-    mPaletteSurfRef = Surface32f::create( loadImage( getAppSupportAssetsPath( "palettes.png" ) ) );
-    mPaletteTexRef = gl::Texture2d::create( *mPaletteSurfRef.get(), gl::Texture2d::Format().minFilter( GL_LINEAR ).magFilter( GL_LINEAR ).loadTopDown().dataType( GL_FLOAT ).internalFormat( GL_RGBA ) );
+    mPaletteSurfRef = Surface8u::create( loadImage( getAppSupportAssetsPath( "palettes.png" ) ), SurfaceConstraintsDefault(), true );
 }
 
-//------------------------------------------------------------------------------
-#pragma mark - IMAGE EXPORTER
-//------------------------------------------------------------------------------
-void Fragment::setupImageSaver()
+void Fragment::loadSessionPalettes()
 {
-    auto drawBg = [this]( glm::vec2 ul, glm::vec2 ur, glm::vec2 lr, glm::vec2 ll ) {
-        _drawOutput( ul, ur, lr, ll );
-    };
-    mImageSaverRef = ImageSaver::create( mOutputWindowRef, nullptr, drawBg, nullptr );
+    // Every png in the session's Shaders/Palettes folder, in name order, as palettes 1 -> N
+    mSessionPaletteSurfRefs.clear();
+    auto folder = getAppSupportWorkingSessionShadersPath( PALETTES_PATH );
+    if( !fs::exists( folder ) ) {
+        return;
+    }
+    vector<fs::path> files;
+    for( fs::directory_iterator it( folder ), eit; it != eit; ++it ) {
+        if( it->path().extension() == ".png" ) {
+            files.push_back( it->path() );
+        }
+    }
+    std::sort( files.begin(), files.end() );
+    for( auto &it : files ) {
+        try {
+            mSessionPaletteSurfRefs.push_back( Surface8u::create( loadImage( it ), SurfaceConstraintsDefault(), true ) );
+        }
+        catch( const std::exception &exc ) {
+            CI_LOG_E( "Error loading palette: " << it << " " << exc.what() );
+        }
+    }
+}
+
+void Fragment::setupPalettes()
+{
+    // All palettes are stacked top to bottom into one 8-bit atlas at the width of palettes.png.
+    // The bytes go up as they are, without an sRGB decode, so they sample exactly like the
+    // float texture did. The decoded surfaces are released once they are on the GPU.
+    vector<Surface8uRef> palettes;
+    if( mPaletteSurfRef ) {
+        palettes.push_back( mPaletteSurfRef );
+    }
+    for( auto &it : mSessionPaletteSurfRefs ) {
+        if( int( palettes.size() ) < kMaxPalettes ) {
+            palettes.push_back( it );
+        }
+    }
+    mPaletteSurfRef = nullptr;
+    mSessionPaletteSurfRefs.clear();
+    if( palettes.empty() ) {
+        return;
+    }
+
+    int width = palettes[0]->getWidth();
+    int height = 0;
+    for( auto &it : palettes ) {
+        if( it->getWidth() != width ) {
+            it = Surface8u::create( ip::resize( *it, it->getBounds(), ivec2( width, it->getHeight() ) ) );
+        }
+        height += it->getHeight();
+    }
+
+    Surface8u atlas( width, height, true, SurfaceChannelOrder::RGBA );
+    mPaletteTable.clear();
+    int row = 0;
+    for( auto &it : palettes ) {
+        int rows = it->getHeight();
+        atlas.copyFrom( *it, it->getBounds(), ivec2( 0, row ) );
+        // Centers of the first and last row, so sampling never bleeds into a neighbour
+        mPaletteTable.push_back( vec4( ( row + 0.5f ) / height, ( row + rows - 0.5f ) / height, rows, 0.0f ) );
+        row += rows;
+    }
+    mPaletteTexRef = gl::Texture2d::create( atlas, gl::Texture2d::Format().minFilter( GL_LINEAR ).magFilter( GL_LINEAR ).loadTopDown().internalFormat( GL_RGBA8 ) );
+    mResourceManagerRef->track( "PALETTES", mPaletteTexRef );
+    mFrameDirty = true;
+    if( mThumbnailCacheRef ) {
+        updateThumbnailEnvironment();
+    }
+}
+
+void Fragment::watchPalettes()
+{
+    auto reload = [this]( const vector<fs::path> &paths ) {
+        for( auto &it : paths ) {
+            if( it.extension() == ".png" ) {
+                CI_LOG_V( "PALETTE CHANGED: " << it );
+                loadPalettes();
+                loadSessionPalettes();
+                setupPalettes();
+                return;
+            }
+        }
+    };
+    auto folder = getAppSupportWorkingSessionShadersPath( PALETTES_PATH );
+    if( !fs::exists( folder ) ) {
+        createDirectories( folder );
+    }
+    mPaletteWatcherRefs.clear();
+    mPaletteWatcherRefs.push_back( FileWatcher::create( getAppSupportAssetsPath(), reload ) );
+    mPaletteWatcherRefs.push_back( FileWatcher::create( folder, reload ) );
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - AUDIO
+//------------------------------------------------------------------------------
+
+void Fragment::setupAudio()
+{
+    mAudioAnalyzerRef = AudioAnalyzer::create();
+    // Row 0 holds the spectrum, row 1 the waveform
+    auto fmt = gl::Texture2d::Format().internalFormat( GL_R32F ).dataType( GL_FLOAT ).minFilter( GL_LINEAR ).magFilter( GL_LINEAR ).wrap( GL_CLAMP_TO_EDGE );
+    mAudioTexRef = gl::Texture2d::create( AudioFrame::kSize, 2, fmt );
+    mResourceManagerRef->track( "AUDIO", mAudioTexRef );
+}
+
+void Fragment::updateAudio()
+{
+    if( mAudioAnalyzerRef->hasFile() ) {
+        mAudioAnalyzerRef->analyzeFile( getAnimationSeconds() );
+    }
+    if( mAudioAnalyzerRef->update() ) {
+        const AudioFrame &frame = mAudioAnalyzerRef->getFrame();
+        mAudioTexRef->update( frame.mSpectrum, GL_RED, GL_FLOAT, 0, AudioFrame::kSize, 1, ivec2( 0, 0 ) );
+        mAudioTexRef->update( frame.mWaveform, GL_RED, GL_FLOAT, 0, AudioFrame::kSize, 1, ivec2( 0, 1 ) );
+        mFrameDirty = mFrameDirty || mUsesAudio;
+    }
+}
+
+void Fragment::setAudioFile( const fs::path &path )
+{
+    // A file always wins over live input so exports stay sample accurate
+    mAudioFilePath = path;
+    if( path.empty() || !mAudioAnalyzerRef->loadFile( path ) ) {
+        mAudioFilePath.clear();
+        mAudioAnalyzerRef->clearFile();
+        if( mAudioInput ) {
+            mAudioAnalyzerRef->startInput();
+        }
+    }
+    else {
+        mAudioAnalyzerRef->stopInput();
+    }
+}
+
+void Fragment::saveAudio( const fs::path &path )
+{
+    JsonTree tree;
+    tree.addChild( JsonTree( "FILE", mAudioFilePath.string() ) );
+    tree.write( addPath( path, AUDIO_PATH ) );
+}
+
+void Fragment::loadAudio( const fs::path &path )
+{
+    fs::path file;
+    auto pth = addPath( path, AUDIO_PATH );
+    if( fs::exists( pth ) ) {
+        JsonTree tree( loadFile( pth ) );
+        if( tree.hasChild( "FILE" ) ) {
+            file = fs::path( tree.getValueForKey<string>( "FILE" ) );
+        }
+    }
+    if( file != mAudioFilePath ) {
+        setAudioFile( fs::exists( file ) ? file : fs::path() );
+    }
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - TEXTURE CHANNELS
+//------------------------------------------------------------------------------
+
+void Fragment::setupTextureChannels()
+{
+    mTextureCacheRef = TextureCache::create();
+}
+
+void Fragment::parseTextureChannels( const vector<string> &sources )
+{
+    // uniform sampler2D foo; //image:photo.png
+    // uniform sampler2D bar; //video:footage (a folder of numbered frames)
+    static const regex expr( "^\\s*uniform\\s+sampler2D\\s+(\\w+)\\s*;\\s*//\\s*(image|video)\\s*:\\s*(.+?)\\s*$" );
+    mTextureChannels.clear();
+    for( auto &source : sources ) {
+        istringstream stream( source );
+        string line;
+        smatch match;
+        while( getline( stream, line ) ) {
+            if( !regex_match( line, match, expr ) ) {
+                continue;
+            }
+            TextureChannel channel;
+            channel.mName = match[1];
+            channel.mVideo = match[2] == "video";
+            auto path = getTextureChannelPath( match[3] );
+            if( channel.mVideo && fs::is_directory( path ) ) {
+                for( fs::directory_iterator it( path ), end; it != end; ++it ) {
+                    auto ext = it->path().extension().string();
+                    std::transform( ext.begin(), ext.end(), ext.begin(), ::tolower );
+                    if( ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tif" || ext == ".tiff" ) {
+                        channel.mFrames.push_back( it->path() );
+                    }
+                }
+                std::sort( channel.mFrames.begin(), channel.mFrames.end() );
+            }
+            else if( !channel.mVideo && fs::is_regular_file( path ) ) {
+                channel.mFrames.push_back( path );
+            }
+
+            if( channel.mFrames.empty() ) {
+                CI_LOG_E( "Texture channel " << channel.mName << " has nothing to load at: " << path );
+                continue;
+            }
+            mTextureCacheRef->prefetch( channel.mFrames[0] );
+            mTextureChannels.push_back( channel );
+        }
+    }
+}
+
+void Fragment::updateTextureChannels()
+{
+    if( mTextureCacheRef->update() ) {
+        mFrameDirty = true;
+    }
+
+    // Exports block on the exact frame, live playback keeps the last one until the next is resident
+    bool exporting = isExporting();
+    long frame = long( std::round( mCurrentTime * mTotalFrames ) );
+    for( auto &channel : mTextureChannels ) {
+        size_t count = channel.mFrames.size();
+        size_t index = size_t( frame ) % count;
+        auto texture = mTextureCacheRef->get( channel.mFrames[index], exporting );
+        if( texture && texture != channel.mTextureRef ) {
+            channel.mTextureRef = texture;
+            mFrameDirty = true;
+        }
+        if( channel.mVideo ) {
+            for( size_t i = 1; i < std::min( count, size_t( 4 ) ); i++ ) {
+                mTextureCacheRef->prefetch( channel.mFrames[( index + i ) % count] );
+            }
+        }
+    }
+}
+
+fs::path Fragment::getTextureChannelPath( const string &path )
+{
+    fs::path pth( path );
+    if( pth.is_absolute() ) {
+        return pth;
+    }
+    auto shaders = getAppSupportWorkingSessionShadersPath( path );
+    if( fs::exists( shaders ) ) {
+        return shaders;
+    }
+    return getAppSupportAssetsPath( path );
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - SWEEP
+//------------------------------------------------------------------------------
+
+bool Fragment::loadSweep( vector<SweepAxis> &axes, vector<float> &times, ivec2 &cell )
+{
+    PanelValues values = getPanelValues( SHADER_UI );
+    auto pth = getAppSupportWorkingSessionSettingsPath( SWEEP_PATH );
+    if( !fs::exists( pth ) ) {
+        // Starts the session off with its first two scalar params over their widgets'
+        // whole range, ready to be edited
+        auto ui = mUIRef->getUI( SHADER_UI );
+        auto range = [&ui]( const string &name ) {
+            auto view = ui != nullptr ? ui->getSubView( name ) : nullptr;
+            string type = view != nullptr ? view->getType() : "";
+            if( type == "Sliderf" ) {
+                Sliderf *widget = static_cast<Sliderf *>( view.get() );
+                return vec2( widget->getMin(), widget->getMax() );
+            }
+            else if( type == "Slideri" ) {
+                Slideri *widget = static_cast<Slideri *>( view.get() );
+                return vec2( widget->getMin(), widget->getMax() );
+            }
+            else if( type == "Dialerf" ) {
+                Dialerf *widget = static_cast<Dialerf *>( view.get() );
+                return vec2( widget->getMin(), widget->getMax() );
+            }
+            else if( type == "Dialeri" ) {
+                Dialeri *widget = static_cast<Dialeri *>( view.get() );
+                return vec2( widget->getMin(), widget->getMax() );
+            }
+            return vec2( 0.0f, 1.0f );
+        };
+        JsonTree tree;
+        JsonTree params = JsonTree::makeArray( "PARAMS" );
+        for( auto &it : values ) {
+            if( it.second.second.size() == 1 && it.second.first != "Toggle" && params.getNumChildren() < 2 ) {
+                vec2 minMax = range( it.first );
+                JsonTree param;
+                param.addChild( JsonTree( "NAME", it.first ) );
+                param.addChild( JsonTree( "MIN", minMax.x ) );
+                param.addChild( JsonTree( "MAX", minMax.y ) );
+                param.addChild( JsonTree( "STEPS", 8 ) );
+                params.pushBack( param );
+            }
+        }
+        tree.addChild( params );
+        JsonTree timesTree = JsonTree::makeArray( "TIMES" );
+        timesTree.pushBack( JsonTree( "", 0.0f ) );
+        tree.addChild( timesTree );
+        JsonTree cellTree = JsonTree::makeArray( "CELL" );
+        cellTree.pushBack( JsonTree( "", 256 ) );
+        cellTree.pushBack( JsonTree( "", 144 ) );
+        tree.addChild( cellTree );
+        tree.write( pth );
+        CI_LOG_I( "SWEEP SETTINGS CREATED: " << pth );
+    }
+
+    try {
+        JsonTree tree( loadFile( pth ) );
+        if( tree.hasChild( "PARAMS" ) ) {
+            for( auto &it : tree.getChild( "PARAMS" ).getChildren() ) {
+                SweepAxis axis;
+                axis.mName = it.getValueForKey<string>( "NAME" );
+                axis.mMin = it.getValueForKey<float>( "MIN" );
+                axis.mMax = it.getValueForKey<float>( "MAX" );
+                axis.mSteps = std::max( it.getValueForKey<int>( "STEPS" ), 1 );
+                auto param = values.find( axis.mName );
+                if( param == values.end() || param->second.second.size() != 1 ) {
+                    CI_LOG_E( "SWEEP PARAM NOT FOUND OR NOT A SCALAR: " << axis.mName );
+                    continue;
+                }
+                axis.mType = param->second.first;
+                if( axes.size() < 2 ) {
+                    axes.push_back( axis );
+                }
+            }
+        }
+        if( tree.hasChild( "TIMES" ) ) {
+            for( auto &it : tree.getChild( "TIMES" ).getChildren() ) {
+                times.push_back( it.getValue<float>() );
+            }
+        }
+        if( tree.hasChild( "CELL" ) ) {
+            cell = ivec2( tree.getChild( "CELL" ).getValueAtIndex<int>( 0 ), tree.getChild( "CELL" ).getValueAtIndex<int>( 1 ) );
+        }
+    }
+    catch( const ci::Exception &exc ) {
+        CI_LOG_E( "Error loading sweep: " << pth << " " << exc.what() );
+        return false;
+    }
+    if( times.empty() ) {
+        times.push_back( mCurrentTime );
+    }
+    cell = glm::max( cell, ivec2( 8 ) );
+    return !axes.empty();
+}
+
+void Fragment::renderSweep( const fs::path &path )
+{
+    vector<SweepAxis> axes;
+    vector<float> times;
+    ivec2 cell( 256, 144 );
+    if( !mGlslProgRef || !mCompiledGlsl || !mBatchRef || !loadSweep( axes, times, cell ) ) {
+        CI_LOG_E( "NOTHING TO SWEEP, CHECK " << SWEEP_PATH );
+        return;
+    }
+
+    // Columns step the first param with every time side by side, rows step the second
+    int columns = axes[0].mSteps * int( times.size() );
+    int rows = axes.size() > 1 ? axes[1].mSteps : 1;
+    GLint maxSize = 0;
+    glGetIntegerv( GL_MAX_TEXTURE_SIZE, &maxSize );
+    float fit = std::min( 1.0f, std::min( float( maxSize ) / float( columns * cell.x ), float( maxSize ) / float( rows * cell.y ) ) );
+    cell = glm::max( ivec2( vec2( cell ) * fit ), ivec2( 1 ) );
+    auto fbo = gl::Fbo::create( columns * cell.x, rows * cell.y, gl::Fbo::Format().disableDepth() );
+
+    auto valueAt = []( const SweepAxis &axis, int step ) {
+        return axis.mSteps > 1 ? lerp( axis.mMin, axis.mMax, float( step ) / float( axis.mSteps - 1 ) ) : axis.mMin;
+    };
+    auto setValue = [this]( const SweepAxis &axis, float value ) {
+        if( axis.mType == "Slideri" || axis.mType == "Dialeri" ) {
+            mGlslProgRef->uniform( axis.mName, int( std::round( value ) ) );
+        }
+        else {
+            mGlslProgRef->uniform( axis.mName, value );
+        }
+    };
+
+    Timer timer( true );
+    vec2 size = getCanvasSize();
+    JsonTree cells = JsonTree::makeArray( "CELLS" );
+    {
+        // Everything but the swept params is set once, each cell is then a single draw
+        // into its own viewport of the sheet
+        gl::ScopedFramebuffer scpFbo( fbo );
+        gl::ScopedViewport scpViewport( ivec2( 0 ), fbo->getSize() );
+        gl::ScopedMatrices scpMatrices;
+        gl::setMatricesWindow( size );
+        gl::clear( mBgColor );
+        applyUniforms( mGlslProgRef, size );
+        if( mPrepassGlslProgRef ) {
+            mGlslProgRef->uniform( "iDepthPrepassSize", vec2( 0.0f ) );
+        }
+        gl::ScopedBlendAlpha scpAlp;
+        for( int row = 0; row < rows; row++ ) {
+            for( int column = 0; column < columns; column++ ) {
+                int step = column / int( times.size() );
+                float time = times[column % times.size()];
+                JsonTree entry;
+                entry.addChild( JsonTree( "COLUMN", column ) );
+                entry.addChild( JsonTree( "ROW", row ) );
+                entry.addChild( JsonTree( "TIME", time ) );
+                mGlslProgRef->uniform( "iAnimationTime", time );
+                setValue( axes[0], valueAt( axes[0], step ) );
+                entry.addChild( JsonTree( axes[0].mName, valueAt( axes[0], step ) ) );
+                if( axes.size() > 1 ) {
+                    setValue( axes[1], valueAt( axes[1], row ) );
+                    entry.addChild( JsonTree( axes[1].mName, valueAt( axes[1], row ) ) );
+                }
+                cells.pushBack( entry );
+                // The first row sits at the top of the sheet
+                gl::viewport( ivec2( column * cell.x, ( rows - 1 - row ) * cell.y ), cell );
+                mBatchRef->draw();
+            }
+        }
+    }
+
+    writeImage( path, fbo->readPixels8u( fbo->getBounds() ) );
+    JsonTree tree;
+    tree.addChild( JsonTree( "IMAGE", path.filename().string() ) );
+    JsonTree cellTree = JsonTree::makeArray( "CELL" );
+    cellTree.pushBack( JsonTree( "", cell.x ) );
+    cellTree.pushBack( JsonTree( "", cell.y ) );
+    tree.addChild( cellTree );
+    tree.addChild( cells );
+    fs::path json = path;
+    tree.write( json.replace_extension( "json" ) );
+    CI_LOG_I( "SWEEP SAVED: " << path << " " << columns * rows << " CELLS IN " << timer.getSeconds() << "s" );
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - IMAGE EXPORTER
+//------------------------------------------------------------------------------
+void Fragment::setupImageSaver()
+{
+    auto drawBg = [this]( glm::vec2 ul, glm::vec2 ur, glm::vec2 lr, glm::vec2 ll ) {
+        _drawOutput( ul, ur, lr, ll );
+    };
+    mImageSaverRef = ImageSaver::create( mOutputWindowRef, nullptr, drawBg, nullptr );
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - EXR EXPORTER
+//------------------------------------------------------------------------------
+bool Fragment::renderExr( const fs::path &path )
+{
+    if( !mGlslProgRef || !mCompiledGlsl ) {
+        CI_LOG_E( "NOTHING TO EXPORT: " << path );
+        return false;
+    }
+    Timer timer( true );
+
+    // The image is OUTPUT IMAGE SCALE canvases across and down, rendered one canvas sized
+    // tile at a time and streamed to the file as it goes, so the whole image is never in
+    // memory. Larger images are written as tiled EXRs with those same tiles. Tiles are
+    // halved until one fits in what the budgets leave, edge tiles are cut to the image.
+    int scale = std::max( *mImageSaverRef->getSizeMultiplier(), 1 );
+    vec2 size = getCanvasSize();
+    ivec2 image = ivec2( size ) * scale;
+    size_t channels = 4 + mAovNames.size();
+    size_t planes = mAovNames.empty() ? 1 : 2;
+    string category = mAovNames.empty() ? "EXR" : "EXR AOV";
+    int grid = scale;
+    ivec2 tile( size );
+    auto fits = [&]( const ivec2 &candidate ) {
+        size_t pixels = size_t( candidate.x ) * candidate.y;
+        return mResourceManagerRef->fits( ResourceManager::GPU, pixels * 16 * planes, category ) &&
+               mResourceManagerRef->fits( ResourceManager::CPU, pixels * 4 * ( 4 * planes + channels ) );
+    };
+    while( !fits( tile ) && tile.x > 1 && tile.y > 1 ) {
+        grid *= 2;
+        tile = ( image + ivec2( grid - 1 ) ) / grid;
+    }
+    if( grid > scale ) {
+        CI_LOG_I( "EXR TILES " << tile.x << "x" << tile.y << " TO STAY IN BUDGET" );
+    }
+    ExrWriter::Format fmt;
+    fmt.mSize = image;
+    fmt.mTileSize = grid > 1 ? tile : ivec2( 0 );
+    for( auto &it : { "R", "G", "B", "A" } ) {
+        ExrWriter::Channel channel;
+        channel.mName = it;
+        fmt.mChannels.push_back( channel );
+    }
+    // Depths and positions need more than a half's 11 bits
+    for( auto &it : mAovNames ) {
+        ExrWriter::Channel channel;
+        channel.mName = it;
+        channel.mHalf = false;
+        fmt.mChannels.push_back( channel );
+    }
+    auto writer = ExrWriter::create( path, fmt );
+    if( !writer ) {
+        return false;
+    }
+
+    // Sequences get the framebuffer of the frame before
+    bool aov = !mAovNames.empty();
+    auto fbo = mResourceManagerRef->getFbo( category, tile, [aov]( const ivec2 &pixels ) {
+        auto texFmt = gl::Texture2d::Format().internalFormat( GL_RGBA32F ).minFilter( GL_NEAREST ).magFilter( GL_NEAREST );
+        auto fboFmt = gl::Fbo::Format().disableDepth().colorTexture( texFmt );
+        if( aov ) {
+            fboFmt.attachment( GL_COLOR_ATTACHMENT1, gl::Texture2d::create( pixels.x, pixels.y, texFmt ) );
+        }
+        return gl::Fbo::create( pixels.x, pixels.y, fboFmt );
+    } );
+    // The AOV variant of the export tier is the only one that writes the second output
+    auto glsl = aov ? getAovGlslProg( mQualityTiersRef->getExportTier() ) : mQualityTiersRef->getExportGlslProg();
+    if( !glsl ) {
+        glsl = mGlslProgRef;
+    }
+
+    vector<float> color( size_t( tile.x ) * tile.y * 4 );
+    vector<float> aovs( aov ? color.size() : 0 );
+    vector<float> pixels( size_t( tile.x ) * tile.y * channels );
+    {
+        // Blending would clamp and premultiply against the background, the file gets the
+        // shader's values as they are
+        gl::ScopedFramebuffer scpFbo( fbo );
+        gl::ScopedViewport scpViewport( ivec2( 0 ), tile );
+        gl::ScopedMatrices scpMatrices;
+        gl::setMatricesWindow( size );
+        gl::ScopedBlend scpBlend( false );
+        applyUniforms( glsl, size );
+        if( mPrepassGlslProgRef ) {
+            glsl->uniform( "iDepthPrepassSize", vec2( 0.0f ) );
+        }
+        for( int ty = 0; ty < grid; ty++ ) {
+            for( int tx = 0; tx < grid; tx++ ) {
+                vec2 uv0 = vec2( tx, ty ) * vec2( tile ) / vec2( image );
+                vec2 uv1 = vec2( tx + 1, ty + 1 ) * vec2( tile ) / vec2( image );
+                vector<vec2> t = getTexcoords( uv0, uv1 );
+                gl::clear( ColorA( 0.0f, 0.0f, 0.0f, 0.0f ) );
+                mResourceManagerRef->getRect( "EXPORT", glsl, Rectf( vec2( 0.0f ), size ), t[0], t[1], t[2], t[3] )->draw();
+
+                glReadBuffer( GL_COLOR_ATTACHMENT0 );
+                glReadPixels( 0, 0, tile.x, tile.y, GL_RGBA, GL_FLOAT, color.data() );
+                if( aov ) {
+                    glReadBuffer( GL_COLOR_ATTACHMENT1 );
+                    glReadPixels( 0, 0, tile.x, tile.y, GL_RGBA, GL_FLOAT, aovs.data() );
+                }
+                // GL rows run bottom up, EXR rows top down, and EXR color is premultiplied
+                for( int y = 0; y < tile.y; y++ ) {
+                    const float *src = &color[size_t( tile.y - 1 - y ) * tile.x * 4];
+                    const float *srcAov = aov ? &aovs[size_t( tile.y - 1 - y ) * tile.x * 4] : nullptr;
+                    float *dst = &pixels[size_t( y ) * tile.x * channels];
+                    for( int x = 0; x < tile.x; x++ ) {
+                        float alpha = src[x * 4 + 3];
+                        dst[0] = src[x * 4] * alpha;
+                        dst[1] = src[x * 4 + 1] * alpha;
+                        dst[2] = src[x * 4 + 2] * alpha;
+                        dst[3] = alpha;
+                        for( size_t c = 4; c < channels; c++ ) {
+                            dst[c] = srcAov[x * 4 + c - 4];
+                        }
+                        dst += channels;
+                    }
+                }
+                if( grid > 1 ) {
+                    writer->writeTile( ivec2( tx, ty ), pixels.data() );
+                }
+                else {
+                    writer->writeRows( pixels.data(), tile.y );
+                }
+            }
+        }
+        glReadBuffer( GL_COLOR_ATTACHMENT0 );
+    }
+    writer->close();
+    CI_LOG_I( "EXR SAVED: " << path << " " << fmt.mSize.x << "x" << fmt.mSize.y << " IN " << timer.getSeconds() << "s" );
+    return true;
+}
+
+string Fragment::getFrameNumber( int frame )
+{
+    string number = to_string( frame );
+    number.insert( 0, 5 - std::min( number.size(), size_t( 5 ) ), '0' );
+    return number;
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - TILED EXPORTER
+//------------------------------------------------------------------------------
+bool Fragment::drawTiles( const function<bool( const ivec2 &index, const Surface8u &tile )> &tileFn )
+{
+    // OUTPUT IMAGE SCALE canvases across and down, only one canvas is ever on the GPU
+    int scale = std::max( *mImageSaverRef->getSizeMultiplier(), 1 );
+    vec2 size = getCanvasSize();
+    ivec2 tile( size );
+    auto fbo = mResourceManagerRef->getFbo( "TILES", tile, gl::Fbo::Format().disableDepth() );
+    auto glsl = mQualityTiersRef->getExportGlslProg();
+    if( !glsl ) {
+        glsl = mGlslProgRef;
+    }
+
+    gl::ScopedFramebuffer scpFbo( fbo );
+    gl::ScopedViewport scpViewport( ivec2( 0 ), tile );
+    gl::ScopedMatrices scpMatrices;
+    gl::setMatricesWindow( size );
+    gl::ScopedBlendAlpha scpAlp;
+    applyUniforms( glsl, size );
+    if( mPrepassGlslProgRef ) {
+        glsl->uniform( "iDepthPrepassSize", vec2( 0.0f ) );
+    }
+    for( int ty = 0; ty < scale; ty++ ) {
+        for( int tx = 0; tx < scale; tx++ ) {
+            vector<vec2> t = getTexcoords( vec2( tx, ty ) / float( scale ), vec2( tx + 1, ty + 1 ) / float( scale ) );
+            gl::clear( mBgColor );
+            mResourceManagerRef->getRect( "EXPORT", glsl, Rectf( vec2( 0.0f ), size ), t[0], t[1], t[2], t[3] )->draw();
+            if( !tileFn( ivec2( tx, ty ), fbo->readPixels8u( fbo->getBounds() ) ) ) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool Fragment::renderTiles( const fs::path &directory, const string &name, const string &ext )
+{
+    if( !mGlslProgRef || !mCompiledGlsl ) {
+        CI_LOG_E( "NOTHING TO EXPORT: " << directory );
+        return false;
+    }
+    Timer timer( true );
+    // Each tile its own file named after its row and column
+    fs::create_directories( directory );
+    bool saved = drawTiles( [&]( const ivec2 &index, const Surface8u &tile ) {
+        fs::path path = directory / ( name + "_" + to_string( index.y ) + "_" + to_string( index.x ) + "." + ext );
+        try {
+            writeImage( path, tile );
+        }
+        catch( const ci::Exception &exc ) {
+            CI_LOG_E( "Unable to write tile " << path << ": " << exc.what() );
+            return false;
+        }
+        return true;
+    } );
+    if( !saved ) {
+        return false;
+    }
+    int scale = std::max( *mImageSaverRef->getSizeMultiplier(), 1 );
+    ivec2 tile( getCanvasSize() );
+    CI_LOG_I( "TILES SAVED: " << directory << " " << scale * scale << " OF " << tile.x << "x" << tile.y << " IN " << timer.getSeconds() << "s" );
+    return true;
+}
+
+bool Fragment::renderImage( const fs::path &path )
+{
+    // The tiles put together into the one image, for callers that checked fitsImage()
+    if( !mGlslProgRef || !mCompiledGlsl ) {
+        CI_LOG_E( "NOTHING TO EXPORT: " << path );
+        return false;
+    }
+    Timer timer( true );
+    int scale = std::max( *mImageSaverRef->getSizeMultiplier(), 1 );
+    ivec2 tile( getCanvasSize() );
+    auto image = Surface8u::create( tile.x * scale, tile.y * scale, true );
+    mResourceManagerRef->track( "EXPORT IMAGE", image );
+    drawTiles( [&]( const ivec2 &index, const Surface8u &surface ) {
+        image->copyFrom( surface, surface.getBounds(), index * tile );
+        return true;
+    } );
+    try {
+        writeImage( path, *image );
+    }
+    catch( const ci::Exception &exc ) {
+        CI_LOG_E( "Unable to write image " << path << ": " << exc.what() );
+        return false;
+    }
+    CI_LOG_I( "IMAGE SAVED: " << path << " " << image->getWidth() << "x" << image->getHeight() << " IN " << timer.getSeconds() << "s" );
+    return true;
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - JOBS
+//------------------------------------------------------------------------------
+void Fragment::setupJobs()
+{
+    mJobQueueRef = JobQueue::create();
+    if( !mJobQueueRef->parseArgs( getCommandLineArgs() ) ) {
+        CI_LOG_W( "SOME JOBS COULDN'T BE READ, SEE ABOVE" );
+        mJobFailures++;
+    }
+    mJobsRunning = !mJobQueueRef->isEmpty() || mJobQueueRef->shouldQuit();
+    if( !mJobQueueRef->isEmpty() ) {
+        CI_LOG_I( "JOBS QUEUED: " << mJobQueueRef->getNumJobs() );
+    }
+}
+
+void Fragment::updateJobs()
+{
+    // Called by the output window once per draw, so a job has the GL context, the compiled
+    // programs and everything the live view uses. It waits for the first build, then each
+    // draw either starts a job, waits on its shaders, or renders one of its frames.
+    if( !mJobsRunning || mGlslGeneration == 0 ) {
+        return;
+    }
+    if( mJobFrame >= 0 ) {
+        fs::path path = mJob.mOutput;
+        if( mJob.mLastFrame > mJob.mFirstFrame ) {
+            path = path.parent_path() / ( path.stem().string() + "_" + getFrameNumber( mJobFrame ) + path.extension().string() );
+        }
+        if( !renderJob( path ) ) {
+            CI_LOG_E( "JOB FRAME FAILED: " << mJob.mName << " " << mJobFrame );
+            mJobFailures++;
+        }
+        if( ++mJobFrame > mJob.mLastFrame ) {
+            CI_LOG_I( "JOB DONE: " << mJob.mName << " IN " << getElapsedSeconds() - mJobTime << "s" );
+            mJobFrame = -1;
+            mJobParams.clear();
+        }
+        return;
+    }
+    if( mJobCompiling ) {
+        if( mGlslGeneration == mJobGeneration && getElapsedSeconds() - mJobTime < mJobCompileTimeout ) {
+            return;
+        }
+        mJobCompiling = false;
+        applyJob();
+        return;
+    }
+    if( !mJobQueueRef->isEmpty() ) {
+        // Exports started by hand finish first
+        if( !isExporting() ) {
+            startJob();
+        }
+        return;
+    }
+    mJobsRunning = false;
+    mJobSize = ivec2( 0 );
+    mJobShadersHash = 0;
+    mSetupBatch = true;
+    CI_LOG_I( "JOBS DONE" << ( mJobFailures > 0 ? ", " + to_string( mJobFailures ) + " FAILED" : "" ) );
+    if( mJobQueueRef->shouldQuit() ) {
+        quit();
+    }
+}
+
+void Fragment::startJob()
+{
+    mJob = mJobQueueRef->pop();
+    mJobTime = getElapsedSeconds();
+    mJobGeneration = mGlslGeneration;
+    CI_LOG_I( "JOB STARTED: " << mJob.mName << ", " << mJobQueueRef->getNumJobs() << " LEFT" );
+    if( mJob.mSession.empty() ) {
+        applyJob();
+        return;
+    }
+    if( !fs::exists( mJob.mSession ) ) {
+        CI_LOG_E( "JOB SKIPPED, NO SESSION: " << mJob.mSession );
+        mJobFailures++;
+        return;
+    }
+    // Jobs that share shaders only bring in the session's settings, the programs and their
+    // quality tiers stay as they are. Otherwise the shaders are rebuilt before rendering.
+    // The working shaders only change when a job loads, so their hash carries over from
+    // the job before and is read again only after a load.
+    auto shaders = getAppSupportWorkingSessionShadersPath();
+    size_t hash = mJobShadersHash != 0 ? mJobShadersHash : getShadersHash( shaders );
+    if( !fs::exists( addPath( mJob.mSession, SNAPSHOT_PATH ) ) && getShadersHash( addPath( mJob.mSession, SHADERS_PATH ) ) == hash ) {
+        stopOscRecording();
+        loadOscRecording( mJob.mSession );
+        loadSettings( mJob.mSession );
+        mJobShadersHash = hash;
+    }
+    else {
+        load( mJob.mSession );
+        mJobShadersHash = getShadersHash( shaders );
+    }
+    mJobCompiling = mJobShadersHash != hash;
+    if( !mJobCompiling ) {
+        applyJob();
+    }
+}
+
+void Fragment::applyJob()
+{
+    mJobParams.clear();
+    if( !mCompiledGlsl ) {
+        CI_LOG_E( "JOB SKIPPED, SHADERS DIDN'T COMPILE: " << mJob.mName );
+        mJobFailures++;
+        return;
+    }
+    if( mJob.mOutput.empty() ) {
+        CI_LOG_E( "JOB SKIPPED, NO OUTPUT: " << mJob.mName );
+        mJobFailures++;
+        return;
+    }
+    if( !mJob.mCamera.empty() ) {
+        loadCamera( mJob.mCamera, mCameraRef->getCameraPersp(), [this]() { mCameraRef->update(); } );
+    }
+    if( mJob.mScale > 0 ) {
+        mImageSaverRef->setSizeMultiplier( mJob.mScale );
+        mSequenceSaverRef->setSizeMultiplier( mJob.mScale );
+    }
+    if( mJob.mTotalFrames > 0 ) {
+        mTotalFrames = mJob.mTotalFrames;
+        mMovieSaverRef->setTotalFrames( mTotalFrames );
+        mSequenceSaverRef->setTotalFrames( mTotalFrames );
+    }
+    mJobSize = mJob.mSize;
+    mSetupBatch = true;
+    // Overrides go through the params' widgets, so OSC and snapshots see them. Ranges take
+    // their low and high, colors all four channels. Timeline tracks of an overridden param
+    // hold off until the job is done, or they would undo it from the next frame on.
+    if( !mJob.mParams.empty() ) {
+        PanelValues values = getPanelValues( SHADER_UI );
+        for( auto &it : mJob.mParams ) {
+            auto value = values.find( it.first );
+            if( value == values.end() || value->second.second.size() != it.second.size() ) {
+                CI_LOG_W( "JOB PARAM IGNORED: " << it.first << ", NO PARAM WITH " << it.second.size() << " VALUES" );
+                continue;
+            }
+            value->second.second = it.second;
+            string name = it.first;
+            std::transform( name.begin(), name.end(), name.begin(), ::toupper );
+            mJobParams.insert( name );
+        }
+        setPanelValues( SHADER_UI, values );
+    }
+    mJobFrame = mJob.mFirstFrame;
+}
+
+bool Fragment::renderJob( const fs::path &path )
+{
+    fs::create_directories( path.parent_path() );
+    string ext = path.extension().string();
+    if( ext == ".exr" ) {
+        return renderExr( path );
+    }
+    fs::path output = path;
+    if( ext != ".png" && ext != ".jpg" && ext != ".tif" ) {
+        output.replace_extension( "png" );
+        ext = ".png";
+    }
+    if( !fitsImage( *mImageSaverRef->getSizeMultiplier() ) ) {
+        CI_LOG_I( "IMAGE OVER BUDGET, SAVING TILES" );
+        return renderTiles( output.parent_path() / ( output.stem().string() + "_tiles" ), output.stem().string(), ext.substr( 1 ) );
+    }
+    return renderImage( output );
+}
+
+size_t Fragment::getShadersHash( const fs::path &root )
+{
+    // Names and contents of every file under root, in name order
+    if( !fs::exists( root ) ) {
+        return 0;
+    }
+    map<string, string> files;
+    for( fs::recursive_directory_iterator it( root ), end; it != end; ++it ) {
+        if( fs::is_regular_file( it->path() ) ) {
+            ifstream stream( it->path().string(), ios::binary );
+            files[it->path().string().substr( root.string().size() )] = string( istreambuf_iterator<char>( stream ), istreambuf_iterator<char>() );
+        }
+    }
+    string all;
+    for( auto &it : files ) {
+        all += it.first + '\0' + it.second + '\0';
+    }
+    return hash<string>()( all );
 }
 
 //------------------------------------------------------------------------------
@@ -910,35 +3389,74 @@ void Fragment::setupGlsl()
         }
     };
 
-    auto superFn = [this]() {
-        auto ui = mUIRef->getUI( SHADER_UI );
-        if( ui != nullptr ) {
-            if( mGlslInitialized ) {
-                mUIRef->saveUI( ui, getAppSupportWorkingSessionSettingsPath() );
-            }
-        }
-    };
+    auto superFn = []() {};
 
     auto successFn = [this, consoleUI]( ci::gl::GlslProgRef result, const std::vector<std::string> sources ) {
         mOutputWindowRef->getRenderer()->makeCurrentContext( true );
-        mGlslProgRef = result;
+        mQualityTiersRef->setSources( sources, result );
+        mGlslProgRef = mQualityTiersRef->getLiveGlslProg();
         mSetupBatch = true;
-        if( mGlslParamsRef ) {
-            mGlslParamsRef->clearUniforms();
+
+        // Most live edits leave the uniform declarations alone, in which case the params,
+        // their widgets and the bindings to them stay exactly as they are
+        string signature = getUniformSignature( sources );
+        auto ui = mUIRef->getUI( SHADER_UI );
+        if( !mGlslParamsRef || ui == nullptr || signature != mUniformSignature ) {
+            mUniformSignature = signature;
+            mTimelineSetters.clear();
+            PanelValues values = getPanelValues( SHADER_UI );
+            if( mGlslParamsRef ) {
+                mGlslParamsRef->clearUniforms();
+            }
+            else {
+                mGlslParamsRef = GlslParams::create();
+            }
+            mGlslParamsRef->parseUniforms( sources );
+            parseTextureChannels( sources );
+            if( ui != nullptr ) {
+                ui->clear();
+                setupShaderUI( ui );
+                mUIRef->addShaderParamsUI( ui, *( mGlslParamsRef.get() ) );
+                if( !mPendingParamValues.empty() ) {
+                    setPanelValues( SHADER_UI, mPendingParamValues );
+                }
+                else if( mGlslInitialized ) {
+                    setPanelValues( SHADER_UI, values );
+                }
+                else {
+                    mUIRef->loadUI( ui, getAppSupportWorkingSessionSettingsPath() );
+                }
+            }
+            bindTimeline();
+            bindParamGetters();
         }
-        else {
-            mGlslParamsRef = GlslParams::create();
+        mPendingParamValues.clear();
+        reflectUniforms();
+        setupVariants( sources );
+        // Shaders that include aov.glsl name the four channels of their second output
+        mAovNames.clear();
+        string aovNames;
+        if( findDefine( sources, "FRAGMENT_AOV" ) && findDefine( sources, "AOV_NAMES", &aovNames ) ) {
+            istringstream stream( aovNames );
+            string name;
+            while( stream >> name && mAovNames.size() < 4 ) {
+                mAovNames.push_back( name );
+            }
         }
-        mGlslParamsRef->parseUniforms( sources );
-        auto ui = mUIRef->getUI( SHADER_UI );
-        if( ui != nullptr ) {
-            ui->clear();
-            setupShaderUI( ui );
-            mUIRef->addShaderParamsUI( ui, *( mGlslParamsRef.get() ) );
-            mUIRef->loadUI( ui, getAppSupportWorkingSessionSettingsPath() );
+        // The console shows the analysis once it comes in rather than the old source's
+        mAnalysisSources = sources;
+        mAnalysisTiers.clear();
+        mShaderAnalysisRef = nullptr;
+        analyzeShader( mQualityTiersRef->getLiveTier() );
+        if( mCheckerboardRef ) {
+            mCheckerboardRef->reset();
+        }
+        if( !mStartupReported ) {
+            reportStartup();
         }
         mCompiledGlsl = true;
         mGlslInitialized = true;
+        mGlslGeneration++;
         mCompiledMessageError = "";
         consoleUI();
     };
@@ -946,24 +3464,470 @@ void Fragment::setupGlsl()
     auto errorFn = [this, consoleUI]( ci::Exception exc ) {
         CI_LOG_E( string( SHADER_UI ) + " ERROR: " + string( exc.what() ) );
         mGlslProgRef = gl::getStockShader( gl::ShaderDef().color() );
+        mQualityTiersRef->clear();
+        mAovNames.clear();
+        mShaderAnalysisRef = nullptr;
+        mPrepassGlslProgRef = nullptr;
+        mBakeGlslProgRef = nullptr;
+        mFrameDirty = true;
         mCompiledGlsl = false;
+        mGlslGeneration++;
         mCompiledMessageError = exc.what();
         consoleUI();
+        if( !mStartupReported ) {
+            reportStartup();
+        }
     };
 
     auto vertex = getAppSupportWorkingSessionShadersPath( "shader.vert" );
     auto fragment = getAppSupportWorkingSessionShadersPath( "shader.frag" );
-    auto format = gl::GlslProg::Format();
+    auto format = gl::GlslProg::Format().fragDataLocation( 0, "oColor" ).fragDataLocation( 1, "oAov" );
+
+    auto compile = [vertex, fragment, format, superFn, successFn, errorFn]() {
+        reza::live::glsl( vertex, fragment, format, superFn, successFn, errorFn );
+    };
+
+    // The whole Shaders tree is watched so edits to includes rebuild too, and a save that
+    // writes several files (or loading a session) settles into a single compile
+    mShaderWatcherRef = FileWatcher::create( getAppSupportWorkingSessionShadersPath(), [this, compile]( const vector<fs::path> &paths ) {
+        bool rebuild = false;
+        for( auto &it : paths ) {
+            string ext = it.extension().string();
+            if( ext == ".vert" || ext == ".frag" || ext == ".glsl" ) {
+                CI_LOG_V( "SHADER CHANGED: " << it );
+                rebuild = true;
+            }
+        }
+        if( rebuild ) {
+            mSnapshotShadersDirty = true;
+            compile();
+        }
+    } );
+    // The first build runs on the first frame, once the UIs and settings are in place
+    mShaderWatcherRef->touch( fragment );
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - SHADER PARAMS
+//------------------------------------------------------------------------------
+
+string Fragment::getUniformSignature( const vector<string> &sources )
+{
+    // Uniform declarations together with their annotations are everything the params and
+    // texture channels are built from
+    string signature;
+    for( auto &source : sources ) {
+        istringstream stream( source );
+        string line;
+        while( getline( stream, line ) ) {
+            size_t start = line.find_first_not_of( " \t" );
+            if( start != string::npos && line.compare( start, 8, "uniform " ) == 0 ) {
+                size_t end = line.find_last_not_of( " \t\r" );
+                signature += line.substr( start, end - start + 1 ) + "\n";
+            }
+        }
+    }
+    return signature;
+}
+
+Fragment::PanelValues Fragment::getPanelValues( const string &panel )
+{
+    PanelValues values;
+    auto ui = mUIRef->getUI( panel );
+    if( ui == nullptr ) {
+        return values;
+    }
+    for( auto &view : ui->getSubViews() ) {
+        string name = view->getName();
+        string type = view->getType();
+        vector<float> value;
+        if( type == "Sliderf" ) {
+            value.push_back( static_cast<Sliderf *>( view.get() )->getValue() );
+        }
+        else if( type == "Slideri" ) {
+            value.push_back( static_cast<Slideri *>( view.get() )->getValue() );
+        }
+        else if( type == "Dialerf" ) {
+            value.push_back( static_cast<Dialerf *>( view.get() )->getValue() );
+        }
+        else if( type == "Dialeri" ) {
+            value.push_back( static_cast<Dialeri *>( view.get() )->getValue() );
+        }
+        else if( type == "Toggle" ) {
+            value.push_back( static_cast<Toggle *>( view.get() )->getValue() ? 1.0f : 0.0f );
+        }
+        else if( type == "XYPad" ) {
+            vec2 xy = static_cast<XYPad *>( view.get() )->getValue();
+            value.push_back( xy.x );
+            value.push_back( xy.y );
+        }
+        else if( type == "Rangef" ) {
+            Rangef *widget = static_cast<Rangef *>( view.get() );
+            value.push_back( widget->getValueLow() );
+            value.push_back( widget->getValueHigh() );
+        }
+        else if( type == "Rangei" ) {
+            Rangei *widget = static_cast<Rangei *>( view.get() );
+            value.push_back( widget->getValueLow() );
+            value.push_back( widget->getValueHigh() );
+        }
+        else if( type == "ColorPicker" ) {
+            ColorA color = static_cast<ColorPicker *>( view.get() )->getColor();
+            value.push_back( color.r );
+            value.push_back( color.g );
+            value.push_back( color.b );
+            value.push_back( color.a );
+        }
+        else if( type == "MultiSlider" ) {
+            MultiSlider *widget = static_cast<MultiSlider *>( view.get() );
+            vector<string> suffixes = { "-X", "-Y", "-Z", "-W" };
+            int total = std::min( int( widget->getSubViews().size() ), int( suffixes.size() ) );
+            for( int i = 0; i < total; i++ ) {
+                value.push_back( widget->getValue( name + suffixes[i] ) );
+            }
+        }
+        if( !value.empty() ) {
+            values[name] = make_pair( type, value );
+        }
+    }
+    return values;
+}
+
+void Fragment::setPanelValues( const string &panel, const PanelValues &values )
+{
+    // Only widgets that kept their name and type get their value back, anything new or
+    // retyped starts from the defaults in its annotation
+    auto ui = mUIRef->getUI( panel );
+    if( ui == nullptr ) {
+        return;
+    }
+    for( auto &view : ui->getSubViews() ) {
+        auto it = values.find( view->getName() );
+        if( it == values.end() || it->second.first != view->getType() || it->second.second.empty() ) {
+            continue;
+        }
+        const string &type = it->second.first;
+        const vector<float> &value = it->second.second;
+        if( type == "Sliderf" ) {
+            static_cast<Sliderf *>( view.get() )->setValue( value[0] );
+        }
+        else if( type == "Slideri" ) {
+            static_cast<Slideri *>( view.get() )->setValue( int( value[0] ) );
+        }
+        else if( type == "Dialerf" ) {
+            static_cast<Dialerf *>( view.get() )->setValue( value[0] );
+        }
+        else if( type == "Dialeri" ) {
+            static_cast<Dialeri *>( view.get() )->setValue( int( value[0] ) );
+        }
+        else if( type == "Toggle" ) {
+            static_cast<Toggle *>( view.get() )->setValue( value[0] > 0.5f );
+        }
+        else if( type == "XYPad" && value.size() > 1 ) {
+            static_cast<XYPad *>( view.get() )->setValue( vec2( value[0], value[1] ) );
+        }
+        else if( type == "Rangef" && value.size() > 1 ) {
+            static_cast<Rangef *>( view.get() )->setValue( value[0], value[1] );
+        }
+        else if( type == "Rangei" && value.size() > 1 ) {
+            static_cast<Rangei *>( view.get() )->setValue( int( value[0] ), int( value[1] ) );
+        }
+        else if( type == "ColorPicker" && value.size() > 3 ) {
+            static_cast<ColorPicker *>( view.get() )->setColor( ColorA( value[0], value[1], value[2], value[3] ) );
+        }
+        else if( type == "MultiSlider" ) {
+            MultiSlider *widget = static_cast<MultiSlider *>( view.get() );
+            vector<string> suffixes = { "-X", "-Y", "-Z", "-W" };
+            int total = std::min( { int( widget->getSubViews().size() ), int( suffixes.size() ), int( value.size() ) } );
+            for( int i = 0; i < total; i++ ) {
+                widget->setValue( view->getName() + suffixes[i], value[i] );
+            }
+        }
+        view->trigger();
+    }
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - TIMELINE
+//------------------------------------------------------------------------------
+
+void Fragment::setupTimeline()
+{
+    mTimelineRef = Timeline::create();
+}
+
+void Fragment::updateTimeline()
+{
+    size_t total = mTimelineSetters.size();
+    if( !mTimelineEnabled || total == 0 ) {
+        // Turning the timeline back on writes every track again
+        std::fill( mTimelineLast.begin(), mTimelineLast.end(), NAN );
+        return;
+    }
+    // A track only writes when its value moves, so a widget dragged while the timeline holds
+    // still keeps the drag until the next key takes over
+    mTimelineRef->evaluate( mCurrentTime, mTimelineValues.data() );
+    for( size_t i = 0; i < total; i++ ) {
+        if( !mTimelineSetters[i] || mJobParams.count( mTimelineParams[i] ) ) {
+            mTimelineLast[i] = NAN;
+        }
+        else if( mTimelineValues[i] != mTimelineLast[i] ) {
+            mTimelineLast[i] = mTimelineValues[i];
+            mTimelineSetters[i]( mTimelineValues[i] );
+        }
+    }
+}
+
+void Fragment::bindTimeline()
+{
+    mTimelineSetters.clear();
+    mTimelineParams.clear();
+    mTimelineRef->compile();
+    for( auto &it : mTimelineRef->getTracks() ) {
+        auto setter = getViewSetter( it.mName );
+        if( !setter ) {
+            CI_LOG_W( "Timeline track not bound: " << it.mName );
+        }
+        mTimelineSetters.push_back( setter );
+        vector<string> keys = split( it.mName, "/" );
+        string name = keys.size() > 1 ? keys[1] : "";
+        std::transform( name.begin(), name.end(), name.begin(), ::toupper );
+        mTimelineParams.push_back( name );
+    }
+    mTimelineValues.resize( mTimelineSetters.size() );
+    mTimelineLast.assign( mTimelineSetters.size(), NAN );
+}
+
+void Fragment::keyTimeline()
+{
+    auto ui = mUIRef->getUI( SHADER_UI );
+    if( ui == nullptr ) {
+        return;
+    }
+    string prefix = string( SHADER_UI ) + "/";
+    for( auto &view : ui->getSubViews() ) {
+        string name = view->getName();
+        string type = view->getType();
+        if( type == "Sliderf" ) {
+            mTimelineRef->addKey( prefix + name, mCurrentTime, static_cast<Sliderf *>( view.get() )->getValue() );
+        }
+        else if( type == "Slideri" ) {
+            mTimelineRef->addKey( prefix + name, mCurrentTime, static_cast<Slideri *>( view.get() )->getValue() );
+        }
+        else if( type == "Dialerf" ) {
+            mTimelineRef->addKey( prefix + name, mCurrentTime, static_cast<Dialerf *>( view.get() )->getValue() );
+        }
+        else if( type == "Dialeri" ) {
+            mTimelineRef->addKey( prefix + name, mCurrentTime, static_cast<Dialeri *>( view.get() )->getValue() );
+        }
+        else if( type == "Toggle" ) {
+            mTimelineRef->addKey( prefix + name, mCurrentTime, static_cast<Toggle *>( view.get() )->getValue() ? 1.0f : 0.0f, Ease::STEP );
+        }
+        else if( type == "XYPad" ) {
+            vec2 value = static_cast<XYPad *>( view.get() )->getValue();
+            mTimelineRef->addKey( prefix + name + "/1", mCurrentTime, value.x );
+            mTimelineRef->addKey( prefix + name + "/2", mCurrentTime, value.y );
+        }
+        else if( type == "Rangef" ) {
+            Rangef *widget = static_cast<Rangef *>( view.get() );
+            mTimelineRef->addKey( prefix + name + "/1", mCurrentTime, widget->getValueLow() );
+            mTimelineRef->addKey( prefix + name + "/2", mCurrentTime, widget->getValueHigh() );
+        }
+        else if( type == "Rangei" ) {
+            Rangei *widget = static_cast<Rangei *>( view.get() );
+            mTimelineRef->addKey( prefix + name + "/1", mCurrentTime, widget->getValueLow() );
+            mTimelineRef->addKey( prefix + name + "/2", mCurrentTime, widget->getValueHigh() );
+        }
+        else if( type == "ColorPicker" ) {
+            ColorA color = static_cast<ColorPicker *>( view.get() )->getColor();
+            for( int i = 0; i < 4; i++ ) {
+                mTimelineRef->addKey( prefix + name + "/" + to_string( i + 1 ), mCurrentTime, color[i] );
+            }
+        }
+        else if( type == "MultiSlider" ) {
+            MultiSlider *widget = static_cast<MultiSlider *>( view.get() );
+            vector<string> suffixes = { "-X", "-Y", "-Z", "-W" };
+            int total = std::min( int( widget->getSubViews().size() ), int( suffixes.size() ) );
+            for( int i = 0; i < total; i++ ) {
+                mTimelineRef->addKey( prefix + name + "/" + to_string( i + 1 ), mCurrentTime, widget->getValue( name + suffixes[i] ) );
+            }
+        }
+    }
+    bindTimeline();
+    saveTimeline( getAppSupportWorkingSessionSettingsPath() );
+}
+
+void Fragment::saveTimeline( const fs::path &path )
+{
+    auto pth = addPath( path, TIMELINE_PATH );
+    if( mTimelineRef->isEmpty() ) {
+        if( fs::exists( pth ) ) {
+            fs::remove( pth );
+        }
+    }
+    else {
+        mTimelineRef->save( pth );
+    }
+}
 
-    wd::unwatch( vertex );
-    wd::unwatch( fragment );
+void Fragment::loadTimeline( const fs::path &path )
+{
+    mTimelineRef->load( addPath( path, TIMELINE_PATH ) );
+    bindTimeline();
+}
 
-    auto cb = [this, vertex, fragment, format, superFn, successFn, errorFn]( const fs::path &path ) {
-        reza::live::glsl( vertex, fragment, format, superFn, successFn, errorFn );
-    };
+function<void( float )> Fragment::getViewSetter( const string &address )
+{
+    // Timeline tracks use the same addressing as OSC (panel/widget/component) but carry
+    // values in the widget's own range instead of 0 -> 1.
+    vector<string> keys = split( address, "/" );
+    int numKeys = int( keys.size() );
+    if( numKeys < 2 || mUIRef == nullptr ) {
+        return nullptr;
+    }
+    auto ui = mUIRef->getUI( keys[0] );
+    if( ui == nullptr ) {
+        return nullptr;
+    }
+    string subkey = keys[1];
+    auto view = ui->getSubView( subkey );
+    if( view == nullptr ) {
+        std::transform( subkey.begin(), subkey.end(), subkey.begin(), ::toupper );
+        view = ui->getSubView( subkey );
+    }
+    if( view == nullptr ) {
+        return nullptr;
+    }
 
-    wd::watch( vertex, cb );
-    wd::watch( fragment, cb );
+    // Widgets are only triggered when the value they end up with changed, a timeline
+    // holding still doesn't rerun every binding each frame
+    View *ptr = view.get();
+    string type = view->getType();
+    if( type == "Sliderf" ) {
+        return [ptr]( float value ) {
+            Sliderf *widget = static_cast<Sliderf *>( ptr );
+            float last = widget->getValue();
+            widget->setValue( value );
+            if( widget->getValue() != last ) {
+                ptr->trigger();
+            }
+        };
+    }
+    else if( type == "Slideri" ) {
+        return [ptr]( float value ) {
+            Slideri *widget = static_cast<Slideri *>( ptr );
+            int last = widget->getValue();
+            widget->setValue( int( std::round( value ) ) );
+            if( widget->getValue() != last ) {
+                ptr->trigger();
+            }
+        };
+    }
+    else if( type == "Dialerf" ) {
+        return [ptr]( float value ) {
+            Dialerf *widget = static_cast<Dialerf *>( ptr );
+            float last = widget->getValue();
+            widget->setValue( value );
+            if( widget->getValue() != last ) {
+                ptr->trigger();
+            }
+        };
+    }
+    else if( type == "Dialeri" ) {
+        return [ptr]( float value ) {
+            Dialeri *widget = static_cast<Dialeri *>( ptr );
+            int last = widget->getValue();
+            widget->setValue( int( std::round( value ) ) );
+            if( widget->getValue() != last ) {
+                ptr->trigger();
+            }
+        };
+    }
+    else if( type == "Toggle" ) {
+        return [ptr]( float value ) {
+            Toggle *widget = static_cast<Toggle *>( ptr );
+            if( widget->getValue() != ( value > 0.5f ) ) {
+                widget->setValue( value > 0.5f );
+                ptr->trigger();
+            }
+        };
+    }
+    else if( type == "XYPad" && numKeys > 2 ) {
+        int index = stoi( keys[2] );
+        return [ptr, index]( float value ) {
+            XYPad *widget = static_cast<XYPad *>( ptr );
+            vec2 last = widget->getValue();
+            vec2 v = last;
+            if( index == 1 ) {
+                v.x = value;
+            }
+            else {
+                v.y = value;
+            }
+            widget->setValue( v );
+            if( widget->getValue() != last ) {
+                ptr->trigger();
+            }
+        };
+    }
+    else if( type == "Rangef" && numKeys > 2 ) {
+        int index = stoi( keys[2] );
+        return [ptr, index]( float value ) {
+            Rangef *widget = static_cast<Rangef *>( ptr );
+            float low = widget->getValueLow();
+            float high = widget->getValueHigh();
+            widget->setValue( index == 1 ? value : low, index == 1 ? high : value );
+            if( widget->getValueLow() != low || widget->getValueHigh() != high ) {
+                ptr->trigger();
+            }
+        };
+    }
+    else if( type == "Rangei" && numKeys > 2 ) {
+        int index = stoi( keys[2] );
+        return [ptr, index]( float value ) {
+            Rangei *widget = static_cast<Rangei *>( ptr );
+            int low = widget->getValueLow();
+            int high = widget->getValueHigh();
+            int v = int( std::round( value ) );
+            widget->setValue( index == 1 ? v : low, index == 1 ? high : v );
+            if( widget->getValueLow() != low || widget->getValueHigh() != high ) {
+                ptr->trigger();
+            }
+        };
+    }
+    else if( type == "ColorPicker" && numKeys > 2 ) {
+        int index = stoi( keys[2] );
+        if( index < 1 || index > 4 ) {
+            return nullptr;
+        }
+        return [ptr, index]( float value ) {
+            ColorPicker *widget = static_cast<ColorPicker *>( ptr );
+            ColorA last = widget->getColor();
+            ColorA color = last;
+            color[index - 1] = value;
+            widget->setColor( color );
+            if( widget->getColor() != last ) {
+                ptr->trigger();
+            }
+        };
+    }
+    else if( type == "MultiSlider" && numKeys > 2 ) {
+        int index = stoi( keys[2] );
+        vector<string> suffixes = { "-X", "-Y", "-Z", "-W" };
+        if( index < 1 || index > int( suffixes.size() ) ) {
+            return nullptr;
+        }
+        string key = subkey + suffixes[index - 1];
+        return [ptr, key]( float value ) {
+            MultiSlider *widget = static_cast<MultiSlider *>( ptr );
+            float last = widget->getValue( key );
+            widget->setValue( key, value );
+            if( widget->getValue( key ) != last ) {
+                ptr->trigger();
+            }
+        };
+    }
+    return nullptr;
 }
 
 //------------------------------------------------------------------------------
@@ -1019,14 +3983,21 @@ void Fragment::saveSettings( const fs::path &path )
     saveDefaultPaths( getAppSupportPath() );
     mUIRef->saveUIs( pth );
     saveCamera( addPath( pth, CAMERA_PATH ), mCameraRef->getCameraPersp() );
+    saveTimeline( pth );
+    saveAudio( pth );
 }
 
 void Fragment::loadSettings( const fs::path &path )
 {
     auto pth = addPath( path, SETTINGS_PATH );
     loadDefaultPaths( getAppSupportPath() );
+    mLoadingSettings = true;
     mUIRef->loadUIs( pth );
+    mLoadingSettings = false;
+    syncOscRecordingUI();
     loadCamera( addPath( pth, CAMERA_PATH ), mCameraRef->getCameraPersp(), [this]() { mCameraRef->update(); } );
+    loadTimeline( pth );
+    loadAudio( pth );
 }
 
 //------------------------------------------------------------------------------
@@ -1080,6 +4051,335 @@ void Fragment::loadSession()
     }
 }
 
+//------------------------------------------------------------------------------
+#pragma mark - SNAPSHOT
+//------------------------------------------------------------------------------
+
+void Fragment::setupSnapshot()
+{
+    mSnapshotRef = Snapshot::create();
+    // The marker is left by cleanup(), a run that never got there crashed
+    auto marker = getAppSupportPath( CLEAN_SHUTDOWN_PATH );
+    mCleanShutdown = fs::exists( marker );
+    if( mCleanShutdown ) {
+        fs::remove( marker );
+    }
+}
+
+void Fragment::updateSnapshot()
+{
+    // Autosave. The panels, camera and timeline are read here, the shader sources are only
+    // read again after the watcher saw them change, and the reading and writing happen on
+    // a worker. Nothing is handed over when nothing changed since the last time.
+    double now = getElapsedSeconds();
+    if( now - mSnapshotTime < mSnapshotInterval ) {
+        return;
+    }
+    if( mSnapshotSave.valid() ) {
+        if( mSnapshotSave.wait_for( chrono::seconds( 0 ) ) != future_status::ready ) {
+            return;
+        }
+        mSnapshotSave.get();
+    }
+    mSnapshotTime = now;
+    auto chunks = getSnapshotChunks();
+    if( chunks == mSnapshotChunks && !mSnapshotShadersDirty ) {
+        return;
+    }
+    mSnapshotChunks = chunks;
+    bool shaders = mSnapshotShadersDirty;
+    mSnapshotShadersDirty = false;
+    auto root = getAppSupportWorkingSessionShadersPath();
+    auto path = getAppSupportWorkingSessionSettingsPath( SNAPSHOT_PATH );
+    mSnapshotSave = async( launch::async, [this, chunks, shaders, root, path] {
+        if( shaders ) {
+            mSnapshotRef->setChunk( Snapshot::tag( "SHDR" ), getSnapshotShaders( root ) );
+        }
+        for( auto &it : chunks ) {
+            mSnapshotRef->setChunk( it.first, it.second );
+        }
+        return mSnapshotRef->save( path );
+    } );
+}
+
+void Fragment::waitSnapshot()
+{
+    if( mSnapshotSave.valid() ) {
+        mSnapshotSave.get();
+    }
+}
+
+bool Fragment::isSnapshotSource( const fs::path &path )
+{
+    // Images and other binary assets stay out of the snapshot, they're copied with the session
+    string ext = path.extension().string();
+    return ext == ".vert" || ext == ".frag" || ext == ".glsl";
+}
+
+string Fragment::getSnapshotShaders( const fs::path &root )
+{
+    ChunkWriter shaders;
+    vector<pair<string, string>> files;
+    if( fs::exists( root ) ) {
+        for( fs::recursive_directory_iterator it( root ), end; it != end; ++it ) {
+            if( fs::is_regular_file( it->path() ) && isSnapshotSource( it->path() ) ) {
+                string relative = it->path().string().substr( root.string().size() );
+                ifstream stream( it->path().string(), ios::binary );
+                files.push_back( make_pair( relative, string( istreambuf_iterator<char>( stream ), istreambuf_iterator<char>() ) ) );
+            }
+        }
+    }
+    shaders.write<uint32_t>( uint32_t( files.size() ) );
+    for( auto &it : files ) {
+        shaders.writeString( it.first );
+        shaders.writeString( it.second );
+    }
+    return shaders.getBytes();
+}
+
+bool Fragment::isSnapshotCurrent( const fs::path &session )
+{
+    // Whether the session's snapshot was written after every shader and settings file it
+    // covers, i.e. nothing was edited outside the app since
+    auto snapshot = addPath( session, SNAPSHOT_PATH );
+    if( !fs::exists( snapshot ) ) {
+        return false;
+    }
+    auto written = fs::last_write_time( snapshot );
+    for( fs::recursive_directory_iterator it( session ), end; it != end; ++it ) {
+        string ext = it->path().extension().string();
+        if( fs::is_regular_file( it->path() ) && ( isSnapshotSource( it->path() ) || ext == ".json" ) && fs::last_write_time( it->path() ) > written ) {
+            CI_LOG_I( "SNAPSHOT OLDER THAN " << it->path() );
+            return false;
+        }
+    }
+    return true;
+}
+
+map<uint32_t, string> Fragment::getSnapshotChunks()
+{
+    map<uint32_t, string> chunks;
+    ChunkWriter panels;
+    vector<string> names = { APP_UI, SHADER_UI, EXPORTER_UI };
+    panels.write<uint32_t>( uint32_t( names.size() ) );
+    for( auto &name : names ) {
+        PanelValues values = getPanelValues( name );
+        panels.writeString( name );
+        panels.write<uint32_t>( uint32_t( values.size() ) );
+        for( auto &it : values ) {
+            panels.writeString( it.first );
+            panels.writeString( it.second.first );
+            panels.write<uint32_t>( uint32_t( it.second.second.size() ) );
+            for( float value : it.second.second ) {
+                panels.write( value );
+            }
+        }
+    }
+    chunks[Snapshot::tag( "UIS " )] = panels.getBytes();
+
+    ChunkWriter camera;
+    const auto &cam = mCameraRef->getCameraPersp();
+    camera.write( cam.getEyePoint() );
+    camera.write( cam.getOrientation() );
+    camera.write( cam.getPivotDistance() );
+    camera.write( cam.getFov() );
+    camera.write( cam.getNearClip() );
+    camera.write( cam.getFarClip() );
+    chunks[Snapshot::tag( "CAM " )] = camera.getBytes();
+
+    ChunkWriter timeline;
+    timeline.write<uint32_t>( uint32_t( mTimelineRef->getNumTracks() ) );
+    for( auto &track : mTimelineRef->getTracks() ) {
+        timeline.writeString( track.mName );
+        timeline.write<uint32_t>( uint32_t( track.mKeys.size() ) );
+        for( auto &key : track.mKeys ) {
+            timeline.write( key.mTime );
+            timeline.write( key.mValue );
+            timeline.write<int32_t>( int32_t( key.mEase ) );
+        }
+    }
+    chunks[Snapshot::tag( "TIME" )] = timeline.getBytes();
+
+    ChunkWriter audio;
+    audio.writeString( mAudioFilePath.string() );
+    chunks[Snapshot::tag( "AUDI" )] = audio.getBytes();
+    return chunks;
+}
+
+bool Fragment::saveSnapshot( const fs::path &path )
+{
+    waitSnapshot();
+    mSnapshotChunks = getSnapshotChunks();
+    for( auto &it : mSnapshotChunks ) {
+        mSnapshotRef->setChunk( it.first, it.second );
+    }
+    mSnapshotRef->setChunk( Snapshot::tag( "SHDR" ), getSnapshotShaders( getAppSupportWorkingSessionShadersPath() ) );
+    mSnapshotShadersDirty = false;
+    return mSnapshotRef->save( path );
+}
+
+bool Fragment::loadSnapshot( const fs::path &path )
+{
+    waitSnapshot();
+    if( !fs::exists( path ) || !mSnapshotRef->load( path ) ) {
+        return false;
+    }
+
+    // Every chunk is read through before anything is applied, so a snapshot cut short
+    // leaves the session to its JSON files rather than loading half of it
+    auto shaders = mSnapshotRef->getChunk( Snapshot::tag( "SHDR" ) );
+    uint32_t numFiles = 0;
+    bool hasShaders = shaders.read( numFiles );
+    vector<pair<string, string>> files;
+    for( uint32_t i = 0; i < numFiles && shaders.isGood(); i++ ) {
+        string relative, contents;
+        if( shaders.readString( relative ) && shaders.readString( contents ) ) {
+            files.push_back( make_pair( relative, contents ) );
+        }
+    }
+
+    auto panels = mSnapshotRef->getChunk( Snapshot::tag( "UIS " ) );
+    uint32_t numPanels = 0;
+    panels.read( numPanels );
+    vector<pair<string, PanelValues>> panelValues;
+    for( uint32_t i = 0; i < numPanels && panels.isGood(); i++ ) {
+        string name;
+        uint32_t numValues = 0;
+        panels.readString( name );
+        panels.read( numValues );
+        PanelValues values;
+        for( uint32_t j = 0; j < numValues && panels.isGood(); j++ ) {
+            string key, type;
+            uint32_t count = 0;
+            panels.readString( key );
+            panels.readString( type );
+            panels.read( count );
+            vector<float> value( count );
+            for( uint32_t k = 0; k < count && panels.isGood(); k++ ) {
+                panels.read( value[k] );
+            }
+            values[key] = make_pair( type, value );
+        }
+        panelValues.push_back( make_pair( name, values ) );
+    }
+
+    auto camera = mSnapshotRef->getChunk( Snapshot::tag( "CAM " ) );
+    vec3 eye;
+    quat orientation;
+    float pivot, fov, nearClip, farClip;
+    bool hasCamera = camera.read( eye ) && camera.read( orientation ) && camera.read( pivot ) && camera.read( fov ) && camera.read( nearClip ) && camera.read( farClip );
+
+    auto timeline = mSnapshotRef->getChunk( Snapshot::tag( "TIME" ) );
+    uint32_t numTracks = 0;
+    bool hasTimeline = timeline.read( numTracks );
+    vector<Track> tracks;
+    for( uint32_t i = 0; i < numTracks && timeline.isGood(); i++ ) {
+        Track track;
+        uint32_t numKeys = 0;
+        timeline.readString( track.mName );
+        timeline.read( numKeys );
+        for( uint32_t j = 0; j < numKeys && timeline.isGood(); j++ ) {
+            float time, value;
+            int32_t ease;
+            if( timeline.read( time ) && timeline.read( value ) && timeline.read( ease ) ) {
+                track.mKeys.push_back( { time, value, Ease( ease ) } );
+            }
+        }
+        tracks.push_back( track );
+    }
+
+    auto audio = mSnapshotRef->getChunk( Snapshot::tag( "AUDI" ) );
+    string audioFile;
+    bool hasAudio = audio.readString( audioFile );
+
+    // Chunks the snapshot doesn't have are fine, ones it has have to read through
+    string truncated;
+    for( auto &it : { make_pair( "SHDR", shaders.isGood() ), make_pair( "UIS ", panels.isGood() ), make_pair( "CAM ", camera.isGood() ), make_pair( "TIME", timeline.isGood() ), make_pair( "AUDI", audio.isGood() ) } ) {
+        if( !it.second && mSnapshotRef->hasChunk( Snapshot::tag( it.first ) ) ) {
+            truncated += string( truncated.empty() ? "" : ", " ) + it.first;
+        }
+    }
+    if( !truncated.empty() ) {
+        CI_LOG_E( "SNAPSHOT TRUNCATED, LOADING SESSION FILES INSTEAD: " << path << " (" << truncated << ")" );
+        mSnapshotRef->clear();
+        return false;
+    }
+
+    // Only shader files that differ are written, each write is picked up by the watcher.
+    // Sources the snapshot doesn't have are removed so the tree matches it.
+    bool shadersChanged = false;
+    auto root = getAppSupportWorkingSessionShadersPath();
+    set<string> sources;
+    for( auto &file : files ) {
+        const string &relative = file.first;
+        const string &contents = file.second;
+        sources.insert( relative );
+        auto target = fs::path( root.string() + relative );
+        if( fs::exists( target ) ) {
+            ifstream stream( target.string(), ios::binary );
+            if( string( istreambuf_iterator<char>( stream ), istreambuf_iterator<char>() ) == contents ) {
+                continue;
+            }
+        }
+        createDirectories( target.parent_path() );
+        ofstream stream( target.string(), ios::binary | ios::trunc );
+        stream.write( contents.data(), contents.size() );
+        shadersChanged = true;
+    }
+    if( hasShaders && fs::exists( root ) ) {
+        vector<fs::path> stale;
+        for( fs::recursive_directory_iterator it( root ), end; it != end; ++it ) {
+            if( fs::is_regular_file( it->path() ) && isSnapshotSource( it->path() ) && !sources.count( it->path().string().substr( root.string().size() ) ) ) {
+                stale.push_back( it->path() );
+            }
+        }
+        for( auto &it : stale ) {
+            fs::remove( it );
+            shadersChanged = true;
+        }
+    }
+
+    mLoadingSettings = true;
+    for( auto &it : panelValues ) {
+        setPanelValues( it.first, it.second );
+        // A rebuilt params panel gets these values instead of the ones it had
+        if( it.first == SHADER_UI && shadersChanged ) {
+            mPendingParamValues = it.second;
+        }
+    }
+    mLoadingSettings = false;
+    syncOscRecordingUI();
+
+    if( hasCamera ) {
+        auto &cam = mCameraRef->getCameraPersp();
+        cam.setEyePoint( eye );
+        cam.setOrientation( orientation );
+        cam.setPivotDistance( pivot );
+        cam.setFov( fov );
+        cam.setNearClip( nearClip );
+        cam.setFarClip( farClip );
+        mCameraRef->update();
+    }
+
+    if( hasTimeline ) {
+        mTimelineRef->clear();
+        for( auto &track : tracks ) {
+            for( auto &key : track.mKeys ) {
+                mTimelineRef->addKey( track.mName, key.mTime, key.mValue, key.mEase );
+            }
+        }
+        bindTimeline();
+    }
+
+    if( hasAudio && fs::path( audioFile ) != mAudioFilePath ) {
+        setAudioFile( fs::exists( audioFile ) ? fs::path( audioFile ) : fs::path() );
+    }
+
+    mSnapshotRef->close();
+    mFrameDirty = true;
+    return true;
+}
+
 //------------------------------------------------------------------------------
 #pragma mark - SAVE & LOAD
 //------------------------------------------------------------------------------
@@ -1089,10 +4389,19 @@ void Fragment::save( const fs::path &path )
     createDirectory( path );
     saveShaders( path );
     saveSettings( path );
+    saveOscRecording( path );
+    saveSnapshot( addPath( path, SNAPSHOT_PATH ) );
 }
 
 void Fragment::load( const fs::path &path )
 {
+    stopOscRecording();
+    loadOscRecording( path );
+    // Sessions saved with a snapshot skip the directory copy and the JSON round trip,
+    // unless their files were edited after it was written
+    if( isSnapshotCurrent( path ) && loadSnapshot( addPath( path, SNAPSHOT_PATH ) ) ) {
+        return;
+    }
     copyDirectory( path, getAppSupportWorkingSessionPath() );
     loadSettings( path );
     loadShaders( path );
@@ -1104,125 +4413,431 @@ void Fragment::load( const fs::path &path )
 
 void Fragment::setupOsc()
 {
-    mReceiverRef = nullptr;
-    mReceiverRef = ReceiverRef( new Receiver( mOscPort ) );
-    mReceiverRef->setListener( "/*",
-        [this]( const osc::Message &msg ) {
-            string address = msg.getAddress().substr( 1 );
-            string typeTag = msg.getTypeTagString();
-            vector<string> keys = split( address, "/" );
-            int numKeys = int( keys.size() );
-            if( numKeys > 1 ) {
-                auto ui = mUIRef->getUI( keys[0] );
-                if( ui ) {
-                    string subkey = keys[1];
-                    auto view = ui->getSubView( subkey );
-                    if( view == nullptr ) {
-                        std::transform( subkey.begin(), subkey.end(), subkey.begin(), ::toupper );
-                        view = ui->getSubView( subkey );
-                    }
-                    if( view ) {
-                        string type = view->getType();
-                        if( type == "Sliderf" && typeTag == "f" ) {
-                            Sliderf *widget = static_cast<Sliderf *>( view.get() );
-                            widget->setValue( lmap<float>( msg.getArgFloat( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
-                        }
-                        else if( type == "Slideri" && typeTag == "f" ) {
-                            Slideri *widget = static_cast<Slideri *>( view.get() );
-                            widget->setValue( lmap<float>( msg.getArgFloat( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
-                        }
-                        else if( type == "Sliderd" && typeTag == "f" ) {
-                            Sliderd *widget = static_cast<Sliderd *>( view.get() );
-                            widget->setValue( lmap<double>( msg.getArgDouble( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
+    mReceiverUdpRefs.clear();
+    mReceiverTcpRefs.clear();
+
+    auto listener = [this]( const osc::Message &msg ) { receiveOscMessage( msg ); };
+    for( int i = 0; i < mOscPortCount; i++ ) {
+        uint16_t port = uint16_t( mOscPort + i );
+        if( mOscUdp ) {
+            auto receiver = ReceiverUdpRef( new osc::ReceiverUdp( port ) );
+            receiver->setListener( "/*", listener );
+            try {
+                receiver->bind();
+                receiver->listen(
+                    []( asio::error_code error, asio::ip::udp::endpoint endpoint ) -> bool {
+                        if( error ) {
+                            CI_LOG_E( "Error Listening: " << error.message() << " val: " << error.value() << " endpoint: " << endpoint );
+                            return false;
                         }
-                        else if( type == "MultiSlider" && typeTag == "f" && numKeys > 2 ) {
-                            MultiSlider *widget = static_cast<MultiSlider *>( view.get() );
-                            int index = stoi( keys[2] );
-                            if( ( index - 1 ) < int( widget->getSubViews().size() ) ) {
-                                string key = subkey;
-                                switch( index ) {
-                                case 1:
-                                    key += "-X";
-                                    break;
-                                case 2:
-                                    key += "-Y";
-                                    break;
-                                case 3:
-                                    key += "-Z";
-                                    break;
-                                case 4:
-                                    key += "-W";
-                                    break;
-                                default:
-                                    break;
-                                }
-
-                                widget->setValue( key, lmap<float>( msg.getArgFloat( 0 ), 0.0, 1.0, widget->getMin( key ), widget->getMax( key ) ) );
-                            }
-                        }
-                        else if( type == "Dialeri" && typeTag == "f" ) {
-                            Dialeri *widget = static_cast<Dialeri *>( view.get() );
-                            widget->setValue( lmap<float>( msg.getArgFloat( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
-                        }
-                        else if( type == "Dialerf" && typeTag == "f" ) {
-                            Dialerf *widget = static_cast<Dialerf *>( view.get() );
-                            widget->setValue( lmap<float>( msg.getArgFloat( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
-                        }
-                        else if( type == "Dialerd" && typeTag == "f" ) {
-                            Dialerd *widget = static_cast<Dialerd *>( view.get() );
-                            widget->setValue( lmap<double>( msg.getArgDouble( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
-                        }
-                        else if( type == "Toggle" ) {
-                            Toggle *toggle = static_cast<Toggle *>( view.get() );
-                            if( typeTag == "f" ) {
-                                toggle->setValue( msg.getArgFloat( 0 ) );
-                            }
-                            else if( typeTag == "b" ) {
-                                toggle->setValue( msg.getArgBool( 0 ) );
-                            }
-                        }
-                        else if( type == "Button" ) {
-                            Button *button = static_cast<Button *>( view.get() );
-                            if( typeTag == "f" ) {
-                                button->setValue( msg.getArgFloat( 0 ) );
-                            }
-                            else if( typeTag == "b" ) {
-                                button->setValue( msg.getArgBool( 0 ) );
-                            }
+                        else
+                            return true;
+                    } );
+                mReceiverUdpRefs.push_back( receiver );
+            }
+            catch( const osc::Exception &ex ) {
+                CI_LOG_E( "Error binding UDP " << port << ": " << ex.what() << " val: " << ex.value() );
+            }
+        }
+        if( mOscTcp ) {
+            auto receiver = ReceiverTcpRef( new osc::ReceiverTcp( port ) );
+            receiver->setListener( "/*", listener );
+            try {
+                receiver->bind();
+                receiver->accept(
+                    []( asio::error_code error, asio::ip::tcp::endpoint endpoint ) -> bool {
+                        if( error ) {
+                            CI_LOG_E( "Error Accepting: " << error.message() << " val: " << error.value() << " endpoint: " << endpoint );
+                            return false;
                         }
-                        else if( type == "XYPad" ) {
-                            XYPad *widget = static_cast<XYPad *>( view.get() );
-                            if( typeTag == "ff" ) {
-                                vec2 min = widget->getMin();
-                                vec2 max = widget->getMax();
-                                float x = lmap<float>( msg.getArgFloat( 0 ), 0, 1, min.x, max.x );
-                                float y = lmap<float>( msg.getArgFloat( 1 ), 0, 1, min.y, max.y );
-                                widget->setValue( vec2( x, y ) );
-                            }
+                        else
+                            return true;
+                    } );
+                mReceiverTcpRefs.push_back( receiver );
+            }
+            catch( const osc::Exception &ex ) {
+                CI_LOG_E( "Error binding TCP " << port << ": " << ex.what() << " val: " << ex.value() );
+            }
+        }
+    }
+}
+
+void Fragment::receiveOscMessage( const osc::Message &msg )
+{
+    mFramePacerRef->markInput();
+    mOscRecorderRef->record( msg );
+    if( !mOscReplaying ) {
+        mOscQueue.push_back( msg );
+    }
+}
+
+void Fragment::updateOsc()
+{
+    // Everything that arrived since the last frame, including every message of a
+    // bundle, is applied together before the frame is drawn. ci::osc does not expose
+    // bundle timetags, so bundles are treated as immediate.
+    for( auto &it : mOscQueue ) {
+        routeOscMessage( it );
+    }
+    mOscQueue.clear();
+}
+
+void Fragment::routeOscMessage( const osc::Message &msg )
+{
+    string address = msg.getAddress().substr( 1 );
+    string typeTag = msg.getTypeTagString();
+    vector<string> keys = split( address, "/" );
+    int numKeys = int( keys.size() );
+
+    // A whole vector can arrive in one message, either as N floats or as a blob of packed floats
+    vector<float> values;
+    if( typeTag == "b" ) {
+        const auto &blob = msg.getArgBlob( 0 );
+        values.resize( blob.getSize() / sizeof( float ) );
+        memcpy( values.data(), blob.getData(), values.size() * sizeof( float ) );
+    }
+    else if( typeTag.size() > 1 && typeTag.find_first_not_of( 'f' ) == string::npos ) {
+        for( size_t i = 0; i < typeTag.size(); i++ ) {
+            values.push_back( msg.getArgFloat( uint32_t( i ) ) );
+        }
+    }
+
+    if( numKeys > 1 ) {
+        auto ui = mUIRef->getUI( keys[0] );
+        if( ui ) {
+            string subkey = keys[1];
+            auto view = ui->getSubView( subkey );
+            if( view == nullptr ) {
+                std::transform( subkey.begin(), subkey.end(), subkey.begin(), ::toupper );
+                view = ui->getSubView( subkey );
+            }
+            if( view ) {
+                string type = view->getType();
+                if( type == "Sliderf" && typeTag == "f" ) {
+                    Sliderf *widget = static_cast<Sliderf *>( view.get() );
+                    widget->setValue( lmap<float>( msg.getArgFloat( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
+                }
+                else if( type == "Slideri" && typeTag == "f" ) {
+                    Slideri *widget = static_cast<Slideri *>( view.get() );
+                    widget->setValue( lmap<float>( msg.getArgFloat( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
+                }
+                else if( type == "Sliderd" && typeTag == "f" ) {
+                    Sliderd *widget = static_cast<Sliderd *>( view.get() );
+                    widget->setValue( lmap<double>( msg.getArgDouble( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
+                }
+                else if( type == "MultiSlider" && numKeys == 2 && !values.empty() ) {
+                    MultiSlider *widget = static_cast<MultiSlider *>( view.get() );
+                    vector<string> suffixes = { "-X", "-Y", "-Z", "-W" };
+                    size_t total = std::min( std::min( values.size(), widget->getSubViews().size() ), suffixes.size() );
+                    for( size_t i = 0; i < total; i++ ) {
+                        string key = subkey + suffixes[i];
+                        widget->setValue( key, lmap<float>( values[i], 0.0, 1.0, widget->getMin( key ), widget->getMax( key ) ) );
+                    }
+                }
+                else if( type == "MultiSlider" && typeTag == "f" && numKeys > 2 ) {
+                    MultiSlider *widget = static_cast<MultiSlider *>( view.get() );
+                    int index = stoi( keys[2] );
+                    if( ( index - 1 ) < int( widget->getSubViews().size() ) ) {
+                        string key = subkey;
+                        switch( index ) {
+                        case 1:
+                            key += "-X";
+                            break;
+                        case 2:
+                            key += "-Y";
+                            break;
+                        case 3:
+                            key += "-Z";
+                            break;
+                        case 4:
+                            key += "-W";
+                            break;
+                        default:
+                            break;
                         }
-                        view->trigger();
+
+                        widget->setValue( key, lmap<float>( msg.getArgFloat( 0 ), 0.0, 1.0, widget->getMin( key ), widget->getMax( key ) ) );
+                    }
+                }
+                else if( type == "Dialeri" && typeTag == "f" ) {
+                    Dialeri *widget = static_cast<Dialeri *>( view.get() );
+                    widget->setValue( lmap<float>( msg.getArgFloat( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
+                }
+                else if( type == "Dialerf" && typeTag == "f" ) {
+                    Dialerf *widget = static_cast<Dialerf *>( view.get() );
+                    widget->setValue( lmap<float>( msg.getArgFloat( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
+                }
+                else if( type == "Dialerd" && typeTag == "f" ) {
+                    Dialerd *widget = static_cast<Dialerd *>( view.get() );
+                    widget->setValue( lmap<double>( msg.getArgDouble( 0 ), 0.0, 1.0, widget->getMin(), widget->getMax() ) );
+                }
+                else if( type == "Toggle" ) {
+                    Toggle *toggle = static_cast<Toggle *>( view.get() );
+                    if( typeTag == "f" ) {
+                        toggle->setValue( msg.getArgFloat( 0 ) );
+                    }
+                    else if( typeTag == "b" ) {
+                        toggle->setValue( msg.getArgBool( 0 ) );
                     }
                 }
+                else if( type == "Button" ) {
+                    Button *button = static_cast<Button *>( view.get() );
+                    if( typeTag == "f" ) {
+                        button->setValue( msg.getArgFloat( 0 ) );
+                    }
+                    else if( typeTag == "b" ) {
+                        button->setValue( msg.getArgBool( 0 ) );
+                    }
+                }
+                else if( type == "XYPad" ) {
+                    XYPad *widget = static_cast<XYPad *>( view.get() );
+                    if( typeTag == "ff" ) {
+                        vec2 min = widget->getMin();
+                        vec2 max = widget->getMax();
+                        float x = lmap<float>( msg.getArgFloat( 0 ), 0, 1, min.x, max.x );
+                        float y = lmap<float>( msg.getArgFloat( 1 ), 0, 1, min.y, max.y );
+                        widget->setValue( vec2( x, y ) );
+                    }
+                }
+                view->trigger();
             }
-        } );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - OSC RECORDING & REPLAY
+//------------------------------------------------------------------------------
+
+void Fragment::setupOscRecorder()
+{
+    mOscRecorderRef = OscRecorder::create();
+    mOscPlayerRef = OscPlayer::create();
+}
+
+void Fragment::startOscRecording()
+{
+    // Replay has to start from the same params the performance started from
+    auto ui = mUIRef->getUI( SHADER_UI );
+    if( ui != nullptr ) {
+        auto statePath = getAppSupportWorkingSessionSettingsPath( OSC_STATE_PATH );
+        createDirectory( statePath );
+        mUIRef->saveUI( ui, statePath );
+    }
+    mOscRecorderRef->start( getAppSupportWorkingSessionSettingsPath( OSC_LOG_PATH ) );
+}
+
+void Fragment::stopOscRecording()
+{
+    if( mOscRecorderRef->isRecording() ) {
+        mOscRecorderRef->stop();
+        CI_LOG_I( "OSC RECORDED: " << mOscRecorderRef->getNumRecorded() << " DROPPED: " << mOscRecorderRef->getNumDropped() );
+    }
+}
+
+void Fragment::updateOscReplay()
+{
+    bool exporting = isExporting();
+    if( exporting && mOscReplay && !mOscReplaying ) {
+        mOscReplaying = mOscPlayerRef->load( getAppSupportWorkingSessionSettingsPath( OSC_LOG_PATH ) ) && !mOscPlayerRef->isEmpty();
+        auto statePath = getAppSupportWorkingSessionSettingsPath( OSC_STATE_PATH );
+        auto ui = mUIRef->getUI( SHADER_UI );
+        if( mOscReplaying && ui != nullptr && fs::exists( statePath ) ) {
+            mUIRef->loadUI( ui, statePath );
+        }
+    }
+    else if( !exporting && mOscReplaying ) {
+        mOscReplaying = false;
+        mOscPlayerRef->clear();
+    }
+
+    if( mOscReplaying ) {
+        mOscPlayerRef->update( getAnimationSeconds(), [this]( const osc::Message &msg ) { routeOscMessage( msg ); } );
+    }
+}
+
+void Fragment::saveOscRecording( const fs::path &path )
+{
+    auto log = getAppSupportWorkingSessionSettingsPath( OSC_LOG_PATH );
+    if( fs::exists( log ) ) {
+        auto target = addPath( path, OSC_LOG_PATH );
+        if( fs::exists( target ) ) {
+            fs::remove( target );
+        }
+        fs::copy_file( log, target );
+    }
+    auto state = getAppSupportWorkingSessionSettingsPath( OSC_STATE_PATH );
+    if( fs::exists( state ) ) {
+        auto target = addPath( path, OSC_STATE_PATH );
+        createDirectory( target );
+        copyDirectory( state, target );
+    }
+}
+
+void Fragment::loadOscRecording( const fs::path &path )
+{
+    auto log = getAppSupportWorkingSessionSettingsPath( OSC_LOG_PATH );
+    if( fs::exists( log ) ) {
+        fs::remove( log );
+    }
+    auto source = addPath( path, OSC_LOG_PATH );
+    if( fs::exists( source ) ) {
+        fs::copy_file( source, log );
+    }
+    auto state = addPath( path, OSC_STATE_PATH );
+    if( fs::exists( state ) ) {
+        auto target = getAppSupportWorkingSessionSettingsPath( OSC_STATE_PATH );
+        createDirectory( target );
+        copyDirectory( state, target );
+    }
+}
+
+void Fragment::syncOscRecordingUI()
+{
+    auto appUI = mUIRef->getUI( APP_UI );
+    if( appUI != nullptr ) {
+        auto view = appUI->getSubView( "REC OSC" );
+        if( view ) {
+            static_cast<Toggle *>( view.get() )->setValue( mOscRecorderRef->isRecording() );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - REMOTE
+//------------------------------------------------------------------------------
 
+void Fragment::setupRemote()
+{
+    mRemoteServerRef.reset();
+    if( !mRemote ) {
+        return;
+    }
+    auto fmt = RemoteServer::Format().width( mRemoteWidth ).kbps( mRemoteKbps ).fps( getFrameRate() );
+    // Only this machine can connect unless remote.json opts in to another address, which
+    // takes a token too: { "ADDRESS": "0.0.0.0", "TOKEN": "..." }
+    auto pth = getAppSupportPath( REMOTE_PATH );
+    if( fs::exists( pth ) ) {
+        try {
+            JsonTree tree( loadFile( pth ) );
+            if( tree.hasChild( "ADDRESS" ) ) {
+                fmt.address( tree.getValueForKey<string>( "ADDRESS" ) );
+            }
+            if( tree.hasChild( "TOKEN" ) ) {
+                fmt.token( tree.getValueForKey<string>( "TOKEN" ) );
+            }
+        }
+        catch( const ci::Exception &exc ) {
+            CI_LOG_E( "Error loading remote settings: " << pth << " " << exc.what() );
+            return;
+        }
+    }
     try {
-        mReceiverRef->bind();
+        mRemoteServerRef = RemoteServer::create( uint16_t( mRemotePort ), fmt );
+        mRemoteStateTime = 0.0;
+        CI_LOG_I( "REMOTE ON " << fmt.mAddress << ":" << mRemotePort );
     }
-    catch( const osc::Exception &ex ) {
-        CI_LOG_E( "Error binding: " << ex.what() << " val: " << ex.value() );
+    catch( const std::exception &exc ) {
+        CI_LOG_E( "Error starting remote on " << fmt.mAddress << ":" << mRemotePort << ": " << exc.what() );
     }
-#if USE_UDP
-    mReceiverRef->listen(
-        []( asio::error_code error, protocol::endpoint endpoint ) -> bool {
-            if( error ) {
-                CI_LOG_E( "Error Listening: " << error.message() << " val: " << error.value() << " endpoint: " << endpoint );
-                return false;
+}
+
+void Fragment::updateRemote()
+{
+    if( !mRemoteServerRef ) {
+        return;
+    }
+    // Control messages take the same route as OSC, so they are recorded and replayed too
+    for( auto &it : mRemoteServerRef->getMessages() ) {
+        try {
+            JsonTree tree( it );
+            osc::Message msg( tree.getValueForKey( "ADDRESS" ) );
+            for( auto &value : tree.getChild( "VALUE" ).getChildren() ) {
+                msg.append( value.getValue<float>() );
             }
-            else
-                return true;
-        } );
-#endif
+            receiveOscMessage( msg );
+        }
+        catch( const JsonTree::Exception &exc ) {
+            CI_LOG_E( "Invalid remote message: " << exc.what() );
+        }
+    }
+    // The state is only gathered while a socket is connected to receive it
+    double now = getElapsedSeconds();
+    if( mRemoteServerRef->getNumSocketClients() > 0 && now - mRemoteStateTime > mRemoteStateInterval ) {
+        mRemoteServerRef->setState( getRemoteState() );
+        mRemoteStateTime = now;
+    }
+}
+
+string Fragment::getRemoteState()
+{
+    // Every widget routeOscMessage can set, at its OSC address with values normalized the
+    // way OSC sends them
+    auto unit = []( float value, float min, float max ) { return max > min ? ( value - min ) / ( max - min ) : 0.0f; };
+    JsonTree params = JsonTree::makeArray( "PARAMS" );
+    for( auto &panel : { string( SHADER_UI ), string( APP_UI ) } ) {
+        auto ui = mUIRef->getUI( panel );
+        if( ui == nullptr ) {
+            continue;
+        }
+        for( auto &view : ui->getSubViews() ) {
+            string name = view->getName();
+            string type = view->getType();
+            vector<float> value;
+            if( type == "Sliderf" ) {
+                Sliderf *widget = static_cast<Sliderf *>( view.get() );
+                value.push_back( unit( widget->getValue(), widget->getMin(), widget->getMax() ) );
+            }
+            else if( type == "Slideri" ) {
+                Slideri *widget = static_cast<Slideri *>( view.get() );
+                value.push_back( unit( widget->getValue(), widget->getMin(), widget->getMax() ) );
+            }
+            else if( type == "Dialerf" ) {
+                Dialerf *widget = static_cast<Dialerf *>( view.get() );
+                value.push_back( unit( widget->getValue(), widget->getMin(), widget->getMax() ) );
+            }
+            else if( type == "Dialeri" ) {
+                Dialeri *widget = static_cast<Dialeri *>( view.get() );
+                value.push_back( unit( widget->getValue(), widget->getMin(), widget->getMax() ) );
+            }
+            else if( type == "Toggle" ) {
+                value.push_back( static_cast<Toggle *>( view.get() )->getValue() ? 1.0f : 0.0f );
+            }
+            else if( type == "Button" ) {
+                value.push_back( static_cast<Button *>( view.get() )->getValue() ? 1.0f : 0.0f );
+            }
+            else if( type == "XYPad" ) {
+                XYPad *widget = static_cast<XYPad *>( view.get() );
+                vec2 xy = widget->getValue();
+                value.push_back( unit( xy.x, widget->getMin().x, widget->getMax().x ) );
+                value.push_back( unit( xy.y, widget->getMin().y, widget->getMax().y ) );
+            }
+            else if( type == "MultiSlider" ) {
+                MultiSlider *widget = static_cast<MultiSlider *>( view.get() );
+                vector<string> suffixes = { "-X", "-Y", "-Z", "-W" };
+                int total = std::min( int( widget->getSubViews().size() ), int( suffixes.size() ) );
+                for( int i = 0; i < total; i++ ) {
+                    string key = name + suffixes[i];
+                    value.push_back( unit( widget->getValue( key ), widget->getMin( key ), widget->getMax( key ) ) );
+                }
+            }
+            if( value.empty() ) {
+                continue;
+            }
+            JsonTree param;
+            param.addChild( JsonTree( "ADDRESS", "/" + panel + "/" + name ) );
+            param.addChild( JsonTree( "TYPE", type ) );
+            JsonTree values = JsonTree::makeArray( "VALUE" );
+            for( auto &it : value ) {
+                values.addChild( JsonTree( "", it ) );
+            }
+            param.addChild( values );
+            params.addChild( param );
+        }
+    }
+    JsonTree tree;
+    tree.addChild( params );
+    return tree.serialize();
 }
 
 void Fragment::openEditor()
@@ -0,0 +1,145 @@
+#include "FramePacer.h"
+
+#include "cinder/gl/gl.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace reza {
+namespace pace {
+
+// Left between the end of a just in time frame and the vertical blank, for the swap and
+// the scheduler waking late
+static const double kMargin = 1.5;
+// ADAPTIVE turns vsync off after this many late frames in a row and back on after this
+// many that took under kFastRatio of a refresh
+static const int kLateFrames = 2;
+static const int kFastFrames = 30;
+static const double kFastRatio = 0.8;
+// Nanoseconds a fence is waited on before the frame goes ahead anyway
+static const GLuint64 kFenceTimeout = 100000000;
+
+FramePacer::FramePacer( double refreshRate )
+    : mPeriod( 1000.0 / refreshRate ), mWindowStart( Clock::now() )
+{
+}
+
+double FramePacer::milliseconds( Clock::duration duration )
+{
+    return chrono::duration<double, milli>( duration ).count();
+}
+
+void FramePacer::waitForGpu()
+{
+    // Unlike glFinish this only waits on the commands in front of the fence
+    GLsync fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    glClientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeout );
+    glDeleteSync( fence );
+}
+
+void FramePacer::setMode( Mode mode )
+{
+    mMode = mode;
+    mVerticalSync = mode != UNCAPPED;
+    mLateFrames = mFastFrames = 0;
+}
+
+void FramePacer::markInput()
+{
+    if( !mInput ) {
+        mInputTime = Clock::now();
+        mInput = true;
+    }
+}
+
+void FramePacer::latchInputs()
+{
+    // Whatever arrived up to now is read by this frame
+    if( mInput ) {
+        mFrameInputTime = mInputTime;
+        mFrameInput = true;
+        mInput = false;
+    }
+}
+
+void FramePacer::beginFrame()
+{
+    // The previous frame's swap is the last command queued, so it's on screen once the
+    // fence behind it signals. Only just in time needs to know that, the other modes keep
+    // the CPU a frame ahead and let the swap hold the loop back.
+    if( mMode == JUST_IN_TIME ) {
+        waitForGpu();
+    }
+    auto now = Clock::now();
+
+    if( mPresented ) {
+        double interval = milliseconds( now - mPresentTime );
+        bool late = interval > mPeriod * 1.5;
+        mWindowInterval += interval;
+        mWindowFrames++;
+        mWindowMissed += late && mVerticalSync ? 1 : 0;
+        if( mMode == ADAPTIVE ) {
+            if( mVerticalSync ) {
+                mLateFrames = late ? mLateFrames + 1 : 0;
+                if( mLateFrames >= kLateFrames ) {
+                    mVerticalSync = false;
+                    mLateFrames = mFastFrames = 0;
+                }
+            }
+            else {
+                mFastFrames = interval < mPeriod * kFastRatio ? mFastFrames + 1 : 0;
+                if( mFastFrames >= kFastFrames ) {
+                    mVerticalSync = true;
+                    mLateFrames = mFastFrames = 0;
+                }
+            }
+        }
+    }
+    mPresentTime = now;
+    mPresented = true;
+
+    if( mFrameInput ) {
+        double latency = milliseconds( now - mFrameInputTime );
+        mWindowLatency += latency;
+        mWindowMaxLatency = std::max( mWindowMaxLatency, latency );
+        mWindowInputs++;
+        mFrameInput = false;
+    }
+
+    if( milliseconds( now - mWindowStart ) > 1000.0 ) {
+        mLatency = mWindowInputs > 0 ? mWindowLatency / mWindowInputs : 0.0;
+        mMaxLatency = mWindowMaxLatency;
+        mFrameInterval = mWindowFrames > 0 ? mWindowInterval / mWindowFrames : 0.0;
+        mMissedFrames = mWindowMissed;
+        mRenderTime = mWindowRenderTime;
+        mWindowLatency = mWindowMaxLatency = mWindowInterval = mWindowRenderTime = 0.0;
+        mWindowInputs = mWindowFrames = mWindowMissed = 0;
+        mWindowStart = now;
+    }
+
+    if( mMode == JUST_IN_TIME ) {
+        double delay = std::min( mDelay, mPeriod - mRenderTime - kMargin );
+        if( delay > 0.0 ) {
+            this_thread::sleep_until( now + chrono::duration_cast<Clock::duration>( chrono::duration<double, milli>( delay ) ) );
+        }
+    }
+    mFrameStart = Clock::now();
+}
+
+void FramePacer::endFrame()
+{
+    // Just in time needs the render time to know how late a frame can start, the GPU is
+    // waited on here rather than at the next present so the swap isn't counted in it
+    if( mMode != JUST_IN_TIME ) {
+        return;
+    }
+    waitForGpu();
+    double render = milliseconds( Clock::now() - mFrameStart );
+    mWindowRenderTime = std::max( mWindowRenderTime, render );
+    mRenderTime = std::max( mRenderTime, render );
+}
+
+} // namespace pace
+} // namespace reza
@@ -0,0 +1,198 @@
+#include "JobQueue.h"
+
+#include "cinder/Log.h"
+#include "cinder/Utilities.h"
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace job {
+
+fs::path JobQueue::resolve( const fs::path &root, const string &path )
+{
+    fs::path result( path );
+    return result.is_absolute() || root.empty() ? result : root / result;
+}
+
+bool JobQueue::parseJob( const JsonTree &tree, const fs::path &root, Job *job )
+{
+    try {
+        if( tree.hasChild( "NAME" ) ) {
+            job->mName = tree.getValueForKey( "NAME" );
+        }
+        if( tree.hasChild( "SESSION" ) ) {
+            job->mSession = resolve( root, tree.getValueForKey( "SESSION" ) );
+        }
+        if( tree.hasChild( "OUTPUT" ) ) {
+            job->mOutput = resolve( root, tree.getValueForKey( "OUTPUT" ) );
+        }
+        if( tree.hasChild( "SIZE" ) ) {
+            auto &size = tree.getChild( "SIZE" );
+            job->mSize = ivec2( size.getValueAtIndex<int>( 0 ), size.getValueAtIndex<int>( 1 ) );
+        }
+        if( tree.hasChild( "SCALE" ) ) {
+            job->mScale = tree.getValueForKey<int>( "SCALE" );
+        }
+        if( tree.hasChild( "FRAMES" ) ) {
+            auto &frames = tree.getChild( "FRAMES" );
+            job->mFirstFrame = frames.getValueAtIndex<int>( 0 );
+            job->mLastFrame = frames.getNumChildren() > 1 ? frames.getValueAtIndex<int>( 1 ) : job->mFirstFrame;
+        }
+        if( tree.hasChild( "TOTAL FRAMES" ) ) {
+            job->mTotalFrames = tree.getValueForKey<int>( "TOTAL FRAMES" );
+        }
+        if( tree.hasChild( "CAMERA" ) ) {
+            job->mCamera = resolve( root, tree.getValueForKey( "CAMERA" ) );
+        }
+        if( tree.hasChild( "PARAMS" ) ) {
+            for( auto &param : tree.getChild( "PARAMS" ).getChildren() ) {
+                vector<float> values;
+                if( param.getNodeType() == JsonTree::NODE_ARRAY ) {
+                    for( auto &it : param.getChildren() ) {
+                        values.push_back( it.getValue<float>() );
+                    }
+                }
+                else {
+                    values.push_back( param.getValue<float>() );
+                }
+                job->mParams[param.getKey()] = values;
+            }
+        }
+    }
+    catch( const JsonTree::Exception &exc ) {
+        CI_LOG_E( "Unable to read job: " << exc.what() );
+        return false;
+    }
+    if( job->mName.empty() ) {
+        job->mName = job->mOutput.stem().string();
+    }
+    return true;
+}
+
+bool JobQueue::loadFile( const fs::path &path )
+{
+    JsonTree tree;
+    try {
+        tree = JsonTree( ci::loadFile( path ) );
+    }
+    catch( const ci::Exception &exc ) {
+        CI_LOG_E( "Unable to load jobs " << path << ": " << exc.what() );
+        return false;
+    }
+    fs::path root = path.parent_path();
+    Job defaults;
+    if( tree.hasChild( "DEFAULTS" ) && !parseJob( tree.getChild( "DEFAULTS" ), root, &defaults ) ) {
+        return false;
+    }
+    if( !tree.hasChild( "JOBS" ) ) {
+        CI_LOG_E( "No JOBS in " << path );
+        return false;
+    }
+    bool valid = true;
+    for( auto &it : tree.getChild( "JOBS" ).getChildren() ) {
+        Job job = defaults;
+        if( parseJob( it, root, &job ) ) {
+            mJobs.push_back( job );
+        }
+        else {
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+bool JobQueue::parseArgs( const vector<string> &args )
+{
+    // The first argument is the executable, macOS adds -psn_ and -NS ones of its own
+    Job job;
+    bool described = false;
+    bool valid = true;
+    for( size_t i = 1; i < args.size(); i++ ) {
+        const string &arg = args[i];
+        bool hasValue = i + 1 < args.size();
+        const string value = hasValue ? args[i + 1] : "";
+        try {
+            if( arg == "--quit" ) {
+                mQuit = true;
+                continue;
+            }
+            else if( arg.compare( 0, 2, "--" ) != 0 ) {
+                if( arg.compare( 0, 5, "-psn_" ) != 0 && arg.compare( 0, 3, "-NS" ) != 0 ) {
+                    CI_LOG_W( "Ignoring argument " << arg );
+                }
+                continue;
+            }
+            else if( !hasValue ) {
+                CI_LOG_E( "Missing value for " << arg );
+                valid = false;
+                continue;
+            }
+            i++;
+            if( arg == "--jobs" ) {
+                valid = loadFile( resolve( fs::current_path(), value ) ) && valid;
+                continue;
+            }
+            described = true;
+            if( arg == "--session" ) {
+                job.mSession = resolve( fs::current_path(), value );
+            }
+            else if( arg == "--output" ) {
+                job.mOutput = resolve( fs::current_path(), value );
+            }
+            else if( arg == "--size" ) {
+                auto size = split( value, "x" );
+                job.mSize = ivec2( stoi( size.at( 0 ) ), stoi( size.at( 1 ) ) );
+            }
+            else if( arg == "--scale" ) {
+                job.mScale = stoi( value );
+            }
+            else if( arg == "--frames" ) {
+                auto frames = split( value, ":" );
+                job.mFirstFrame = stoi( frames.at( 0 ) );
+                job.mLastFrame = frames.size() > 1 ? stoi( frames[1] ) : job.mFirstFrame;
+            }
+            else if( arg == "--total" ) {
+                job.mTotalFrames = stoi( value );
+            }
+            else if( arg == "--camera" ) {
+                job.mCamera = resolve( fs::current_path(), value );
+            }
+            else if( arg == "--param" ) {
+                size_t equals = value.find( '=' );
+                vector<float> values;
+                for( auto &it : split( value.substr( equals + 1 ), "," ) ) {
+                    values.push_back( stof( it ) );
+                }
+                job.mParams[value.substr( 0, equals )] = values;
+            }
+            else {
+                CI_LOG_E( "Unknown argument " << arg );
+                valid = false;
+            }
+        }
+        catch( const std::exception &exc ) {
+            CI_LOG_E( "Unable to read " << arg << " " << value << ": " << exc.what() );
+            valid = false;
+        }
+    }
+    if( described ) {
+        if( job.mOutput.empty() ) {
+            CI_LOG_E( "No --output for the job on the command line" );
+            return false;
+        }
+        job.mName = job.mOutput.stem().string();
+        mJobs.push_back( job );
+    }
+    return valid;
+}
+
+JobQueue::Job JobQueue::pop()
+{
+    Job job = mJobs.front();
+    mJobs.pop_front();
+    return job;
+}
+
+} // namespace job
+} // namespace reza
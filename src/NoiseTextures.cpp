@@ -0,0 +1,255 @@
+#include "NoiseTextures.h"
+
+#include "cinder/Log.h"
+#include "cinder/gl/gl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace noise {
+
+// Lattice coordinates are wrapped before hashing, which is all it takes to make the
+// noise tile
+static uint32_t hash( int x, int y, int z, int period, uint32_t seed )
+{
+    x = ( x % period + period ) % period;
+    y = ( y % period + period ) % period;
+    z = ( z % period + period ) % period;
+    uint32_t h = uint32_t( x ) * 73856093u ^ uint32_t( y ) * 19349663u ^ uint32_t( z ) * 83492791u ^ seed;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static float random( int x, int y, int z, int period, uint32_t seed )
+{
+    return float( hash( x, y, z, period, seed ) & 0xffffff ) / float( 0x1000000 );
+}
+
+static float fade( float t )
+{
+    return t * t * t * ( t * ( t * 6.0f - 15.0f ) + 10.0f );
+}
+
+static float dfade( float t )
+{
+    return 30.0f * t * t * ( t * ( t - 2.0f ) + 1.0f );
+}
+
+static vec2 gradient2( int x, int y, int period )
+{
+    float angle = random( x, y, 0, period, 0x2d ) * 6.28318530718f;
+    return vec2( cos( angle ), sin( angle ) );
+}
+
+static vec3 gradient3( int x, int y, int z, int period )
+{
+    static const vec3 edges[12] = {
+        vec3( 1, 1, 0 ), vec3( -1, 1, 0 ), vec3( 1, -1, 0 ), vec3( -1, -1, 0 ),
+        vec3( 1, 0, 1 ), vec3( -1, 0, 1 ), vec3( 1, 0, -1 ), vec3( -1, 0, -1 ),
+        vec3( 0, 1, 1 ), vec3( 0, -1, 1 ), vec3( 0, 1, -1 ), vec3( 0, -1, -1 )
+    };
+    return edges[hash( x, y, z, period, 0x3d ) % 12];
+}
+
+// Gradient noise and its analytic derivatives, scaled to roughly the range of snoise
+static vec3 perlin2( const vec2 &p, int period )
+{
+    ivec2 i( floor( p ) );
+    vec2 f = p - vec2( i );
+    vec2 g00 = gradient2( i.x, i.y, period ), g10 = gradient2( i.x + 1, i.y, period );
+    vec2 g01 = gradient2( i.x, i.y + 1, period ), g11 = gradient2( i.x + 1, i.y + 1, period );
+    float n00 = dot( g00, f ), n10 = dot( g10, f - vec2( 1, 0 ) );
+    float n01 = dot( g01, f - vec2( 0, 1 ) ), n11 = dot( g11, f - vec2( 1, 1 ) );
+    vec2 u( fade( f.x ), fade( f.y ) );
+    vec2 du( dfade( f.x ), dfade( f.y ) );
+    float k1 = n10 - n00, k2 = n01 - n00, k3 = n00 - n10 - n01 + n11;
+    float value = n00 + u.x * k1 + u.y * k2 + u.x * u.y * k3;
+    vec2 grad = g00 + u.x * ( g10 - g00 ) + u.y * ( g01 - g00 ) + u.x * u.y * ( g00 - g10 - g01 + g11 );
+    grad += vec2( du.x * ( k1 + u.y * k3 ), du.y * ( k2 + u.x * k3 ) );
+    return vec3( value, grad ) * 1.41421356f;
+}
+
+static float perlin3( const vec3 &p, int period )
+{
+    ivec3 i( floor( p ) );
+    vec3 f = p - vec3( i );
+    vec3 u( fade( f.x ), fade( f.y ), fade( f.z ) );
+    float n[8];
+    for( int c = 0; c < 8; c++ ) {
+        ivec3 o( c & 1, ( c >> 1 ) & 1, ( c >> 2 ) & 1 );
+        n[c] = dot( gradient3( i.x + o.x, i.y + o.y, i.z + o.z, period ), f - vec3( o ) );
+    }
+    float x00 = mix( n[0], n[1], u.x ), x10 = mix( n[2], n[3], u.x );
+    float x01 = mix( n[4], n[5], u.x ), x11 = mix( n[6], n[7], u.x );
+    return mix( mix( x00, x10, u.y ), mix( x01, x11, u.y ), u.z );
+}
+
+// Distances to the nearest and second nearest feature point, one point per cell
+static vec2 cellular2( const vec2 &p, int period )
+{
+    ivec2 i( floor( p ) );
+    float f1 = 1e9f, f2 = 1e9f;
+    for( int y = -1; y <= 1; y++ ) {
+        for( int x = -1; x <= 1; x++ ) {
+            ivec2 c = i + ivec2( x, y );
+            vec2 point = vec2( c ) + vec2( random( c.x, c.y, 0, period, 0x5a ), random( c.x, c.y, 0, period, 0xa5 ) );
+            float d = distance( p, point );
+            if( d < f1 ) {
+                f2 = f1;
+                f1 = d;
+            }
+            else if( d < f2 ) {
+                f2 = d;
+            }
+        }
+    }
+    return vec2( f1, f2 );
+}
+
+static vec2 cellular3( const vec3 &p, int period )
+{
+    ivec3 i( floor( p ) );
+    float f1 = 1e9f, f2 = 1e9f;
+    for( int z = -1; z <= 1; z++ ) {
+        for( int y = -1; y <= 1; y++ ) {
+            for( int x = -1; x <= 1; x++ ) {
+                ivec3 c = i + ivec3( x, y, z );
+                vec3 point = vec3( c ) + vec3( random( c.x, c.y, c.z, period, 0x5a ), random( c.x, c.y, c.z, period, 0xa5 ), random( c.x, c.y, c.z, period, 0x6b ) );
+                float d = distance( p, point );
+                if( d < f1 ) {
+                    f2 = f1;
+                    f1 = d;
+                }
+                else if( d < f2 ) {
+                    f2 = d;
+                }
+            }
+        }
+    }
+    return vec2( f1, f2 );
+}
+
+// Splits rows over all cores
+static void parallelFor( int count, const function<void( int )> &fn )
+{
+    int numThreads = std::max( 1, std::min( int( thread::hardware_concurrency() ), count ) );
+    vector<thread> threads;
+    for( int t = 0; t < numThreads; t++ ) {
+        threads.emplace_back( [t, numThreads, count, &fn] {
+            for( int i = t; i < count; i += numThreads ) {
+                fn( i );
+            }
+        } );
+    }
+    for( auto &it : threads ) {
+        it.join();
+    }
+}
+
+void NoiseTextures::generate()
+{
+    // Texel centers sit half a sample into the tile, matching GL_REPEAT lookups of p / period
+    int n2 = kNoise2DPeriod * kNoise2DSamples;
+    mNoise2D.resize( size_t( n2 ) * n2 * 3 );
+    parallelFor( n2, [this, n2]( int y ) {
+        for( int x = 0; x < n2; x++ ) {
+            vec3 v = perlin2( ( vec2( x, y ) + 0.5f ) / float( kNoise2DSamples ), kNoise2DPeriod );
+            float *dst = &mNoise2D[( size_t( y ) * n2 + x ) * 3];
+            dst[0] = v.x;
+            dst[1] = v.y;
+            dst[2] = v.z;
+        }
+    } );
+
+    int n3 = kNoise3DPeriod * kNoise3DSamples;
+    mNoise3D.resize( size_t( n3 ) * n3 * n3 );
+    parallelFor( n3, [this, n3]( int z ) {
+        for( int y = 0; y < n3; y++ ) {
+            for( int x = 0; x < n3; x++ ) {
+                mNoise3D[( size_t( z ) * n3 + y ) * n3 + x] = perlin3( ( vec3( x, y, z ) + 0.5f ) / float( kNoise3DSamples ), kNoise3DPeriod );
+            }
+        }
+    } );
+
+    int c2 = kCellular2DPeriod * kCellular2DSamples;
+    mCellular2D.resize( size_t( c2 ) * c2 * 2 );
+    parallelFor( c2, [this, c2]( int y ) {
+        for( int x = 0; x < c2; x++ ) {
+            vec2 v = cellular2( ( vec2( x, y ) + 0.5f ) / float( kCellular2DSamples ), kCellular2DPeriod );
+            mCellular2D[( size_t( y ) * c2 + x ) * 2] = v.x;
+            mCellular2D[( size_t( y ) * c2 + x ) * 2 + 1] = v.y;
+        }
+    } );
+
+    int c3 = kCellular3DPeriod * kCellular3DSamples;
+    mCellular3D.resize( size_t( c3 ) * c3 * c3 * 2 );
+    parallelFor( c3, [this, c3]( int z ) {
+        for( int y = 0; y < c3; y++ ) {
+            for( int x = 0; x < c3; x++ ) {
+                vec2 v = cellular3( ( vec3( x, y, z ) + 0.5f ) / float( kCellular3DSamples ), kCellular3DPeriod );
+                size_t index = ( ( size_t( z ) * c3 + y ) * c3 + x ) * 2;
+                mCellular3D[index] = v.x;
+                mCellular3D[index + 1] = v.y;
+            }
+        }
+    } );
+}
+
+void NoiseTextures::upload()
+{
+    int n2 = kNoise2DPeriod * kNoise2DSamples;
+    int n3 = kNoise3DPeriod * kNoise3DSamples;
+    int c2 = kCellular2DPeriod * kCellular2DSamples;
+    int c3 = kCellular3DPeriod * kCellular3DSamples;
+    if( mNoise2D.empty() ) {
+        CI_LOG_E( "Noise textures uploaded before they were generated" );
+        return;
+    }
+
+    auto fmt2 = []( GLint internalFormat ) {
+        return gl::Texture2d::Format().internalFormat( internalFormat ).dataType( GL_FLOAT ).minFilter( GL_LINEAR ).magFilter( GL_LINEAR ).wrap( GL_REPEAT );
+    };
+    auto fmt3 = []( GLint internalFormat ) {
+        return gl::Texture3d::Format().internalFormat( internalFormat ).minFilter( GL_LINEAR ).magFilter( GL_LINEAR ).wrap( GL_REPEAT );
+    };
+    mNoise2DRef = gl::Texture2d::create( mNoise2D.data(), GL_RGB, n2, n2, fmt2( GL_RGB16F ) );
+    mCellular2DRef = gl::Texture2d::create( mCellular2D.data(), GL_RG, c2, c2, fmt2( GL_RG16F ) );
+    mNoise3DRef = gl::Texture3d::create( n3, n3, n3, fmt3( GL_R16F ) );
+    mNoise3DRef->update( mNoise3D.data(), GL_RED, GL_FLOAT, 0, n3, n3, n3 );
+    mCellular3DRef = gl::Texture3d::create( c3, c3, c3, fmt3( GL_RG16F ) );
+    mCellular3DRef->update( mCellular3D.data(), GL_RG, GL_FLOAT, 0, c3, c3, c3 );
+
+    mByteSize = ( mNoise2D.size() + mNoise3D.size() + mCellular2D.size() + mCellular3D.size() ) * 2;
+    mNoise2D = vector<float>();
+    mNoise3D = vector<float>();
+    mCellular2D = vector<float>();
+    mCellular3D = vector<float>();
+}
+
+void NoiseTextures::bind( const gl::GlslProgRef &glsl, uint8_t unit )
+{
+    if( !isUploaded() ) {
+        return;
+    }
+    mNoise2DRef->bind( unit );
+    mNoise3DRef->bind( uint8_t( unit + 1 ) );
+    mCellular2DRef->bind( uint8_t( unit + 2 ) );
+    mCellular3DRef->bind( uint8_t( unit + 3 ) );
+    glsl->uniform( "iNoise2D", int( unit ) );
+    glsl->uniform( "iNoise3D", int( unit + 1 ) );
+    glsl->uniform( "iCellular2D", int( unit + 2 ) );
+    glsl->uniform( "iCellular3D", int( unit + 3 ) );
+}
+
+} // namespace noise
+} // namespace reza
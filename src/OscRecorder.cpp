@@ -0,0 +1,357 @@
+#include "OscRecorder.h"
+
+#include "cinder/Log.h"
+
+#include <cstring>
+#include <fstream>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace rec {
+
+static const char kMagic[4] = { 'F', 'O', 'S', 'C' };
+static const uint32_t kVersion = 1;
+
+namespace {
+
+class Writer {
+  public:
+    Writer( uint8_t *data, size_t capacity )
+        : mData( data ), mCapacity( capacity ) {}
+
+    bool bytes( const void *src, size_t size )
+    {
+        if( mSize + size > mCapacity ) {
+            mValid = false;
+            return false;
+        }
+        memcpy( mData + mSize, src, size );
+        mSize += size;
+        return true;
+    }
+
+    template <typename T>
+    bool value( T v ) { return bytes( &v, sizeof( T ) ); }
+
+    bool string16( const std::string &str )
+    {
+        return value<uint16_t>( uint16_t( str.size() ) ) && bytes( str.data(), str.size() );
+    }
+
+    uint8_t *mData;
+    size_t mCapacity;
+    size_t mSize = 0;
+    bool mValid = true;
+};
+
+class Reader {
+  public:
+    Reader( const uint8_t *data, size_t size )
+        : mData( data ), mSize( size ) {}
+
+    bool bytes( void *dst, size_t size )
+    {
+        if( mOffset + size > mSize ) {
+            return false;
+        }
+        memcpy( dst, mData + mOffset, size );
+        mOffset += size;
+        return true;
+    }
+
+    template <typename T>
+    bool value( T &v ) { return bytes( &v, sizeof( T ) ); }
+
+    bool string16( std::string &str )
+    {
+        uint16_t length;
+        if( !value( length ) || mOffset + length > mSize ) {
+            return false;
+        }
+        str.assign( reinterpret_cast<const char *>( mData + mOffset ), length );
+        mOffset += length;
+        return true;
+    }
+
+    const uint8_t *mData;
+    size_t mSize;
+    size_t mOffset = 0;
+};
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+// OscRecorder
+//------------------------------------------------------------------------------
+
+OscRecorder::OscRecorder( size_t capacity )
+    : mRing( capacity ), mScratch( 64 * 1024 ), mHead( 0 ), mTail( 0 ), mRecording( false ), mScratchBusy( false ), mNumRecorded( 0 ), mNumDropped( 0 )
+{
+}
+
+OscRecorder::~OscRecorder()
+{
+    stop();
+}
+
+bool OscRecorder::start( const fs::path &path )
+{
+    stop();
+    mFile = fopen( path.string().c_str(), "wb" );
+    if( mFile == nullptr ) {
+        CI_LOG_E( "Unable to open OSC log: " << path );
+        return false;
+    }
+    fwrite( kMagic, 1, sizeof( kMagic ), mFile );
+    fwrite( &kVersion, sizeof( kVersion ), 1, mFile );
+
+    mHead = 0;
+    mTail = 0;
+    mNumRecorded = 0;
+    mNumDropped = 0;
+    mStartTime = chrono::steady_clock::now();
+    mRecording = true;
+    mWriterThread = thread( &OscRecorder::write, this );
+    return true;
+}
+
+void OscRecorder::stop()
+{
+    if( !mRecording ) {
+        return;
+    }
+    mRecording = false;
+    if( mWriterThread.joinable() ) {
+        mWriterThread.join();
+    }
+    drain();
+    fclose( mFile );
+    mFile = nullptr;
+}
+
+void OscRecorder::record( const osc::Message &msg )
+{
+    if( !mRecording ) {
+        return;
+    }
+
+    // A second caller would scribble over the scratch buffer, its message is dropped
+    if( mScratchBusy.exchange( true, memory_order_acquire ) ) {
+        mNumDropped++;
+        return;
+    }
+
+    double seconds = chrono::duration<double>( chrono::steady_clock::now() - mStartTime ).count();
+    // The tags are read one at a time, getTypeTagString() would build a string
+    size_t numArgs = msg.getNumArgs();
+
+    Writer w( mScratch.data(), mScratch.size() );
+    w.value<uint32_t>( 0 );
+    w.value<double>( seconds );
+    w.string16( msg.getAddress() );
+    w.value<uint16_t>( uint16_t( numArgs ) );
+    for( size_t i = 0; i < numArgs && w.mValid; i++ ) {
+        w.value<char>( char( msg.getArgType( uint32_t( i ) ) ) );
+    }
+    for( size_t i = 0; i < numArgs && w.mValid; i++ ) {
+        uint32_t index = uint32_t( i );
+        switch( char( msg.getArgType( index ) ) ) {
+        case 'i':
+            w.value<int32_t>( msg.getArgInt32( index ) );
+            break;
+        case 'f':
+            w.value<float>( msg.getArgFloat( index ) );
+            break;
+        case 'd':
+            w.value<double>( msg.getArgDouble( index ) );
+            break;
+        case 'h':
+            w.value<int64_t>( msg.getArgInt64( index ) );
+            break;
+        case 's': {
+            const string &str = msg.getArgString( index );
+            w.value<uint32_t>( uint32_t( str.size() ) );
+            w.bytes( str.data(), str.size() );
+        } break;
+        case 'b': {
+            const auto &blob = msg.getArgBlob( index );
+            w.value<uint32_t>( uint32_t( blob.getSize() ) );
+            w.bytes( blob.getData(), blob.getSize() );
+        } break;
+        case 'T':
+        case 'F':
+            break;
+        default:
+            w.mValid = false;
+            break;
+        }
+    }
+
+    size_t capacity = mRing.size();
+    size_t head = mHead.load( memory_order_relaxed );
+    size_t tail = mTail.load( memory_order_acquire );
+    if( !w.mValid || capacity - ( head - tail ) < w.mSize ) {
+        mNumDropped++;
+        mScratchBusy.store( false, memory_order_release );
+        return;
+    }
+
+    uint32_t size = uint32_t( w.mSize - sizeof( uint32_t ) );
+    memcpy( mScratch.data(), &size, sizeof( size ) );
+
+    size_t offset = head % capacity;
+    size_t first = std::min( w.mSize, capacity - offset );
+    memcpy( mRing.data() + offset, mScratch.data(), first );
+    memcpy( mRing.data(), mScratch.data() + first, w.mSize - first );
+    mHead.store( head + w.mSize, memory_order_release );
+    mNumRecorded++;
+    mScratchBusy.store( false, memory_order_release );
+}
+
+void OscRecorder::write()
+{
+    while( mRecording ) {
+        drain();
+        this_thread::sleep_for( chrono::milliseconds( 10 ) );
+    }
+}
+
+void OscRecorder::drain()
+{
+    size_t capacity = mRing.size();
+    size_t tail = mTail.load( memory_order_relaxed );
+    size_t head = mHead.load( memory_order_acquire );
+    if( head == tail ) {
+        return;
+    }
+    size_t offset = tail % capacity;
+    size_t total = head - tail;
+    size_t first = std::min( total, capacity - offset );
+    fwrite( mRing.data() + offset, 1, first, mFile );
+    fwrite( mRing.data(), 1, total - first, mFile );
+    fflush( mFile );
+    mTail.store( head, memory_order_release );
+}
+
+//------------------------------------------------------------------------------
+// OscPlayer
+//------------------------------------------------------------------------------
+
+bool OscPlayer::load( const fs::path &path )
+{
+    clear();
+    ifstream file( path.string(), ios::binary );
+    if( !file ) {
+        return false;
+    }
+    mData.assign( istreambuf_iterator<char>( file ), istreambuf_iterator<char>() );
+
+    Reader r( mData.data(), mData.size() );
+    char magic[4];
+    uint32_t version;
+    if( !r.bytes( magic, sizeof( magic ) ) || memcmp( magic, kMagic, sizeof( magic ) ) != 0 || !r.value( version ) || version != kVersion ) {
+        CI_LOG_E( "Invalid OSC log: " << path );
+        clear();
+        return false;
+    }
+
+    uint32_t size;
+    while( r.value( size ) ) {
+        Entry entry;
+        entry.mOffset = r.mOffset;
+        entry.mSize = size;
+        if( !r.value( entry.mTime ) || entry.mOffset + size > mData.size() ) {
+            // a truncated tail is expected if the app went down mid-write
+            break;
+        }
+        mEntries.push_back( entry );
+        r.mOffset = entry.mOffset + size;
+    }
+    return true;
+}
+
+void OscPlayer::clear()
+{
+    mData.clear();
+    mEntries.clear();
+    mPosition = 0;
+}
+
+void OscPlayer::reset()
+{
+    mPosition = 0;
+}
+
+void OscPlayer::update( double time, const function<void( const osc::Message & )> &fn )
+{
+    while( mPosition < mEntries.size() && mEntries[mPosition].mTime <= time ) {
+        osc::Message msg;
+        if( decode( mPosition, msg ) ) {
+            fn( msg );
+        }
+        mPosition++;
+    }
+}
+
+bool OscPlayer::decode( size_t index, osc::Message &msg ) const
+{
+    const Entry &entry = mEntries[index];
+    Reader r( mData.data() + entry.mOffset, entry.mSize );
+    double time;
+    string address, typeTag;
+    if( !r.value( time ) || !r.string16( address ) || !r.string16( typeTag ) ) {
+        return false;
+    }
+
+    msg.setAddress( address );
+    for( auto tag : typeTag ) {
+        switch( tag ) {
+        case 'i': {
+            int32_t v;
+            if( !r.value( v ) ) return false;
+            msg.append( v );
+        } break;
+        case 'f': {
+            float v;
+            if( !r.value( v ) ) return false;
+            msg.append( v );
+        } break;
+        case 'd': {
+            double v;
+            if( !r.value( v ) ) return false;
+            msg.append( v );
+        } break;
+        case 'h': {
+            int64_t v;
+            if( !r.value( v ) ) return false;
+            msg.append( v );
+        } break;
+        case 's': {
+            uint32_t length;
+            if( !r.value( length ) || r.mOffset + length > r.mSize ) return false;
+            msg.append( string( reinterpret_cast<const char *>( r.mData + r.mOffset ), length ) );
+            r.mOffset += length;
+        } break;
+        case 'b': {
+            uint32_t length;
+            if( !r.value( length ) || r.mOffset + length > r.mSize ) return false;
+            msg.appendBlob( const_cast<uint8_t *>( r.mData + r.mOffset ), length );
+            r.mOffset += length;
+        } break;
+        case 'T':
+            msg.append( true );
+            break;
+        case 'F':
+            msg.append( false );
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace rec
+} // namespace reza
@@ -0,0 +1,194 @@
+#include "Projector.h"
+
+#include "cinder/Display.h"
+#include "cinder/Json.h"
+#include "cinder/Log.h"
+#include "cinder/app/App.h"
+#include "cinder/gl/gl.h"
+
+using namespace ci;
+using namespace ci::app;
+using namespace std;
+
+namespace reza {
+namespace proj {
+
+static const char *sVertex = R"(#version 150
+uniform mat4 ciModelViewProjection;
+in vec4 ciPosition;
+void main()
+{
+    gl_Position = ciModelViewProjection * ciPosition;
+}
+)";
+
+static const char *sFragment = R"(#version 150
+uniform sampler2D uCanvas;
+uniform vec2 uViewport;
+uniform mat3 uInverseWarp;
+uniform vec4 uRect;
+uniform vec4 uBlend;
+uniform float uBlendPower;
+uniform float uGamma;
+out vec4 oColor;
+
+float ramp( float x, float width )
+{
+    if( width <= 0.0 ) {
+        return 1.0;
+    }
+    float t = clamp( x / width, 0.0, 1.0 );
+    float curve = t < 0.5 ? 0.5 * pow( 2.0 * t, uBlendPower ) : 1.0 - 0.5 * pow( 2.0 * ( 1.0 - t ), uBlendPower );
+    return pow( curve, 1.0 / uGamma );
+}
+
+void main()
+{
+    vec2 window = vec2( gl_FragCoord.x / uViewport.x, 1.0 - gl_FragCoord.y / uViewport.y );
+    vec3 warped = uInverseWarp * vec3( window, 1.0 );
+    vec2 local = warped.xy / warped.z;
+    if( any( lessThan( local, vec2( 0.0 ) ) ) || any( greaterThan( local, vec2( 1.0 ) ) ) ) {
+        oColor = vec4( 0.0, 0.0, 0.0, 1.0 );
+        return;
+    }
+    vec2 uv = mix( uRect.xy, uRect.zw, local );
+    vec3 color = texture( uCanvas, vec2( uv.x, 1.0 - uv.y ) ).rgb;
+    float mask = ramp( local.x, uBlend.x ) * ramp( 1.0 - local.x, uBlend.y ) * ramp( local.y, uBlend.z ) * ramp( 1.0 - local.y, uBlend.w );
+    oColor = vec4( color * mask, 1.0 );
+}
+)";
+
+// Maps the unit square (ul, ur, lr, ll) onto an arbitrary quad, see Heckbert's
+// "Fundamentals of Texture Mapping and Image Warping"
+static mat3 getSquareToQuad( const vec2 corners[4] )
+{
+    vec2 p0 = corners[0], p1 = corners[1], p2 = corners[2], p3 = corners[3];
+    vec2 d1 = p1 - p2;
+    vec2 d2 = p3 - p2;
+    vec2 d3 = p0 - p1 + p2 - p3;
+    float det = d1.x * d2.y - d2.x * d1.y;
+    float g = 0.0f, h = 0.0f;
+    if( det != 0.0f ) {
+        g = ( d3.x * d2.y - d2.x * d3.y ) / det;
+        h = ( d1.x * d3.y - d3.x * d1.y ) / det;
+    }
+    vec3 u( p1.x - p0.x + g * p1.x, p1.y - p0.y + g * p1.y, g );
+    vec3 v( p3.x - p0.x + h * p3.x, p3.y - p0.y + h * p3.y, h );
+    return mat3( u, v, vec3( p0, 1.0f ) );
+}
+
+vector<Projector::Format> Projector::load( const fs::path &path, ivec2 &canvasSize )
+{
+    vector<Format> formats;
+    if( !fs::exists( path ) ) {
+        return formats;
+    }
+    try {
+        JsonTree tree( loadFile( path ) );
+        if( tree.hasChild( "CANVAS" ) ) {
+            auto canvas = tree.getChild( "CANVAS" );
+            canvasSize = ivec2( canvas.getValueAtIndex<int>( 0 ), canvas.getValueAtIndex<int>( 1 ) );
+        }
+        if( !tree.hasChild( "OUTPUTS" ) ) {
+            return formats;
+        }
+        for( auto &output : tree.getChild( "OUTPUTS" ).getChildren() ) {
+            Format fmt;
+            auto vec = [&output]( const string &key, int index ) { return output.getChild( key ).getValueAtIndex<float>( index ); };
+            if( output.hasChild( "NAME" ) ) {
+                fmt.mName = output.getValueForKey<string>( "NAME" );
+            }
+            if( output.hasChild( "DISPLAY" ) ) {
+                fmt.mDisplay = output.getValueForKey<int>( "DISPLAY" );
+            }
+            if( output.hasChild( "FULLSCREEN" ) ) {
+                fmt.mFullScreen = output.getValueForKey<bool>( "FULLSCREEN" );
+            }
+            if( output.hasChild( "POS" ) ) {
+                fmt.mPos = ivec2( vec( "POS", 0 ), vec( "POS", 1 ) );
+            }
+            if( output.hasChild( "SIZE" ) ) {
+                fmt.mSize = ivec2( vec( "SIZE", 0 ), vec( "SIZE", 1 ) );
+            }
+            if( output.hasChild( "RECT" ) ) {
+                fmt.mRect = Rectf( vec( "RECT", 0 ), vec( "RECT", 1 ), vec( "RECT", 2 ), vec( "RECT", 3 ) );
+            }
+            if( output.hasChild( "KEYSTONE" ) ) {
+                for( int i = 0; i < 4; i++ ) {
+                    fmt.mCorners[i] = vec2( vec( "KEYSTONE", i * 2 ), vec( "KEYSTONE", i * 2 + 1 ) );
+                }
+            }
+            if( output.hasChild( "BLEND" ) ) {
+                fmt.mBlend = vec4( vec( "BLEND", 0 ), vec( "BLEND", 1 ), vec( "BLEND", 2 ), vec( "BLEND", 3 ) );
+            }
+            if( output.hasChild( "BLEND POWER" ) ) {
+                fmt.mBlendPower = output.getValueForKey<float>( "BLEND POWER" );
+            }
+            if( output.hasChild( "GAMMA" ) ) {
+                fmt.mGamma = output.getValueForKey<float>( "GAMMA" );
+            }
+            formats.push_back( fmt );
+        }
+    }
+    catch( const ci::Exception &exc ) {
+        CI_LOG_E( "Error loading outputs: " << path << " " << exc.what() );
+    }
+    return formats;
+}
+
+Projector::Projector( const Format &format, const std::function<gl::Texture2dRef()> &canvasFn )
+    : mFormat( format ), mCanvasFn( canvasFn )
+{
+    mInverseWarp = glm::inverse( getSquareToQuad( mFormat.mCorners ) );
+
+    auto displays = Display::getDisplays();
+    auto display = displays[std::min( std::max( mFormat.mDisplay, 0 ), int( displays.size() ) - 1 )];
+    auto wfmt = Window::Format().size( mFormat.mSize ).display( display ).title( mFormat.mName );
+    if( mFormat.mFullScreen ) {
+        wfmt.fullScreen();
+    }
+    else {
+        wfmt.pos( display->getBounds().getUL() + mFormat.mPos );
+    }
+    mWindowRef = App::get()->createWindow( wfmt );
+    mWindowRef->getSignalDraw().connect( [this] { draw(); } );
+    mWindowRef->getSignalClose().connect( [this] { mWindowRef.reset(); } );
+
+    try {
+        mGlslProgRef = gl::GlslProg::create( gl::GlslProg::Format().vertex( sVertex ).fragment( sFragment ) );
+    }
+    catch( const ci::Exception &exc ) {
+        CI_LOG_E( "Projector shader error: " << exc.what() );
+    }
+}
+
+Projector::~Projector()
+{
+    if( mWindowRef ) {
+        mWindowRef->close();
+    }
+}
+
+void Projector::draw()
+{
+    gl::clear( Color::black() );
+    auto canvas = mCanvasFn();
+    if( !canvas || !mGlslProgRef ) {
+        return;
+    }
+    vec2 size = mWindowRef->getSize();
+    gl::setMatricesWindow( size );
+    gl::ScopedGlslProg scpGlsl( mGlslProgRef );
+    gl::ScopedTextureBind scpTex( canvas, 0 );
+    mGlslProgRef->uniform( "uCanvas", 0 );
+    mGlslProgRef->uniform( "uViewport", vec2( mWindowRef->toPixels( mWindowRef->getSize() ) ) );
+    mGlslProgRef->uniform( "uInverseWarp", mInverseWarp );
+    mGlslProgRef->uniform( "uRect", vec4( mFormat.mRect.x1, mFormat.mRect.y1, mFormat.mRect.x2, mFormat.mRect.y2 ) );
+    mGlslProgRef->uniform( "uBlend", mFormat.mBlend );
+    mGlslProgRef->uniform( "uBlendPower", mFormat.mBlendPower );
+    mGlslProgRef->uniform( "uGamma", mFormat.mGamma );
+    gl::drawSolidRect( Rectf( vec2( 0.0f ), size ) );
+}
+
+} // namespace proj
+} // namespace reza
@@ -0,0 +1,309 @@
+#include "QualityTiers.h"
+
+#include "cinder/Thread.h"
+#include "cinder/app/cocoa/PlatformCocoa.h"
+#include "cinder/gl/gl.h"
+
+#include <CoreVideo/CoreVideo.h>
+
+#include <algorithm>
+#include <chrono>
+#include <regex>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace quality {
+
+// Rendered frames a tier is given before its average is trusted, and before it may step up
+static const int kSettleFrames = 8;
+static const int kRaiseFrames = 60;
+// A tier that ran over budget isn't tried again for this long
+static const double kMemorySeconds = 10.0;
+
+static double now()
+{
+    return chrono::duration<double>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+QualityTiers::QualityTiers( const CompileFn &compileFn )
+    : mCompileFn( compileFn )
+{
+    mContextRef = gl::Context::create( gl::context() );
+    mThread = thread( &QualityTiers::run, this );
+}
+
+QualityTiers::~QualityTiers()
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        mRunning = false;
+    }
+    mJobsCondition.notify_all();
+    mThread.join();
+}
+
+double QualityTiers::getRefreshRate( const DisplayRef &display )
+{
+    // CoreGraphics reports 0 Hz for built in panels, the display link knows their period
+    double refreshRate = 0.0;
+    auto mac = dynamic_pointer_cast<DisplayMac>( display );
+    CVDisplayLinkRef link = nullptr;
+    if( mac && CVDisplayLinkCreateWithCGDisplay( mac->getCgDirectDisplayId(), &link ) == kCVReturnSuccess ) {
+        CVTime period = CVDisplayLinkGetNominalOutputVideoRefreshPeriod( link );
+        if( !( period.flags & kCVTimeIsIndefinite ) && period.timeValue > 0 ) {
+            refreshRate = double( period.timeScale ) / double( period.timeValue );
+        }
+        CVDisplayLinkRelease( link );
+    }
+    return refreshRate > 0.0 ? refreshRate : 60.0;
+}
+
+void QualityTiers::run()
+{
+    ThreadSetup threadSetup;
+    mContextRef->makeCurrent();
+    while( true ) {
+        Job job;
+        {
+            unique_lock<mutex> lock( mMutex );
+            mJobsCondition.wait( lock, [this] { return !mRunning || !mJobs.empty(); } );
+            if( !mRunning ) {
+                return;
+            }
+            job = mJobs.front();
+            mJobs.pop_front();
+        }
+        auto glsl = mCompileFn( *job.mSources, job.mDefines );
+        // Other contexts only see the program once the commands that built it are flushed
+        glFlush();
+        {
+            lock_guard<mutex> lock( mMutex );
+            mResults.push_back( { job, glsl } );
+        }
+        mResultsCondition.notify_all();
+    }
+}
+
+void QualityTiers::setSources( const vector<string> &sources, const gl::GlslProgRef &glsl )
+{
+    size_t key = sources.size() > 1 ? hash<string>()( sources[0] + '\0' + sources[1] ) : 0;
+    if( key != mSourcesKey ) {
+        invalidateTimes();
+    }
+    mSourcesKey = key;
+    mSpecialized = sources.size() > 1 && regex_search( sources[1], regex( "\\bFRAGMENT_QUALITY\\b" ) );
+
+    {
+        lock_guard<mutex> lock( mMutex );
+        mJobs.clear();
+        mGeneration++;
+    }
+    mSources = make_shared<vector<string>>( sources );
+    mVariantRefs.clear();
+    mVariantsPending = 0;
+    for( int tier = 0; tier < kTiers; tier++ ) {
+        mGlslProgRefs[tier] = mSpecialized ? nullptr : glsl;
+        mPending[tier] = false;
+    }
+    mGlslProgRefs[kDefaultTier] = glsl;
+    if( !mSpecialized ) {
+        return;
+    }
+
+    // The tiers live output falls back to when it runs over budget go first
+    vector<int> order;
+    for( int tier = kDefaultTier - 1; tier >= 0; tier-- ) {
+        order.push_back( tier );
+    }
+    for( int tier = kDefaultTier + 1; tier < kTiers; tier++ ) {
+        order.push_back( tier );
+    }
+    {
+        lock_guard<mutex> lock( mMutex );
+        for( int tier : order ) {
+            size_t tierKey = key ^ ( size_t( tier + 1 ) * 0x9e3779b9 + ( key << 6 ) + ( key >> 2 ) );
+            auto it = find_if( mCache.begin(), mCache.end(), [tierKey]( const pair<size_t, gl::GlslProgRef> &entry ) { return entry.first == tierKey; } );
+            if( it != mCache.end() ) {
+                mCache.splice( mCache.begin(), mCache, it );
+                mGlslProgRefs[tier] = it->second;
+                continue;
+            }
+            mPending[tier] = true;
+            mJobs.push_back( { tierKey, tier, mGeneration, mSources, { "FRAGMENT_QUALITY " + to_string( tier ) }, 0, 0 } );
+        }
+    }
+    mJobsCondition.notify_all();
+}
+
+void QualityTiers::clear()
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        mJobs.clear();
+        mGeneration++;
+    }
+    for( int tier = 0; tier < kTiers; tier++ ) {
+        mGlslProgRefs[tier] = nullptr;
+        mPending[tier] = false;
+    }
+    mSources = nullptr;
+    mVariantRefs.clear();
+    mVariantsPending = 0;
+    mSpecialized = false;
+}
+
+bool QualityTiers::update()
+{
+    vector<Result> results;
+    uint64_t generation;
+    {
+        lock_guard<mutex> lock( mMutex );
+        results.swap( mResults );
+        generation = mGeneration;
+    }
+    bool changed = false;
+    for( auto &it : results ) {
+        if( it.mJob.mRequest != 0 ) {
+            if( it.mJob.mRequest == mRequest && it.mJob.mGeneration == generation && mVariantsPending > 0 ) {
+                mVariantRefs[it.mJob.mVariant] = it.mGlslProgRef;
+                mVariantsPending--;
+            }
+            continue;
+        }
+        // Programs for sources that have since changed are still worth keeping around
+        mCache.push_front( { it.mJob.mKey, it.mGlslProgRef } );
+        if( mCache.size() > kCacheSize ) {
+            mCache.pop_back();
+        }
+        if( it.mJob.mGeneration == generation ) {
+            mGlslProgRefs[it.mJob.mTier] = it.mGlslProgRef;
+            mPending[it.mJob.mTier] = false;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+gl::GlslProgRef QualityTiers::getGlslProg( int tier, bool wait )
+{
+    tier = std::min( std::max( tier, 0 ), kTiers - 1 );
+    if( wait && mPending[tier] ) {
+        {
+            unique_lock<mutex> lock( mMutex );
+            mResultsCondition.wait( lock, [this, tier] {
+                return std::find_if( mResults.begin(), mResults.end(), [this, tier]( const Result &r ) { return r.mJob.mRequest == 0 && r.mJob.mTier == tier && r.mJob.mGeneration == mGeneration; } ) != mResults.end();
+            } );
+        }
+        update();
+    }
+    return mGlslProgRefs[tier];
+}
+
+gl::GlslProgRef QualityTiers::getExportGlslProg()
+{
+    return mGlslProgRefs[getExportTier()];
+}
+
+int QualityTiers::getExportTier()
+{
+    for( int tier = kTiers - 1; tier >= kDefaultTier; tier-- ) {
+        if( getGlslProg( tier, true ) ) {
+            return tier;
+        }
+    }
+    return kDefaultTier;
+}
+
+gl::GlslProgRef QualityTiers::getLiveGlslProg()
+{
+    for( int tier = mTier; tier >= 0; tier-- ) {
+        if( mGlslProgRefs[tier] ) {
+            mLiveTier = tier;
+            return mGlslProgRefs[tier];
+        }
+    }
+    mLiveTier = kDefaultTier;
+    return mGlslProgRefs[kDefaultTier];
+}
+
+void QualityTiers::compileVariants( int tier, const vector<string> &defines )
+{
+    if( !mSources ) {
+        return;
+    }
+    tier = std::min( std::max( tier, 0 ), kTiers - 1 );
+    mRequest++;
+    mVariantTier = tier;
+    mVariantRefs.assign( defines.size(), nullptr );
+    mVariantsPending = defines.size();
+    {
+        lock_guard<mutex> lock( mMutex );
+        mJobs.erase( remove_if( mJobs.begin(), mJobs.end(), []( const Job &job ) { return job.mRequest != 0; } ), mJobs.end() );
+        for( size_t i = defines.size(); i > 0; i-- ) {
+            vector<string> jobDefines = { defines[i - 1] };
+            if( mSpecialized ) {
+                jobDefines.push_back( "FRAGMENT_QUALITY " + to_string( tier ) );
+            }
+            mJobs.push_front( { 0, tier, mGeneration, mSources, jobDefines, mRequest, i - 1 } );
+        }
+    }
+    mJobsCondition.notify_all();
+}
+
+bool QualityTiers::getVariants( int &tier, vector<gl::GlslProgRef> &glsls )
+{
+    if( mVariantRefs.empty() || mVariantsPending > 0 ) {
+        return false;
+    }
+    tier = mVariantTier;
+    glsls.swap( mVariantRefs );
+    mVariantRefs.clear();
+    return true;
+}
+
+void QualityTiers::addFrameTime( double milliseconds, double budgetMilliseconds )
+{
+    mFrameTime = mFrames == 0 ? milliseconds : mFrameTime + ( milliseconds - mFrameTime ) * 0.2;
+    mFrames++;
+    double time = now();
+    if( mFrames >= kSettleFrames ) {
+        mTierTimes[mLiveTier] = mFrameTime;
+        mTierTimestamps[mLiveTier] = time;
+    }
+    if( !mAuto || !mSpecialized || mFrames < kSettleFrames ) {
+        return;
+    }
+
+    if( mFrameTime > budgetMilliseconds * 0.9 && mLiveTier > 0 ) {
+        mTier = mLiveTier - 1;
+        mFrames = 0;
+    }
+    else if( mFrameTime < budgetMilliseconds * 0.5 && mLiveTier < kTiers - 1 && mFrames >= kRaiseFrames ) {
+        int next = mLiveTier + 1;
+        bool tooSlow = mTierTimestamps[next] > 0.0 && time - mTierTimestamps[next] < kMemorySeconds && mTierTimes[next] > budgetMilliseconds * 0.9;
+        if( !tooSlow && mGlslProgRefs[next] ) {
+            mTier = next;
+            mFrames = 0;
+        }
+    }
+}
+
+void QualityTiers::setTier( int tier )
+{
+    mTier = std::min( std::max( tier, 0 ), kTiers - 1 );
+    mFrames = 0;
+}
+
+void QualityTiers::invalidateTimes()
+{
+    for( int tier = 0; tier < kTiers; tier++ ) {
+        mTierTimes[tier] = 0.0;
+        mTierTimestamps[tier] = 0.0;
+    }
+    mFrames = 0;
+}
+
+} // namespace quality
+} // namespace reza
@@ -0,0 +1,836 @@
+#include "RemoteServer.h"
+
+#include "cinder/ImageIo.h"
+#include "cinder/Log.h"
+#include "cinder/Stream.h"
+#include "cinder/gl/scoped.h"
+
+#include <algorithm>
+#include <deque>
+#include <istream>
+#include <map>
+#include <stdexcept>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace remote {
+
+static const size_t kMaxRequest = 1 << 16;
+static const size_t kMaxMessage = 1 << 14;
+static const size_t kMaxQueued = 64;
+static const size_t kMaxMessages = 1024;
+static const char *kBoundary = "fragmentframe";
+static const char *kWebSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+static const char *sPage = R"(<!DOCTYPE html>
+<html>
+<head>
+<meta charset="utf-8">
+<meta name="viewport" content="width=device-width">
+<title>Fragment</title>
+<style>
+body { margin: 0; background: #111; color: #ccc; font: 11px monospace; display: flex; flex-wrap: wrap; }
+#preview { max-width: 100%; align-self: flex-start; }
+#controls { flex: 1; min-width: 280px; padding: 8px; }
+.row { display: flex; align-items: center; margin: 2px 0; }
+.row label { width: 45%; overflow: hidden; white-space: nowrap; }
+.row input[type=range] { flex: 1; }
+</style>
+</head>
+<body>
+<img id="preview">
+<div id="controls"></div>
+<script>
+var controls = document.getElementById( 'controls' );
+var inputs = {};
+var socket = null;
+
+function send( address, value ) {
+    if( socket && socket.readyState == 1 ) {
+        socket.send( JSON.stringify( { ADDRESS: address, VALUE: value } ) );
+    }
+}
+
+function build( params ) {
+    controls.innerHTML = '';
+    inputs = {};
+    params.forEach( function( param ) {
+        var row = document.createElement( 'div' );
+        var label = document.createElement( 'label' );
+        var list = [];
+        row.className = 'row';
+        label.textContent = param.ADDRESS;
+        row.appendChild( label );
+        param.VALUE.forEach( function( value ) {
+            var input = document.createElement( 'input' );
+            if( param.TYPE == 'Toggle' ) {
+                input.type = 'checkbox';
+                input.checked = value > 0.5;
+                input.onchange = function() { send( param.ADDRESS, [input.checked ? 1 : 0] ); };
+            }
+            else if( param.TYPE == 'Button' ) {
+                input.type = 'button';
+                input.value = 'PRESS';
+                input.onmousedown = function() { send( param.ADDRESS, [1] ); };
+                input.onmouseup = function() { send( param.ADDRESS, [0] ); };
+            }
+            else {
+                input.type = 'range';
+                input.min = 0;
+                input.max = 1;
+                input.step = 0.001;
+                input.value = value;
+                input.oninput = function() {
+                    send( param.ADDRESS, list.map( function( it ) { return parseFloat( it.value ); } ) );
+                };
+            }
+            list.push( input );
+            row.appendChild( input );
+        } );
+        inputs[param.ADDRESS] = list;
+        controls.appendChild( row );
+    } );
+}
+
+function update( params ) {
+    var same = params.length == Object.keys( inputs ).length && params.every( function( param ) {
+        return inputs[param.ADDRESS] && inputs[param.ADDRESS].length == param.VALUE.length;
+    } );
+    if( !same ) {
+        build( params );
+        return;
+    }
+    params.forEach( function( param ) {
+        inputs[param.ADDRESS].forEach( function( input, i ) {
+            if( input === document.activeElement ) {
+                return;
+            }
+            if( input.type == 'checkbox' ) {
+                input.checked = param.VALUE[i] > 0.5;
+            }
+            else if( input.type == 'range' ) {
+                input.value = param.VALUE[i];
+            }
+        } );
+    } );
+}
+
+function connect() {
+    socket = new WebSocket( 'ws://' + location.host + '/ws' + location.search );
+    socket.onmessage = function( event ) { update( JSON.parse( event.data ).PARAMS || [] ); };
+    socket.onclose = function() { setTimeout( connect, 1000 ); };
+}
+
+document.getElementById( 'preview' ).src = '/stream' + location.search;
+connect();
+</script>
+</body>
+</html>
+)";
+
+namespace {
+
+string sha1( const string &message )
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    string data = message;
+    uint64_t bits = uint64_t( message.size() ) * 8;
+    data.push_back( char( 0x80 ) );
+    while( data.size() % 64 != 56 ) {
+        data.push_back( 0 );
+    }
+    for( int i = 7; i >= 0; i-- ) {
+        data.push_back( char( ( bits >> ( i * 8 ) ) & 0xff ) );
+    }
+
+    auto rotate = []( uint32_t v, int n ) { return ( v << n ) | ( v >> ( 32 - n ) ); };
+    for( size_t chunk = 0; chunk < data.size(); chunk += 64 ) {
+        uint32_t w[80];
+        for( int i = 0; i < 16; i++ ) {
+            const uint8_t *p = reinterpret_cast<const uint8_t *>( data.data() + chunk + i * 4 );
+            w[i] = uint32_t( p[0] ) << 24 | uint32_t( p[1] ) << 16 | uint32_t( p[2] ) << 8 | uint32_t( p[3] );
+        }
+        for( int i = 16; i < 80; i++ ) {
+            w[i] = rotate( w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1 );
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for( int i = 0; i < 80; i++ ) {
+            uint32_t f, k;
+            if( i < 20 ) {
+                f = ( b & c ) | ( ~b & d );
+                k = 0x5A827999;
+            }
+            else if( i < 40 ) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if( i < 60 ) {
+                f = ( b & c ) | ( b & d ) | ( c & d );
+                k = 0x8F1BBCDC;
+            }
+            else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rotate( a, 5 ) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotate( b, 30 );
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    string digest;
+    for( uint32_t v : h ) {
+        for( int i = 3; i >= 0; i-- ) {
+            digest.push_back( char( ( v >> ( i * 8 ) ) & 0xff ) );
+        }
+    }
+    return digest;
+}
+
+string base64( const string &data )
+{
+    static const char *kChars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    string result;
+    for( size_t i = 0; i < data.size(); i += 3 ) {
+        uint32_t n = uint32_t( uint8_t( data[i] ) ) << 16;
+        if( i + 1 < data.size() ) {
+            n |= uint32_t( uint8_t( data[i + 1] ) ) << 8;
+        }
+        if( i + 2 < data.size() ) {
+            n |= uint32_t( uint8_t( data[i + 2] ) );
+        }
+        result.push_back( kChars[( n >> 18 ) & 63] );
+        result.push_back( kChars[( n >> 12 ) & 63] );
+        result.push_back( i + 1 < data.size() ? kChars[( n >> 6 ) & 63] : '=' );
+        result.push_back( i + 2 < data.size() ? kChars[n & 63] : '=' );
+    }
+    return result;
+}
+
+// Server frames are never masked or fragmented
+shared_ptr<const string> makeWebSocketFrame( uint8_t opcode, const string &payload )
+{
+    auto frame = make_shared<string>();
+    frame->push_back( char( 0x80 | opcode ) );
+    size_t size = payload.size();
+    if( size < 126 ) {
+        frame->push_back( char( size ) );
+    }
+    else if( size < 65536 ) {
+        frame->push_back( char( 126 ) );
+        frame->push_back( char( ( size >> 8 ) & 0xff ) );
+        frame->push_back( char( size & 0xff ) );
+    }
+    else {
+        frame->push_back( char( 127 ) );
+        for( int i = 7; i >= 0; i-- ) {
+            frame->push_back( char( ( uint64_t( size ) >> ( i * 8 ) ) & 0xff ) );
+        }
+    }
+    frame->append( payload );
+    return frame;
+}
+
+string toLower( string str )
+{
+    std::transform( str.begin(), str.end(), str.begin(), ::tolower );
+    return str;
+}
+
+string getQueryValue( const string &target, const string &key )
+{
+    size_t query = target.find( '?' );
+    while( query != string::npos ) {
+        size_t begin = query + 1;
+        size_t end = target.find( '&', begin );
+        string pair = target.substr( begin, end == string::npos ? string::npos : end - begin );
+        if( pair.compare( 0, key.size() + 1, key + "=" ) == 0 ) {
+            return pair.substr( key.size() + 1 );
+        }
+        query = end;
+    }
+    return "";
+}
+
+// Takes as long whichever character differs, so the token can't be guessed a byte at a time
+bool isEqual( const string &a, const string &b )
+{
+    if( a.size() != b.size() ) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for( size_t i = 0; i < a.size(); i++ ) {
+        diff |= (unsigned char)( a[i] ^ b[i] );
+    }
+    return diff == 0;
+}
+
+// Pages on other names that resolve to loopback (DNS rebinding) send their own name here,
+// and a matching Origin with it
+bool isLoopbackHost( const string &host, uint16_t port )
+{
+    string suffix = ":" + to_string( port );
+    string name = toLower( host );
+    for( auto &it : { "127.0.0.1", "localhost", "[::1]" } ) {
+        if( name == it + suffix ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Connection, lives on the network thread
+//------------------------------------------------------------------------------
+
+class RemoteServer::Connection : public std::enable_shared_from_this<RemoteServer::Connection> {
+  public:
+    enum Kind {
+        REQUEST,
+        STREAM, // MJPEG until the client leaves
+        FRAME,  // a single JPEG, sent once the next frame is encoded
+        SOCKET
+    };
+
+    Connection( RemoteServer *server )
+        : mSocket( server->mIoService ), mServer( server ), mBuffer( kMaxRequest ) {}
+
+    void start();
+    void close();
+    bool isOpen() const { return !mClosed; }
+    Kind getKind() const { return mKind; }
+
+    void sendFrame( const shared_ptr<const string> &jpeg );
+    void sendText( const shared_ptr<const string> &text );
+
+    asio::ip::tcp::socket mSocket;
+
+  protected:
+    void handleRequest();
+    void respond( const string &status, const string &type, const string &body );
+    void queue( const shared_ptr<const string> &data );
+    void read();
+    bool parseFrames();
+    void write();
+
+    RemoteServer *mServer;
+    asio::streambuf mBuffer;
+    Kind mKind = REQUEST;
+    bool mClosed = false;
+    bool mCloseAfterWrite = false;
+    bool mWriting = false;
+    deque<shared_ptr<const string>> mQueue;
+    shared_ptr<const string> mWaitingFrame;
+    vector<shared_ptr<const string>> mWritten;
+    string mFragments;
+};
+
+void RemoteServer::Connection::start()
+{
+    auto self = shared_from_this();
+    asio::async_read_until( mSocket, mBuffer, "\r\n\r\n", [this, self]( const asio::error_code &error, size_t bytes ) {
+        if( error || mClosed ) {
+            close();
+            return;
+        }
+        handleRequest();
+    } );
+}
+
+void RemoteServer::Connection::close()
+{
+    if( mClosed ) {
+        return;
+    }
+    mClosed = true;
+    if( mKind == STREAM || mKind == FRAME ) {
+        mServer->mStreamClients--;
+    }
+    else if( mKind == SOCKET ) {
+        mServer->mSocketClients--;
+    }
+    asio::error_code error;
+    mSocket.shutdown( asio::ip::tcp::socket::shutdown_both, error );
+    mSocket.close( error );
+}
+
+void RemoteServer::Connection::handleRequest()
+{
+    istream stream( &mBuffer );
+    string method, target, line;
+    stream >> method >> target;
+    getline( stream, line );
+    map<string, string> headers;
+    while( getline( stream, line ) && line != "\r" && !line.empty() ) {
+        size_t colon = line.find( ':' );
+        if( colon == string::npos ) {
+            continue;
+        }
+        size_t begin = line.find_first_not_of( " \t", colon + 1 );
+        size_t end = line.find_last_not_of( " \t\r" );
+        headers[toLower( line.substr( 0, colon ) )] = begin == string::npos ? "" : line.substr( begin, end + 1 - begin );
+    }
+
+    string path = target.substr( 0, target.find( '?' ) );
+    const string &token = mServer->mFormat.mToken;
+    string origin = headers["origin"];
+    if( method != "GET" ) {
+        respond( "405 Method Not Allowed", "text/plain", "" );
+    }
+    else if( !token.empty() && !isEqual( getQueryValue( target, "token" ), token ) ) {
+        respond( "401 Unauthorized", "text/plain", "" );
+    }
+    else if( token.empty() && !isLoopbackHost( headers["host"], mServer->mPort ) ) {
+        respond( "403 Forbidden", "text/plain", "" );
+    }
+    else if( path == "/ws" && !origin.empty() && origin != "http://" + headers["host"] ) {
+        respond( "403 Forbidden", "text/plain", "" );
+    }
+    else if( path == "/ws" && toLower( headers["upgrade"] ) == "websocket" && !headers["sec-websocket-key"].empty() ) {
+        mKind = SOCKET;
+        mServer->mSocketClients++;
+        string accept = base64( sha1( headers["sec-websocket-key"] + kWebSocketGuid ) );
+        queue( make_shared<string>( "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " + accept + "\r\n\r\n" ) );
+        if( mServer->mState ) {
+            sendText( mServer->mState );
+        }
+        read();
+    }
+    else if( path == "/stream" ) {
+        mKind = STREAM;
+        mServer->mStreamClients++;
+        mServer->mWaiting = true;
+        queue( make_shared<string>( string( "HTTP/1.1 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=" ) + kBoundary + "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n" ) );
+        // Nothing is expected from the client, the read only notices when it leaves
+        read();
+    }
+    else if( path == "/frame.jpg" ) {
+        mKind = FRAME;
+        mServer->mStreamClients++;
+        mServer->mWaiting = true;
+        read();
+    }
+    else if( path == "/" || path == "/index.html" ) {
+        respond( "200 OK", "text/html; charset=utf-8", sPage );
+    }
+    else {
+        respond( "404 Not Found", "text/plain", "" );
+    }
+}
+
+void RemoteServer::Connection::respond( const string &status, const string &type, const string &body )
+{
+    auto response = make_shared<string>( "HTTP/1.1 " + status + "\r\nContent-Type: " + type + "\r\nContent-Length: " + to_string( body.size() ) + "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n" );
+    response->append( body );
+    mCloseAfterWrite = true;
+    queue( response );
+}
+
+void RemoteServer::Connection::sendFrame( const shared_ptr<const string> &jpeg )
+{
+    if( mKind == FRAME ) {
+        if( !mCloseAfterWrite ) {
+            respond( "200 OK", "image/jpeg", *jpeg );
+        }
+        return;
+    }
+    mWaitingFrame = jpeg;
+    write();
+}
+
+void RemoteServer::Connection::sendText( const shared_ptr<const string> &text )
+{
+    queue( makeWebSocketFrame( 0x1, *text ) );
+}
+
+void RemoteServer::Connection::queue( const shared_ptr<const string> &data )
+{
+    // A client that stopped reading would otherwise hold on to everything sent its way
+    if( mQueue.size() >= kMaxQueued ) {
+        close();
+        return;
+    }
+    mQueue.push_back( data );
+    write();
+}
+
+void RemoteServer::Connection::write()
+{
+    if( mWriting || mClosed ) {
+        return;
+    }
+    mWritten.clear();
+    if( !mQueue.empty() ) {
+        mWritten.push_back( mQueue.front() );
+        mQueue.pop_front();
+    }
+    else if( mWaitingFrame ) {
+        mWritten.push_back( make_shared<string>( string( "--" ) + kBoundary + "\r\nContent-Type: image/jpeg\r\nContent-Length: " + to_string( mWaitingFrame->size() ) + "\r\n\r\n" ) );
+        mWritten.push_back( mWaitingFrame );
+        mWritten.push_back( make_shared<string>( "\r\n" ) );
+        mWaitingFrame.reset();
+    }
+    else {
+        if( mCloseAfterWrite ) {
+            close();
+        }
+        return;
+    }
+
+    vector<asio::const_buffer> buffers;
+    for( auto &it : mWritten ) {
+        buffers.push_back( asio::buffer( *it ) );
+    }
+    mWriting = true;
+    auto self = shared_from_this();
+    asio::async_write( mSocket, buffers, [this, self]( const asio::error_code &error, size_t bytes ) {
+        mWriting = false;
+        if( error ) {
+            close();
+            return;
+        }
+        write();
+    } );
+}
+
+void RemoteServer::Connection::read()
+{
+    if( mKind == SOCKET && !parseFrames() ) {
+        return;
+    }
+    auto self = shared_from_this();
+    mSocket.async_read_some( mBuffer.prepare( 4096 ), [this, self]( const asio::error_code &error, size_t bytes ) {
+        if( error || mClosed ) {
+            close();
+            return;
+        }
+        mBuffer.commit( bytes );
+        if( mKind != SOCKET ) {
+            mBuffer.consume( mBuffer.size() );
+        }
+        read();
+    } );
+}
+
+bool RemoteServer::Connection::parseFrames()
+{
+    while( true ) {
+        const uint8_t *data = asio::buffer_cast<const uint8_t *>( mBuffer.data() );
+        size_t size = mBuffer.size();
+        if( size < 2 ) {
+            return true;
+        }
+        bool fin = ( data[0] & 0x80 ) != 0;
+        uint8_t opcode = data[0] & 0x0f;
+        uint64_t length = data[1] & 0x7f;
+        size_t offset = 2;
+        if( length == 126 ) {
+            if( size < 4 ) {
+                return true;
+            }
+            length = uint64_t( data[2] ) << 8 | data[3];
+            offset = 4;
+        }
+        else if( length == 127 ) {
+            if( size < 10 ) {
+                return true;
+            }
+            length = 0;
+            for( int i = 0; i < 8; i++ ) {
+                length = length << 8 | data[2 + i];
+            }
+            offset = 10;
+        }
+        // Clients always mask, anything bigger than a control message is not ours
+        if( !( data[1] & 0x80 ) || length > kMaxMessage ) {
+            close();
+            return false;
+        }
+        if( size < offset + 4 + length ) {
+            return true;
+        }
+        const uint8_t *mask = data + offset;
+        offset += 4;
+        string payload( size_t( length ), '\0' );
+        for( size_t i = 0; i < payload.size(); i++ ) {
+            payload[i] = char( data[offset + i] ^ mask[i & 3] );
+        }
+        mBuffer.consume( offset + size_t( length ) );
+
+        switch( opcode ) {
+        case 0x0:
+        case 0x1:
+            mFragments = opcode == 0x1 ? payload : mFragments + payload;
+            if( mFragments.size() > kMaxMessage ) {
+                close();
+                return false;
+            }
+            if( fin ) {
+                mServer->receive( mFragments );
+                mFragments.clear();
+            }
+            break;
+        case 0x8:
+            mCloseAfterWrite = true;
+            queue( makeWebSocketFrame( 0x8, "" ) );
+            return false;
+        case 0x9:
+            queue( makeWebSocketFrame( 0xA, payload ) );
+            break;
+        case 0xA:
+            break;
+        default:
+            close();
+            return false;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// RemoteServer
+//------------------------------------------------------------------------------
+
+RemoteServer::RemoteServer( uint16_t port, const Format &format )
+    : mPort( port ), mFormat( format ), mWork( new asio::io_service::work( mIoService ) ), mAcceptor( mIoService ), mStreamClients( 0 ), mSocketClients( 0 ), mWaiting( false ), mEncoding( false )
+{
+    asio::ip::tcp::endpoint endpoint( asio::ip::address::from_string( mFormat.mAddress ), port );
+    if( !endpoint.address().is_loopback() && mFormat.mToken.empty() ) {
+        throw std::invalid_argument( "listening on " + mFormat.mAddress + " needs a token" );
+    }
+    mAcceptor.open( endpoint.protocol() );
+    mAcceptor.set_option( asio::ip::tcp::acceptor::reuse_address( true ) );
+    mAcceptor.bind( endpoint );
+    mAcceptor.listen();
+    accept();
+
+    mNetworkThread = thread( [this] { mIoService.run(); } );
+    mEncoderThread = thread( &RemoteServer::encode, this );
+}
+
+RemoteServer::~RemoteServer()
+{
+    {
+        lock_guard<mutex> lock( mEncoderMutex );
+        mRunning = false;
+    }
+    mEncoderCondition.notify_all();
+    mEncoderThread.join();
+
+    // Once every socket is closed their handlers finish and run() returns
+    mIoService.post( [this] {
+        asio::error_code error;
+        mAcceptor.close( error );
+        for( auto &it : mConnections ) {
+            if( auto connection = it.lock() ) {
+                connection->close();
+            }
+        }
+    } );
+    mWork.reset();
+    mNetworkThread.join();
+}
+
+void RemoteServer::accept()
+{
+    auto connection = make_shared<Connection>( this );
+    mAcceptor.async_accept( connection->mSocket, [this, connection]( const asio::error_code &error ) {
+        if( error == asio::error::operation_aborted ) {
+            return;
+        }
+        if( error ) {
+            CI_LOG_E( "Remote accept error: " << error.message() );
+        }
+        else {
+            mConnections.erase( remove_if( mConnections.begin(), mConnections.end(), []( const weak_ptr<Connection> &it ) { return it.expired(); } ), mConnections.end() );
+            mConnections.push_back( connection );
+            connection->start();
+        }
+        accept();
+    } );
+}
+
+bool RemoteServer::wantsFrame()
+{
+    if( mStreamClients == 0 || mEncoding || mReading || !( mChanged || mWaiting ) ) {
+        return false;
+    }
+    lock_guard<mutex> lock( mEncoderMutex );
+    return chrono::steady_clock::now() >= mNextFrameTime;
+}
+
+bool RemoteServer::capture( const gl::FboRef &frame, bool changed )
+{
+    mChanged = mChanged || changed;
+
+    if( mReading ) {
+        Surface8u surface( mReadSize.x, mReadSize.y, false );
+        size_t rowBytes = size_t( mReadSize.x ) * 4;
+        uint8_t inc = surface.getPixelInc();
+        uint8_t r = surface.getRedOffset();
+        uint8_t g = surface.getGreenOffset();
+        uint8_t b = surface.getBlueOffset();
+        bool mapped = false;
+        {
+            gl::ScopedBuffer scpBuffer( mPboRef );
+            const uint8_t *src = static_cast<const uint8_t *>( mPboRef->mapBufferRange( 0, rowBytes * mReadSize.y, GL_MAP_READ_BIT ) );
+            if( src ) {
+                // Rows come back bottom up
+                for( int y = 0; y < mReadSize.y; y++ ) {
+                    const uint8_t *row = src + ( mReadSize.y - 1 - y ) * rowBytes;
+                    uint8_t *dst = surface.getData( ivec2( 0, y ) );
+                    for( int x = 0; x < mReadSize.x; x++ ) {
+                        dst[r] = row[x * 4];
+                        dst[g] = row[x * 4 + 1];
+                        dst[b] = row[x * 4 + 2];
+                        dst += inc;
+                    }
+                }
+                mPboRef->unmap();
+                mapped = true;
+            }
+        }
+        mReading = false;
+        if( mapped ) {
+            {
+                lock_guard<mutex> lock( mEncoderMutex );
+                mPending = surface;
+                mHasPending = true;
+            }
+            mEncoderCondition.notify_one();
+        }
+        else {
+            CI_LOG_E( "Unable to map remote preview read back" );
+            mEncoding = false;
+        }
+    }
+
+    if( !frame || !wantsFrame() ) {
+        return false;
+    }
+    ivec2 size = frame->getSize();
+    int width = std::max( std::min( mFormat.mWidth, size.x ), 1 );
+    mReadSize = ivec2( width, std::max( int( std::round( float( width ) * size.y / size.x ) ), 1 ) );
+    if( !mPreviewFboRef || mPreviewFboRef->getSize() != mReadSize ) {
+        mPreviewFboRef = gl::Fbo::create( mReadSize.x, mReadSize.y, gl::Fbo::Format().disableDepth() );
+    }
+    frame->blitTo( mPreviewFboRef, frame->getBounds(), mPreviewFboRef->getBounds(), GL_LINEAR );
+
+    size_t bytes = size_t( mReadSize.x ) * mReadSize.y * 4;
+    if( !mPboRef || size_t( mPboRef->getSize() ) < bytes ) {
+        mPboRef = gl::Pbo::create( GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ );
+    }
+    {
+        gl::ScopedFramebuffer scpFbo( GL_READ_FRAMEBUFFER, mPreviewFboRef );
+        gl::ScopedBuffer scpBuffer( mPboRef );
+        glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+        glReadPixels( 0, 0, mReadSize.x, mReadSize.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr );
+    }
+    mReading = true;
+    mEncoding = true;
+    mChanged = false;
+    {
+        lock_guard<mutex> lock( mEncoderMutex );
+        mNextFrameTime = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>( chrono::duration<double>( 1.0 / std::max( mFormat.mFps, 1.0f ) ) );
+    }
+    return true;
+}
+
+void RemoteServer::encode()
+{
+    while( true ) {
+        Surface8u surface;
+        {
+            unique_lock<mutex> lock( mEncoderMutex );
+            mEncoderCondition.wait( lock, [this] { return mHasPending || !mRunning; } );
+            if( !mRunning ) {
+                return;
+            }
+            surface = mPending;
+            mPending = Surface8u();
+            mHasPending = false;
+        }
+
+        auto stream = OStreamMem::create( surface.getWidth() * surface.getHeight() / 4 );
+        try {
+            writeImage( DataTargetStream::createRef( stream ), surface, ImageTarget::Options().quality( mFormat.mQuality ), "jpg" );
+        }
+        catch( const ci::Exception &exc ) {
+            CI_LOG_E( "Remote preview encode error: " << exc.what() );
+            mEncoding = false;
+            continue;
+        }
+        auto jpeg = make_shared<const string>( static_cast<const char *>( stream->getBuffer() ), size_t( stream->tell() ) );
+
+        // The next frame waits until this one has gone out at the stream's bandwidth
+        double seconds = double( jpeg->size() ) * 8.0 / ( std::max( mFormat.mKbps, 1 ) * 1000.0 );
+        {
+            lock_guard<mutex> lock( mEncoderMutex );
+            mNextFrameTime = std::max( mNextFrameTime, chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>( chrono::duration<double>( seconds ) ) );
+        }
+        mIoService.post( [this, jpeg] { publishFrame( jpeg ); } );
+        mEncoding = false;
+    }
+}
+
+void RemoteServer::publishFrame( const shared_ptr<const string> &jpeg )
+{
+    mWaiting = false;
+    for( auto &it : mConnections ) {
+        auto connection = it.lock();
+        if( connection && connection->isOpen() && ( connection->getKind() == Connection::STREAM || connection->getKind() == Connection::FRAME ) ) {
+            connection->sendFrame( jpeg );
+        }
+    }
+}
+
+void RemoteServer::setState( const string &state )
+{
+    if( state == mLastState ) {
+        return;
+    }
+    mLastState = state;
+    auto shared = make_shared<const string>( state );
+    mIoService.post( [this, shared] { publishState( shared ); } );
+}
+
+void RemoteServer::publishState( const shared_ptr<const string> &state )
+{
+    mState = state;
+    for( auto &it : mConnections ) {
+        auto connection = it.lock();
+        if( connection && connection->isOpen() && connection->getKind() == Connection::SOCKET ) {
+            connection->sendText( state );
+        }
+    }
+}
+
+void RemoteServer::receive( const string &message )
+{
+    lock_guard<mutex> lock( mMessagesMutex );
+    if( mMessages.size() < kMaxMessages ) {
+        mMessages.push_back( message );
+    }
+}
+
+vector<string> RemoteServer::getMessages()
+{
+    vector<string> messages;
+    lock_guard<mutex> lock( mMessagesMutex );
+    messages.swap( mMessages );
+    return messages;
+}
+
+} // namespace remote
+} // namespace reza
@@ -0,0 +1,214 @@
+#include "ResourceManager.h"
+
+#include "cinder/GeomIo.h"
+#include "cinder/Log.h"
+#include "cinder/TriMesh.h"
+
+#include <algorithm>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace res {
+
+// Color attachments looked at when counting a framebuffer
+static const int kMaxAttachments = 4;
+
+size_t ResourceManager::getTexelBytes( GLenum internalFormat )
+{
+    switch( internalFormat ) {
+    case GL_R8: return 1;
+    case GL_RG8:
+    case GL_R16F: return 2;
+    case GL_RGB8:
+    case GL_RGB: return 3;
+    case GL_RG16F:
+    case GL_R32F:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F: return 4;
+    case GL_RGB16F: return 6;
+    case GL_RGBA16F:
+    case GL_RG32F: return 8;
+    case GL_RGB32F: return 12;
+    case GL_RGBA32F: return 16;
+    default: return 4;
+    }
+}
+
+size_t ResourceManager::getByteSize( const gl::Texture2dRef &texture )
+{
+    if( !texture ) {
+        return 0;
+    }
+    size_t bytes = size_t( texture->getWidth() ) * texture->getHeight() * getTexelBytes( texture->getInternalFormat() );
+    // A full mip chain adds a third
+    return texture->hasMipmapping() ? bytes + bytes / 3 : bytes;
+}
+
+size_t ResourceManager::getByteSize( const gl::FboRef &fbo )
+{
+    size_t bytes = 0;
+    for( int i = 0; i < kMaxAttachments; i++ ) {
+        bytes += getByteSize( fbo->getTexture2d( GLenum( GL_COLOR_ATTACHMENT0 + i ) ) );
+    }
+    return bytes;
+}
+
+void ResourceManager::prune()
+{
+    mTracked.erase( remove_if( mTracked.begin(), mTracked.end(), []( const Tracked &it ) { return it.mOwner.expired(); } ), mTracked.end() );
+}
+
+size_t ResourceManager::getBytes( Pool pool )
+{
+    size_t bytes = 0;
+    for( auto &it : getUsage() ) {
+        bytes += it.mPool == pool ? it.mBytes : 0;
+    }
+    return bytes;
+}
+
+bool ResourceManager::fits( Pool pool, size_t bytes, const string &replacing )
+{
+    if( mBudgets[pool] == 0 ) {
+        return true;
+    }
+    size_t used = 0;
+    for( auto &it : getUsage() ) {
+        used += it.mPool == pool && it.mCategory != replacing ? it.mBytes : 0;
+    }
+    return used + bytes <= mBudgets[pool];
+}
+
+vector<ResourceManager::Usage> ResourceManager::getUsage()
+{
+    prune();
+    map<pair<string, Pool>, size_t> totals;
+    for( auto &it : mTracked ) {
+        totals[make_pair( it.mCategory, it.mPool )] += it.mBytes;
+    }
+    for( auto &it : mSources ) {
+        totals[make_pair( it.mCategory, it.mPool )] += it.mBytesFn();
+    }
+    vector<Usage> usage;
+    for( auto &it : totals ) {
+        if( it.second > 0 ) {
+            usage.push_back( { it.first.first, it.first.second, it.second } );
+        }
+    }
+    sort( usage.begin(), usage.end(), []( const Usage &a, const Usage &b ) { return a.mBytes > b.mBytes; } );
+    return usage;
+}
+
+gl::FboRef ResourceManager::getFbo( const string &category, const ivec2 &size, const FboFn &createFn )
+{
+    for( auto &it : mFbos ) {
+        if( it.mCategory == category && it.mFbo.use_count() == 1 && it.mFbo->getSize() == size ) {
+            it.mIdle = false;
+            return it.mFbo;
+        }
+    }
+    // Idle ones of another size are what a resize left behind
+    mFbos.erase( remove_if( mFbos.begin(), mFbos.end(), [&category]( const PooledFbo &it ) {
+                     return it.mCategory == category && it.mFbo.use_count() == 1;
+                 } ),
+        mFbos.end() );
+    PooledFbo pooled;
+    pooled.mCategory = category;
+    pooled.mFbo = createFn( size );
+    track( category, pooled.mFbo );
+    mFbos.push_back( pooled );
+    return pooled.mFbo;
+}
+
+gl::FboRef ResourceManager::getFbo( const string &category, const ivec2 &size, const gl::Fbo::Format &format )
+{
+    return getFbo( category, size, [&format]( const ivec2 &size ) { return gl::Fbo::create( size.x, size.y, format ); } );
+}
+
+gl::BatchRef ResourceManager::getRect( const string &category, const gl::GlslProgRef &glsl, const Rectf &rect, const vec2 &ul, const vec2 &ur, const vec2 &lr, const vec2 &ll )
+{
+    auto &pooled = mRects[category];
+    array<vec2, 4> texcoords = { { ul, ur, lr, ll } };
+    auto source = geom::Rect( rect ).texCoords( ul, ur, lr, ll );
+    if( pooled.mBatch && pooled.mGlsl == glsl ) {
+        if( pooled.mRect == rect && pooled.mTexcoords == texcoords ) {
+            return pooled.mBatch;
+        }
+        // Same layout as the batch was made with, so only the values need to go up
+        TriMesh mesh( source, TriMesh::Format().positions( 2 ).texCoords0( 2 ) );
+        auto vboMesh = pooled.mBatch->getVboMesh();
+        try {
+            vboMesh->bufferAttrib( geom::POSITION, mesh.getBufferPositions() );
+            vboMesh->bufferAttrib( geom::TEX_COORD_0, mesh.getBufferTexCoords0() );
+            pooled.mRect = rect;
+            pooled.mTexcoords = texcoords;
+            return pooled.mBatch;
+        }
+        catch( const ci::Exception &exc ) {
+            CI_LOG_W( "Remaking " << category << " batch: " << exc.what() );
+        }
+    }
+    pooled.mGlsl = glsl;
+    pooled.mBatch = gl::Batch::create( source, glsl );
+    pooled.mRect = rect;
+    pooled.mTexcoords = texcoords;
+    size_t bytes = 0;
+    for( auto &it : pooled.mBatch->getVboMesh()->getVertexArrayVbos() ) {
+        bytes += it.second->getSize();
+    }
+    track( category, GPU, pooled.mBatch, bytes );
+    return pooled.mBatch;
+}
+
+void ResourceManager::trim()
+{
+    mFbos.erase( remove_if( mFbos.begin(), mFbos.end(), []( const PooledFbo &it ) {
+                     return it.mIdle && it.mFbo.use_count() == 1;
+                 } ),
+        mFbos.end() );
+    for( auto &it : mFbos ) {
+        it.mIdle = it.mFbo.use_count() == 1;
+    }
+}
+
+void ResourceManager::track( const string &category, Pool pool, const shared_ptr<const void> &owner, size_t bytes )
+{
+    if( !owner ) {
+        return;
+    }
+    for( auto &it : mTracked ) {
+        if( !it.mOwner.owner_before( owner ) && !owner.owner_before( it.mOwner ) ) {
+            return;
+        }
+    }
+    mTracked.push_back( { category, pool, owner, bytes } );
+}
+
+void ResourceManager::track( const string &category, const gl::Texture2dRef &texture )
+{
+    track( category, GPU, texture, getByteSize( texture ) );
+}
+
+void ResourceManager::track( const string &category, const gl::FboRef &fbo )
+{
+    if( fbo ) {
+        track( category, GPU, fbo, getByteSize( fbo ) );
+    }
+}
+
+void ResourceManager::track( const string &category, const Surface8uRef &surface )
+{
+    if( surface ) {
+        track( category, CPU, surface, size_t( surface->getRowBytes() ) * surface->getHeight() );
+    }
+}
+
+void ResourceManager::addSource( const string &category, Pool pool, const function<size_t()> &bytesFn )
+{
+    mSources.push_back( { category, pool, bytesFn } );
+}
+
+} // namespace res
+} // namespace reza
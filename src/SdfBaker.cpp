@@ -0,0 +1,176 @@
+#include "SdfBaker.h"
+
+#include "cinder/Log.h"
+#include "cinder/Timer.h"
+#include "cinder/gl/gl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace bake {
+
+SdfBaker::~SdfBaker()
+{
+    if( mFbo != 0 ) {
+        glDeleteFramebuffers( 1, &mFbo );
+    }
+}
+
+void SdfBaker::bake( const gl::GlslProgRef &glsl, int resolution, bool sparse, const function<void( const gl::GlslProgRef & )> &uniformsFn )
+{
+    Timer timer( true );
+    resolution = std::max( kBrickSize, resolution / kBrickSize * kBrickSize );
+    auto dense = render( glsl, resolution, uniformsFn );
+    if( sparse ) {
+        pack( dense, resolution );
+    }
+    else {
+        mVolumeRef = dense;
+        mBricksRef = nullptr;
+        mByteSize = size_t( resolution ) * resolution * resolution * 2;
+    }
+    mBakeSeconds = timer.getSeconds();
+    CI_LOG_V( "SDF BAKED: " << resolution << "^3 " << ( sparse ? "SPARSE " : "" ) << mByteSize / 1024 << "KB " << mBakeSeconds * 1000.0 << "ms" );
+}
+
+gl::Texture3dRef SdfBaker::render( const gl::GlslProgRef &glsl, int resolution, const function<void( const gl::GlslProgRef & )> &uniformsFn )
+{
+    auto fmt = gl::Texture3d::Format().internalFormat( GL_R16F ).minFilter( GL_LINEAR ).magFilter( GL_LINEAR ).wrap( GL_CLAMP_TO_EDGE );
+    auto volume = gl::Texture3d::create( resolution, resolution, resolution, fmt );
+    if( mFbo == 0 ) {
+        glGenFramebuffers( 1, &mFbo );
+    }
+
+    // Every slice is one full screen draw into a layer of the volume
+    gl::ScopedFramebuffer scpFbo( GL_FRAMEBUFFER, mFbo );
+    gl::ScopedViewport scpViewport( ivec2( 0 ), ivec2( resolution ) );
+    gl::ScopedMatrices scpMatrices;
+    gl::setMatricesWindow( resolution, resolution );
+    gl::ScopedGlslProg scpGlsl( glsl );
+    gl::ScopedBlend scpBlend( false );
+    uniformsFn( glsl );
+    glsl->uniform( "iBakeResolution", float( resolution ) );
+    for( int z = 0; z < resolution; z++ ) {
+        glFramebufferTextureLayer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, volume->getId(), 0, z );
+        glsl->uniform( "iBakeSlice", float( z ) );
+        gl::drawSolidRect( Rectf( 0.0f, 0.0f, float( resolution ), float( resolution ) ) );
+    }
+    glFramebufferTextureLayer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0 );
+    return volume;
+}
+
+void SdfBaker::pack( const gl::Texture3dRef &dense, int resolution )
+{
+    size_t count = size_t( resolution ) * resolution * resolution;
+    vector<float> samples( count );
+    {
+        gl::ScopedTextureBind scpTex( dense );
+        glGetTexImage( GL_TEXTURE_3D, 0, GL_RED, GL_FLOAT, samples.data() );
+    }
+    auto sample = [&]( int x, int y, int z ) {
+        x = std::min( x, resolution - 1 );
+        y = std::min( y, resolution - 1 );
+        z = std::min( z, resolution - 1 );
+        return samples[( size_t( z ) * resolution + y ) * resolution + x];
+    };
+
+    // A brick interpolates between kBrickSize + 1 samples per axis, the last of which
+    // belongs to its neighbour, so filtering never reads across brick boundaries
+    const int stride = kBrickSize + 1;
+    int bricks = resolution / kBrickSize;
+    float voxel = 2.0f / float( resolution ); // distances are baked in units of the half extent
+    vector<ivec3> occupied;
+    vector<float> table( size_t( bricks ) * bricks * bricks * 4, 0.0f );
+    vector<float> nearest( size_t( bricks ) * bricks * bricks, 0.0f );
+    for( int bz = 0; bz < bricks; bz++ ) {
+        for( int by = 0; by < bricks; by++ ) {
+            for( int bx = 0; bx < bricks; bx++ ) {
+                float minimum = numeric_limits<float>::max();
+                float sign = 1.0f;
+                for( int z = 0; z < stride; z++ ) {
+                    for( int y = 0; y < stride; y++ ) {
+                        for( int x = 0; x < stride; x++ ) {
+                            float d = sample( bx * kBrickSize + x, by * kBrickSize + y, bz * kBrickSize + z );
+                            if( std::abs( d ) < minimum ) {
+                                minimum = std::abs( d );
+                                sign = d < 0.0f ? -1.0f : 1.0f;
+                            }
+                        }
+                    }
+                }
+                size_t index = ( size_t( bz ) * bricks + by ) * bricks + bx;
+                // Bricks the surface can't reach are replaced by a single distance, short of
+                // the nearest sample by a voxel so it never overshoots anywhere in the brick
+                nearest[index] = sign * ( minimum - voxel );
+                if( minimum < float( kBrickSize ) * voxel ) {
+                    occupied.push_back( ivec3( bx, by, bz ) );
+                }
+            }
+        }
+    }
+
+    int side = std::max( 1, int( std::ceil( std::cbrt( double( occupied.size() ) ) ) ) );
+    ivec3 atlasBricks( side, side, std::max( 1, int( ( occupied.size() + side * side - 1 ) / ( side * side ) ) ) );
+    ivec3 atlasSize = atlasBricks * stride;
+    vector<float> atlas( size_t( atlasSize.x ) * atlasSize.y * atlasSize.z, 0.0f );
+    for( size_t i = 0; i < occupied.size(); i++ ) {
+        ivec3 b = occupied[i];
+        ivec3 slot( int( i ) % side, ( int( i ) / side ) % side, int( i ) / ( side * side ) );
+        for( int z = 0; z < stride; z++ ) {
+            for( int y = 0; y < stride; y++ ) {
+                for( int x = 0; x < stride; x++ ) {
+                    ivec3 dst = slot * stride + ivec3( x, y, z );
+                    atlas[( size_t( dst.z ) * atlasSize.y + dst.y ) * atlasSize.x + dst.x] = sample( b.x * kBrickSize + x, b.y * kBrickSize + y, b.z * kBrickSize + z );
+                }
+            }
+        }
+        size_t index = ( size_t( b.z ) * bricks + b.y ) * bricks + b.x;
+        table[index * 4 + 0] = float( slot.x );
+        table[index * 4 + 1] = float( slot.y );
+        table[index * 4 + 2] = float( slot.z );
+        table[index * 4 + 3] = 1.0f;
+    }
+    for( size_t index = 0; index < nearest.size(); index++ ) {
+        if( table[index * 4 + 3] == 0.0f ) {
+            table[index * 4 + 0] = nearest[index];
+        }
+    }
+
+    auto atlasFmt = gl::Texture3d::Format().internalFormat( GL_R16F ).minFilter( GL_LINEAR ).magFilter( GL_LINEAR ).wrap( GL_CLAMP_TO_EDGE );
+    mVolumeRef = gl::Texture3d::create( atlasSize.x, atlasSize.y, atlasSize.z, atlasFmt );
+    mVolumeRef->update( atlas.data(), GL_RED, GL_FLOAT, 0, atlasSize.x, atlasSize.y, atlasSize.z );
+    auto tableFmt = gl::Texture3d::Format().internalFormat( GL_RGBA16F ).minFilter( GL_NEAREST ).magFilter( GL_NEAREST ).wrap( GL_CLAMP_TO_EDGE );
+    mBricksRef = gl::Texture3d::create( bricks, bricks, bricks, tableFmt );
+    mBricksRef->update( table.data(), GL_RGBA, GL_FLOAT, 0, bricks, bricks, bricks );
+    mByteSize = atlas.size() * 2 + table.size() * 2;
+}
+
+int SdfBaker::bind( const gl::GlslProgRef &glsl, uint8_t unit )
+{
+    if( !mVolumeRef ) {
+        return 0;
+    }
+    mVolumeRef->bind( unit );
+    glsl->uniform( "iBakedSdf", int( unit ) );
+    if( mBricksRef ) {
+        mBricksRef->bind( uint8_t( unit + 1 ) );
+        glsl->uniform( "iBakedSdfBricks", int( unit + 1 ) );
+        return 2;
+    }
+    return 1;
+}
+
+void SdfBaker::clear()
+{
+    mVolumeRef = nullptr;
+    mBricksRef = nullptr;
+    mByteSize = 0;
+}
+
+} // namespace bake
+} // namespace reza
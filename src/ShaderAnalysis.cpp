@@ -0,0 +1,1141 @@
+#include "ShaderAnalysis.h"
+
+#include "cinder/Json.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace analysis {
+
+namespace {
+
+enum TokenKind { IDENTIFIER, NUMBER, SYMBOL };
+
+struct Token {
+    TokenKind mKind;
+    string mText;
+    int mLine;
+    bool mSpaceBefore;
+};
+
+struct Macro {
+    bool mFunction = false;
+    vector<string> mParams;
+    vector<Token> mBody;
+};
+
+typedef map<string, Macro> Macros;
+
+// Cost in arithmetic ops, a rough average over current GPUs
+const map<string, double> kBuiltins = {
+    { "abs", 1 }, { "sign", 1 }, { "floor", 1 }, { "ceil", 1 }, { "fract", 1 }, { "trunc", 1 },
+    { "round", 1 }, { "roundEven", 1 }, { "min", 1 }, { "max", 1 }, { "step", 1 }, { "mod", 2 },
+    { "clamp", 2 }, { "mix", 2 }, { "dot", 2 }, { "cross", 3 }, { "length", 3 }, { "faceforward", 3 },
+    { "distance", 4 }, { "normalize", 4 }, { "reflect", 4 }, { "smoothstep", 4 }, { "sqrt", 4 },
+    { "inversesqrt", 4 }, { "sin", 4 }, { "cos", 4 }, { "exp", 4 }, { "exp2", 4 }, { "log", 4 },
+    { "log2", 4 }, { "tan", 8 }, { "asin", 8 }, { "acos", 8 }, { "atan", 8 }, { "sinh", 8 },
+    { "cosh", 8 }, { "tanh", 8 }, { "pow", 8 }, { "refract", 8 }, { "determinant", 16 },
+    { "inverse", 32 }, { "transpose", 1 }, { "outerProduct", 4 }, { "matrixCompMult", 1 },
+    { "dFdx", 1 }, { "dFdy", 1 }, { "fwidth", 2 }, { "lessThan", 1 }, { "lessThanEqual", 1 },
+    { "greaterThan", 1 }, { "greaterThanEqual", 1 }, { "equal", 1 }, { "notEqual", 1 },
+    { "any", 1 }, { "all", 1 }, { "not", 1 }, { "isnan", 1 }, { "isinf", 1 }, { "textureSize", 1 },
+    { "floatBitsToInt", 0 }, { "floatBitsToUint", 0 }, { "intBitsToFloat", 0 }, { "uintBitsToFloat", 0 }
+};
+
+// Builtins at least this expensive are worth a warning inside a loop
+const double kExpensiveBuiltin = 8.0;
+
+const set<string> kTextureFunctions = {
+    "texture", "texture2D", "texture3D", "textureCube", "textureLod", "textureGrad", "textureOffset",
+    "textureProj", "textureProjLod", "textureLodOffset", "textureGradOffset", "texelFetch",
+    "texelFetchOffset", "textureGather", "texture2DLod"
+};
+
+const set<string> kKeywords = {
+    "if", "else", "for", "while", "do", "switch", "case", "return", "break", "continue", "discard",
+    "layout", "struct", "const", "in", "out", "inout", "uniform", "highp", "mediump", "lowp",
+    "precision", "flat", "smooth", "void", "bool", "int", "uint", "float", "double"
+};
+
+const set<string> kOperators = {
+    "+", "-", "*", "/", "%", "+=", "-=", "*=", "/=", "%=", "++", "--", "<", ">", "<=", ">=", "==",
+    "!=", "&&", "||", "^^", "!", "?", "&", "|", "^", "<<", ">>"
+};
+
+bool isType( const string &name )
+{
+    static const set<string> scalars = { "void", "bool", "int", "uint", "float", "double" };
+    if( scalars.count( name ) ) {
+        return true;
+    }
+    // vec3, ivec2, bvec4, mat3, mat2x4, dmat4, ...
+    size_t pos = ( name[0] == 'i' || name[0] == 'u' || name[0] == 'b' || name[0] == 'd' ) ? 1 : 0;
+    if( name.compare( pos, 3, "vec" ) == 0 && name.size() == pos + 4 ) {
+        return name[pos + 3] >= '2' && name[pos + 3] <= '4';
+    }
+    pos = name[0] == 'd' ? 1 : 0;
+    if( name.compare( pos, 3, "mat" ) == 0 && ( name.size() == pos + 4 || name.size() == pos + 6 ) ) {
+        return true;
+    }
+    return name.find( "sampler" ) != string::npos;
+}
+
+string stripComments( const string &source )
+{
+    // Comments become spaces, newlines inside them stay so line numbers still match
+    string result;
+    result.reserve( source.size() );
+    for( size_t i = 0; i < source.size(); i++ ) {
+        if( source[i] == '/' && i + 1 < source.size() && source[i + 1] == '/' ) {
+            while( i < source.size() && source[i] != '\n' ) {
+                i++;
+            }
+            if( i < source.size() ) {
+                result += '\n';
+            }
+        }
+        else if( source[i] == '/' && i + 1 < source.size() && source[i + 1] == '*' ) {
+            i += 2;
+            while( i < source.size() && !( source[i] == '*' && i + 1 < source.size() && source[i + 1] == '/' ) ) {
+                result += source[i] == '\n' ? '\n' : ' ';
+                i++;
+            }
+            i++;
+            result += ' ';
+        }
+        else {
+            result += source[i];
+        }
+    }
+    return result;
+}
+
+vector<Token> tokenize( const string &text, int line )
+{
+    static const vector<string> symbols = {
+        "<<=", ">>=", "++", "--", "+=", "-=", "*=", "/=", "%=", "<=", ">=", "==", "!=", "&&", "||",
+        "^^", "<<", ">>", "&=", "|=", "^=", "##"
+    };
+    vector<Token> tokens;
+    bool space = true;
+    size_t i = 0;
+    while( i < text.size() ) {
+        char c = text[i];
+        if( isspace( c ) ) {
+            space = true;
+            i++;
+            continue;
+        }
+        size_t start = i;
+        TokenKind kind = SYMBOL;
+        if( isalpha( c ) || c == '_' ) {
+            kind = IDENTIFIER;
+            while( i < text.size() && ( isalnum( text[i] ) || text[i] == '_' ) ) {
+                i++;
+            }
+        }
+        else if( isdigit( c ) || ( c == '.' && i + 1 < text.size() && isdigit( text[i + 1] ) ) ) {
+            kind = NUMBER;
+            bool hex = c == '0' && i + 1 < text.size() && ( text[i + 1] == 'x' || text[i + 1] == 'X' );
+            while( i < text.size() ) {
+                char n = text[i];
+                bool exponent = !hex && ( n == '+' || n == '-' ) && ( text[i - 1] == 'e' || text[i - 1] == 'E' );
+                if( !isalnum( n ) && n != '.' && !exponent ) {
+                    break;
+                }
+                i++;
+            }
+        }
+        else {
+            i++;
+            for( auto &it : symbols ) {
+                if( text.compare( start, it.size(), it ) == 0 ) {
+                    i = start + it.size();
+                    break;
+                }
+            }
+        }
+        tokens.push_back( { kind, text.substr( start, i - start ), line, space } );
+        space = false;
+    }
+    return tokens;
+}
+
+double parseNumber( const string &text )
+{
+    if( text.size() > 2 && text[0] == '0' && ( text[1] == 'x' || text[1] == 'X' ) ) {
+        return double( strtoull( text.c_str() + 2, nullptr, 16 ) );
+    }
+    return strtod( text.c_str(), nullptr );
+}
+
+size_t findClosing( const vector<Token> &tokens, size_t open, size_t end )
+{
+    int depth = 0;
+    for( size_t i = open; i < end; i++ ) {
+        if( tokens[i].mKind != SYMBOL ) {
+            continue;
+        }
+        const string &s = tokens[i].mText;
+        if( s == "(" || s == "[" || s == "{" ) {
+            depth++;
+        }
+        else if( s == ")" || s == "]" || s == "}" ) {
+            if( --depth == 0 ) {
+                return i;
+            }
+        }
+    }
+    return end;
+}
+
+vector<Token> expand( const vector<Token> &tokens, const Macros &macros, const set<string> &disabled, int depth )
+{
+    vector<Token> result;
+    for( size_t i = 0; i < tokens.size(); i++ ) {
+        const Token &token = tokens[i];
+        auto it = token.mKind == IDENTIFIER && depth < 64 && !disabled.count( token.mText ) ? macros.find( token.mText ) : macros.end();
+        if( it == macros.end() ) {
+            result.push_back( token );
+            continue;
+        }
+        const Macro &macro = it->second;
+        vector<Token> body;
+        if( macro.mFunction ) {
+            if( i + 1 >= tokens.size() || tokens[i + 1].mText != "(" ) {
+                result.push_back( token );
+                continue;
+            }
+            size_t close = findClosing( tokens, i + 1, tokens.size() );
+            if( close == tokens.size() ) {
+                result.push_back( token );
+                continue;
+            }
+            vector<vector<Token>> args( 1 );
+            int nested = 0;
+            for( size_t j = i + 2; j < close; j++ ) {
+                const string &s = tokens[j].mText;
+                if( s == "(" || s == "[" || s == "{" ) {
+                    nested++;
+                }
+                else if( s == ")" || s == "]" || s == "}" ) {
+                    nested--;
+                }
+                else if( s == "," && nested == 0 ) {
+                    args.emplace_back();
+                    continue;
+                }
+                args.back().push_back( tokens[j] );
+            }
+            for( auto &arg : args ) {
+                arg = expand( arg, macros, disabled, depth + 1 );
+            }
+            for( auto &part : macro.mBody ) {
+                auto param = find( macro.mParams.begin(), macro.mParams.end(), part.mText );
+                size_t index = param - macro.mParams.begin();
+                if( part.mKind == IDENTIFIER && param != macro.mParams.end() && index < args.size() ) {
+                    body.insert( body.end(), args[index].begin(), args[index].end() );
+                }
+                else if( part.mText != "##" ) {
+                    body.push_back( part );
+                }
+            }
+            i = close;
+        }
+        else {
+            body = macro.mBody;
+        }
+        for( auto &part : body ) {
+            part.mLine = token.mLine;
+        }
+        set<string> inner = disabled;
+        inner.insert( token.mText );
+        auto expanded = expand( body, macros, inner, depth + 1 );
+        result.insert( result.end(), expanded.begin(), expanded.end() );
+    }
+    return result;
+}
+
+// Constant expressions of the preprocessor and of loop headers. Identifiers come from
+// constants, or count as zero in #if, anything else makes the expression not constant.
+class Evaluator {
+  public:
+    Evaluator( const vector<Token> &tokens, size_t begin, size_t end, const map<string, double> *constants )
+        : mTokens( tokens ), mPos( begin ), mEnd( end ), mConstants( constants ) {}
+
+    bool evaluate( double &value )
+    {
+        value = parse( 0 );
+        return !mFailed && mPos == mEnd;
+    }
+
+  protected:
+    const string &peek() const
+    {
+        static const string none;
+        return mPos < mEnd ? mTokens[mPos].mText : none;
+    }
+
+    static int precedence( const string &op )
+    {
+        static const map<string, int> table = {
+            { "||", 1 }, { "&&", 2 }, { "|", 3 }, { "^", 4 }, { "&", 5 }, { "==", 6 }, { "!=", 6 },
+            { "<", 7 }, { ">", 7 }, { "<=", 7 }, { ">=", 7 }, { "<<", 8 }, { ">>", 8 }, { "+", 9 },
+            { "-", 9 }, { "*", 10 }, { "/", 10 }, { "%", 10 }
+        };
+        auto it = table.find( op );
+        return it != table.end() ? it->second : -1;
+    }
+
+    double parse( int minimum )
+    {
+        double left = unary();
+        while( !mFailed && mPos < mEnd ) {
+            string op = peek();
+            int prec = precedence( op );
+            if( prec < 0 || prec < minimum ) {
+                break;
+            }
+            mPos++;
+            double right = parse( prec + 1 );
+            left = apply( op, left, right );
+        }
+        return left;
+    }
+
+    double apply( const string &op, double a, double b )
+    {
+        if( op == "||" ) return a != 0.0 || b != 0.0;
+        if( op == "&&" ) return a != 0.0 && b != 0.0;
+        if( op == "|" ) return double( int64_t( a ) | int64_t( b ) );
+        if( op == "^" ) return double( int64_t( a ) ^ int64_t( b ) );
+        if( op == "&" ) return double( int64_t( a ) & int64_t( b ) );
+        if( op == "==" ) return a == b;
+        if( op == "!=" ) return a != b;
+        if( op == "<" ) return a < b;
+        if( op == ">" ) return a > b;
+        if( op == "<=" ) return a <= b;
+        if( op == ">=" ) return a >= b;
+        if( op == "<<" ) return double( int64_t( a ) << int64_t( b ) );
+        if( op == ">>" ) return double( int64_t( a ) >> int64_t( b ) );
+        if( op == "+" ) return a + b;
+        if( op == "-" ) return a - b;
+        if( op == "*" ) return a * b;
+        if( b == 0.0 ) {
+            mFailed = true;
+            return 0.0;
+        }
+        if( op == "/" ) return a / b;
+        return fmod( a, b );
+    }
+
+    double unary()
+    {
+        if( mPos >= mEnd ) {
+            mFailed = true;
+            return 0.0;
+        }
+        const Token &token = mTokens[mPos++];
+        const string &s = token.mText;
+        if( s == "!" ) return unary() == 0.0;
+        if( s == "-" ) return -unary();
+        if( s == "+" ) return unary();
+        if( s == "~" ) return double( ~int64_t( unary() ) );
+        if( s == "(" ) {
+            double value = parse( 0 );
+            expect( ")" );
+            return value;
+        }
+        if( token.mKind == NUMBER ) {
+            return parseNumber( s );
+        }
+        if( token.mKind != IDENTIFIER ) {
+            mFailed = true;
+            return 0.0;
+        }
+        if( peek() == "(" && ( s == "int" || s == "uint" || s == "float" || s == "min" || s == "max" || s == "abs" || s == "floor" || s == "ceil" ) ) {
+            mPos++;
+            double a = parse( 0 );
+            double b = 0.0;
+            bool pair = s == "min" || s == "max";
+            if( pair ) {
+                expect( "," );
+                b = parse( 0 );
+            }
+            expect( ")" );
+            if( s == "int" || s == "uint" ) return double( int64_t( a ) );
+            if( s == "min" ) return std::min( a, b );
+            if( s == "max" ) return std::max( a, b );
+            if( s == "abs" ) return fabs( a );
+            if( s == "floor" ) return floor( a );
+            if( s == "ceil" ) return ceil( a );
+            return a;
+        }
+        if( s == "true" ) return 1.0;
+        if( s == "false" ) return 0.0;
+        if( !mConstants ) {
+            return 0.0;
+        }
+        auto it = mConstants->find( s );
+        if( it == mConstants->end() ) {
+            mFailed = true;
+            return 0.0;
+        }
+        return it->second;
+    }
+
+    void expect( const string &text )
+    {
+        if( peek() != text ) {
+            mFailed = true;
+            return;
+        }
+        mPos++;
+    }
+
+    const vector<Token> &mTokens;
+    size_t mPos;
+    size_t mEnd;
+    const map<string, double> *mConstants;
+    bool mFailed = false;
+};
+
+bool evaluate( const vector<Token> &tokens, size_t begin, size_t end, const map<string, double> *constants, double &value )
+{
+    if( begin >= end ) {
+        return false;
+    }
+    return Evaluator( tokens, begin, end, constants ).evaluate( value );
+}
+
+void define( Macros &macros, const vector<Token> &tokens, size_t start )
+{
+    if( start >= tokens.size() || tokens[start].mKind != IDENTIFIER ) {
+        return;
+    }
+    Macro macro;
+    size_t body = start + 1;
+    // A function like macro has its parenthesis right after the name
+    if( body < tokens.size() && tokens[body].mText == "(" && !tokens[body].mSpaceBefore ) {
+        macro.mFunction = true;
+        for( body++; body < tokens.size() && tokens[body].mText != ")"; body++ ) {
+            if( tokens[body].mKind == IDENTIFIER ) {
+                macro.mParams.push_back( tokens[body].mText );
+            }
+        }
+        body++;
+    }
+    if( body < tokens.size() ) {
+        macro.mBody.assign( tokens.begin() + body, tokens.end() );
+    }
+    macros[tokens[start].mText] = macro;
+}
+
+bool evaluateIf( const vector<Token> &tokens, const Macros &macros )
+{
+    vector<Token> replaced;
+    for( size_t i = 2; i < tokens.size(); i++ ) {
+        if( tokens[i].mText != "defined" ) {
+            replaced.push_back( tokens[i] );
+            continue;
+        }
+        bool paren = i + 1 < tokens.size() && tokens[i + 1].mText == "(";
+        size_t name = i + ( paren ? 2 : 1 );
+        bool found = name < tokens.size() && macros.count( tokens[name].mText );
+        replaced.push_back( { NUMBER, found ? "1" : "0", tokens[i].mLine, true } );
+        i = name + ( paren ? 1 : 0 );
+    }
+    replaced = expand( replaced, macros, set<string>(), 0 );
+    double value = 0.0;
+    return evaluate( replaced, 0, replaced.size(), nullptr, value ) && value != 0.0;
+}
+
+vector<Token> preprocess( const string &source, const vector<string> &defines )
+{
+    Macros macros;
+    for( auto &it : defines ) {
+        define( macros, tokenize( it, 0 ), 0 );
+    }
+
+    struct Branch {
+        bool mParent;
+        bool mActive;
+        bool mTaken;
+    };
+    vector<Branch> branches;
+    auto active = [&branches]() { return branches.empty() || branches.back().mActive; };
+
+    vector<Token> result;
+    istringstream stream( stripComments( source ) );
+    string text;
+    int line = 0;
+    while( getline( stream, text ) ) {
+        line++;
+        int first = line;
+        while( !text.empty() && text.back() == '\\' && stream ) {
+            string next;
+            getline( stream, next );
+            text.back() = ' ';
+            text += next;
+            line++;
+        }
+        auto tokens = tokenize( text, first );
+        if( tokens.empty() ) {
+            continue;
+        }
+        if( tokens[0].mText != "#" ) {
+            if( active() ) {
+                auto expanded = expand( tokens, macros, set<string>(), 0 );
+                result.insert( result.end(), expanded.begin(), expanded.end() );
+            }
+            continue;
+        }
+        string directive = tokens.size() > 1 ? tokens[1].mText : "";
+        if( directive == "ifdef" || directive == "ifndef" ) {
+            bool found = tokens.size() > 2 && macros.count( tokens[2].mText );
+            bool value = directive == "ifdef" ? found : !found;
+            branches.push_back( { active(), active() && value, value } );
+        }
+        else if( directive == "if" ) {
+            bool value = active() && evaluateIf( tokens, macros );
+            branches.push_back( { active(), value, value } );
+        }
+        else if( directive == "elif" && !branches.empty() ) {
+            Branch &branch = branches.back();
+            bool value = !branch.mTaken && branch.mParent && evaluateIf( tokens, macros );
+            branch.mActive = value;
+            branch.mTaken = branch.mTaken || value;
+        }
+        else if( directive == "else" && !branches.empty() ) {
+            Branch &branch = branches.back();
+            branch.mActive = branch.mParent && !branch.mTaken;
+            branch.mTaken = true;
+        }
+        else if( directive == "endif" && !branches.empty() ) {
+            branches.pop_back();
+        }
+        else if( !active() ) {
+            continue;
+        }
+        else if( directive == "define" ) {
+            define( macros, tokens, 2 );
+        }
+        else if( directive == "undef" && tokens.size() > 2 ) {
+            macros.erase( tokens[2].mText );
+        }
+        else if( directive == "line" && tokens.size() > 2 && tokens[2].mKind == NUMBER ) {
+            line = int( parseNumber( tokens[2].mText ) ) - 1;
+        }
+    }
+    return result;
+}
+
+string formatCount( double value )
+{
+    ostringstream stream;
+    stream.setf( ios::fixed );
+    if( value >= 1e6 ) {
+        stream.precision( 1 );
+        stream << value / 1e6 << "M";
+    }
+    else if( value >= 1e4 ) {
+        stream.precision( 1 );
+        stream << value / 1e3 << "K";
+    }
+    else {
+        stream.precision( value < 10.0 && value != floor( value ) ? 1 : 0 );
+        stream << value;
+    }
+    return stream.str();
+}
+
+// Walks function bodies, one instance per shader
+class Counter {
+  public:
+    struct Body {
+        string mName;
+        string mDisplayName;
+        size_t mArity;
+        size_t mBegin;
+        size_t mEnd;
+        int mLine;
+        double mAlu = 0.0;
+        double mTexture = 0.0;
+        map<size_t, double> mCalls;
+    };
+
+    Counter( const vector<Token> &tokens )
+        : mTokens( tokens )
+    {
+        parseGlobals();
+        auto globals = mConstants;
+        for( size_t i = 0; i < mBodies.size(); i++ ) {
+            mCurrent = i;
+            mConstants = globals;
+            walk( mBodies[i].mBegin, mBodies[i].mEnd, 1.0 );
+        }
+    }
+
+    vector<Body> mBodies;
+    vector<ShaderAnalysis::Loop> mLoops;
+    vector<size_t> mLoopOwners;
+    // Function, builtin -> worst loop multiplier and its line
+    map<pair<size_t, string>, pair<double, int>> mExpensive;
+
+  protected:
+    const Token *at( size_t i ) const { return i < mTokens.size() ? &mTokens[i] : nullptr; }
+    bool is( size_t i, const string &text ) const { return i < mTokens.size() && mTokens[i].mText == text; }
+
+    void parseGlobals()
+    {
+        map<string, size_t> overloads;
+        for( size_t i = 0; i < mTokens.size(); i++ ) {
+            const Token &token = mTokens[i];
+            if( token.mText == "{" ) {
+                i = findClosing( mTokens, i, mTokens.size() );
+                continue;
+            }
+            if( token.mText == "struct" && at( i + 1 ) ) {
+                mStructs.insert( mTokens[i + 1].mText );
+                continue;
+            }
+            if( token.mText == "const" ) {
+                i = parseConstant( i );
+                continue;
+            }
+            // type name ( params ) { body }
+            if( token.mKind != IDENTIFIER || !is( i + 1, "(" ) || i == 0 || mTokens[i - 1].mKind != IDENTIFIER ) {
+                continue;
+            }
+            size_t close = findClosing( mTokens, i + 1, mTokens.size() );
+            if( !is( close + 1, "{" ) ) {
+                i = close;
+                continue;
+            }
+            Body body;
+            body.mName = token.mText;
+            body.mLine = token.mLine;
+            body.mBegin = close + 2;
+            body.mEnd = findClosing( mTokens, close + 1, mTokens.size() );
+            string types;
+            body.mArity = 0;
+            bool expectType = true;
+            for( size_t p = i + 2; p < close; p++ ) {
+                const string &s = mTokens[p].mText;
+                if( s == "," ) {
+                    expectType = true;
+                }
+                else if( expectType && mTokens[p].mKind == IDENTIFIER && !kKeywords.count( s ) ) {
+                    types += ( body.mArity ? "," : "" ) + s;
+                    body.mArity++;
+                    expectType = false;
+                }
+                else if( expectType && isType( s ) && s != "void" ) {
+                    types += ( body.mArity ? "," : "" ) + s;
+                    body.mArity++;
+                    expectType = false;
+                }
+            }
+            body.mDisplayName = body.mName + "(" + types + ")";
+            overloads[body.mName]++;
+            mBodies.push_back( body );
+            i = body.mEnd;
+        }
+        // Only overloaded functions need their parameters to tell them apart
+        for( auto &it : mBodies ) {
+            if( overloads[it.mName] == 1 ) {
+                it.mDisplayName = it.mName;
+            }
+        }
+    }
+
+    // const type name = expression ; returns the index of the semicolon
+    size_t parseConstant( size_t i )
+    {
+        size_t end = i;
+        while( end < mTokens.size() && mTokens[end].mText != ";" ) {
+            end++;
+        }
+        for( size_t p = i + 1; p + 1 < end; p++ ) {
+            if( mTokens[p].mKind == IDENTIFIER && mTokens[p + 1].mText == "=" ) {
+                double value;
+                if( evaluate( mTokens, p + 2, end, &mConstants, value ) ) {
+                    mConstants[mTokens[p].mText] = value;
+                }
+                break;
+            }
+        }
+        return end;
+    }
+
+    size_t resolve( const string &name, size_t arity ) const
+    {
+        size_t found = mBodies.size();
+        for( size_t i = 0; i < mBodies.size(); i++ ) {
+            if( mBodies[i].mName == name ) {
+                if( mBodies[i].mArity == arity ) {
+                    return i;
+                }
+                found = found == mBodies.size() ? i : found;
+            }
+        }
+        return found;
+    }
+
+    size_t countArguments( size_t open, size_t close ) const
+    {
+        if( close == open + 1 ) {
+            return 0;
+        }
+        size_t count = 1;
+        int depth = 0;
+        for( size_t i = open + 1; i < close; i++ ) {
+            const string &s = mTokens[i].mText;
+            if( s == "(" || s == "[" || s == "{" ) {
+                depth++;
+            }
+            else if( s == ")" || s == "]" || s == "}" ) {
+                depth--;
+            }
+            else if( s == "," && depth == 0 ) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    // One past the end of the statement starting at i
+    size_t statementEnd( size_t i, size_t end ) const
+    {
+        if( i >= end ) {
+            return end;
+        }
+        const string &s = mTokens[i].mText;
+        if( s == "{" ) {
+            return std::min( findClosing( mTokens, i, end ) + 1, end );
+        }
+        if( s == "for" || s == "while" || s == "if" || s == "switch" ) {
+            size_t close = findClosing( mTokens, i + 1, end );
+            size_t next = statementEnd( close + 1, end );
+            if( s == "if" && is( next, "else" ) && next < end ) {
+                return statementEnd( next + 1, end );
+            }
+            return next;
+        }
+        if( s == "do" ) {
+            size_t next = statementEnd( i + 1, end );
+            size_t close = findClosing( mTokens, next + 1, end );
+            return std::min( close + 2, end );
+        }
+        int depth = 0;
+        for( size_t j = i; j < end; j++ ) {
+            const string &t = mTokens[j].mText;
+            if( t == "(" || t == "[" || t == "{" ) {
+                depth++;
+            }
+            else if( t == ")" || t == "]" || t == "}" ) {
+                depth--;
+            }
+            else if( t == ";" && depth <= 0 ) {
+                return j + 1;
+            }
+        }
+        return end;
+    }
+
+    // Trips of for( init; condition; increment ), false if they aren't constant
+    bool countTrips( size_t open, size_t close, double &trips ) const
+    {
+        vector<size_t> semicolons;
+        int depth = 0;
+        for( size_t i = open + 1; i < close; i++ ) {
+            const string &s = mTokens[i].mText;
+            depth += ( s == "(" ) - ( s == ")" );
+            if( s == ";" && depth == 0 ) {
+                semicolons.push_back( i );
+            }
+        }
+        if( semicolons.size() != 2 ) {
+            return false;
+        }
+        // init: [type] var = start
+        size_t assign = open + 1;
+        while( assign < semicolons[0] && mTokens[assign].mText != "=" ) {
+            assign++;
+        }
+        double start;
+        if( assign == semicolons[0] || assign == open + 1 || !evaluate( mTokens, assign + 1, semicolons[0], &mConstants, start ) ) {
+            return false;
+        }
+        const string &var = mTokens[assign - 1].mText;
+
+        // condition: var op limit, the first such clause of an &&
+        string op;
+        double limit = 0.0;
+        bool found = false;
+        size_t clause = semicolons[0] + 1;
+        for( size_t i = clause; i <= semicolons[1] && !found; i++ ) {
+            if( i < semicolons[1] && mTokens[i].mText != "&&" ) {
+                continue;
+            }
+            if( clause + 1 < i && mTokens[clause].mText == var ) {
+                op = mTokens[clause + 1].mText;
+                found = evaluate( mTokens, clause + 2, i, &mConstants, limit );
+            }
+            else if( clause + 1 < i && mTokens[i - 1].mText == var ) {
+                static const map<string, string> flipped = { { "<", ">" }, { ">", "<" }, { "<=", ">=" }, { ">=", "<=" }, { "!=", "!=" } };
+                auto it = flipped.find( mTokens[i - 2].mText );
+                if( it != flipped.end() ) {
+                    op = it->second;
+                    found = evaluate( mTokens, clause, i - 2, &mConstants, limit );
+                }
+            }
+            clause = i + 1;
+        }
+        if( !found ) {
+            return false;
+        }
+
+        // increment: var++, ++var, var--, --var, var += step, var -= step
+        size_t inc = semicolons[1] + 1;
+        double step = 0.0;
+        if( close - inc == 2 && ( mTokens[inc].mText == "++" || mTokens[inc + 1].mText == "++" ) ) {
+            step = 1.0;
+        }
+        else if( close - inc == 2 && ( mTokens[inc].mText == "--" || mTokens[inc + 1].mText == "--" ) ) {
+            step = -1.0;
+        }
+        else if( close - inc > 2 && mTokens[inc].mText == var && ( mTokens[inc + 1].mText == "+=" || mTokens[inc + 1].mText == "-=" ) ) {
+            if( !evaluate( mTokens, inc + 2, close, &mConstants, step ) ) {
+                return false;
+            }
+            step = mTokens[inc + 1].mText == "+=" ? step : -step;
+        }
+        if( step == 0.0 ) {
+            return false;
+        }
+
+        double span = ( limit - start ) / step;
+        if( op == "<" || op == ">" || op == "!=" ) {
+            trips = ceil( span - 1e-9 );
+        }
+        else if( op == "<=" || op == ">=" ) {
+            trips = floor( span + 1e-9 ) + 1.0;
+        }
+        else {
+            return false;
+        }
+        // A loop stepping away from its limit runs until it wraps, call that unknown
+        if( ( ( op == "<" || op == "<=" ) && step < 0.0 ) || ( ( op == ">" || op == ">=" ) && step > 0.0 ) ) {
+            return false;
+        }
+        trips = std::max( trips, 0.0 );
+        return true;
+    }
+
+    void addLoop( int line, double trips, bool constant )
+    {
+        ShaderAnalysis::Loop loop;
+        loop.mFunction = mBodies[mCurrent].mDisplayName;
+        loop.mLine = line;
+        loop.mTrips = trips;
+        loop.mConstant = constant;
+        mLoops.push_back( loop );
+        mLoopOwners.push_back( mCurrent );
+    }
+
+    void walk( size_t begin, size_t end, double multiplier )
+    {
+        Body &body = mBodies[mCurrent];
+        for( size_t i = begin; i < end; i++ ) {
+            const Token &token = mTokens[i];
+            const string &s = token.mText;
+            if( ( s == "for" || s == "while" ) && is( i + 1, "(" ) ) {
+                size_t close = std::min( findClosing( mTokens, i + 1, end ), end );
+                double trips = ShaderAnalysis::kUnknownTrips;
+                bool constant = s == "for" && countTrips( i + 1, close, trips );
+                if( !constant ) {
+                    trips = ShaderAnalysis::kUnknownTrips;
+                }
+                addLoop( token.mLine, trips, constant );
+                size_t bodyEnd = statementEnd( close + 1, end );
+                // The header runs once per trip too, near enough
+                walk( i + 2, close, multiplier * trips );
+                walk( close + 1, bodyEnd, multiplier * trips );
+                i = bodyEnd - 1;
+                continue;
+            }
+            if( s == "do" ) {
+                size_t bodyEnd = statementEnd( i + 1, end );
+                size_t statement = std::max( statementEnd( i, end ), bodyEnd );
+                addLoop( token.mLine, ShaderAnalysis::kUnknownTrips, false );
+                // The body, then the condition after its while
+                walk( i + 1, bodyEnd, multiplier * ShaderAnalysis::kUnknownTrips );
+                walk( bodyEnd + 1, statement, multiplier * ShaderAnalysis::kUnknownTrips );
+                i = statement - 1;
+                continue;
+            }
+            // Locals initialized to a constant count as one until something assigns to them,
+            // that's how most loop bounds are written
+            if( s == "const" || ( isType( s ) && at( i + 1 ) && mTokens[i + 1].mKind == IDENTIFIER && is( i + 2, "=" ) ) ) {
+                parseConstant( i );
+                // Past the name, its initialization isn't an assignment that ends it
+                while( i + 1 < end && mTokens[i].mText != "=" && mTokens[i].mText != ";" ) {
+                    i++;
+                }
+            }
+            else if( token.mKind == IDENTIFIER && mConstants.count( s ) && ( isAssignment( i + 1 ) || ( i > 0 && ( mTokens[i - 1].mText == "++" || mTokens[i - 1].mText == "--" ) ) ) ) {
+                mConstants.erase( s );
+            }
+            if( token.mKind == IDENTIFIER && is( i + 1, "(" ) ) {
+                if( kTextureFunctions.count( s ) ) {
+                    body.mTexture += multiplier;
+                    if( multiplier > 1.0 ) {
+                        noteExpensive( s, multiplier, token.mLine );
+                    }
+                    continue;
+                }
+                auto builtin = kBuiltins.find( s );
+                if( builtin != kBuiltins.end() ) {
+                    body.mAlu += builtin->second * multiplier;
+                    if( multiplier > 1.0 && builtin->second >= kExpensiveBuiltin ) {
+                        noteExpensive( s, multiplier, token.mLine );
+                    }
+                    continue;
+                }
+                if( kKeywords.count( s ) || isType( s ) || mStructs.count( s ) ) {
+                    continue;
+                }
+                size_t close = findClosing( mTokens, i + 1, end );
+                size_t callee = resolve( s, countArguments( i + 1, close ) );
+                if( callee < mBodies.size() ) {
+                    body.mCalls[callee] += multiplier;
+                }
+                continue;
+            }
+            if( token.mKind == SYMBOL && kOperators.count( s ) ) {
+                // Unary plus and minus are free modifiers on the operand
+                if( ( s == "+" || s == "-" ) && i > 0 ) {
+                    const Token &previous = mTokens[i - 1];
+                    bool operand = previous.mKind == NUMBER || ( previous.mKind == IDENTIFIER && !kKeywords.count( previous.mText ) ) || previous.mText == ")" || previous.mText == "]";
+                    if( !operand ) {
+                        continue;
+                    }
+                }
+                body.mAlu += multiplier;
+            }
+        }
+    }
+
+    bool isAssignment( size_t i ) const
+    {
+        static const set<string> assignments = { "=", "+=", "-=", "*=", "/=", "%=", "++", "--", "<<=", ">>=", "&=", "|=", "^=" };
+        return i < mTokens.size() && assignments.count( mTokens[i].mText );
+    }
+
+    void noteExpensive( const string &name, double multiplier, int line )
+    {
+        auto &entry = mExpensive[make_pair( mCurrent, name )];
+        if( multiplier > entry.first ) {
+            entry = make_pair( multiplier, line );
+        }
+    }
+
+    const vector<Token> &mTokens;
+    mutable map<string, double> mConstants;
+    set<string> mStructs;
+    size_t mCurrent = 0;
+};
+
+} // namespace
+
+ShaderAnalysis::ShaderAnalysis( const string &source, const vector<string> &defines )
+    : mDefines( defines )
+{
+    auto tokens = preprocess( source, defines );
+    Counter counter( tokens );
+    auto &bodies = counter.mBodies;
+
+    size_t main = bodies.size();
+    for( size_t i = 0; i < bodies.size(); i++ ) {
+        if( bodies[i].mName == "main" ) {
+            main = i;
+        }
+    }
+    if( main == bodies.size() ) {
+        mWarnings.push_back( "NO MAIN FUNCTION FOUND" );
+        return;
+    }
+
+    // Callers before callees, GLSL has no recursion but a broken shader might
+    vector<size_t> order;
+    vector<int> state( bodies.size(), 0 );
+    function<void( size_t )> visit = [&]( size_t index ) {
+        state[index] = 1;
+        for( auto &it : bodies[index].mCalls ) {
+            if( state[it.first] == 0 ) {
+                visit( it.first );
+            }
+        }
+        state[index] = 2;
+        order.push_back( index );
+    };
+    visit( main );
+    reverse( order.begin(), order.end() );
+    vector<size_t> position( bodies.size(), 0 );
+    for( size_t i = 0; i < order.size(); i++ ) {
+        position[order[i]] = i;
+    }
+
+    vector<double> calls( bodies.size(), 0.0 );
+    calls[main] = 1.0;
+    for( size_t index : order ) {
+        for( auto &it : bodies[index].mCalls ) {
+            if( state[it.first] == 2 && position[it.first] > position[index] ) {
+                calls[it.first] += calls[index] * it.second;
+            }
+        }
+    }
+
+    for( size_t index : order ) {
+        auto &body = bodies[index];
+        Function entry;
+        entry.mName = body.mDisplayName;
+        entry.mLine = body.mLine;
+        entry.mAlu = body.mAlu;
+        entry.mTexture = body.mTexture;
+        entry.mCalls = calls[index];
+        for( auto &it : body.mCalls ) {
+            entry.mFanOut.push_back( make_pair( bodies[it.first].mDisplayName, it.second ) );
+        }
+        sort( entry.mFanOut.begin(), entry.mFanOut.end(), []( const pair<string, double> &a, const pair<string, double> &b ) { return a.second > b.second; } );
+        mCost += entry.mCalls * ( entry.mAlu + entry.mTexture * kTextureWeight );
+        mTextureFetches += entry.mCalls * entry.mTexture;
+        mFunctions.push_back( entry );
+    }
+    for( auto &it : mFunctions ) {
+        it.mShare = mCost > 0.0 ? it.mCalls * ( it.mAlu + it.mTexture * kTextureWeight ) / mCost : 0.0;
+    }
+    stable_sort( mFunctions.begin(), mFunctions.end(), []( const Function &a, const Function &b ) { return a.mShare > b.mShare; } );
+
+    for( size_t i = 0; i < counter.mLoops.size(); i++ ) {
+        auto &loop = counter.mLoops[i];
+        if( calls[counter.mLoopOwners[i]] == 0.0 ) {
+            continue;
+        }
+        mLoops.push_back( loop );
+        if( !loop.mConstant ) {
+            mWarnings.push_back( loop.mFunction + " LINE " + to_string( loop.mLine ) + ": LOOP BOUND NOT CONSTANT, COUNTED AS " + to_string( kUnknownTrips ) );
+        }
+    }
+    for( auto &it : counter.mExpensive ) {
+        if( calls[it.first.first] == 0.0 ) {
+            continue;
+        }
+        mWarnings.push_back( bodies[it.first.first].mDisplayName + " LINE " + to_string( it.second.second ) + ": " + it.first.second + " IN A " + formatCount( it.second.first ) + "x LOOP" );
+    }
+}
+
+vector<string> ShaderAnalysis::getSummary( size_t count ) const
+{
+    vector<string> lines;
+    string cost = "COST: ~" + formatCount( mCost ) + " OPS, " + formatCount( mTextureFetches ) + " TEX PER PIXEL";
+    if( mGpuMilliseconds > 0.0 ) {
+        ostringstream stream;
+        stream.precision( 3 );
+        stream << ", GPU " << mGpuMilliseconds << " MS";
+        cost += stream.str();
+    }
+    lines.push_back( cost );
+    for( size_t i = 0; i < std::min( count, mFunctions.size() ); i++ ) {
+        auto &entry = mFunctions[i];
+        if( entry.mShare < 0.005 ) {
+            break;
+        }
+        ostringstream stream;
+        stream << int( entry.mShare * 100.0 + 0.5 ) << "% " << entry.mName << " x" << formatCount( entry.mCalls );
+        if( mGpuMilliseconds > 0.0 ) {
+            stream.setf( ios::fixed );
+            stream.precision( 2 );
+            stream << " ~" << entry.mShare * mGpuMilliseconds << " MS";
+        }
+        // Where a function multiplies the work, e.g. a normal costing six scene() calls
+        string separator = " -> ";
+        for( auto &it : entry.mFanOut ) {
+            if( it.second >= 2.0 ) {
+                stream << separator << formatCount( it.second ) << "x " << it.first;
+                separator = ", ";
+            }
+        }
+        lines.push_back( stream.str() );
+    }
+    for( auto &it : mWarnings ) {
+        lines.push_back( it );
+    }
+    return lines;
+}
+
+string ShaderAnalysis::serialize() const
+{
+    JsonTree tree;
+    tree.addChild( JsonTree( "COST", mCost ) );
+    tree.addChild( JsonTree( "TEXTURE FETCHES", mTextureFetches ) );
+    tree.addChild( JsonTree( "GPU MS", mGpuMilliseconds ) );
+    JsonTree defines = JsonTree::makeArray( "DEFINES" );
+    for( auto &it : mDefines ) {
+        defines.addChild( JsonTree( "", it ) );
+    }
+    tree.addChild( defines );
+
+    JsonTree functions = JsonTree::makeArray( "FUNCTIONS" );
+    for( auto &it : mFunctions ) {
+        JsonTree function;
+        function.addChild( JsonTree( "NAME", it.mName ) );
+        function.addChild( JsonTree( "LINE", it.mLine ) );
+        function.addChild( JsonTree( "CALLS", it.mCalls ) );
+        function.addChild( JsonTree( "ALU", it.mAlu ) );
+        function.addChild( JsonTree( "TEXTURE", it.mTexture ) );
+        function.addChild( JsonTree( "SHARE", it.mShare ) );
+        function.addChild( JsonTree( "GPU MS", it.mShare * mGpuMilliseconds ) );
+        JsonTree fanOut = JsonTree::makeArray( "FAN OUT" );
+        for( auto &call : it.mFanOut ) {
+            JsonTree callee;
+            callee.addChild( JsonTree( "NAME", call.first ) );
+            callee.addChild( JsonTree( "CALLS", call.second ) );
+            fanOut.addChild( callee );
+        }
+        function.addChild( fanOut );
+        functions.addChild( function );
+    }
+    tree.addChild( functions );
+
+    JsonTree loops = JsonTree::makeArray( "LOOPS" );
+    for( auto &it : mLoops ) {
+        JsonTree loop;
+        loop.addChild( JsonTree( "FUNCTION", it.mFunction ) );
+        loop.addChild( JsonTree( "LINE", it.mLine ) );
+        loop.addChild( JsonTree( "TRIPS", it.mTrips ) );
+        loop.addChild( JsonTree( "CONSTANT", it.mConstant ) );
+        loops.addChild( loop );
+    }
+    tree.addChild( loops );
+
+    JsonTree warnings = JsonTree::makeArray( "WARNINGS" );
+    for( auto &it : mWarnings ) {
+        warnings.addChild( JsonTree( "", it ) );
+    }
+    tree.addChild( warnings );
+    return tree.serialize();
+}
+
+} // namespace analysis
+} // namespace reza
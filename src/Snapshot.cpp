@@ -0,0 +1,164 @@
+#include "Snapshot.h"
+
+#include "cinder/Log.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace snap {
+
+static const char kMagic[4] = { 'F', 'S', 'N', 'P' };
+
+Snapshot::~Snapshot()
+{
+    close();
+}
+
+bool Snapshot::setChunk( uint32_t tag, const string &bytes )
+{
+    auto it = mChunks.find( tag );
+    if( it != mChunks.end() && it->second.mSize == bytes.size() && memcmp( it->second.mData, bytes.data(), bytes.size() ) == 0 ) {
+        return false;
+    }
+    string &owned = mOwned[tag];
+    owned = bytes;
+    mChunks[tag] = { owned.data(), owned.size() };
+    mDirty = true;
+    return true;
+}
+
+ChunkReader Snapshot::getChunk( uint32_t tag ) const
+{
+    auto it = mChunks.find( tag );
+    if( it == mChunks.end() ) {
+        return ChunkReader( nullptr, 0 );
+    }
+    return ChunkReader( it->second.mData, it->second.mSize );
+}
+
+bool Snapshot::save( const fs::path &path )
+{
+    if( !mDirty && path == mPath && fs::exists( path ) ) {
+        return true;
+    }
+
+    // Written next to the destination and renamed over it, so a crash mid-save leaves
+    // the previous snapshot intact
+    string tmp = path.string() + ".tmp";
+    FILE *file = fopen( tmp.c_str(), "wb" );
+    if( file == nullptr ) {
+        CI_LOG_E( "Unable to write snapshot: " << path );
+        return false;
+    }
+    bool ok = fwrite( kMagic, 1, 4, file ) == 4;
+    uint32_t version = kVersion;
+    ok = ok && fwrite( &version, sizeof( version ), 1, file ) == 1;
+    for( auto &it : mChunks ) {
+        uint32_t header[2] = { it.first, uint32_t( it.second.mSize ) };
+        ok = ok && fwrite( header, sizeof( header ), 1, file ) == 1;
+        ok = ok && fwrite( it.second.mData, 1, it.second.mSize, file ) == it.second.mSize;
+    }
+    ok = fflush( file ) == 0 && ok;
+    ok = fsync( fileno( file ) ) == 0 && ok;
+    ok = fclose( file ) == 0 && ok;
+    if( !ok || rename( tmp.c_str(), path.string().c_str() ) != 0 ) {
+        CI_LOG_E( "Unable to write snapshot: " << path );
+        remove( tmp.c_str() );
+        return false;
+    }
+    mDirty = false;
+    mPath = path;
+    return true;
+}
+
+bool Snapshot::load( const fs::path &path )
+{
+    clear();
+
+    int fd = open( path.string().c_str(), O_RDONLY );
+    if( fd < 0 ) {
+        return false;
+    }
+    struct stat info;
+    if( fstat( fd, &info ) != 0 || info.st_size < 8 ) {
+        ::close( fd );
+        return false;
+    }
+    size_t size = size_t( info.st_size );
+    void *mapping = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+    if( mapping == MAP_FAILED ) {
+        CI_LOG_E( "Unable to map snapshot: " << path );
+        return false;
+    }
+    mMapping = mapping;
+    mMappingSize = size;
+
+    const char *data = static_cast<const char *>( mapping );
+    uint32_t version = 0;
+    memcpy( &version, data + 4, sizeof( version ) );
+    if( memcmp( data, kMagic, 4 ) != 0 || version > kVersion ) {
+        CI_LOG_E( "Unsupported snapshot: " << path );
+        close();
+        return false;
+    }
+
+    // Chunks point straight into the mapping, nothing is copied until it is read
+    const char *ptr = data + 8;
+    const char *end = data + size;
+    while( size_t( end - ptr ) >= 8 ) {
+        uint32_t header[2];
+        memcpy( header, ptr, sizeof( header ) );
+        ptr += sizeof( header );
+        if( size_t( end - ptr ) < header[1] ) {
+            break;
+        }
+        mChunks[header[0]] = { ptr, header[1] };
+        ptr += header[1];
+    }
+    // A file cut off inside a chunk isn't loaded at all, and stays dirty so the next save rewrites it
+    if( ptr != end ) {
+        CI_LOG_E( "Truncated snapshot: " << path );
+        clear();
+        return false;
+    }
+    mPath = path;
+    mDirty = false;
+    return true;
+}
+
+void Snapshot::clear()
+{
+    close();
+    mChunks.clear();
+    mOwned.clear();
+    mDirty = true;
+    mPath.clear();
+}
+
+void Snapshot::close()
+{
+    if( mMapping != nullptr ) {
+        // Chunks that still point into the mapping are copied out before it goes away
+        for( auto &it : mChunks ) {
+            if( mOwned.find( it.first ) == mOwned.end() ) {
+                string &owned = mOwned[it.first];
+                owned.assign( it.second.mData, it.second.mSize );
+                it.second = { owned.data(), owned.size() };
+            }
+        }
+        munmap( mMapping, mMappingSize );
+        mMapping = nullptr;
+        mMappingSize = 0;
+    }
+}
+
+} // namespace snap
+} // namespace reza
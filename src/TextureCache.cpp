@@ -0,0 +1,231 @@
+#include "TextureCache.h"
+
+#include "cinder/ImageIo.h"
+#include "cinder/Log.h"
+#include "cinder/gl/scoped.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace tex {
+
+TextureCache::TextureCache( int numThreads )
+{
+    for( int i = 0; i < std::max( numThreads, 1 ); i++ ) {
+        mThreads.push_back( thread( &TextureCache::run, this ) );
+    }
+}
+
+TextureCache::~TextureCache()
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        mRunning = false;
+    }
+    mJobsCondition.notify_all();
+    for( auto &it : mThreads ) {
+        it.join();
+    }
+}
+
+gl::Texture2dRef TextureCache::get( const fs::path &path, bool wait )
+{
+    string key = path.string();
+    time_t modified = getModified( key, path, wait );
+    auto it = mTextures.find( key );
+    if( it != mTextures.end() && it->second.mModified == modified ) {
+        it->second.mLastUsed = mFrame;
+        return it->second.mTexture;
+    }
+    // A file that didn't decode is tried again once it's written to
+    auto failed = mFailed.find( key );
+    if( failed != mFailed.end() && failed->second == modified ) {
+        return it != mTextures.end() ? it->second.mTexture : nullptr;
+    }
+
+    request( key, path, modified );
+    if( wait ) {
+        {
+            unique_lock<mutex> lock( mMutex );
+            mResultsCondition.wait( lock, [this, &key] {
+                return std::find_if( mResults.begin(), mResults.end(), [&key]( const pair<string, Surface8uRef> &r ) { return r.first == key; } ) != mResults.end();
+            } );
+        }
+        update();
+        it = mTextures.find( key );
+    }
+
+    // While a changed file reloads the stale texture keeps being used
+    if( it != mTextures.end() ) {
+        it->second.mLastUsed = mFrame;
+        return it->second.mTexture;
+    }
+    return nullptr;
+}
+
+void TextureCache::prefetch( const fs::path &path )
+{
+    string key = path.string();
+    if( mTextures.find( key ) == mTextures.end() && mFailed.find( key ) == mFailed.end() ) {
+        request( key, path, getModified( key, path ) );
+    }
+}
+
+time_t TextureCache::getModified( const string &key, const fs::path &path, bool force )
+{
+    auto now = chrono::steady_clock::now();
+    auto it = mModified.find( key );
+    if( it != mModified.end() && !force && now - it->second.first < chrono::seconds( 1 ) ) {
+        return it->second.second;
+    }
+    time_t modified = fs::exists( path ) ? fs::last_write_time( path ) : 0;
+    mModified[key] = make_pair( now, modified );
+    return modified;
+}
+
+void TextureCache::request( const string &key, const fs::path &path, time_t modified )
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        if( mPending.find( key ) != mPending.end() ) {
+            return;
+        }
+        mPending[key] = modified;
+        mJobs.push_back( make_pair( key, path ) );
+    }
+    mJobsCondition.notify_one();
+}
+
+void TextureCache::run()
+{
+    while( true ) {
+        pair<string, fs::path> job;
+        {
+            unique_lock<mutex> lock( mMutex );
+            mJobsCondition.wait( lock, [this] { return !mRunning || !mJobs.empty(); } );
+            if( !mRunning ) {
+                return;
+            }
+            job = mJobs.front();
+            mJobs.pop_front();
+        }
+
+        Surface8uRef surface = nullptr;
+        try {
+            surface = Surface8u::create( loadImage( job.second ), SurfaceConstraintsDefault(), true );
+        }
+        catch( const std::exception &exc ) {
+            CI_LOG_E( "Error loading image: " << job.second << " " << exc.what() );
+        }
+
+        {
+            lock_guard<mutex> lock( mMutex );
+            mResults.push_back( make_pair( job.first, surface ) );
+        }
+        mResultsCondition.notify_all();
+    }
+}
+
+bool TextureCache::update()
+{
+    mFrame++;
+    vector<pair<string, Surface8uRef>> results;
+    map<string, time_t> modified;
+    {
+        lock_guard<mutex> lock( mMutex );
+        results.swap( mResults );
+        for( auto &it : results ) {
+            modified[it.first] = mPending[it.first];
+            mPending.erase( it.first );
+        }
+    }
+    bool uploaded = false;
+    for( auto &it : results ) {
+        if( it.second ) {
+            upload( it.first, it.second );
+            mTextures[it.first].mModified = modified[it.first];
+            mFailed.erase( it.first );
+            uploaded = true;
+        }
+        else {
+            mFailed[it.first] = modified[it.first];
+        }
+    }
+    if( !results.empty() ) {
+        evict();
+    }
+    return uploaded;
+}
+
+void TextureCache::upload( const string &key, const Surface8uRef &surface )
+{
+    int width = surface->getWidth();
+    int height = surface->getHeight();
+    size_t rowBytes = size_t( width ) * 4;
+    size_t bytes = rowBytes * height;
+
+    if( !mPboRef || size_t( mPboRef->getSize() ) < bytes ) {
+        mPboRef = gl::Pbo::create( GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW );
+    }
+
+    gl::ScopedBuffer scpBuffer( mPboRef );
+    // Orphaning the storage keeps us from stalling on an upload that is still in flight
+    mPboRef->bufferData( mPboRef->getSize(), nullptr, GL_STREAM_DRAW );
+    uint8_t *dst = static_cast<uint8_t *>( mPboRef->mapBufferRange( 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT ) );
+    if( dst == nullptr ) {
+        CI_LOG_E( "Unable to map upload buffer for: " << key );
+        return;
+    }
+    // Rows go in bottom up so texture space matches vTexcoord
+    for( int y = 0; y < height; y++ ) {
+        memcpy( dst + ( height - 1 - y ) * rowBytes, surface->getData( ivec2( 0, y ) ), rowBytes );
+    }
+    mPboRef->unmap();
+
+    Entry &entry = mTextures[key];
+    if( !entry.mTexture || entry.mTexture->getWidth() != width || entry.mTexture->getHeight() != height ) {
+        auto fmt = gl::Texture2d::Format().internalFormat( GL_RGBA8 ).mipmap().minFilter( GL_LINEAR_MIPMAP_LINEAR ).magFilter( GL_LINEAR ).wrap( GL_REPEAT );
+        mByteSize -= entry.mTexture ? entry.mBytes : 0;
+        entry.mTexture = gl::Texture2d::create( width, height, fmt );
+        entry.mBytes = bytes + bytes / 3;
+        mByteSize += entry.mBytes;
+    }
+    entry.mTexture->update( mPboRef, GL_RGBA, GL_UNSIGNED_BYTE );
+    {
+        gl::ScopedTextureBind scpTex( entry.mTexture );
+        glGenerateMipmap( GL_TEXTURE_2D );
+    }
+    entry.mLastUsed = mFrame;
+}
+
+void TextureCache::evict()
+{
+    while( mByteSize > mByteBudget && mTextures.size() > 1 ) {
+        auto oldest = mTextures.begin();
+        for( auto it = mTextures.begin(); it != mTextures.end(); ++it ) {
+            if( it->second.mLastUsed < oldest->second.mLastUsed ) {
+                oldest = it;
+            }
+        }
+        if( oldest->second.mLastUsed >= mFrame ) {
+            break;
+        }
+        mByteSize -= oldest->second.mBytes;
+        mTextures.erase( oldest );
+    }
+}
+
+void TextureCache::clear()
+{
+    mTextures.clear();
+    mFailed.clear();
+    mModified.clear();
+    mByteSize = 0;
+}
+
+} // namespace tex
+} // namespace reza
@@ -0,0 +1,431 @@
+#include "ThumbnailCache.h"
+
+#include "cinder/ImageIo.h"
+#include "cinder/Json.h"
+#include "cinder/Log.h"
+#include "cinder/Thread.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/ShaderPreprocessor.h"
+#include "cinder/gl/gl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <regex>
+#include <set>
+#include <sstream>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace thumb {
+
+// Seconds of iGlobalTime the frames of a strip are spread over
+static const float kSeconds = 4.0f;
+// Pause after each frame, so the worker never holds the GPU for long
+static const chrono::milliseconds kYield( 30 );
+
+namespace {
+
+// Stable across runs and builds, unlike std::hash
+uint64_t fnv1a( const string &data, uint64_t h = 14695981039346656037ull )
+{
+    for( unsigned char c : data ) {
+        h = ( h ^ c ) * 1099511628211ull;
+    }
+    return h;
+}
+
+// Newest modification time of the files a thumbnail is made from
+time_t getSessionTime( const fs::path &session )
+{
+    time_t newest = 0;
+    if( fs::exists( session / "params.json" ) ) {
+        newest = fs::last_write_time( session / "params.json" );
+    }
+    if( fs::exists( session / "Shaders" ) ) {
+        for( fs::recursive_directory_iterator it( session / "Shaders" ), end; it != end; ++it ) {
+            newest = std::max( newest, fs::last_write_time( it->path() ) );
+        }
+    }
+    return newest;
+}
+
+string readFile( const fs::path &path )
+{
+    ifstream stream( path.string(), ios::binary );
+    stringstream buffer;
+    buffer << stream.rdbuf();
+    return buffer.str();
+}
+
+template <typename T>
+void setUniform( const gl::GlslProgRef &glsl, const set<string> &active, const string &name, const T &value )
+{
+    if( active.count( name ) ) {
+        glsl->uniform( name, value );
+    }
+}
+
+// Widget values as saveUI writes them: sliders, dialers and toggles have a VALUE, ranges
+// LVALUE and HVALUE, pads XVALUE and YVALUE, multisliders a key per component
+vector<float> getWidgetValues( const JsonTree &view )
+{
+    vector<float> values;
+    auto add = [&]( const string &key ) {
+        if( view.hasChild( key ) ) {
+            values.push_back( view.getValueForKey<float>( key ) );
+            return true;
+        }
+        return false;
+    };
+    string type = view.getValueForKey( "TYPE" );
+    string name = view.getValueForKey( "NAME" );
+    if( type == "Range" ) {
+        add( "LVALUE" );
+        add( "HVALUE" );
+    }
+    else if( type == "XYPad" ) {
+        add( "XVALUE" );
+        add( "YVALUE" );
+    }
+    else if( type == "ColorPicker" ) {
+        add( "RED" );
+        add( "GREEN" );
+        add( "BLUE" );
+        add( "ALPHA" );
+    }
+    else if( type == "MultiSlider" ) {
+        for( auto &suffix : { "-X", "-Y", "-Z", "-W" } ) {
+            if( !add( name + suffix ) ) {
+                break;
+            }
+        }
+        if( values.empty() ) {
+            add( name );
+        }
+    }
+    else {
+        add( "VALUE" );
+    }
+    return values;
+}
+
+} // namespace
+
+ThumbnailCache::ThumbnailCache( const fs::path &directory, const fs::path &includes, int size, const CompileFn &compileFn )
+    : mDirectory( directory ), mIncludes( includes ), mSize( size ), mCompileFn( compileFn )
+{
+    if( !fs::exists( mDirectory ) ) {
+        fs::create_directories( mDirectory );
+    }
+    mContextRef = gl::Context::create( gl::context() );
+    mThread = thread( &ThumbnailCache::run, this );
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        mRunning = false;
+    }
+    mCondition.notify_all();
+    mThread.join();
+}
+
+void ThumbnailCache::setEnvironment( const Environment &environment )
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        mEnvironment = environment;
+        if( mEnvironment.mNoiseTextures ) {
+            mJobs.insert( mJobs.end(), mWaiting.begin(), mWaiting.end() );
+            mWaiting.clear();
+        }
+    }
+    mCondition.notify_all();
+}
+
+void ThumbnailCache::request( const string &key, const fs::path &session, bool urgent )
+{
+    // The browser asks again on every rebuild, a key queued or done with these same files
+    // only ever moves up the queue
+    time_t time = getSessionTime( session );
+    auto requested = mRequested.find( key );
+    bool unchanged = requested != mRequested.end() && requested->second == time;
+    if( unchanged && !urgent ) {
+        return;
+    }
+    mRequested[key] = time;
+    {
+        lock_guard<mutex> lock( mMutex );
+        auto it = find_if( mJobs.begin(), mJobs.end(), [&key]( const Job &job ) { return job.mKey == key; } );
+        if( it != mJobs.end() ) {
+            if( !urgent ) {
+                return;
+            }
+            mJobs.erase( it );
+        }
+        else if( unchanged ) {
+            return;
+        }
+        if( urgent ) {
+            mJobs.push_front( { key, session } );
+        }
+        else {
+            mJobs.push_back( { key, session } );
+        }
+    }
+    mCondition.notify_all();
+}
+
+void ThumbnailCache::setPaused( bool paused )
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        if( paused == mPaused ) {
+            return;
+        }
+        mPaused = paused;
+    }
+    mCondition.notify_all();
+}
+
+bool ThumbnailCache::update()
+{
+    vector<pair<string, Surface8uRef>> results;
+    {
+        lock_guard<mutex> lock( mMutex );
+        results.swap( mResults );
+    }
+    for( auto &it : results ) {
+        mTextures[it.first] = gl::Texture2d::create( *it.second, gl::Texture2d::Format().minFilter( GL_LINEAR ).magFilter( GL_LINEAR ) );
+    }
+    return !results.empty();
+}
+
+bool ThumbnailCache::isWaitingForNoise()
+{
+    lock_guard<mutex> lock( mMutex );
+    return !mWaiting.empty();
+}
+
+gl::Texture2dRef ThumbnailCache::get( const string &key ) const
+{
+    auto it = mTextures.find( key );
+    return it != mTextures.end() ? it->second : nullptr;
+}
+
+void ThumbnailCache::run()
+{
+    ThreadSetup threadSetup;
+    mContextRef->makeCurrent();
+    while( true ) {
+        Job job;
+        {
+            unique_lock<mutex> lock( mMutex );
+            mCondition.wait( lock, [this] { return !mRunning || ( !mPaused && !mJobs.empty() ); } );
+            if( !mRunning ) {
+                return;
+            }
+            job = mJobs.front();
+            mJobs.pop_front();
+        }
+        bool complete = true;
+        auto surface = make( job.mSession, complete );
+        if( surface ) {
+            lock_guard<mutex> lock( mMutex );
+            mResults.push_back( { job.mKey, surface } );
+            // The noise may have come in while this one was drawn without it
+            if( !complete ) {
+                if( mEnvironment.mNoiseTextures ) {
+                    mJobs.push_back( job );
+                }
+                else {
+                    mWaiting.push_back( job );
+                }
+            }
+        }
+    }
+}
+
+Surface8uRef ThumbnailCache::make( const fs::path &session, bool &complete )
+{
+    // A session's includes are its own, the shared ones only fill in what it doesn't have
+    fs::path shaders = session / "Shaders";
+    gl::ShaderPreprocessor preprocessor;
+    preprocessor.addSearchDirectory( shaders );
+    preprocessor.addSearchDirectory( shaders / "Common" );
+    preprocessor.addSearchDirectory( mIncludes );
+    vector<string> sources;
+    try {
+        for( auto &name : { "shader.vert", "shader.frag" } ) {
+            string source = preprocessor.parse( shaders / name );
+            if( source.compare( 0, 8, "#version" ) != 0 ) {
+                source = "#version 150\n" + source;
+            }
+            sources.push_back( source );
+        }
+    }
+    catch( const ci::Exception &exc ) {
+        CI_LOG_E( "Unable to read thumbnail shaders of " << session << ": " << exc.what() );
+        return nullptr;
+    }
+    string params = readFile( session / "params.json" );
+
+    uint64_t h = fnv1a( to_string( mSize ) + "x" + to_string( kFrames ) );
+    for( auto &it : { sources[0], sources[1], params } ) {
+        h = fnv1a( it + '\0', h );
+    }
+    char name[32];
+    snprintf( name, sizeof( name ), "%016llx.png", static_cast<unsigned long long>( h ) );
+    fs::path path = mDirectory / name;
+    if( fs::exists( path ) ) {
+        try {
+            return Surface8u::create( loadImage( path ) );
+        }
+        catch( const ci::Exception &exc ) {
+            CI_LOG_W( "Rendering thumbnail again, unable to load " << path << ": " << exc.what() );
+        }
+    }
+
+    Environment environment;
+    {
+        lock_guard<mutex> lock( mMutex );
+        environment = mEnvironment;
+    }
+    // The hash only covers the session, so a thumbnail missing part of the environment is
+    // never written where it would be taken as done
+    auto surface = render( sources, params, environment, complete );
+    if( surface && complete ) {
+        try {
+            writeImage( path, *surface );
+        }
+        catch( const ci::Exception &exc ) {
+            CI_LOG_E( "Unable to write thumbnail " << path << ": " << exc.what() );
+        }
+    }
+    return surface;
+}
+
+Surface8uRef ThumbnailCache::render( const vector<string> &sources, const string &params, const Environment &environment, bool &complete )
+{
+    auto glsl = mCompileFn( sources, { "FRAGMENT_QUALITY 0" } );
+    if( !glsl ) {
+        return nullptr;
+    }
+    // Uniform arrays are reported as name[0]
+    set<string> active;
+    for( auto &it : glsl->getActiveUniforms() ) {
+        active.insert( it.mName.substr( 0, it.mName.find( '[' ) ) );
+    }
+    map<string, string> types;
+    regex declaration( "\\buniform\\s+(\\w+)\\s+(\\w+)\\s*;" );
+    for( sregex_iterator it( sources[1].begin(), sources[1].end(), declaration ), end; it != end; ++it ) {
+        types[( *it )[2]] = ( *it )[1];
+    }
+
+    ColorA background( 0.0f, 0.0f, 0.0f, 1.0f );
+    map<string, vector<float>> values;
+    try {
+        JsonTree tree( params );
+        for( auto &view : tree.getChild( "SUBVIEWS" ).getChildren() ) {
+            if( view.hasChild( "NAME" ) && view.hasChild( "TYPE" ) ) {
+                values[view.getValueForKey( "NAME" )] = getWidgetValues( view );
+            }
+        }
+    }
+    catch( const JsonTree::Exception &exc ) {
+        CI_LOG_W( "Thumbnail drawn with default params: " << exc.what() );
+    }
+    auto bg = values.find( "BACKGROUND COLOR" );
+    if( bg != values.end() && bg->second.size() == 4 ) {
+        background = ColorA( bg->second[0], bg->second[1], bg->second[2], bg->second[3] );
+    }
+
+    ivec2 size( mSize * kFrames, mSize );
+    auto fbo = gl::Fbo::create( size.x, size.y, gl::Fbo::Format().disableDepth() );
+    gl::ScopedFramebuffer scpFbo( fbo );
+    gl::ScopedGlslProg scpGlsl( glsl );
+    gl::ScopedMatrices scpMatrices;
+    gl::ScopedBlendAlpha scpBlend;
+    gl::clear( background );
+
+    for( auto &it : values ) {
+        auto type = types.find( it.first );
+        const vector<float> &v = it.second;
+        if( type == types.end() || v.empty() ) {
+            continue;
+        }
+        auto at = [&v]( size_t i ) { return i < v.size() ? v[i] : 0.0f; };
+        if( type->second == "float" ) {
+            setUniform( glsl, active, it.first, v[0] );
+        }
+        else if( type->second == "int" ) {
+            setUniform( glsl, active, it.first, int( v[0] ) );
+        }
+        else if( type->second == "bool" ) {
+            setUniform( glsl, active, it.first, v[0] > 0.5f );
+        }
+        else if( type->second == "vec2" ) {
+            setUniform( glsl, active, it.first, vec2( at( 0 ), at( 1 ) ) );
+        }
+        else if( type->second == "vec3" ) {
+            setUniform( glsl, active, it.first, vec3( at( 0 ), at( 1 ), at( 2 ) ) );
+        }
+        else if( type->second == "vec4" ) {
+            setUniform( glsl, active, it.first, vec4( at( 0 ), at( 1 ), at( 2 ), at( 3 ) ) );
+        }
+    }
+
+    // The camera EasyCamera starts with, and no audio
+    mat3 identity;
+    setUniform( glsl, active, "iBackgroundColor", background );
+    setUniform( glsl, active, "iResolution", vec3( mSize, mSize, 0.0f ) );
+    setUniform( glsl, active, "iAspect", 1.0f );
+    setUniform( glsl, active, "iMouse", vec4( 0.0f ) );
+    setUniform( glsl, active, "iDate", vec4( 0.0f ) );
+    setUniform( glsl, active, "iModelMatrix", identity );
+    setUniform( glsl, active, "iCameraViewMatrix", identity );
+    setUniform( glsl, active, "iCameraPivotPoint", vec3( 0.0f ) );
+    setUniform( glsl, active, "iCameraEyePoint", vec3( 0.0f, 0.0f, 1.0f ) );
+    setUniform( glsl, active, "iCameraFov", toRadians( environment.mFov ) );
+    setUniform( glsl, active, "iAudio", 1 );
+    if( environment.mPalettes ) {
+        setUniform( glsl, active, "iPalettes", 0 );
+        environment.mPalettes->bind( 0 );
+    }
+    if( active.count( "iPaletteTable" ) && !environment.mPaletteTable.empty() ) {
+        glsl->uniform( "iPaletteTable", environment.mPaletteTable.data(), int( environment.mPaletteTable.size() ) );
+    }
+    setUniform( glsl, active, "iPaletteCount", int( environment.mPaletteTable.size() ) );
+    if( environment.mNoiseTextures && environment.mNoiseTextures->isUploaded() ) {
+        environment.mNoiseTextures->bind( glsl, environment.mNoiseUnit );
+    }
+    else {
+        complete = !active.count( "iNoise2D" ) && !active.count( "iNoise3D" ) && !active.count( "iCellular2D" ) && !active.count( "iCellular3D" );
+    }
+
+    for( int i = 0; i < kFrames; i++ ) {
+        float time = float( i ) / float( kFrames );
+        setUniform( glsl, active, "iAnimationTime", time );
+        setUniform( glsl, active, "iGlobalTime", time * kSeconds );
+        {
+            gl::ScopedViewport scpViewport( ivec2( i * mSize, 0 ), ivec2( mSize ) );
+            gl::setMatricesWindow( ivec2( mSize ) );
+            gl::drawSolidRect( Rectf( 0.0f, 0.0f, float( mSize ), float( mSize ) ) );
+        }
+        glFlush();
+        this_thread::sleep_for( kYield );
+        unique_lock<mutex> lock( mMutex );
+        mCondition.wait( lock, [this] { return !mRunning || !mPaused; } );
+        if( !mRunning ) {
+            return nullptr;
+        }
+    }
+    return Surface8u::create( fbo->readPixels8u( fbo->getBounds() ) );
+}
+
+} // namespace thumb
+} // namespace reza
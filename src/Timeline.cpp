@@ -0,0 +1,371 @@
+#include "Timeline.h"
+
+#include "cinder/Json.h"
+#include "cinder/Log.h"
+#include "cinder/Utilities.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ci;
+using namespace std;
+
+namespace reza {
+namespace timeline {
+
+static const float kPi = 3.1415926536f;
+static const float kHalfPi = 1.5707963268f;
+static const float kTwoPi = 6.2831853072f;
+
+static const vector<pair<string, Ease>> &getEaseNames()
+{
+    static const vector<pair<string, Ease>> names = {
+        { "step", Ease::STEP },
+        { "linear", Ease::LINEAR },
+        { "inQuad", Ease::IN_QUAD },
+        { "outQuad", Ease::OUT_QUAD },
+        { "inOutQuad", Ease::IN_OUT_QUAD },
+        { "inCubic", Ease::IN_CUBIC },
+        { "outCubic", Ease::OUT_CUBIC },
+        { "inOutCubic", Ease::IN_OUT_CUBIC },
+        { "inQuart", Ease::IN_QUART },
+        { "outQuart", Ease::OUT_QUART },
+        { "inOutQuart", Ease::IN_OUT_QUART },
+        { "inQuint", Ease::IN_QUINT },
+        { "outQuint", Ease::OUT_QUINT },
+        { "inOutQuint", Ease::IN_OUT_QUINT },
+        { "inSine", Ease::IN_SINE },
+        { "outSine", Ease::OUT_SINE },
+        { "inOutSine", Ease::IN_OUT_SINE },
+        { "inExpo", Ease::IN_EXPO },
+        { "outExpo", Ease::OUT_EXPO },
+        { "inOutExpo", Ease::IN_OUT_EXPO },
+        { "inCirc", Ease::IN_CIRC },
+        { "outCirc", Ease::OUT_CIRC },
+        { "inOutCirc", Ease::IN_OUT_CIRC },
+        { "inElastic", Ease::IN_ELASTIC },
+        { "outElastic", Ease::OUT_ELASTIC },
+        { "inOutElastic", Ease::IN_OUT_ELASTIC },
+        { "inBack", Ease::IN_BACK },
+        { "outBack", Ease::OUT_BACK },
+        { "inOutBack", Ease::IN_OUT_BACK },
+        { "inBounce", Ease::IN_BOUNCE },
+        { "outBounce", Ease::OUT_BOUNCE },
+        { "inOutBounce", Ease::IN_OUT_BOUNCE }
+    };
+    return names;
+}
+
+Ease getEase( const string &name )
+{
+    for( auto &it : getEaseNames() ) {
+        if( it.first == name ) {
+            return it.second;
+        }
+    }
+    return Ease::LINEAR;
+}
+
+string getEaseName( Ease ease )
+{
+    for( auto &it : getEaseNames() ) {
+        if( it.second == ease ) {
+            return it.first;
+        }
+    }
+    return "linear";
+}
+
+static float outBounce( float t )
+{
+    if( t < ( 1.0f / 2.75f ) ) {
+        return 7.5625f * t * t;
+    }
+    else if( t < ( 2.0f / 2.75f ) ) {
+        t -= 1.5f / 2.75f;
+        return 7.5625f * t * t + 0.75f;
+    }
+    else if( t < ( 2.5f / 2.75f ) ) {
+        t -= 2.25f / 2.75f;
+        return 7.5625f * t * t + 0.9375f;
+    }
+    t -= 2.625f / 2.75f;
+    return 7.5625f * t * t + 0.984375f;
+}
+
+float ease( Ease type, float t )
+{
+    switch( type ) {
+    case Ease::STEP:
+        return t < 1.0f ? 0.0f : 1.0f;
+    case Ease::LINEAR:
+        return t;
+    case Ease::IN_QUAD:
+        return t * t;
+    case Ease::OUT_QUAD:
+        return -t * ( t - 2.0f );
+    case Ease::IN_OUT_QUAD:
+        t *= 2.0f;
+        if( t < 1.0f ) return 0.5f * t * t;
+        t -= 1.0f;
+        return -0.5f * ( t * ( t - 2.0f ) - 1.0f );
+    case Ease::IN_CUBIC:
+        return t * t * t;
+    case Ease::OUT_CUBIC:
+        t -= 1.0f;
+        return t * t * t + 1.0f;
+    case Ease::IN_OUT_CUBIC:
+        t *= 2.0f;
+        if( t < 1.0f ) return 0.5f * t * t * t;
+        t -= 2.0f;
+        return 0.5f * ( t * t * t + 2.0f );
+    case Ease::IN_QUART:
+        return t * t * t * t;
+    case Ease::OUT_QUART:
+        t -= 1.0f;
+        return -( t * t * t * t - 1.0f );
+    case Ease::IN_OUT_QUART:
+        t *= 2.0f;
+        if( t < 1.0f ) return 0.5f * t * t * t * t;
+        t -= 2.0f;
+        return -0.5f * ( t * t * t * t - 2.0f );
+    case Ease::IN_QUINT:
+        return t * t * t * t * t;
+    case Ease::OUT_QUINT:
+        t -= 1.0f;
+        return t * t * t * t * t + 1.0f;
+    case Ease::IN_OUT_QUINT:
+        t *= 2.0f;
+        if( t < 1.0f ) return 0.5f * t * t * t * t * t;
+        t -= 2.0f;
+        return 0.5f * ( t * t * t * t * t + 2.0f );
+    case Ease::IN_SINE:
+        return -cos( t * kHalfPi ) + 1.0f;
+    case Ease::OUT_SINE:
+        return sin( t * kHalfPi );
+    case Ease::IN_OUT_SINE:
+        return -0.5f * ( cos( kPi * t ) - 1.0f );
+    case Ease::IN_EXPO:
+        return t == 0.0f ? 0.0f : pow( 2.0f, 10.0f * ( t - 1.0f ) );
+    case Ease::OUT_EXPO:
+        return t == 1.0f ? 1.0f : -pow( 2.0f, -10.0f * t ) + 1.0f;
+    case Ease::IN_OUT_EXPO:
+        if( t == 0.0f ) return 0.0f;
+        if( t == 1.0f ) return 1.0f;
+        t *= 2.0f;
+        if( t < 1.0f ) return 0.5f * pow( 2.0f, 10.0f * ( t - 1.0f ) );
+        t -= 1.0f;
+        return 0.5f * ( -pow( 2.0f, -10.0f * t ) + 2.0f );
+    case Ease::IN_CIRC:
+        return -( sqrt( 1.0f - t * t ) - 1.0f );
+    case Ease::OUT_CIRC:
+        t -= 1.0f;
+        return sqrt( 1.0f - t * t );
+    case Ease::IN_OUT_CIRC:
+        t *= 2.0f;
+        if( t < 1.0f ) return -0.5f * ( sqrt( 1.0f - t * t ) - 1.0f );
+        t -= 2.0f;
+        return 0.5f * ( sqrt( 1.0f - t * t ) + 1.0f );
+    case Ease::IN_ELASTIC: {
+        if( t == 0.0f ) return 0.0f;
+        if( t == 1.0f ) return 1.0f;
+        float p = 0.3f;
+        float s = p / 4.0f;
+        t -= 1.0f;
+        return -( pow( 2.0f, 10.0f * t ) * sin( ( t - s ) * kTwoPi / p ) );
+    }
+    case Ease::OUT_ELASTIC: {
+        if( t == 0.0f ) return 0.0f;
+        if( t == 1.0f ) return 1.0f;
+        float p = 0.3f;
+        float s = p / 4.0f;
+        return pow( 2.0f, -10.0f * t ) * sin( ( t - s ) * kTwoPi / p ) + 1.0f;
+    }
+    case Ease::IN_OUT_ELASTIC: {
+        if( t == 0.0f ) return 0.0f;
+        t *= 2.0f;
+        if( t == 2.0f ) return 1.0f;
+        float p = 0.3f * 1.5f;
+        float s = p / 4.0f;
+        t -= 1.0f;
+        if( t < 0.0f ) return -0.5f * ( pow( 2.0f, 10.0f * t ) * sin( ( t - s ) * kTwoPi / p ) );
+        return pow( 2.0f, -10.0f * t ) * sin( ( t - s ) * kTwoPi / p ) * 0.5f + 1.0f;
+    }
+    case Ease::IN_BACK: {
+        float s = 1.70158f;
+        return t * t * ( ( s + 1.0f ) * t - s );
+    }
+    case Ease::OUT_BACK: {
+        float s = 1.70158f;
+        t -= 1.0f;
+        return t * t * ( ( s + 1.0f ) * t + s ) + 1.0f;
+    }
+    case Ease::IN_OUT_BACK: {
+        float s = 1.70158f * 1.525f;
+        t *= 2.0f;
+        if( t < 1.0f ) return 0.5f * ( t * t * ( ( s + 1.0f ) * t - s ) );
+        t -= 2.0f;
+        return 0.5f * ( t * t * ( ( s + 1.0f ) * t + s ) + 2.0f );
+    }
+    case Ease::IN_BOUNCE:
+        return 1.0f - outBounce( 1.0f - t );
+    case Ease::OUT_BOUNCE:
+        return outBounce( t );
+    case Ease::IN_OUT_BOUNCE:
+        if( t < 0.5f ) return ( 1.0f - outBounce( 1.0f - t * 2.0f ) ) * 0.5f;
+        return outBounce( t * 2.0f - 1.0f ) * 0.5f + 0.5f;
+    }
+    return t;
+}
+
+void Timeline::load( const fs::path &path )
+{
+    clear();
+    if( !fs::exists( path ) ) {
+        return;
+    }
+    try {
+        JsonTree tree( loadFile( path ) );
+        if( tree.hasChild( "RESOLUTION" ) ) {
+            setResolution( tree.getValueForKey<int>( "RESOLUTION" ) );
+        }
+        if( tree.hasChild( "TRACKS" ) ) {
+            for( auto &track : tree.getChild( "TRACKS" ) ) {
+                if( !track.hasChild( "NAME" ) || !track.hasChild( "KEYS" ) ) {
+                    continue;
+                }
+                string name = track.getValueForKey<string>( "NAME" );
+                for( auto &key : track.getChild( "KEYS" ) ) {
+                    Ease type = Ease::LINEAR;
+                    if( key.hasChild( "EASE" ) ) {
+                        type = getEase( key.getValueForKey<string>( "EASE" ) );
+                    }
+                    addKey( name, key.getValueForKey<float>( "TIME" ), key.getValueForKey<float>( "VALUE" ), type );
+                }
+            }
+        }
+    }
+    catch( const ci::Exception &exc ) {
+        CI_LOG_E( "Error loading timeline: " << path << " " << exc.what() );
+        clear();
+    }
+    compile();
+}
+
+void Timeline::save( const fs::path &path )
+{
+    JsonTree tree;
+    tree.addChild( JsonTree( "RESOLUTION", mResolution ) );
+    JsonTree tracks = JsonTree::makeArray( "TRACKS" );
+    for( auto &it : mTracks ) {
+        JsonTree track;
+        track.addChild( JsonTree( "NAME", it.mName ) );
+        JsonTree keys = JsonTree::makeArray( "KEYS" );
+        for( auto &k : it.mKeys ) {
+            JsonTree key;
+            key.addChild( JsonTree( "TIME", k.mTime ) );
+            key.addChild( JsonTree( "VALUE", k.mValue ) );
+            key.addChild( JsonTree( "EASE", getEaseName( k.mEase ) ) );
+            keys.pushBack( key );
+        }
+        track.addChild( keys );
+        tracks.pushBack( track );
+    }
+    tree.addChild( tracks );
+    tree.write( path );
+}
+
+void Timeline::addKey( const string &name, float time, float value, Ease ease )
+{
+    time = std::min( std::max( time, 0.0f ), 1.0f );
+    auto track = std::find_if( mTracks.begin(), mTracks.end(), [&name]( const Track &t ) { return t.mName == name; } );
+    if( track == mTracks.end() ) {
+        mTracks.push_back( Track() );
+        track = mTracks.end() - 1;
+        track->mName = name;
+    }
+
+    Key key = { time, value, ease };
+    auto &keys = track->mKeys;
+    auto it = std::lower_bound( keys.begin(), keys.end(), time, []( const Key &k, float t ) { return k.mTime < t; } );
+    if( it != keys.end() && fabs( it->mTime - time ) < 1e-5f ) {
+        *it = key;
+    }
+    else {
+        keys.insert( it, key );
+    }
+    mCompiled = false;
+}
+
+void Timeline::clear()
+{
+    mTracks.clear();
+    mSamples.clear();
+    mStepped.clear();
+    mCompiled = false;
+}
+
+void Timeline::setResolution( int resolution )
+{
+    mResolution = std::max( resolution, 2 );
+    mCompiled = false;
+}
+
+float Timeline::sample( const Track &track, float time ) const
+{
+    const auto &keys = track.mKeys;
+    if( keys.empty() ) {
+        return 0.0f;
+    }
+    if( time <= keys.front().mTime ) {
+        return keys.front().mValue;
+    }
+    if( time >= keys.back().mTime ) {
+        return keys.back().mValue;
+    }
+    auto next = std::upper_bound( keys.begin(), keys.end(), time, []( float t, const Key &k ) { return t < k.mTime; } );
+    auto prev = next - 1;
+    float span = next->mTime - prev->mTime;
+    float t = span > 0.0f ? ( time - prev->mTime ) / span : 1.0f;
+    return prev->mValue + ( next->mValue - prev->mValue ) * ease( prev->mEase, t );
+}
+
+void Timeline::compile()
+{
+    // One row of mResolution + 1 samples per track, laid out back to back, so
+    // evaluating hundreds of tracks walks a single contiguous buffer.
+    size_t stride = size_t( mResolution ) + 1;
+    mSamples.resize( mTracks.size() * stride );
+    mStepped.assign( mTracks.size(), 0 );
+    for( size_t i = 0; i < mTracks.size(); i++ ) {
+        for( auto &it : mTracks[i].mKeys ) {
+            mStepped[i] |= it.mEase == Ease::STEP ? 1 : 0;
+        }
+        float *row = &mSamples[i * stride];
+        for( size_t s = 0; s < stride; s++ ) {
+            row[s] = sample( mTracks[i], float( s ) / float( mResolution ) );
+        }
+    }
+    mCompiled = true;
+}
+
+void Timeline::evaluate( float time, float *results ) const
+{
+    if( !mCompiled ) {
+        return;
+    }
+    float position = std::min( std::max( time, 0.0f ), 1.0f ) * float( mResolution );
+    size_t index = std::min( size_t( position ), size_t( mResolution - 1 ) );
+    float fraction = position - float( index );
+    size_t stride = size_t( mResolution ) + 1;
+    size_t total = mTracks.size();
+    const float *row = mSamples.data() + index;
+    for( size_t i = 0; i < total; i++, row += stride ) {
+        // Lerping the table would turn a step into a ramp one sample wide, so tracks with
+        // steps are looked up from their keys instead
+        results[i] = mStepped[i] ? sample( mTracks[i], time ) : row[0] + ( row[1] - row[0] ) * fraction;
+    }
+}
+
+} // namespace timeline
+} // namespace reza